@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file           : alarm.h
+  * @brief          : Overspeed, stall, reversal, position window and sensor
+  *                   fault detection in the acquisition path.
+  *
+  *  Alarm_Check() runs on every sample right after the pipeline, on the
+  *  calibrated multi-turn position, so a condition is seen on the sample
+  *  that shows it:
+  *
+  *    overspeed  |speed| above the limit, speed being the travel over the
+  *               last ALARM_SPEED_SPAN samples (half of that as delay)
+  *    stall      |speed| below the stall speed for stall_ms after having
+  *               been above it
+  *    reversal   travel of more than reversal_counts back from the furthest
+  *               position in the established direction
+  *    window     position outside [window_min, window_max] counts
+  *    sensor     read_errors RAW ANGLE reads failed in a row, reported by
+  *               Alarm_ReadError() in place of the sample
+  *
+  *  Conditions are active while they hold, a reversal for the sample it is
+  *  detected on, a sensor fault until the next good reading. With latch
+  *  they stay set in latched until Alarm_Clear(); a sensor fault always
+  *  latches.
+  *  The alarm output is active | latched.
+  ******************************************************************************
+  */
+
+#ifndef __ALARM_H
+#define __ALARM_H
+
+#include <stdint.h>
+
+#define ALARM_OVERSPEED   0x01U
+#define ALARM_STALL       0x02U
+#define ALARM_REVERSAL    0x04U
+#define ALARM_WINDOW      0x08U
+#define ALARM_SENSOR      0x10U
+#define ALARM_KINDS       5U
+
+#define ALARM_SPEED_SPAN  8U   /* samples, power of two */
+#define ALARM_WINDOW_MAX  (INT32_MAX / 16)   /* |window| in counts, Q4 fits */
+
+typedef struct
+{
+  uint16_t overspeed_rpm;  /* 0 = off */
+  uint16_t stall_rpm;      /* 0 = off */
+  uint16_t stall_ms;
+  uint16_t reversal_counts;   /* 0 = off */
+  int32_t  window_min;     /* counts, window_min >= window_max = off */
+  int32_t  window_max;
+  uint8_t  latch;
+  uint8_t  read_errors;    /* failed reads in a row, 0 = off */
+} Alarm_ConfigTypeDef;
+
+typedef struct
+{
+  Alarm_ConfigTypeDef cfg;
+  uint32_t sample_us;
+  /* limits in Q4 counts per ALARM_SPEED_SPAN samples and in samples */
+  int32_t  overspeed;
+  int32_t  stall;
+  uint32_t stall_samples;
+  int32_t  reversal;       /* Q4 */
+  int32_t  ring[ALARM_SPEED_SPAN];
+  uint8_t  idx;
+  uint8_t  fill;
+  int32_t  speed;          /* last estimate, Q4 counts per span */
+  uint8_t  running;        /* above the stall speed since the last stall */
+  uint32_t slow;           /* samples below it */
+  int8_t   dir;            /* established direction, 0 = none yet */
+  int32_t  extreme;        /* furthest position in it, or the start */
+  uint8_t  fails;          /* failed reads in a row, up to read_errors */
+  uint8_t  active;
+  uint8_t  latched;
+  uint32_t events[ALARM_KINDS];
+} Alarm_TypeDef;
+
+int     Alarm_Init(Alarm_TypeDef *a, const Alarm_ConfigTypeDef *cfg, uint32_t sample_us);
+uint8_t Alarm_Check(Alarm_TypeDef *a, int32_t pos);
+uint8_t Alarm_ReadError(Alarm_TypeDef *a);
+void    Alarm_Clear(Alarm_TypeDef *a);
+int32_t Alarm_SpeedCrpm(const Alarm_TypeDef *a);
+
+/**
+  * @brief  Alarm output level.
+  * @retval ALARM_xxx bits active or latched, 0 = no alarm
+  */
+static inline uint8_t Alarm_Output(const Alarm_TypeDef *a)
+{
+  return (uint8_t)(a->active | a->latched);
+}
+
+#endif /* __ALARM_H */
@@ -0,0 +1,272 @@
+/**
+  ******************************************************************************
+  * @file           : app.h
+  * @brief          : Application tasks run by the cooperative scheduler.
+  ******************************************************************************
+  */
+
+#ifndef __APP_H
+#define __APP_H
+
+#include <stdint.h>
+#include "alarm.h"
+#include "commut.h"
+#include "decim.h"
+#include "median.h"
+#include "order.h"
+#include "oversample.h"
+#include "pipeline.h"
+#include "revstat.h"
+#include "servo.h"
+#include "spectrum.h"
+
+/* task periods */
+#define APP_SAMPLE_PERIOD_US     1000U    /* raw angle, 1 kHz */
+#define APP_TELEMETRY_PERIOD_US  10000U   /* output flush, 100 Hz */
+#define APP_HEALTH_PERIOD_US     100000U  /* magnet health, 10 Hz */
+#define APP_LOG_PERIOD_US        50000U   /* deferred log drain, 20 Hz */
+#define APP_BUTTON_PERIOD_US     50000U   /* user button poll, 20 Hz */
+#define APP_RX_PERIOD_US         5000U    /* USART2 frame reception, 200 Hz */
+
+typedef struct
+{
+  uint16_t raw;            /* last RAW ANGLE register value */
+  uint32_t samples;        /* successful reads */
+  uint32_t i2c_errors;     /* failed reads */
+  uint8_t  magnet;         /* AMS5600_getMagnetStrength() code */
+  uint8_t  agc;            /* AGC register */
+  uint8_t  status;         /* APP_STATUS_xxx */
+  Pipeline_OutTypeDef out; /* pipeline outputs of the last sample */
+  int32_t  decim;          /* last decimator output (decim.h), Q4 */
+  int32_t  comp;           /* out.pos carried forward by its age (lagcomp.h), Q4 */
+  uint16_t angle16;        /* raw angle, 16-bit of a turn, the burst mean when oversampling */
+  uint16_t noise;          /* its noise estimate (oversample.h), Q4 counts, 0 = single read */
+} App_StateTypeDef;
+
+#define APP_STATUS_MAGNET      0x03U   /* magnet code as above */
+#define APP_STATUS_READ_ERROR  0x80U   /* last raw angle read failed */
+
+/* raw angle provider of the sample task, AMS5600_getRawAngle() by default */
+typedef uint8_t (*App_SourceFn)(uint16_t *raw);
+
+/* telemetry output */
+typedef enum
+{
+  APP_OUT_OFF = 0,
+  APP_OUT_TEXT,            /* one text line per telemetry period */
+  APP_OUT_BINARY,          /* one OUTPUT frame (telemetry.h) per period */
+  APP_OUT_STREAM           /* every raw sample, compressed (stream.h) */
+} App_OutFormatTypeDef;
+
+#define APP_FIELD_RAW      0x01U   /* raw angle, counts */
+#define APP_FIELD_ANGLE    0x02U   /* angle16, text: degrees (and noise when
+                                      oversampling), binary: u16 centidegrees */
+#define APP_FIELD_POS      0x04U   /* pipeline position, Q4 */
+#define APP_FIELD_FILT     0x08U   /* filtered position, Q4 */
+#define APP_FIELD_VEL      0x10U   /* velocity, Q4 counts per sample */
+#define APP_FIELD_HEALTH   0x20U   /* magnet and AGC, text: when refreshed */
+#define APP_FIELD_EVENT    0x40U   /* DEADBAND_xxx reasons (deadband.h), text: event mode only */
+#define APP_FIELD_DECIM    0x80U   /* decimated position, Q4 */
+#define APP_FIELD_COMP     0x100U  /* latency compensated position (lagcomp.h), Q4 */
+#define APP_FIELD_ALL      0x1FFU
+#define APP_FIELDS_DEFAULT (APP_FIELD_RAW | APP_FIELD_ANGLE | APP_FIELD_HEALTH)
+
+/* OUTPUT frame with every field */
+#define APP_OUTPUT_FRAME_LEN  33U
+
+/* block spectrum (spectrum.h), one per block while enabled: a text line, or
+   in the binary and stream formats a SPECTRUM frame (telemetry.h) of
+   u32 block, u16 n, u32 sample period us, SPECTRUM_TOP_K times u16 bin_q4
+   and u32 amp_mc, SPECTRUM_BANDS times u32 band_mc2, u32 cycles */
+#define APP_SPECTRUM_FRAME_LEN  (14U + 6U * SPECTRUM_TOP_K + 4U * SPECTRUM_BANDS)
+
+/* order tracking (order.h), the latest revolution result once per telemetry
+   period while enabled: a text line, or in the binary and stream formats an
+   ORDER frame (telemetry.h) of u32 revolution, u32 period us, u16 samples,
+   u8 orders, then u32 amp_mc per order */
+#define APP_ORDER_FRAME_LEN(k)  (11U + 4U * (k))
+
+/* revolution statistics (revstat.h), every record while enabled, queued for
+   the telemetry task: a text line, or in the binary and stream formats a
+   REVOLUTION frame (telemetry.h) of u32 revolution, u32 period us,
+   i32 speed 1/100 rpm, u32 ripple 1/100 rpm, i32 min and max acceleration
+   rpm/s, u16 samples */
+#define APP_REVSTAT_FRAME_LEN  26U
+#define APP_REVSTAT_QUEUE      16U
+
+/* alarm events (alarm.h), raised in the sample task right after the
+   pipeline together with ALARM_Pin, queued for the telemetry task: a text
+   line, or in the binary and stream formats an ALARM frame (telemetry.h) of
+   u32 tick ms, u32 sample, u8 raised ALARM_xxx, u8 output ALARM_xxx,
+   i32 position Q4, i32 speed 1/100 rpm, u32 latency ns. The latency runs
+   from the start of the offending read to the pin written */
+#define APP_ALARM_FRAME_LEN  22U
+#define APP_ALARM_QUEUE      8U
+
+typedef struct
+{
+  uint32_t tick_ms;
+  uint32_t sample;
+  uint8_t  raised;
+  uint8_t  output;
+  int32_t  pos;
+  int32_t  speed_crpm;
+  uint32_t latency_ns;
+} App_AlarmRecordTypeDef;
+
+typedef struct
+{
+  uint8_t  output;
+  uint8_t  latched;
+  uint32_t events;
+  uint32_t overflows;      /* records lost to a full queue */
+  uint32_t latency_last_ns;
+  uint32_t latency_max_ns;
+  uint32_t latency_mean_ns;
+} App_AlarmStatsTypeDef;
+
+/* encoder emulation (quad.h): the latency runs from the start of a read to
+   the first edge planned for it */
+typedef struct
+{
+  uint16_t ppr;
+  int32_t  pos;            /* output position, edges */
+  uint32_t limited;        /* samples cut to the edge rate limit */
+  uint32_t dropped;        /* edges given up */
+  uint32_t late;           /* edges behind their interval */
+  uint32_t latency_last_ns;
+  uint32_t latency_max_ns;
+  uint32_t latency_mean_ns;
+} App_QuadStatsTypeDef;
+
+/* position servo (servo.h), run by the TIM4 interrupt: while it runs the
+   loop owns the I2C bus, the sample task takes its readings, the health
+   reads, register accesses and captures wait. After APP_SERVO_FAULT_READS
+   failed reads in a row the output goes to 0 until a read succeeds, then
+   the controller restarts from there. Jitter is the largest deviation of
+   the loop entry from its period */
+#define APP_SERVO_LOOP_MIN_US  250U
+#define APP_SERVO_FAULT_READS  3U
+
+typedef struct
+{
+  uint32_t loop_us;        /* 0 = off */
+  uint32_t loops;
+  int32_t  target;         /* Q4 counts, continued across turns */
+  int32_t  pos;
+  int32_t  setpoint;
+  int32_t  out;            /* Q15 of full scale */
+  uint32_t overruns;       /* loops longer than the period or missed */
+  uint32_t read_errors;
+  uint32_t saturated;      /* loops at full output */
+  uint32_t jitter_max_ns;
+  uint32_t isr_last_cycles;
+  uint32_t isr_max_cycles;
+  uint32_t isr_mean_cycles;
+} App_ServoStatsTypeDef;
+
+/* commutation angle (commut.h), fed by the sample task with the time
+   stamped readings, asked for by the current loop at any time */
+#define APP_COMMUT_VEL_SHIFT  2U
+
+/* latency compensation (lagcomp.h): the position of each sample carried
+   forward to the time it is computed, in app.comp */
+typedef struct
+{
+  uint8_t  enabled;
+  uint16_t conf;           /* CONF the delay model is for */
+  int32_t  sensor_ns;      /* model delay at the last sample's speed */
+  uint32_t age_ns;         /* age of the last sample, read start and model */
+  uint32_t age_max_ns;
+  int32_t  pos;            /* Q4, uncompensated */
+  int32_t  comp;
+} App_LagCompStatsTypeDef;
+
+/* oversampling (oversample.h): readings per sample and the last burst */
+typedef struct
+{
+  uint16_t n;              /* 1 = off */
+  Oversample_OutTypeDef last;
+  uint32_t bursts;
+  uint32_t bus_ns;         /* wire time of one burst */
+} App_OversampleStatsTypeDef;
+
+/* glitch filter (median.h): configuration and counters */
+typedef struct
+{
+  uint8_t  window;         /* 0 = off */
+  uint8_t  k;              /* tenths of sigma */
+  uint16_t floor;          /* counts */
+  uint32_t samples;
+  uint32_t outliers;
+  uint32_t resyncs;
+  int16_t  med;            /* median speed, counts per sample */
+  uint16_t thr;            /* threshold, counts */
+} App_MedianStatsTypeDef;
+
+typedef struct
+{
+  uint8_t  enabled;
+  uint32_t revolutions;
+  uint32_t aborts;         /* revolutions abandoned at the zero or too long */
+  uint32_t overflows;      /* records lost to a full queue */
+} App_RevStatsTypeDef;
+
+#define APP_SAMPLE_PERIOD_MIN_US  250U
+#define APP_PERIOD_MAX_US         1000000U
+
+/* change-driven output, samples waiting for the telemetry task */
+#define APP_EVENT_QUEUE           16U
+#define APP_EVENT_HEARTBEAT_MAX_MS  60000U
+
+typedef struct
+{
+  uint32_t checked;        /* samples seen in event mode */
+  uint32_t suppressed;     /* samples not output */
+  uint32_t moves;          /* outputs for leaving the deadband */
+  uint32_t status_changes;
+  uint32_t heartbeats;
+  uint32_t overflows;      /* outputs lost to a full queue */
+} App_EventStatsTypeDef;
+
+void App_Init(void);
+const App_StateTypeDef *App_GetState(void);
+void App_SetSampleSource(App_SourceFn fn);
+int  App_SetOutput(App_OutFormatTypeDef format, uint16_t fields);
+int  App_SetPeriods(uint32_t sample_us, uint32_t telemetry_us);
+int  App_SetFilter(uint8_t filter_shift, uint8_t vel_shift);
+int  App_SetEventMode(uint8_t enable, uint16_t deadband, uint32_t heartbeat_ms);
+void App_GetEventStats(App_EventStatsTypeDef *stats);
+int  App_SetDecimation(Decim_KindTypeDef kind, uint8_t ratio, uint8_t param);
+const Decim_TypeDef *App_GetDecimation(void);
+uint32_t App_GetSamplePeriod(void);
+int  App_SetSpectrum(uint16_t n);
+const Spectrum_TypeDef *App_GetSpectrum(void);
+int  App_SetOrder(uint16_t points, uint8_t orders);
+const Order_TypeDef *App_GetOrder(void);
+int  App_SetRevStat(uint8_t enable, uint16_t hysteresis, uint8_t acc_shift);
+void App_GetRevStats(App_RevStatsTypeDef *stats);
+int  App_SetAlarm(const Alarm_ConfigTypeDef *cfg);
+void App_ClearAlarm(void);
+void App_GetAlarmStats(App_AlarmStatsTypeDef *stats);
+int  App_SetQuad(uint16_t ppr, uint32_t max_hz);
+void App_GetQuadStats(App_QuadStatsTypeDef *stats);
+void App_QuadEdge(void);
+int  App_SetServo(uint32_t loop_us, const Servo_ConfigTypeDef *cfg);
+int  App_ServoMove(int32_t target, uint32_t vel_max, uint32_t acc_max);
+void App_GetServoStats(App_ServoStatsTypeDef *stats);
+uint32_t App_GetServoPeriod(void);
+void App_ServoLoop(void);
+int  App_SetCommut(uint8_t pole_pairs, uint16_t offset, uint32_t lead_us);
+int  App_CommutAlign(uint16_t samples);
+const Commut_TypeDef *App_GetCommut(void);
+void App_GetElectrical(Commut_OutTypeDef *out);
+int  App_SetLagComp(uint8_t enable, int32_t trim_us);
+void App_ConfChanged(void);
+void App_GetLagCompStats(App_LagCompStatsTypeDef *stats);
+int  App_SetOversample(uint16_t n);
+void App_GetOversampleStats(App_OversampleStatsTypeDef *stats);
+int  App_SetMedian(uint8_t window, uint8_t k, uint16_t floor);
+void App_GetMedianStats(App_MedianStatsTypeDef *stats);
+
+#endif /* __APP_H */
@@ -0,0 +1,365 @@
+/**
+  ******************************************************************************
+  * @file           : app_config.h
+  * @brief          : Build-time switches of the application.
+  *                   Every switch can be overridden from the compiler command
+  *                   line (-DNAME=value), the values below are the defaults.
+  ******************************************************************************
+  */
+
+#ifndef __APP_CONFIG_H
+#define __APP_CONFIG_H
+
+/**
+ * @brief DWT cycle-counter profiling of the named regions (profiler.h).
+ * Set to 0 to compile every PROF_xxx macro out.
+ */
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+/**
+ * @brief Acquisition mode (lowpower.h): LP_MODE_RUN (0) runs the scheduler,
+ * LP_MODE_SLEEP (1) / LP_MODE_STOP (2) sleep the MCU between two samples
+ * taken every APP_LOWPOWER_PERIOD_US.
+ */
+#ifndef APP_LOWPOWER_MODE
+#define APP_LOWPOWER_MODE 0
+#endif
+
+#ifndef APP_LOWPOWER_PERIOD_US
+#define APP_LOWPOWER_PERIOD_US 100000U
+#endif
+
+/**
+ * @brief Run the wake-to-sample latency sweep of every Sleep/Stop and
+ * AS5600 LPM combination at boot, APP_LOWPOWER_SWEEP samples each.
+ */
+#ifndef APP_LOWPOWER_SWEEP
+#define APP_LOWPOWER_SWEEP 0
+#endif
+
+/**
+ * @brief Arm a scope-mode capture (capture.h) at boot, triggered by a
+ * sample-to-sample jump of at least APP_CAPTURE_AT_BOOT counts.
+ */
+#ifndef APP_CAPTURE_AT_BOOT
+#define APP_CAPTURE_AT_BOOT 0
+#endif
+
+/**
+ * @brief Print the bus benchmark table (busbench.h) at boot,
+ * APP_BUSBENCH samples per read path.
+ */
+#ifndef APP_BUSBENCH
+#define APP_BUSBENCH 0
+#endif
+
+/**
+ * @brief Print the spectrum benchmark table (specbench.h) at boot,
+ * APP_SPECBENCH blocks per row.
+ */
+#ifndef APP_SPECBENCH
+#define APP_SPECBENCH 0
+#endif
+
+/**
+ * @brief Print the servo benchmark table (servobench.h) at boot,
+ * APP_SERVOBENCH runs per case.
+ */
+#ifndef APP_SERVOBENCH
+#define APP_SERVOBENCH 0
+#endif
+
+/**
+ * @brief Print the commutation benchmark table (commutbench.h) at boot,
+ * APP_COMMUTBENCH sensor readings per speed.
+ */
+#ifndef APP_COMMUTBENCH
+#define APP_COMMUTBENCH 0
+#endif
+
+/**
+ * @brief Print the oversampling benchmark table (oversamplebench.h) at boot,
+ * APP_OVERSAMPLEBENCH readings per row, with the shaft standing.
+ */
+#ifndef APP_OVERSAMPLEBENCH
+#define APP_OVERSAMPLEBENCH 0
+#endif
+
+/**
+ * @brief Print the glitch filter benchmark table (medianbench.h) at boot,
+ * APP_MEDIANBENCH readings per row.
+ */
+#ifndef APP_MEDIANBENCH
+#define APP_MEDIANBENCH 0
+#endif
+
+/**
+ * @brief Run the sample-rate sweep (ratesweep.h) at boot with this window
+ * per rate step in ms. Holding the user button during reset runs it too,
+ * with RATESWEEP_DEFAULT_MS.
+ */
+#ifndef APP_RATESWEEP_MS
+#define APP_RATESWEEP_MS 0
+#endif
+
+/**
+ * @brief Record the raw sample stream and pipeline output hashes as binary
+ * frames (recorder.h) for replay on a workstation. Replaces the text lines.
+ */
+#ifndef APP_RECORD
+#define APP_RECORD 0
+#endif
+
+/**
+ * @brief Accept trajectory injection (hil.h) over USART2 RX: the first
+ * HIL_DATA frame replaces the I2C read of the sample task.
+ */
+#ifndef APP_HIL
+#define APP_HIL 0
+#endif
+
+/**
+ * @brief Start in change-driven output (deadband.h): a sample goes out when
+ * it moved more than APP_EVENT_DEADBAND counts, the magnet or read status
+ * changed, or nothing was sent for APP_EVENT_HEARTBEAT_MS.
+ */
+#ifndef APP_EVENT_OUTPUT
+#define APP_EVENT_OUTPUT 0
+#endif
+
+#ifndef APP_EVENT_DEADBAND
+#define APP_EVENT_DEADBAND 4U
+#endif
+
+#ifndef APP_EVENT_HEARTBEAT_MS
+#define APP_EVENT_HEARTBEAT_MS 1000U
+#endif
+
+/**
+ * @brief Decimation stage (decim.h) at boot: 0 off, 1 CIC, 2 FIR, with
+ * APP_DECIM_RATIO and APP_DECIM_PARAM (CIC order or FIR taps, 0 = default).
+ */
+#ifndef APP_DECIM
+#define APP_DECIM 0
+#endif
+
+#ifndef APP_DECIM_RATIO
+#define APP_DECIM_RATIO 8U
+#endif
+
+#ifndef APP_DECIM_PARAM
+#define APP_DECIM_PARAM 0U
+#endif
+
+/**
+ * @brief Vibration spectrum (spectrum.h): block length at boot, 0 = off, and
+ * the analysis steps per job of the spectrum task, which runs in the slack
+ * of the sample task.
+ */
+#ifndef APP_SPECTRUM_N
+#define APP_SPECTRUM_N 0U
+#endif
+
+#ifndef APP_SPECTRUM_PERIOD_US
+#define APP_SPECTRUM_PERIOD_US 1000U
+#endif
+
+#ifndef APP_SPECTRUM_STEPS
+#define APP_SPECTRUM_STEPS 256U
+#endif
+
+/**
+ * @brief Order tracking (order.h): grid points per revolution at boot,
+ * 0 = off, orders reported, and the longest revolution tracked, below the
+ * ~51 s wrap of the DWT time stamps.
+ */
+#ifndef APP_ORDER_POINTS
+#define APP_ORDER_POINTS 0U
+#endif
+
+#ifndef APP_ORDER_ORDERS
+#define APP_ORDER_ORDERS 8U
+#endif
+
+#ifndef APP_ORDER_MAX_REV_MS
+#define APP_ORDER_MAX_REV_MS 10000U
+#endif
+
+/**
+ * @brief Per-revolution statistics records (revstat.h) at boot, 0 = off,
+ * hysteresis at the zero in counts, acceleration low-pass shift and the
+ * longest revolution counted.
+ */
+#ifndef APP_REVSTAT
+#define APP_REVSTAT 0
+#endif
+
+#ifndef APP_REVSTAT_HYST
+#define APP_REVSTAT_HYST 32U
+#endif
+
+#ifndef APP_REVSTAT_ACC_SHIFT
+#define APP_REVSTAT_ACC_SHIFT 4U
+#endif
+
+#ifndef APP_REVSTAT_MAX_REV_MS
+#define APP_REVSTAT_MAX_REV_MS 10000U
+#endif
+
+/**
+ * @brief Alarm limits at boot (alarm.h), 0 = off: overspeed and stall speed
+ * in rpm, stall time, reversal travel in counts, position window in counts
+ * (off while min >= max), whether alarms latch until cleared, and the RAW
+ * ANGLE reads failed in a row that raise a (latched) sensor fault. The alarm
+ * output is ALARM_Pin (PA10, Arduino D2), high while an alarm is set.
+ */
+#ifndef APP_ALARM_OVERSPEED_RPM
+#define APP_ALARM_OVERSPEED_RPM 0U
+#endif
+
+#ifndef APP_ALARM_STALL_RPM
+#define APP_ALARM_STALL_RPM 0U
+#endif
+
+#ifndef APP_ALARM_STALL_MS
+#define APP_ALARM_STALL_MS 200U
+#endif
+
+#ifndef APP_ALARM_REVERSAL_COUNTS
+#define APP_ALARM_REVERSAL_COUNTS 0U
+#endif
+
+#ifndef APP_ALARM_WINDOW_MIN
+#define APP_ALARM_WINDOW_MIN 0
+#endif
+
+#ifndef APP_ALARM_WINDOW_MAX
+#define APP_ALARM_WINDOW_MAX 0
+#endif
+
+#ifndef APP_ALARM_LATCH
+#define APP_ALARM_LATCH 1U
+#endif
+
+#ifndef APP_ALARM_READ_ERRORS
+#define APP_ALARM_READ_ERRORS 8U
+#endif
+
+/**
+ * @brief Encoder emulation at boot (quad.h): lines per revolution, 0 = off,
+ * and the highest edge rate the receiver takes. A, B and Z are QUAD_A_Pin
+ * (PB4, Arduino D5), QUAD_B_Pin (PB5, D4) and QUAD_Z_Pin (PB10, D6), edges
+ * timed by TIM2.
+ */
+#ifndef APP_QUAD_PPR
+#define APP_QUAD_PPR 0U
+#endif
+
+#ifndef APP_QUAD_MAX_HZ
+#define APP_QUAD_MAX_HZ 100000U
+#endif
+
+/**
+ * @brief Position servo at boot (servo.h): loop period in us, 0 = off, run
+ * by the TIM4 interrupt, PWM on SERVO_PWM_Pin (PA6, Arduino D12, TIM3_CH1,
+ * 20 kHz) and direction on SERVO_DIR_Pin (PA7, D11). The gains (Q16, see
+ * servo.h) are for a 1 kHz loop and the motor of servobench.h; the
+ * trajectory limits (Q4 counts per s and s^2) bound the way back to the
+ * held position after a sensor fault, moves bring their own.
+ */
+#ifndef APP_SERVO_LOOP_US
+#define APP_SERVO_LOOP_US 0U
+#endif
+
+#ifndef APP_SERVO_KP
+#define APP_SERVO_KP 600000
+#endif
+
+#ifndef APP_SERVO_KI
+#define APP_SERVO_KI 20000
+#endif
+
+#ifndef APP_SERVO_KD
+#define APP_SERVO_KD 4000000
+#endif
+
+#ifndef APP_SERVO_KV
+#define APP_SERVO_KV 655360
+#endif
+
+#ifndef APP_SERVO_KA
+#define APP_SERVO_KA 13107200
+#endif
+
+#ifndef APP_SERVO_D_SHIFT
+#define APP_SERVO_D_SHIFT 2U
+#endif
+
+#ifndef APP_SERVO_OUT_MAX
+#define APP_SERVO_OUT_MAX 32767
+#endif
+
+#ifndef APP_SERVO_VEL
+#define APP_SERVO_VEL 1310720U
+#endif
+
+#ifndef APP_SERVO_ACC
+#define APP_SERVO_ACC 13107200U
+#endif
+
+/**
+ * @brief Electrical angle for commutation at boot (commut.h): pole pairs of
+ * the motor, 0 = off, the electrical offset of its d axis (Q16 of a turn, as
+ * found by an alignment, PERF page 12) and the lead added to the age of each
+ * reading for the sensor's own delay, in us (PERF page 13 has the modelled
+ * one).
+ */
+#ifndef APP_COMMUT_POLE_PAIRS
+#define APP_COMMUT_POLE_PAIRS 0U
+#endif
+
+#ifndef APP_COMMUT_OFFSET
+#define APP_COMMUT_OFFSET 0U
+#endif
+
+#ifndef APP_COMMUT_LEAD_US
+#define APP_COMMUT_LEAD_US 0U
+#endif
+
+/**
+ * @brief Latency compensation of the position at boot (lagcomp.h), 0 = off,
+ * and the trim added to the modelled sample age, in us.
+ */
+#ifndef APP_LAGCOMP
+#define APP_LAGCOMP 0U
+#endif
+
+#ifndef APP_LAGCOMP_TRIM_US
+#define APP_LAGCOMP_TRIM_US 0
+#endif
+
+/**
+ * @brief RAW ANGLE readings averaged per sample at boot (oversample.h),
+ * 1 = single reads. The burst must fit in half the sample period.
+ */
+#ifndef APP_OVERSAMPLE_N
+#define APP_OVERSAMPLE_N 1U
+#endif
+
+/**
+ * @brief Glitch filter at boot (median.h): window of steps, 0 = off, the
+ * threshold in tenths of sigma and its floor in counts.
+ */
+#ifndef APP_MEDIAN_WINDOW
+#define APP_MEDIAN_WINDOW 0U
+#endif
+#ifndef APP_MEDIAN_K
+#define APP_MEDIAN_K 30U
+#endif
+#ifndef APP_MEDIAN_FLOOR
+#define APP_MEDIAN_FLOOR 8U
+#endif
+
+#endif /* __APP_CONFIG_H */
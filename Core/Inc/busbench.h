@@ -0,0 +1,27 @@
+/**
+  ******************************************************************************
+  * @file           : busbench.h
+  * @brief          : Bus-level benchmark of the AS5600 read paths.
+  *
+  *  Every path is run for a number of samples while the platform layer counts
+  *  transactions, repeated STARTs and bytes on the wire (address bytes
+  *  included). The counts are turned into bus time at 100, 400 and 1000 kHz
+  *  with the I2C-bus specification minimum START/STOP/bus-free timings, so
+  *  the 1 MHz row is a model only (the F411 I2C has no Fast-mode Plus).
+  *  CPU cycles per sample are measured with the DWT at the clock hi2c1 runs
+  *  at; on target they include the polling wait for the bus.
+  *
+  *  One CSV row per path and bus clock:
+  *    path,values,meas_khz,clock_khz,samples,trans_per_sample,
+  *    bytes_per_sample,bus_ns_per_sample,max_rate_hz,cycles_per_sample,errors
+  ******************************************************************************
+  */
+
+#ifndef __BUSBENCH_H
+#define __BUSBENCH_H
+
+#include <stdint.h>
+
+void BusBench_Run(uint32_t samples);
+
+#endif /* __BUSBENCH_H */
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file           : capture.h
+  * @brief          : Pre/post-trigger capture of raw angle bursts ("scope mode").
+  *
+  *  Capture_Run() reads RAW ANGLE back to back at the full I2C rate into a
+  *  circular RAM buffer until the trigger fires and the post-trigger samples
+  *  are in. The loop never touches the UART, the buffer is drained afterwards
+  *  by Capture_Drain() through the telemetry writer:
+  *
+  *    CAP,<samples>,<pre>,<period_ns>,<errors>
+  *    <index relative to trigger>,<raw>
+  *    ...
+  *    CAP,END
+  ******************************************************************************
+  */
+
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#include <stdint.h>
+#include "main.h"
+
+/* 72 KB of the 128 KB SRAM */
+#ifndef CAPTURE_BUFFER_SAMPLES
+#define CAPTURE_BUFFER_SAMPLES  36864U
+#endif
+
+/* the armed wait blocks the sample task, it has to end */
+#define CAPTURE_TIMEOUT_MAX_MS  10000U
+
+#define CAPTURE_FLAG_ERROR      0x8000U  /* I2C read failed, angle repeated */
+
+typedef enum
+{
+  CAPTURE_TRIG_IMMEDIATE = 0,  /* trigger as soon as the pre-trigger history is full */
+  CAPTURE_TRIG_RISING,         /* raw angle crosses level upwards */
+  CAPTURE_TRIG_FALLING,        /* raw angle crosses level downwards */
+  CAPTURE_TRIG_VELOCITY,       /* |sample-to-sample delta| >= velocity counts */
+  CAPTURE_TRIG_GPIO            /* gpio_pin reads gpio_state */
+} Capture_TriggerTypeDef;
+
+typedef enum
+{
+  CAPTURE_IDLE = 0,
+  CAPTURE_ARMED,
+  CAPTURE_DONE,
+  CAPTURE_DRAINING
+} Capture_StateTypeDef;
+
+typedef struct
+{
+  Capture_TriggerTypeDef trigger;
+  uint16_t       level;         /* RISING / FALLING threshold, raw counts */
+  uint16_t       velocity;      /* VELOCITY threshold, counts per sample */
+  GPIO_TypeDef  *gpio_port;     /* GPIO trigger input */
+  uint16_t       gpio_pin;
+  GPIO_PinState  gpio_state;
+  uint32_t       pre_samples;   /* history kept before the trigger */
+  uint32_t       post_samples;  /* samples after the trigger, at least 1 */
+  uint32_t       timeout_ms;    /* give up waiting for the trigger,
+                                   1..CAPTURE_TIMEOUT_MAX_MS */
+} Capture_ConfigTypeDef;
+
+typedef struct
+{
+  uint32_t samples;     /* samples in the buffer */
+  uint32_t pre;         /* of which before the trigger */
+  uint32_t period_ns;   /* mean sample period after the trigger */
+  uint32_t errors;      /* failed I2C reads */
+  uint8_t  triggered;   /* 0 when the capture timed out */
+} Capture_ResultTypeDef;
+
+int  Capture_Arm(const Capture_ConfigTypeDef *cfg);
+Capture_StateTypeDef Capture_GetState(void);
+uint8_t Capture_Run(void);
+int  Capture_Drain(void);
+const Capture_ResultTypeDef *Capture_GetResult(void);
+
+#endif /* __CAPTURE_H */
@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file           : command.h
+  * @brief          : Binary runtime command interface over USART2 RX.
+  *
+  *  Requests are CMD frames (telemetry.h) received by uartrx.h, every one is
+  *  answered by a REPLY frame with the same tag and opcode, little endian:
+  *    CMD    u8 tag, u8 op, arguments
+  *    REPLY  u8 tag, u8 op, u8 status (CMD_OK, CMD_ERR_xxx), data
+  *
+  *  op                  arguments                        reply data
+  *  CMD_PING            -                                u8 version, u32 tick_ms,
+  *                                                       u32 samples
+  *  CMD_SET_RATE        u32 sample_us, u32 telemetry_us  -
+  *                      (0 keeps a period)
+  *  CMD_SET_OUTPUT      u8 format (App_OutFormatTypeDef), -
+  *                      u16 fields (APP_FIELD_xxx)
+  *  CMD_SET_FILTER      u8 filter_shift, u8 vel_shift    -
+  *  CMD_CAPTURE         u8 trigger (immediate..velocity), -
+  *                      u16 level, u16 velocity, u32 pre,
+  *                      u32 post, u32 timeout_ms (1..10000)
+  *  CMD_PERF            u8 page, u8 index                see CMD_PERF_xxx
+  *  CMD_PERF_RESET      -                                -
+  *  CMD_REG_READ        u8 reg, u8 count (1..CMD_REG_MAX) u8 data[count]
+  *  CMD_REG_WRITE       u8 reg, u8 data[1..8]            -
+  *                      (ZPOS..CONF only, BURN is refused)
+  *  CMD_SET_EVENT       u8 enable, u16 deadband counts,  -
+  *                      u32 heartbeat_ms (app.h)
+  *  CMD_SET_DECIM       u8 kind (Decim_KindTypeDef),     -
+  *                      u8 ratio, u8 order / taps (0 = default)
+  *  CMD_SET_SPECTRUM    u16 block length, 0 = off        -
+  *  CMD_SET_ORDER       u16 points per revolution,       -
+  *                      0 = off, u8 orders
+  *  CMD_SET_REVSTAT     u8 enable, u16 hysteresis counts, -
+  *                      u8 acceleration shift
+  *  CMD_SET_ALARM       u16 overspeed rpm, u16 stall rpm, -
+  *                      u16 stall ms, u16 reversal counts,
+  *                      i32 window min, i32 window max,
+  *                      u8 latch, u8 read errors
+  *                      (alarm.h, 0 = off)
+  *  CMD_ALARM_CLEAR     -                                -
+  *  CMD_SET_QUAD        u16 lines per revolution,        -
+  *                      0 = off, u32 max edge rate Hz
+  *  CMD_SET_SERVO       u16 loop us, 0 = off, i32 kp,    -
+  *                      ki, kd, kv, ka, u8 d_shift,
+  *                      u16 out_max (servo.h)
+  *  CMD_SERVO_MOVE      i32 target Q4, u32 velocity Q4/s, -
+  *                      u32 acceleration Q4/s^2
+  *  CMD_SET_COMMUT      u8 pole pairs, 0 = off,          -
+  *                      u16 offset Q16, u16 lead us
+  *  CMD_COMMUT_ALIGN    u16 samples (commut.h)           -
+  *  CMD_SET_LAGCOMP     u8 enable, i16 trim us           -
+  *                      (lagcomp.h)
+  *  CMD_SET_OVERSAMPLE  u16 readings per sample,         -
+  *                      0 or 1 = off (oversample.h)
+  *  CMD_SET_MEDIAN      u8 window (0 = off), u8 k        -
+  *                      tenths of sigma, u16 floor
+  *                      counts (median.h)
+  *
+  *  Commands run from the rx task and never touch the I2C bus, except
+  *  CMD_SET_SERVO for the starting position while the loop is stopped. Register
+  *  accesses are queued (one at a time) and executed by the sample task
+  *  right after its own read, in chunks of CMD_BUS_CHUNK bytes and only
+  *  when at least CMD_BUS_SLACK_US remain before its next release, so the
+  *  acquisition instants do not move. While the servo runs its loop owns
+  *  the bus and register accesses and captures are refused with
+  *  CMD_ERR_BUSY.
+  ******************************************************************************
+  */
+
+#ifndef __COMMAND_H
+#define __COMMAND_H
+
+#include <stdint.h>
+
+#define CMD_PROTOCOL_VERSION  1U
+
+/* opcodes */
+#define CMD_PING        0x00U
+#define CMD_SET_RATE    0x01U
+#define CMD_SET_OUTPUT  0x02U
+#define CMD_SET_FILTER  0x03U
+#define CMD_CAPTURE     0x04U
+#define CMD_PERF        0x05U
+#define CMD_PERF_RESET  0x06U
+#define CMD_REG_READ    0x07U
+#define CMD_REG_WRITE   0x08U
+#define CMD_SET_EVENT   0x09U
+#define CMD_SET_DECIM   0x0AU
+#define CMD_SET_SPECTRUM 0x0BU
+#define CMD_SET_ORDER   0x0CU
+#define CMD_SET_REVSTAT 0x0DU
+#define CMD_SET_ALARM   0x0EU
+#define CMD_ALARM_CLEAR 0x0FU
+#define CMD_SET_QUAD    0x10U
+#define CMD_SET_SERVO   0x11U
+#define CMD_SERVO_MOVE  0x12U
+#define CMD_SET_COMMUT  0x13U
+#define CMD_COMMUT_ALIGN 0x14U
+#define CMD_SET_LAGCOMP 0x15U
+#define CMD_SET_OVERSAMPLE 0x16U
+#define CMD_SET_MEDIAN  0x17U
+
+/* CMD_PERF pages */
+#define CMD_PERF_SYSTEM    0U   /* u32 samples, u32 i2c_errors, u32 sched misses,
+                                   u16 load permille, u32 tx bytes dropped,
+                                   u32 rx frames, u32 rx bad frames */
+#define CMD_PERF_TASK      1U   /* task index: u32 period_us, u32 runs,
+                                   u32 misses, u32 max_cycles */
+#define CMD_PERF_PROFILE   2U   /* region index: u32 count, u32 min, u32 max,
+                                   u32 mean cycles */
+#define CMD_PERF_BUS       3U   /* u32 transactions, u32 restarts, u32 bytes,
+                                   u32 errors */
+#define CMD_PERF_EVENT     4U   /* u32 checked, u32 suppressed, u32 moves,
+                                   u32 status changes, u32 heartbeats,
+                                   u32 queue overflows */
+#define CMD_PERF_DECIM     5U   /* u8 kind, u8 ratio, u8 order, u8 taps,
+                                   i16 resolution gain mbit, u32 output
+                                   period us, u32 inputs, u32 outputs */
+#define CMD_PERF_SPECTRUM  6U   /* u16 n, u32 blocks, u32 overruns,
+                                   u32 cycles of the last block, u32 max */
+#define CMD_PERF_ORDER     7U   /* u16 points, u8 orders, u32 revolutions,
+                                   u32 restarts, u32 last period us */
+#define CMD_PERF_REVSTAT   8U   /* u8 enabled, u32 revolutions, u32 aborts,
+                                   u32 queue overflows */
+#define CMD_PERF_ALARM     9U   /* u8 output, u8 latched, u32 events,
+                                   u32 queue overflows, u32 last, max and
+                                   mean latency ns */
+#define CMD_PERF_QUAD     10U   /* u16 ppr, i32 position edges, u32 limited,
+                                   u32 dropped, u32 late, u32 last, max and
+                                   mean latency ns */
+#define CMD_PERF_SERVO    11U   /* u32 loops, i32 error Q4, i16 output,
+                                   u32 overruns, u32 read errors, u32 jitter
+                                   max ns, u32 max and mean ISR cycles */
+#define CMD_PERF_COMMUT   12U   /* u8 pole pairs, u8 alignment state, u16
+                                   offset, u16 electrical angle, i16 sin,
+                                   i16 cos (Q15), i32 speed 1/100 rpm,
+                                   u32 samples, u32 cycles of this angle */
+#define CMD_PERF_LAGCOMP  13U   /* u8 enabled, u16 conf, i32 model delay ns,
+                                   u32 last and max sample age ns, i32
+                                   position and compensated position Q4 */
+#define CMD_PERF_OVERSAMPLE 14U /* u16 n, u16 angle, u16 sigma, u16 noise
+                                   (Q4), u16 spread counts, u32 burst bus
+                                   ns, u32 bursts */
+#define CMD_PERF_MEDIAN   15U   /* u8 window, u8 k, u16 floor, u32 samples,
+                                   u32 outliers, u32 resyncs, i16 median
+                                   speed counts per sample, u16
+                                   threshold counts */
+
+/* reply status */
+#define CMD_OK               0U
+#define CMD_ERR_LENGTH       1U
+#define CMD_ERR_ARG          2U
+#define CMD_ERR_BUSY         3U
+#define CMD_ERR_OP           4U
+#define CMD_ERR_BUS          5U
+#define CMD_ERR_UNSUPPORTED  6U
+
+#define CMD_REG_MAX          32U
+#define CMD_BUS_CHUNK        4U      /* bytes per sample period */
+#define CMD_BUS_SLACK_US     300U
+#define CMD_BUS_MAX_DEFER    1000U   /* sample periods without slack before giving up */
+
+typedef struct
+{
+  uint32_t commands;        /* requests received */
+  uint32_t errors;          /* replies with a non-zero status */
+  uint32_t replies_dropped; /* telemetry buffer full */
+} Cmd_StatsTypeDef;
+
+void Cmd_OnFrame(const uint8_t *payload, uint8_t len);
+void Cmd_BusService(uint32_t slack_us);
+void Cmd_GetStats(Cmd_StatsTypeDef *stats);
+
+#endif /* __COMMAND_H */
@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file           : commut.h
+  * @brief          : Electrical angle and its sine and cosine for field
+  *                   oriented commutation of a brushless motor.
+  *
+  *  Angles are Q16 fractions of a turn, so an electrical angle is the
+  *  mechanical one times the pole pairs, wrapped by the uint16_t arithmetic
+  *  itself, minus the offset of the rotor's d axis:
+  *    theta = mech * pole_pairs - offset
+  *
+  *  The sensor delivers a sample every read (1 kHz or so), the current loop
+  *  wants an angle every PWM cycle (20 kHz). Commut_Sample() takes each
+  *  reading with its time stamp and updates a low-passed velocity;
+  *  Commut_Angle() extrapolates from the last reading to the time it is
+  *  asked for plus a fixed lead (the sensor's own delay behind the stamp),
+  *  and looks the sine and cosine up in a 256 entry table with linear
+  *  interpolation (sintab.h, at most 3 LSB of Q15 off). That part is a multiply, two
+  *  table reads and no division, well inside a 20 kHz budget
+  *  (commutbench.h).
+  *
+  *  The offset is found by alignment: with the stator driving a current
+  *  along the d axis (electrical angle 0) the rotor snaps to it and stands,
+  *  Commut_AlignStart() then averages the next readings into the offset.
+  *  The alignment fails when the rotor was not standing (spread above
+  *  COMMUT_ALIGN_SPREAD).
+  ******************************************************************************
+  */
+
+#ifndef __COMMUT_H
+#define __COMMUT_H
+
+#include <stdint.h>
+
+#define COMMUT_MAX_POLE_PAIRS  32U
+#define COMMUT_VEL_SHIFT_MAX   8U
+#define COMMUT_ALIGN_MAX       1024U    /* samples */
+#define COMMUT_ALIGN_SPREAD    1456U    /* electrical, Q16, 8 degrees */
+#define COMMUT_MAX_AGE_SHIFT   24U      /* older samples extrapolate this far */
+
+typedef enum
+{
+  COMMUT_ALIGN_IDLE = 0,
+  COMMUT_ALIGN_RUNNING,
+  COMMUT_ALIGN_DONE,
+  COMMUT_ALIGN_FAILED
+} Commut_AlignTypeDef;
+
+typedef struct
+{
+  uint16_t theta;          /* electrical angle, Q16 of a turn */
+  int16_t  sin;            /* Q15 */
+  int16_t  cos;
+} Commut_OutTypeDef;
+
+typedef struct
+{
+  uint8_t  pole_pairs;     /* 0 = off */
+  uint16_t offset;         /* electrical, Q16 */
+  uint32_t lead;           /* ticks added to the sample age */
+  uint8_t  vel_shift;      /* velocity low-pass, 2^vel_shift samples */
+  /* last sample */
+  uint8_t  primed;         /* 0, position, position and velocity */
+  uint16_t pos;            /* mechanical, Q16 */
+  uint32_t stamp;          /* ticks */
+  int32_t  vel;            /* mechanical Q16 per tick, Q24 */
+  uint32_t samples;
+  /* alignment */
+  Commut_AlignTypeDef align;
+  uint16_t align_samples;
+  uint16_t align_n;
+  uint16_t align_ref;      /* first electrical reading */
+  int32_t  align_sum;      /* readings - align_ref */
+  int16_t  align_min, align_max;
+} Commut_TypeDef;
+
+int  Commut_Init(Commut_TypeDef *c, uint8_t pole_pairs, uint16_t offset, uint32_t lead_us,
+                 uint8_t vel_shift, uint32_t tick_hz);
+void Commut_Resync(Commut_TypeDef *c);
+void Commut_Sample(Commut_TypeDef *c, uint16_t raw, uint32_t stamp);
+void Commut_Angle(const Commut_TypeDef *c, uint32_t now, Commut_OutTypeDef *out);
+int  Commut_AlignStart(Commut_TypeDef *c, uint16_t samples);
+int32_t Commut_SpeedCrpm(const Commut_TypeDef *c, uint32_t tick_hz);
+
+#endif /* __COMMUT_H */
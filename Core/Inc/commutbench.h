@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file           : commutbench.h
+  * @brief          : Cost and accuracy benchmark of the commutation angle
+  *                   (commut.h) against a 20 kHz PWM cycle.
+  *
+  *  sincos runs SinTab_SinCos() over all 65536 angles against the rounded
+  *  exact values. The angle rows turn a COMMUTBENCH_POLE_PAIRS motor at a
+  *  constant speed, read the sensor every COMMUTBENCH_SAMPLE_US (12 bits,
+  *  +-0.5 count of noise, COMMUTBENCH_DELAY_US old at its stamp) and ask for
+  *  the angle at every PWM cycle in between, as the current loop would;
+  *  err_hold is what the last reading alone gives. align aligns a rotor
+  *  held at an arbitrary angle, align_moving one that turns, which must be
+  *  refused.
+  *
+  *  One CSV row per case:
+  *    case,speed_tps,n,cycles_mean,cycles_max,budget_pct,err_max,err_hold,
+  *    check
+  *  cycles are DWT counts of one SinTab_SinCos() or Commut_Angle() call,
+  *  budget_pct the mean of one PWM cycle at COMMUTBENCH_PWM_HZ, err in
+  *  electrical degrees (sincos: Q15 LSB). Checks: table error within
+  *  3 LSB, angle error within COMMUTBENCH_ERR_DEG and below err_hold, mean
+  *  cost within 5 % of the cycle, offset within COMMUTBENCH_ERR_DEG.
+  ******************************************************************************
+  */
+
+#ifndef __COMMUTBENCH_H
+#define __COMMUTBENCH_H
+
+#include <stdint.h>
+
+#define COMMUTBENCH_PWM_HZ      20000U
+#define COMMUTBENCH_POLE_PAIRS  7U
+#define COMMUTBENCH_SAMPLE_US   1000U
+#define COMMUTBENCH_DELAY_US    100U
+#define COMMUTBENCH_ERR_DEG     3.0
+
+int CommutBench_Run(uint32_t samples);
+
+#endif /* __COMMUTBENCH_H */
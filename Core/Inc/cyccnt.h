@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : cyccnt.h
+  * @brief          : Cortex-M4 DWT cycle counter access.
+  *                   The counter runs at HCLK (84 MHz) and wraps every ~51 s,
+  *                   differences of two 32-bit reads are therefore valid for
+  *                   any interval shorter than that.
+  ******************************************************************************
+  */
+
+#ifndef __CYCCNT_H
+#define __CYCCNT_H
+
+#include "main.h"
+
+/**
+  * @brief  Enable the trace block and start the DWT cycle counter.
+  *         Can be called several times, the counter is not reset.
+  * @retval None
+  */
+static inline void CYCCNT_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief  Current value of the cycle counter.
+  * @retval CPU cycles (wrapping)
+  */
+static inline uint32_t CYCCNT_Read(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+  * @brief  Convert a cycle count into microseconds at the current HCLK.
+  * @param  cycles: number of CPU cycles
+  * @retval microseconds
+  */
+static inline uint32_t CYCCNT_ToUs(uint32_t cycles)
+{
+  return cycles / (SystemCoreClock / 1000000U);
+}
+
+#endif /* __CYCCNT_H */
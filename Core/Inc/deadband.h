@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file           : deadband.h
+  * @brief          : Change-driven output decision for stationary shafts.
+  *
+  *  Every sample is checked against the last one that was output:
+  *    DEADBAND_MOVE       position left the deadband around it
+  *    DEADBAND_STATUS     status byte differs
+  *    DEADBAND_HEARTBEAT  nothing output for heartbeat_ms (and the first
+  *                        sample)
+  *  A non-zero result makes the sample the new reference, anything else is
+  *  counted as suppressed. The position is multi-turn Q4 (pipeline.h), so
+  *  the comparison does not wrap and the filter keeps noise out of it.
+  ******************************************************************************
+  */
+
+#ifndef __DEADBAND_H
+#define __DEADBAND_H
+
+#include <stdint.h>
+
+#define DEADBAND_MOVE       0x01U
+#define DEADBAND_STATUS     0x02U
+#define DEADBAND_HEARTBEAT  0x04U
+
+typedef struct
+{
+  uint16_t deadband;       /* counts, 0 = any change */
+  uint32_t heartbeat_ms;   /* 0 = no heartbeat */
+  uint8_t  primed;
+  int32_t  ref_pos;        /* Q4 */
+  uint8_t  ref_status;
+  uint32_t ref_tick;
+  uint32_t checked;        /* samples seen */
+  uint32_t suppressed;     /* samples not output */
+  uint32_t moves;
+  uint32_t status_changes;
+  uint32_t heartbeats;
+} Deadband_TypeDef;
+
+void    Deadband_Init(Deadband_TypeDef *db, uint16_t deadband, uint32_t heartbeat_ms);
+uint8_t Deadband_Check(Deadband_TypeDef *db, int32_t pos, uint8_t status, uint32_t now_ms);
+
+#endif /* __DEADBAND_H */
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file           : decim.h
+  * @brief          : Decimation of the position stream: sample fast, publish
+  *                   at 1/ratio of the sample rate with less noise.
+  *
+  *  Input is the multi-turn position in counts, output is Q4 (1/16 count)
+  *  once every ratio inputs. Integer arithmetic only, the host build gives
+  *  bit-identical outputs (Host/Test/decim_test.c).
+  *
+  *    DECIM_CIC  order N comb-integrator cascade, gain G = ratio^N:
+  *               y = 16 x[n] + floor((16 S + G/2) / G)
+  *               S = sum c[k] (x[n-k] - x[n]), c = ratio-boxcar convolved
+  *               N times. The integrators wrap modulo 2^64, so the position
+  *               may grow without bound.
+  *    DECIM_FIR  taps-long windowed sinc (Blackman, cutoff at half the
+  *               output rate) in Q15 with sum(h) = 32768, evaluated only at
+  *               the output instants (polyphase saving):
+  *               y = 16 x[n] + ((sum h[k] (x[n-k] - x[n]) + 2^10) >> 11)
+  *               History and differences are 16 bits, two taps per
+  *               __SSUB16/__SMLAD, so the position may not move more than
+  *               32767 counts within the window.
+  *
+  *  Both filters start as if the first input had always been there.
+  *  resolution_mbits is the white-noise resolution gain of the filter,
+  *  -0.5 log2(sum(h^2) / sum(h)^2), in 1/1000 bit.
+  ******************************************************************************
+  */
+
+#ifndef __DECIM_H
+#define __DECIM_H
+
+#include <stdint.h>
+
+#define DECIM_MAX_RATIO      64U
+#define DECIM_CIC_MAX_ORDER  4U
+#define DECIM_FIR_MAX_TAPS   128U
+#define DECIM_CIC_MAX_LEN    (DECIM_CIC_MAX_ORDER * (DECIM_MAX_RATIO - 1U) + 1U)
+
+typedef enum
+{
+  DECIM_OFF = 0,
+  DECIM_CIC,
+  DECIM_FIR
+} Decim_KindTypeDef;
+
+typedef struct
+{
+  Decim_KindTypeDef kind;
+  uint8_t ratio;           /* 2..DECIM_MAX_RATIO */
+  uint8_t order;           /* CIC: 1..DECIM_CIC_MAX_ORDER */
+  uint8_t taps;            /* FIR: even, 4..DECIM_FIR_MAX_TAPS */
+} Decim_ConfigTypeDef;
+
+typedef struct
+{
+  Decim_ConfigTypeDef cfg;
+  uint8_t  phase;          /* inputs since the last output */
+  uint8_t  primed;
+  int32_t  x0;             /* first input */
+  /* CIC */
+  uint64_t gain;           /* ratio^order */
+  uint8_t  gain_shift;     /* log2(gain) when a power of two, else 0xFF */
+  uint64_t integ[DECIM_CIC_MAX_ORDER];
+  uint64_t comb[DECIM_CIC_MAX_ORDER];
+  /* FIR */
+  int16_t  coef[DECIM_FIR_MAX_TAPS];        /* coef[i] weighs the i-th oldest sample */
+  int16_t  hist[2U * DECIM_FIR_MAX_TAPS];   /* counts modulo 2^16, stored twice */
+  uint8_t  pos;
+  int16_t  resolution_mbits;
+  uint32_t inputs;
+  uint32_t outputs;
+} Decim_TypeDef;
+
+int  Decim_Init(Decim_TypeDef *d, const Decim_ConfigTypeDef *cfg);
+int  Decim_Push(Decim_TypeDef *d, int32_t x, int32_t *y);
+
+#endif /* __DECIM_H */
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file           : hil.h
+  * @brief          : Hardware-in-the-loop trajectory injection over USART2.
+  *
+  *  A host streams raw angle values as HIL_DATA frames (telemetry.h,
+  *  received by uartrx.h), little endian:
+  *    u32 sequence of the first value, u16 raw[1..HIL_DATA_MAX]
+  *  The first one switches the sample task over to Hil_Read() (through
+  *  App_SetSampleSource()), which takes one value per sample from a FIFO in
+  *  place of the I2C read. Scheduler, pipeline and outputs keep running on
+  *  the real time base, so downstream consumers see the trajectory at the
+  *  configured sample rate.
+  *
+  *  While injecting, a HIL_STATUS frame goes out every HIL_STATUS_PERIOD_MS:
+  *    u32 values consumed, u32 next expected sequence, u32 underruns,
+  *    u16 FIFO level, u16 sequence gaps, u16 overflows, u8 active
+  *  The host keeps (sent - consumed) below HIL_FIFO_SIZE with it. An empty
+  *  FIFO repeats the last value and counts an underrun. HIL_STOP, or no data
+  *  for HIL_TIMEOUT_MS with the FIFO empty, gives the sensor back.
+  ******************************************************************************
+  */
+
+#ifndef __HIL_H
+#define __HIL_H
+
+#include <stdint.h>
+
+#define HIL_FIFO_SIZE         1024U   /* power of two */
+#define HIL_DATA_MAX          30U     /* values per HIL_DATA frame */
+#define HIL_STATUS_LEN        19U
+#define HIL_STATUS_PERIOD_MS  10U
+#define HIL_TIMEOUT_MS        500U
+
+typedef struct
+{
+  uint32_t consumed;       /* values handed to the sample task */
+  uint32_t next_seq;       /* sequence expected in the next HIL_DATA frame */
+  uint32_t underruns;      /* samples taken with the FIFO empty */
+  uint16_t gaps;           /* HIL_DATA frames with an unexpected sequence */
+  uint16_t overflows;      /* values dropped on a full FIFO */
+  uint8_t  active;         /* sample task is fed from the FIFO */
+} Hil_StatsTypeDef;
+
+void    Hil_OnFrame(uint8_t type, const uint8_t *payload, uint8_t len);
+void    Hil_Report(void);
+uint8_t Hil_Read(uint16_t *raw);
+void    Hil_Stop(void);
+void    Hil_GetStats(Hil_StatsTypeDef *stats);
+
+#endif /* __HIL_H */
@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file           : lagcomp.h
+  * @brief          : Latency compensation of the position: how old a sample
+  *                   is, and where the shaft is by now.
+  *
+  *  A RAW ANGLE reading describes the shaft some time before it is used.
+  *  The AS5600 output goes through a first-order filter whose settling time
+  *  the CONF slow filter bits select (2.2 ms at SF 16x down to 0.286 ms at
+  *  2x, settled to 5 % after three time constants), and a first-order
+  *  filter trails a shaft at constant speed by one time constant. While the
+  *  output trails its input by more than the fast filter threshold (CONF
+  *  FTH, in LSB) the sensor switches to the fast filter, the 2x one; in
+  *  between the lag settles on the threshold itself, fth / speed. The value
+  *  is latched once the read address phase is through, AMS5600_READ_HEAD_BITS
+  *  bit times after the read start. So
+  *    age = (now - read start) - latch + lag + trim
+  *    lag = tau(SF), at most fth / speed, at least tau(2x)
+  *  with trim for what the model misses (hysteresis, CONF HYST, only acts
+  *  at standstill and is left out). The position is then carried forward by
+  *  the tracked velocity over that age.
+  *
+  *  This is the filter of the host simulator (as5600_sim.h), on which
+  *  lagbench_host shows what it buys against speed.
+  ******************************************************************************
+  */
+
+#ifndef __LAGCOMP_H
+#define __LAGCOMP_H
+
+#include <stdint.h>
+
+#define LAGCOMP_TRIM_MAX_US 5000
+
+#define LAGCOMP_CONF_SF(conf)   (((conf) >> 8) & 0x3U)
+#define LAGCOMP_CONF_FTH(conf)  (((conf) >> 10) & 0x7U)
+
+typedef struct
+{
+  uint16_t conf;           /* CONF register the model is for */
+  uint8_t  fth;            /* fast filter threshold, LSB, 0 = off */
+  int32_t  base_ns;        /* sample age at the latch, without the filter */
+  int32_t  slow_ns;        /* the same behind the slow filter */
+  int32_t  fast_ns;        /* and behind the fast filter */
+  int32_t  latch_ns;       /* read start to the data latch */
+  int32_t  trim_ns;
+} LagComp_ModelTypeDef;
+
+int     LagComp_Init(LagComp_ModelTypeDef *m, uint16_t conf, uint32_t bus_hz, int32_t trim_us);
+int32_t LagComp_SensorNs(const LagComp_ModelTypeDef *m, int32_t vel, uint32_t period_us);
+int32_t LagComp_Extrapolate(int32_t pos, int32_t vel, int32_t age_ns, uint32_t period_us);
+
+#endif /* __LAGCOMP_H */
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file           : lowpower.h
+  * @brief          : Low-power acquisition: the MCU sleeps (Sleep or Stop)
+  *                   between samples and is woken by the RTC wake-up timer,
+  *                   the AS5600 polling interval (CONF PM bits) is chosen to
+  *                   match the sample period.
+  ******************************************************************************
+  */
+
+#ifndef __LOWPOWER_H
+#define __LOWPOWER_H
+
+#include <stdint.h>
+
+typedef enum
+{
+  LP_MODE_RUN = 0,   /* no low-power acquisition, scheduler with WFI idle */
+  LP_MODE_SLEEP,     /* core clock gated, peripherals and PLL kept running */
+  LP_MODE_STOP       /* all clocks stopped, PLL restarted on every wake-up */
+} LowPower_ModeTypeDef;
+
+typedef struct
+{
+  uint32_t count;
+  uint32_t min_ns;
+  uint32_t max_ns;
+  uint64_t sum_ns;
+} LowPower_LatencyTypeDef;
+
+void    LowPower_Init(void);
+uint8_t LowPower_As5600ModeFor(uint32_t period_us);
+uint8_t LowPower_Acquire(LowPower_ModeTypeDef mode, uint32_t period_us,
+                         uint16_t *rawAngle, uint32_t *latency_ns);
+void    LowPower_Run(LowPower_ModeTypeDef mode, uint32_t period_us);
+void    LowPower_LatencySweep(uint32_t period_us, uint32_t samples);
+void    LowPower_WakeIRQ(void);
+
+#endif /* __LOWPOWER_H */
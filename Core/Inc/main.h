@@ -49,6 +49,8 @@ extern "C" {
 
 /* USER CODE END EM */
 
+void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
+
 /* Exported functions prototypes ---------------------------------------------*/
 void Error_Handler(void);
 
@@ -65,12 +67,24 @@ void Error_Handler(void);
 #define USART_RX_GPIO_Port GPIOA
 #define LD2_Pin GPIO_PIN_5
 #define LD2_GPIO_Port GPIOA
+#define SERVO_PWM_Pin GPIO_PIN_6
+#define SERVO_PWM_GPIO_Port GPIOA
+#define SERVO_DIR_Pin GPIO_PIN_7
+#define SERVO_DIR_GPIO_Port GPIOA
+#define QUAD_Z_Pin GPIO_PIN_10
+#define QUAD_Z_GPIO_Port GPIOB
+#define ALARM_Pin GPIO_PIN_10
+#define ALARM_GPIO_Port GPIOA
 #define TMS_Pin GPIO_PIN_13
 #define TMS_GPIO_Port GPIOA
 #define TCK_Pin GPIO_PIN_14
 #define TCK_GPIO_Port GPIOA
 #define SWO_Pin GPIO_PIN_3
 #define SWO_GPIO_Port GPIOB
+#define QUAD_A_Pin GPIO_PIN_4
+#define QUAD_A_GPIO_Port GPIOB
+#define QUAD_B_Pin GPIO_PIN_5
+#define QUAD_B_GPIO_Port GPIOB
 
 /* USER CODE BEGIN Private defines */
 
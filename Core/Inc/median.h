@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file           : median.h
+  * @brief          : Sliding-window median (Hampel) rejection of single-sample
+  *                   glitches in the RAW ANGLE stream.
+  *
+  *  An EMI spike on a long cable shows as one reading far off the others,
+  *  and everything downstream (pipeline, alarm, encoder emulation) follows
+  *  it. A median of the readings themselves would open up with the motion
+  *  in the window and lag a turning shaft by half of it, so the test runs
+  *  on the step of each reading from the last accepted one,
+  *    d = raw - y[k-1], wrapped to +-2048 counts,
+  *  over the time dt since that one, in sample periods. d / dt is the speed
+  *  plus noise whatever the angle, across the zero too, and a late or
+  *  missed release is no glitch. The window keeps the last N speeds in an
+  *  order-statistics tree (an AVL tree with subtree sizes over a static
+  *  pool, one node per window slot): one enters and the oldest leaves in
+  *  O(log N), and the median and quartiles are found by rank in O(log N).
+  *  A reading is an outlier when
+  *    |d - median * dt| > floor + k * sigma * dt,
+  *    sigma = (Q3 - Q1) / 1.349
+  *  (the interquartile range stands in for the MAD, which needs a second
+  *  selection over the deviations; both estimate sigma of a symmetric
+  *  distribution). An outlier is replaced by the last output carried on by
+  *  the median speed over its interval, the others pass unchanged, so there
+  *  is no delay.
+  *
+  *  Until the window is full readings pass untested. More than N / 2
+  *  outliers in a row are taken as a real jump: the reading passes and the
+  *  window starts over (resyncs). Costs over N = 5..63 are in
+  *  medianbench.h.
+  ******************************************************************************
+  */
+
+#ifndef __MEDIAN_H
+#define __MEDIAN_H
+
+#include <stdint.h>
+
+#define MEDIAN_MIN_WINDOW  3U
+#define MEDIAN_MAX_WINDOW  63U
+#define MEDIAN_NIL         0xFFU
+#define MEDIAN_DT_ONE      256U     /* interval of a sample on time */
+#define MEDIAN_DT_MIN      64U
+#define MEDIAN_DT_MAX      1024U    /* a longer gap wants Median_Resync() */
+
+typedef struct
+{
+  uint8_t  window;         /* N, speeds tested against */
+  uint8_t  k;              /* threshold in sigma, tenths */
+  uint16_t floor;          /* threshold at no spread, counts */
+  /* order-statistics tree, node i holds window slot i */
+  int16_t  key[MEDIAN_MAX_WINDOW];
+  uint8_t  left[MEDIAN_MAX_WINDOW];
+  uint8_t  right[MEDIAN_MAX_WINDOW];
+  uint8_t  height[MEDIAN_MAX_WINDOW];
+  uint8_t  size[MEDIAN_MAX_WINDOW];
+  uint8_t  root;
+  uint8_t  head;           /* oldest slot once full */
+  uint8_t  count;
+  uint8_t  primed;         /* y is valid */
+  uint16_t y;              /* last output */
+  uint8_t  run;            /* outliers in a row */
+  uint8_t  outlier;        /* the last reading was one */
+  int16_t  med;            /* median speed of the last test, counts per
+                              sample period */
+  uint16_t thr;            /* its threshold, counts */
+  uint32_t samples;
+  uint32_t outliers;
+  uint32_t resyncs;
+} Median_TypeDef;
+
+int      Median_Init(Median_TypeDef *m, uint8_t window, uint8_t k, uint16_t floor);
+void     Median_Resync(Median_TypeDef *m);
+uint16_t Median_Push(Median_TypeDef *m, uint16_t raw, uint16_t dt);
+int16_t  Median_Select(const Median_TypeDef *m, uint8_t rank);
+
+#endif /* __MEDIAN_H */
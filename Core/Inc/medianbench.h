@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file           : medianbench.h
+  * @brief          : Cost and rejection benchmark of the glitch filter
+  *                   (median.h) for windows of 5 to 63 steps.
+  *
+  *  A shaft standing, turning at 50 turns/s (crossing the zero every 20
+  *  samples), speeding up from 0 to 50 turns/s and turning at 50 turns/s
+  *  read up to 40 % of the period early or late is read every sample,
+  *  12 bits with +-0.5 count of noise, and about one reading in 100 is
+  *  replaced by a spike of 16 to 2047 counts either way. The readings go
+  *  through Median_Push() with Hampel's 3 sigma and a floor of
+  *  MEDIANBENCH_FLOOR counts.
+  *
+  *  One CSV row per window and case:
+  *    window,case,samples,cycles_mean,cycles_max,spikes,rejected,missed,
+  *    false,err_max,check
+  *  cycles are DWT counts of one Median_Push() with a full window, rejected
+  *  the outliers it counted, missed the spikes it passed, false the good
+  *  readings it replaced, err_max the largest distance of the output from
+  *  the shaft in counts, spikes included. check fails on a missed spike, a
+  *  false rejection or err_max above MEDIANBENCH_ERR_MAX. The mean cost
+  *  grows with log N, not N.
+  ******************************************************************************
+  */
+
+#ifndef __MEDIANBENCH_H
+#define __MEDIANBENCH_H
+
+#include <stdint.h>
+
+#define MEDIANBENCH_FLOOR    8U
+#define MEDIANBENCH_ERR_MAX  2.0
+
+int MedianBench_Run(uint32_t samples);
+
+#endif /* __MEDIANBENCH_H */
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file           : order.h
+  * @brief          : Order tracking: the angle stream resampled to a fixed
+  *                   number of points per revolution, per-order amplitudes.
+  *
+  *  Every sample brings a multi-turn position (Q4) and a time stamp in any
+  *  32-bit wrapping clock (DWT cycles on the target). The crossings of an
+  *  angle grid of S points per turn, aligned to the calibrated zero, are
+  *  time stamped by linear interpolation between the two samples around
+  *  them, which resamples the stream from time to angle. Over one
+  *  revolution of grid points j = 0..S-1 with times t[j] from its start:
+  *
+  *    e[j] = -(4096 / T) * (t[j] - a1 j - a2 j^2)
+  *
+  *  is the angle deviation in counts from a uniformly accelerating shaft,
+  *  T the duration of the revolution. a1 and a2 go through the start of
+  *  the previous revolution and the end of this one: revolution periods
+  *  are not affected by vibration repeating every turn, so the trend does
+  *  not absorb any order. The DFT of e over j gives order k (k cycles per
+  *  turn) whatever the speed:
+  *    amplitude[k] = 2 |sum e[j] exp(-2 pi i k j / S)| / S
+  *  sum t[j] w^kj is accumulated in int64 with q15 twiddles as the grid
+  *  points arrive, the constant sums of j w^kj and j^2 w^kj are subtracted
+  *  when the revolution completes, so no samples are stored: memory is
+  *  fixed and a grid point costs 2 multiply-accumulates per order.
+  *
+  *  Tracking restarts when the direction changes or a revolution lasts
+  *  longer than max_ticks, the first revolution after a (re)start only
+  *  gives the period for the next. Orders close to half the input samples
+  *  per revolution (result.samples) are attenuated by the interpolation,
+  *  above it they alias.
+  ******************************************************************************
+  */
+
+#ifndef __ORDER_H
+#define __ORDER_H
+
+#include <stdint.h>
+
+#define ORDER_MAX_POINTS   256U   /* grid points per revolution, power of two */
+#define ORDER_MIN_POINTS   8U
+#define ORDER_MAX_ORDERS   12U
+
+typedef struct
+{
+  uint32_t rev;            /* revolutions completed before this one */
+  uint32_t ticks;          /* duration */
+  uint16_t samples;        /* input samples within it */
+  uint8_t  orders;
+  uint32_t amp_mc[ORDER_MAX_ORDERS];   /* order 1.., peak, 1/1000 count */
+} Order_ResultTypeDef;
+
+typedef struct
+{
+  uint16_t points;         /* S, 0 = off */
+  uint8_t  orders;         /* K, 1..ORDER_MAX_ORDERS and <= S / 2 */
+  uint8_t  shift;          /* log2 of the grid spacing, Q4 */
+  uint32_t max_ticks;
+  uint32_t twiddle[ORDER_MAX_POINTS];   /* cos low, sin high, q15, 2 pi m / S */
+  int64_t  jc[ORDER_MAX_ORDERS], js[ORDER_MAX_ORDERS];   /* sum j w^kj */
+  int64_t  qc[ORDER_MAX_ORDERS], qs[ORDER_MAX_ORDERS];   /* sum j^2 w^kj */
+  /* input */
+  uint8_t  primed;
+  int8_t   dir;            /* 1 forward, -1 backward, 0 unknown */
+  int32_t  prev_pos;
+  uint32_t prev_t;
+  /* revolution */
+  int32_t  j;              /* grid points so far, -1 = waiting for a start */
+  uint32_t t0;
+  uint16_t samples;
+  uint32_t last_ticks;     /* previous revolution, 0 = none */
+  int64_t  tc[ORDER_MAX_ORDERS], ts[ORDER_MAX_ORDERS];   /* sum (t - t0) w^kj */
+  uint32_t revs;
+  uint32_t restarts;
+  Order_ResultTypeDef result;
+} Order_TypeDef;
+
+int  Order_Init(Order_TypeDef *o, uint16_t points, uint8_t orders, uint32_t max_ticks);
+int  Order_Push(Order_TypeDef *o, int32_t pos, uint32_t t);
+
+#endif /* __ORDER_H */
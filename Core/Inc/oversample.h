@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file           : oversample.h
+  * @brief          : Averaging of a burst of RAW ANGLE readings into a 16-bit
+  *                   angle with a noise estimate.
+  *
+  *  AMS5600_getRawAngleBurst() takes n readings in one transfer at the full
+  *  bus rate, 18 bit times apart. Their mean is the circular one: the
+  *  readings are taken as differences to the first, wrapped to half a turn,
+  *  which is the direction of the summed unit vectors for any burst spread
+  *  well below half a turn, in integer arithmetic and exact. The result is
+  *  published in 1/16 count, i.e. a 16-bit fraction of a turn.
+  *
+  *  The spread of the readings gives the noise: sigma is their standard
+  *  deviation, noise = sigma / sqrt(n) the one expected of the mean. The
+  *  gain is only real while the readings dither across codes (sigma around
+  *  half a count or more) and are not all one sensor output: the AS5600
+  *  filter (CONF SF) correlates samples closer than its time constant, so a
+  *  burst shorter than that gains less than sqrt(n). oversamplebench.h
+  *  measures what a burst buys against its bus time.
+  ******************************************************************************
+  */
+
+#ifndef __OVERSAMPLE_H
+#define __OVERSAMPLE_H
+
+#include <stdint.h>
+
+#define OVERSAMPLE_MAX_N  64U
+#define OVERSAMPLE_BITS   18U    /* bus bits per reading in a burst */
+
+typedef struct
+{
+  uint16_t angle;          /* circular mean, 16-bit of a turn (Q4 counts) */
+  uint16_t raw;            /* the same rounded to 12 bits */
+  uint16_t n;
+  uint16_t spread;         /* largest minus smallest reading, counts */
+  uint16_t sigma;          /* standard deviation of the readings, Q4 counts */
+  uint16_t noise;          /* expected of the mean, Q4 counts */
+} Oversample_OutTypeDef;
+
+void     Oversample_Mean(const uint16_t *raw, uint16_t n, Oversample_OutTypeDef *out);
+uint32_t Oversample_BusNs(uint16_t n, uint32_t bus_hz);
+
+#endif /* __OVERSAMPLE_H */
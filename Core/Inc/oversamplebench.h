@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file           : oversamplebench.h
+  * @brief          : Resolution gained by oversampling (oversample.h) against
+  *                   the bus time it costs.
+  *
+  *  With the shaft standing, readings of n = 1..OVERSAMPLE_MAX_N averaged
+  *  samples are taken at SF 16x and 2x (CONF is restored afterwards). The
+  *  spread of the published 16-bit angles over the readings is the noise
+  *  actually reached. Standing still hides the quantiser: without noise
+  *  every reading is the same code and the mean keeps its error, with
+  *  gaussian noise sigma the mean keeps a bias of
+  *    q(sigma)^2 = sum over k of exp(-4 pi^2 k^2 sigma^2) / (2 pi^2 k^2)
+  *  rms over the angle (1/sqrt(12) count at sigma = 0, negligible from half
+  *  a count on). With that and the 1/16 count output step added,
+  *    eff_bits = 12 - log2(sqrt(12) * rms error in counts)
+  *  so a plain 12-bit reading scores 12.
+  *
+  *  One CSV row per filter setting and n:
+  *    sf,n,readings,bus_us,cycles_mean,sigma,noise_est,noise_meas,eff_bits,
+  *    gain_bits
+  *  bus_us is the wire time of one burst at the clock hi2c1 runs at,
+  *  cycles_mean the DWT count of a reading (on target including the bus
+  *  wait), sigma and noise_est the means of the published figures and
+  *  noise_meas the measured one, all in 1/16 count; gain_bits is against
+  *  n = 1 at the same setting.
+  ******************************************************************************
+  */
+
+#ifndef __OVERSAMPLEBENCH_H
+#define __OVERSAMPLEBENCH_H
+
+#include <stdint.h>
+
+void OversampleBench_Run(uint32_t readings);
+
+#endif /* __OVERSAMPLEBENCH_H */
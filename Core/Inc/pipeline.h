@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : pipeline.h
+  * @brief          : Raw angle processing: unwrap, calibration, filtering.
+  *
+  *  Integer arithmetic only, so the same input stream gives bit-identical
+  *  outputs on the target and on the host (replay, recorder.h).
+  *
+  *    unwrap       12-bit sample-to-sample delta accumulated into a
+  *                 multi-turn position in counts
+  *    calibration  zero offset plus a 16-point correction table over one
+  *                 turn, linearly interpolated, in 1/16 count
+  *    filter       first-order low-pass, alpha = 2^-filter_shift
+  *    velocity     low-passed difference of the filtered position,
+  *                 alpha = 2^-vel_shift
+  *
+  *  Positions and velocities are Q4 (1/16 count; 1 count = 360/4096 deg).
+  ******************************************************************************
+  */
+
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#include <stdint.h>
+
+#define PIPELINE_LUT_SIZE     16U
+#define PIPELINE_STATE_SIZE   47U   /* Pipeline_Save() length */
+
+typedef struct
+{
+  int16_t offset;                    /* zero position, counts */
+  int8_t  lut[PIPELINE_LUT_SIZE];    /* correction at k * 256 counts, 1/16 count */
+  uint8_t filter_shift;              /* 0 = filter off */
+  uint8_t vel_shift;                 /* 0 = unfiltered difference */
+} Pipeline_ConfigTypeDef;
+
+typedef struct
+{
+  Pipeline_ConfigTypeDef cfg;
+  uint16_t last_raw;
+  uint8_t  primed;       /* first sample seen */
+  int32_t  turns_pos;    /* unwrapped raw position, counts */
+  int64_t  filt_acc;     /* filtered position, Q4 << 16 */
+  int32_t  filt_prev;    /* previous filtered position, Q4 */
+  int64_t  vel_acc;      /* filtered velocity, Q4 << 16 */
+} Pipeline_TypeDef;
+
+typedef struct
+{
+  int32_t pos;           /* calibrated multi-turn position, Q4 */
+  int32_t filt;          /* low-pass position, Q4 */
+  int32_t vel;           /* Q4 counts per sample */
+} Pipeline_OutTypeDef;
+
+void     Pipeline_Init(Pipeline_TypeDef *pl, const Pipeline_ConfigTypeDef *cfg);
+void     Pipeline_DefaultConfig(Pipeline_ConfigTypeDef *cfg);
+void     Pipeline_Step(Pipeline_TypeDef *pl, uint16_t raw, Pipeline_OutTypeDef *out);
+uint16_t Pipeline_Save(const Pipeline_TypeDef *pl, uint8_t *buf);
+int      Pipeline_Load(Pipeline_TypeDef *pl, const uint8_t *buf, uint16_t len);
+uint32_t Pipeline_Hash(uint32_t hash, const Pipeline_OutTypeDef *out);
+
+#define PIPELINE_HASH_INIT  2166136261UL   /* FNV-1a offset basis */
+
+#endif /* __PIPELINE_H */
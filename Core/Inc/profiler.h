@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : profiler.h
+  * @brief          : DWT cycle-counter profiling of named code regions.
+  *
+  *  Usage:
+  *    PROF_BEGIN(PROF_REGION_READ);
+  *    status = AMS5600_getRawAngle(&rawAngle);
+  *    PROF_END(PROF_REGION_READ);
+  *
+  *  Each region keeps count/min/max/sum and a log2 histogram in RAM, bin k
+  *  counting the samples in [2^k, 2^(k+1)) cycles. Recording costs a few tens
+  *  of cycles and never touches the UART, Profiler_Dump() prints the tables
+  *  on demand. With PROFILER_ENABLED set to 0 every macro expands to nothing.
+  ******************************************************************************
+  */
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include <stdint.h>
+#include "app_config.h"
+#include "cyccnt.h"
+
+typedef enum
+{
+  PROF_REGION_READ = 0,   /* I2C read of the sensor */
+  PROF_REGION_CONVERT,    /* raw counts to engineering units */
+  PROF_REGION_FORMAT,     /* text formatting of the output line */
+  PROF_REGION_TRANSMIT,   /* hand-over of the line to USART2 */
+  PROF_REGION_ISR,        /* interrupt handler body */
+  PROF_REGION_COMPRESS,   /* stream encoder, per sample */
+  PROF_REGION_DECIMATE,   /* decimation stage, per sample */
+  PROF_REGION_SPECTRUM,   /* spectrum analysis, per slice */
+  PROF_REGION_ORDER,      /* order tracking, per sample */
+  PROF_REGION_REVSTAT,    /* revolution statistics, per sample */
+  PROF_REGION_ALARM,      /* alarm check and output, per sample */
+  PROF_REGION_QUAD,       /* encoder emulation plan, per sample */
+  PROF_REGION_QUAD_EDGE,  /* encoder emulation edge interrupt */
+  PROF_REGION_SERVO,      /* position controller, per loop */
+  PROF_REGION_MEDIAN,     /* glitch filter, per sample */
+  PROF_REGION_COUNT
+} Prof_RegionTypeDef;
+
+#define PROF_HIST_BINS  32U
+
+typedef struct
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t hist[PROF_HIST_BINS];
+} Prof_StatsTypeDef;
+
+#if PROFILER_ENABLED
+
+extern Prof_StatsTypeDef prof_stats[PROF_REGION_COUNT];
+extern uint32_t prof_overhead;
+
+#define PROF_BEGIN(region)  uint32_t prof_t0_##region = CYCCNT_Read()
+#define PROF_END(region)    Profiler_Record((region), CYCCNT_Read() - prof_t0_##region)
+
+/**
+  * @brief  Add one measurement to a region, the measurement overhead
+  *         calibrated by Profiler_Init() is removed first.
+  * @param  region: region index
+  * @param  cycles: raw cycle count of the measurement
+  * @retval None
+  */
+static inline void Profiler_Record(Prof_RegionTypeDef region, uint32_t cycles)
+{
+  Prof_StatsTypeDef *s = &prof_stats[region];
+
+  cycles = (cycles > prof_overhead) ? cycles - prof_overhead : 0U;
+  if (cycles < s->min) s->min = cycles;
+  if (cycles > s->max) s->max = cycles;
+  s->count++;
+  s->sum += cycles;
+  s->hist[31U - __CLZ(cycles | 1U)]++;
+}
+
+void Profiler_Init(void);
+void Profiler_Reset(void);
+void Profiler_GetStats(Prof_RegionTypeDef region, Prof_StatsTypeDef *stats);
+void Profiler_Dump(void);
+
+#else /* PROFILER_ENABLED */
+
+#define PROF_BEGIN(region)  ((void)0)
+#define PROF_END(region)    ((void)0)
+
+static inline void Profiler_Init(void) {}
+static inline void Profiler_Reset(void) {}
+static inline void Profiler_Dump(void) {}
+
+#endif /* PROFILER_ENABLED */
+
+#endif /* __PROFILER_H */
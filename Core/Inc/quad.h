@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file           : quad.h
+  * @brief          : Incremental encoder emulation: the position stream as
+  *                   quadrature A/B and an index pulse Z.
+  *
+  *  The output position is counted in edges, 4 * ppr per turn, A leading B
+  *  when the position increases. Z is high in the quarter cycle with A and B
+  *  high at the calibrated zero. Every sample plans the edges up to one
+  *  sample ahead of it (linear extrapolation from the previous sample), so
+  *  at constant speed the output position matches the samples. Quad_Edge()
+  *  (one call per edge, from a timer interrupt) emits them at equal
+  *  intervals over the coming sample period, first one half an interval
+  *  in. Each sample's plan replaces the one before it. So the edge rate
+  *  follows the velocity sample by sample, and an edge is never later than
+  *  one sample period after the read that asked for it.
+  *
+  *  Edge intervals never get shorter than tick_hz / max_hz. When a plan
+  *  needs more edges than that allows in one period, it emits the ones that
+  *  fit and drops the rest in whole cycles of four (A/B continuity is kept,
+  *  and the receiver's count is short by dropped). So the lag stays bounded
+  *  rather than growing while the shaft is too fast for the receiver.
+  ******************************************************************************
+  */
+
+#ifndef __QUAD_H
+#define __QUAD_H
+
+#include <stdint.h>
+
+#define QUAD_MAX_PPR      4096U     /* 4 edges per count of the sensor */
+#define QUAD_MAX_EDGE_HZ  250000U   /* one interrupt per edge */
+
+#define QUAD_PIN_A  0x01U
+#define QUAD_PIN_B  0x02U
+#define QUAD_PIN_Z  0x04U
+
+typedef struct
+{
+  uint16_t ppr;            /* 0 = off */
+  uint32_t edges_per_turn;
+  uint32_t min_ticks;      /* shortest edge interval */
+  /* plan, the edge interrupt side */
+  volatile int32_t  pos;   /* emitted edges, the output position */
+  volatile uint32_t left;  /* edges of the plan still to emit */
+  uint32_t planned;        /* edges in the plan */
+  int8_t   dir;
+  uint32_t base, rem, acc; /* interval base + rem / planned ticks */
+  /* sample side */
+  uint8_t  primed;
+  uint8_t  extrapolate;    /* previous target valid */
+  int32_t  target;         /* edges at the latest sample */
+  int32_t  goal;           /* position the plan ends at */
+  /* counters */
+  uint32_t limited;        /* plans cut to the edge rate limit */
+  uint32_t dropped;        /* edges given up */
+} Quad_TypeDef;
+
+int      Quad_Init(Quad_TypeDef *q, uint16_t ppr, uint32_t max_hz, uint32_t tick_hz);
+void     Quad_Resync(Quad_TypeDef *q);
+uint32_t Quad_Plan(Quad_TypeDef *q, int32_t pos, uint32_t period);
+uint32_t Quad_Edge(Quad_TypeDef *q);
+
+/**
+  * @brief  Output levels of the current position.
+  * @retval QUAD_PIN_xxx bits set high
+  */
+static inline uint8_t Quad_Pins(const Quad_TypeDef *q)
+{
+  /* A B: 11 01 00 10 going forward, A leads */
+  static const uint8_t ab[4] = { QUAD_PIN_A | QUAD_PIN_B, QUAD_PIN_B, 0U, QUAD_PIN_A };
+  int32_t pos = q->pos;
+  uint8_t pins = ab[pos & 3];
+
+  if (pos % (int32_t)q->edges_per_turn == 0) pins |= QUAD_PIN_Z;
+  return pins;
+}
+
+#endif /* __QUAD_H */
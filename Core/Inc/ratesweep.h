@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : ratesweep.h
+  * @brief          : Maximum sustainable sample-rate sweep.
+  *
+  *  For each output format (text line / binary frame) and transport
+  *  (blocking HAL_UART_Transmit / DMA telemetry) the sample rate is stepped
+  *  up through a fixed ladder. Each step samples RAW ANGLE on a DWT-timed
+  *  grid for a fixed window and sends one record per sample. A step fails on
+  *  the first deadline miss (a sample finishing after the next release) or
+  *  dropped telemetry byte; the last passing rate is the sustainable rate.
+  *
+  *  The sample records go out during the sweep, the summary table follows
+  *  with printf once every combination is done:
+  *    SWEEP,format,transport,sustainable_hz,fail_hz,misses,dropped
+  *  fail_hz is 0 when the top of the ladder passed.
+  ******************************************************************************
+  */
+
+#ifndef __RATESWEEP_H
+#define __RATESWEEP_H
+
+#include <stdint.h>
+
+#define RATESWEEP_DEFAULT_MS  500U   /* window per rate step */
+
+typedef enum
+{
+  RATESWEEP_FMT_TEXT = 0,
+  RATESWEEP_FMT_BINARY
+} RateSweep_FormatTypeDef;
+
+typedef enum
+{
+  RATESWEEP_TX_BLOCKING = 0,
+  RATESWEEP_TX_DMA
+} RateSweep_TransportTypeDef;
+
+typedef struct
+{
+  RateSweep_FormatTypeDef    format;
+  RateSweep_TransportTypeDef transport;
+  uint32_t sustainable_hz;   /* highest passing rate, 0 if none passed */
+  uint32_t fail_hz;          /* first failing rate, 0 if none failed */
+  uint32_t misses;           /* at fail_hz */
+  uint32_t dropped;          /* telemetry bytes dropped at fail_hz */
+} RateSweep_ResultTypeDef;
+
+#define RATESWEEP_COMBINATIONS  4U
+
+void RateSweep_Run(uint32_t window_ms);
+const RateSweep_ResultTypeDef *RateSweep_GetResults(void);
+
+#endif /* __RATESWEEP_H */
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file           : recorder.h
+  * @brief          : Field recording of the raw sample stream for sample-exact
+  *                   replay through the pipeline on a workstation.
+  *
+  *  Samples are grouped in batches of RECORDER_BATCH. Every batch goes out as
+  *  one RECORD frame (telemetry.h), little endian:
+  *    u32 sequence of the first sample, u16 raw[RECORDER_BATCH],
+  *    u32 FNV-1a hash of the batch outputs (Pipeline_Hash),
+  *    i32 filtered position after the last sample
+  *  A STATE frame (u32 sequence, Pipeline_Save() image) precedes the first
+  *  batch, every RECORDER_STATE_EVERY batches and the batch following a
+  *  dropped frame, so a replay can pick up after a gap.
+  *
+  *  A capture file is the byte stream as received from the UART; anything
+  *  that is not a valid frame (text, deferred log records) is skipped.
+  ******************************************************************************
+  */
+
+#ifndef __RECORDER_H
+#define __RECORDER_H
+
+#include <stdint.h>
+#include "pipeline.h"
+
+#define RECORDER_BATCH        16U
+#define RECORDER_STATE_EVERY  64U
+#define RECORDER_RECORD_LEN   (4U + 2U * RECORDER_BATCH + 4U + 4U)
+#define RECORDER_STATE_LEN    (4U + PIPELINE_STATE_SIZE)
+
+/* frame output, Telemetry_WriteFrame() on the target */
+typedef uint16_t (*Recorder_SinkFn)(uint8_t type, const void *payload, uint8_t len);
+
+typedef struct
+{
+  Recorder_SinkFn sink;
+  uint32_t seq;            /* index of the next sample */
+  uint32_t batch_seq;      /* index of the first sample of the batch */
+  uint16_t raw[RECORDER_BATCH];
+  uint8_t  n;
+  uint8_t  need_state;
+  uint32_t hash;
+  uint32_t batches;
+  uint32_t dropped;        /* frames the sink refused */
+} Recorder_TypeDef;
+
+void Recorder_Init(Recorder_TypeDef *rec, Recorder_SinkFn sink);
+void Recorder_Step(Recorder_TypeDef *rec, Pipeline_TypeDef *pl, uint16_t raw, Pipeline_OutTypeDef *out);
+
+#endif /* __RECORDER_H */
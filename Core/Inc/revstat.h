@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file           : revstat.h
+  * @brief          : Per-revolution statistics of the shaft: period, mean
+  *                   speed, speed ripple and angular acceleration extremes.
+  *
+  *  Revolutions are counted at the 4095 -> 0 wrap of the raw angle (the
+  *  sensor zero), on the raw angle unwrapped sample to sample. The first
+  *  wrap starts counting in its direction, every further full turn the same
+  *  way completes a record. Going back across the last wrap by more than
+  *  the hysteresis abandons the revolution, so a shaft resting or shaking
+  *  on the zero does not produce records. Wrap instants are interpolated
+  *  between the time stamps of the two samples around them.
+  *
+  *  Within a revolution every sample adds the pipeline velocity (low-passed
+  *  as configured by vel_shift) to a Welford mean / sum of squares, and its
+  *  change since the previous sample, low-passed with alpha = 2^-acc_shift,
+  *  to the acceleration extremes: a constant cost per sample. One count per
+  *  sample of velocity change is 915 rpm/s at 1 kHz, so acc_shift sets how
+  *  much of that quantisation reaches the extremes. Units are converted
+  *  once per revolution with the mean sample interval of that revolution.
+  ******************************************************************************
+  */
+
+#ifndef __REVSTAT_H
+#define __REVSTAT_H
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t rev;            /* records before this one */
+  uint32_t period_us;
+  int32_t  speed_crpm;     /* 1/100 rpm from the period, negative backwards */
+  uint32_t ripple_crpm;    /* standard deviation of the speed */
+  int32_t  acc_min;        /* rpm/s */
+  int32_t  acc_max;
+  uint16_t samples;
+} RevStat_RecordTypeDef;
+
+typedef struct
+{
+  uint16_t hysteresis;     /* counts */
+  uint8_t  acc_shift;      /* acceleration low-pass, 0 = off */
+  uint32_t max_ticks;      /* longest revolution */
+  uint32_t tick_hz;
+  /* input */
+  uint8_t  primed;
+  int32_t  unwrapped;      /* raw angle, counts, 0..4095 after every sample */
+  uint32_t prev_t;
+  int32_t  prev_vel;
+  int64_t  acc;            /* filtered acceleration, Q4 counts per sample^2 << 16 */
+  /* revolution */
+  int8_t   dir;            /* 1 forward, -1 backward, 0 not counting */
+  int32_t  mark;           /* last wrap, relative to unwrapped */
+  uint32_t t0;
+  uint16_t n;
+  float    mean;           /* Welford, Q4 counts per sample */
+  float    m2;
+  int64_t  acc_min, acc_max;   /* as acc */
+  uint32_t revs;
+  uint32_t aborts;
+  RevStat_RecordTypeDef record;
+} RevStat_TypeDef;
+
+void RevStat_Init(RevStat_TypeDef *rs, uint16_t hysteresis, uint8_t acc_shift, uint32_t max_ticks, uint32_t tick_hz);
+void RevStat_Resync(RevStat_TypeDef *rs);
+int  RevStat_Push(RevStat_TypeDef *rs, uint16_t raw, int32_t vel, uint32_t t);
+
+#endif /* __REVSTAT_H */
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file           : scheduler.h
+  * @brief          : Cooperative multi-rate scheduler.
+  *
+  *  Tasks are released on a fixed time grid (release n = start + n * period)
+  *  and run to completion. Ready tasks are dispatched rate-monotonically, the
+  *  shortest period first. A job that completes after its next release, or
+  *  is skipped because a previous job overran, counts as a deadline miss.
+  *  The timebase is the DWT cycle counter extended to 64 bits, so periods
+  *  below the 1 ms HAL tick are supported. When nothing is ready the core
+  *  waits in WFI, woken at the next release by the one-shot timer armed
+  *  through the hook given to Sched_SetWakeup(). Without one the 1 ms
+  *  SysTick is the only sure wake-up, so the core then only sleeps when the
+  *  next release is at least a tick away and polls the counter otherwise.
+  ******************************************************************************
+  */
+
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS  8U
+#define SCHED_SLEEP_MIN_CYCLES  256U   /* shorter idle gaps are polled */
+
+typedef void (*Sched_TaskFn)(void);
+/* arm a one-shot interrupt in this many CPU cycles */
+typedef void (*Sched_WakeupFn)(uint32_t cycles);
+
+typedef struct
+{
+  const char  *name;
+  Sched_TaskFn fn;
+  uint32_t     period_us;
+  uint64_t     period;        /* cycles */
+  uint64_t     next_release;  /* cycles */
+  uint32_t     runs;
+  uint32_t     misses;
+  uint32_t     max_cycles;
+  uint64_t     busy_cycles;
+} Sched_TaskTypeDef;
+
+int  Sched_AddTask(const char *name, Sched_TaskFn fn, uint32_t period_us);
+int  Sched_SetPeriod(int task, uint32_t period_us);
+void Sched_Start(void);
+void Sched_SetWakeup(Sched_WakeupFn fn);
+void Sched_Dispatch(void);
+void Sched_Resync(void);
+void Sched_ResetStats(void);
+uint64_t Sched_Now(void);
+uint32_t Sched_GetLoadPermille(void);
+uint32_t Sched_GetMisses(void);
+const Sched_TaskTypeDef *Sched_GetTask(int task);
+void Sched_Dump(void);
+
+#endif /* __SCHEDULER_H */
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : servo.h
+  * @brief          : Fixed-point position controller: trapezoidal setpoint,
+  *                   PID with velocity and acceleration feed-forward.
+  *
+  *  Servo_Step() runs once per control loop and is the whole controller, no
+  *  HAL: the target loop interrupt and the host plant simulation
+  *  (servobench.h) run the same code. Inside, time is counted in loops, so
+  *  the gains belong to one loop rate.
+  *
+  *  Positions are Q4 counts of RAW ANGLE (65536 per turn), continued across
+  *  turns. The setpoint moves towards the target with at most vel_max and
+  *  acc_max, braking to stop on it (both 0: it jumps there). The output,
+  *  Q15 of full scale, is
+  *    u = kp e + I + kv v + ka a + kd (v - d(pos))
+  *  with e = setpoint - pos, v and a the setpoint velocity and acceleration
+  *  and d(pos) the measured position difference through a first-order
+  *  low-pass of 2^d_shift loops. The derivative damps the velocity error
+  *  rather than the velocity itself, so it does not brake against the
+  *  feed-forward during a move; with a step (v = 0) it acts on the
+  *  measurement only and the target step does not kick. The integrator adds
+  *  ki e per loop, only inside the proportional band (|kp e| < out_max) and
+  *  not while the output is saturated and e would drive it further out
+  *  (conditional integration); it never holds more than out_max by itself,
+  *  so it does not wind up during long saturated moves.
+  *
+  *  Gains are Q16 of output units per Q4 count (kp, ki), per Q4 count per
+  *  loop (kv, kd) and per Q4 count per loop^2 (ka).
+  ******************************************************************************
+  */
+
+#ifndef __SERVO_H
+#define __SERVO_H
+
+#include <stdint.h>
+
+#define SERVO_OUT_MAX     32767
+#define SERVO_D_SHIFT_MAX 8U
+#define SERVO_LOOP_MAX_US 65535U
+#define SERVO_ACC_MAX     0x0FFFFFFFUL   /* Q4 counts per s^2, 4096 turns/s^2 */
+
+typedef struct
+{
+  int32_t  kp, ki, kd;     /* Q16 */
+  int32_t  kv, ka;         /* feed-forward, Q16 */
+  uint8_t  d_shift;        /* derivative low-pass, up to SERVO_D_SHIFT_MAX */
+  int32_t  out_max;        /* saturation, 1..SERVO_OUT_MAX */
+} Servo_ConfigTypeDef;
+
+typedef struct
+{
+  Servo_ConfigTypeDef cfg;
+  uint32_t loop_us;
+  /* setpoint generator, Q16 fractions of Q4 counts and loops */
+  int32_t  target;
+  int32_t  vel_max;        /* per loop, Q16, 0 = step */
+  int32_t  acc_max;        /* per loop^2, Q16, 0 = step */
+  int64_t  ref;            /* setpoint */
+  int32_t  vel;            /* setpoint velocity */
+  int32_t  acc;            /* setpoint acceleration of the last loop */
+  /* controller */
+  int32_t  prev_pos;
+  int32_t  dpos;           /* filtered position difference, Q8 */
+  int32_t  integ;          /* integrator, Q16 of output units */
+  int32_t  err;            /* setpoint - pos of the last loop */
+  int32_t  out;
+  uint8_t  saturated;
+  uint32_t saturated_loops;
+} Servo_TypeDef;
+
+int     Servo_Init(Servo_TypeDef *s, const Servo_ConfigTypeDef *cfg, uint32_t loop_us, int32_t pos);
+void    Servo_Reset(Servo_TypeDef *s, int32_t pos);
+void    Servo_Move(Servo_TypeDef *s, int32_t target, uint32_t vel_max, uint32_t acc_max);
+int32_t Servo_Step(Servo_TypeDef *s, int32_t pos);
+
+/**
+  * @brief  Setpoint of the last loop.
+  * @retval position, Q4 counts
+  */
+static inline int32_t Servo_Setpoint(const Servo_TypeDef *s)
+{
+  return (int32_t)(s->ref >> 16);
+}
+
+#endif /* __SERVO_H */
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : servobench.h
+  * @brief          : Closed-loop benchmark of the position controller
+  *                   (servo.h) against a simulated motor.
+  *
+  *  The plant is a DC motor on a PWM bridge: speed follows the duty with a
+  *  first-order lag (SERVOBENCH_WMAX turns/s at full duty, time constant
+  *  SERVOBENCH_TAU_MS), Coulomb friction and a load torque, integrated in
+  *  steps of 1/20 loop. The sensor is the AS5600 RAW ANGLE: 12 bits,
+  *  +-0.5 count of noise, read at the start of the loop; the output takes
+  *  effect SERVOBENCH_DELAY_US later (read and controller in the loop
+  *  interrupt). The controller is Servo_Step() itself with the APP_SERVO_xxx
+  *  boot gains (app_config.h) at a 1 kHz loop, so the same code and numbers
+  *  run here and in the loop interrupt.
+  *
+  *  Cases: a 10 turn step (saturated, the anti-windup case), a 10 turn
+  *  trapezoidal move, a 2 turn move and back, and a 20 % load step while
+  *  holding. One CSV row per case:
+  *    case,loops,cycles_mean,cycles_max,err_rms,err_max,dev_max,settle_ms,
+  *    final,saturated,check
+  *  cycles are DWT counts of Servo_Step() over all runs, err the following
+  *  error (setpoint - position), dev_max the largest distance from the
+  *  target after the shaft first got within 2 counts of it (overshoot,
+  *  load deviation), settle_ms the time from the setpoint arriving (or the load step) to the last loop
+  *  more than 2 counts off, final the distance at the end, all in counts,
+  *  saturated the loops at full output. check fails when the final
+  *  distance exceeds 2 counts or the shaft is not settled for the last
+  *  100 loops.
+  ******************************************************************************
+  */
+
+#ifndef __SERVOBENCH_H
+#define __SERVOBENCH_H
+
+#include <stdint.h>
+
+#define SERVOBENCH_LOOP_US   1000U
+#define SERVOBENCH_WMAX      50.0    /* turns/s, 3000 rpm */
+#define SERVOBENCH_TAU_MS    20.0
+#define SERVOBENCH_FRICTION  0.03    /* of full scale */
+#define SERVOBENCH_DELAY_US  150.0
+
+int ServoBench_Run(uint32_t runs);
+
+#endif /* __SERVOBENCH_H */
@@ -0,0 +1,22 @@
+/**
+  ******************************************************************************
+  * @file           : sintab.h
+  * @brief          : Q15 sine and cosine from a 256 entry table.
+  *
+  *  Angles are Q16 fractions of a turn. SinTab_SinCos() interpolates
+  *  linearly between the entries, at most 3 LSB of Q15 off; at angles that
+  *  are multiples of 256 (any grid of up to 256 points per turn) it returns
+  *  the entries themselves, round(32767 sin). A multiply and two table reads each, no trigonometry
+  *  at run time: the commutation angle (commut.h) takes one per PWM cycle,
+  *  order tracking (order.h) its twiddles.
+  ******************************************************************************
+  */
+
+#ifndef __SINTAB_H
+#define __SINTAB_H
+
+#include <stdint.h>
+
+void SinTab_SinCos(uint16_t theta, int16_t *s, int16_t *co);
+
+#endif /* __SINTAB_H */
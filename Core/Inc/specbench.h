@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * @file           : specbench.h
+  * @brief          : Cost and accuracy benchmark of the block spectrum
+  *                   (spectrum.h).
+  *
+  *  Synthetic positions at 1 kHz, a shaft at constant speed or accelerating
+  *  with two torsional vibration components, quantised to whole counts, are
+  *  analysed with n = 256, 1024 and 4096 (up to SPECTRUM_MAX_N) in slices of
+  *  APP_SPECTRUM_STEPS as the spectrum task does. The two largest peaks must
+  *  be the two components, within half a bin and 5 % of their amplitude.
+  *
+  *  One CSV row per signal and block length:
+  *    signal,n,blocks,cycles_per_block,max_slice_cycles,peak1_chz,peak1_mc,
+  *    peak2_chz,peak2_mc,check
+  *  cycles are DWT counts of the whole analysis of a block and of the
+  *  longest Spectrum_Service() call, frequencies in 1/100 Hz, amplitudes in
+  *  1/1000 count, averaged over the blocks. A length above SPECTRUM_MAX_N
+  *  gives a row with 0 blocks and check "skipped SPECTRUM_MAX_N=<max>".
+  ******************************************************************************
+  */
+
+#ifndef __SPECBENCH_H
+#define __SPECBENCH_H
+
+#include <stdint.h>
+
+int SpecBench_Run(uint32_t blocks);
+
+#endif /* __SPECBENCH_H */
@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.h
+  * @brief          : Vibration spectrum of the multi-turn angle, per block.
+  *
+  *  The sample task fills one of two blocks of n positions while the other
+  *  one is analysed in slices of Spectrum_Service() work, so the analysis
+  *  overlaps acquisition and no job runs longer than a slice. A block that
+  *  completes before the previous one is analysed is dropped (overruns).
+  *
+  *  Per block:
+  *    - the least squares parabola is removed, leaving the angle deviation
+  *      from constant acceleration (torsional vibration, runout, noise)
+  *    - scaled to +-2^14, Hann window, packed as n/2 complex q15 values
+  *    - n/2-point radix-2 DIF FFT, each stage halves (__SHADD16/__SHSUB16)
+  *      and rotates with one __SMLAD/__SMLSDX pair, no saturation needed
+  *    - split into the n/2+1 bins of the real FFT as |X|^2
+  *  Reported are the SPECTRUM_TOP_K largest local maxima from bin 2 on
+  *  (bin 1 shares the main lobe of any speed change), frequency in
+  *  1/16 bin (Hann 3-bin interpolation) and amplitude in 1/1000 count from
+  *  the power of the 3 bins, and the mean square in 1/1000 count^2 of the
+  *  octave bands [1, n/16), [n/16, n/8), [n/8, n/4), [n/4, n/2]. A bin is
+  *  1 / (n * sample period).
+  ******************************************************************************
+  */
+
+#ifndef __SPECTRUM_H
+#define __SPECTRUM_H
+
+#include <stdint.h>
+
+#ifndef SPECTRUM_MAX_N
+#define SPECTRUM_MAX_N   1024U   /* power of two, about 12 bytes of RAM each */
+#endif
+#define SPECTRUM_MIN_N   64U
+#define SPECTRUM_TOP_K   4U
+#define SPECTRUM_BANDS   4U
+
+typedef struct
+{
+  uint16_t bin_q4;         /* 0 = no peak */
+  uint32_t amp_mc;         /* sine amplitude, 1/1000 count */
+} Spectrum_PeakTypeDef;
+
+typedef struct
+{
+  uint32_t block;          /* blocks completed before this one */
+  uint16_t n;
+  Spectrum_PeakTypeDef peak[SPECTRUM_TOP_K];   /* largest first */
+  uint32_t band_mc2[SPECTRUM_BANDS];
+  uint32_t cycles;         /* analysis of the block, all slices */
+} Spectrum_ResultTypeDef;
+
+typedef struct
+{
+  uint16_t n;              /* 0 = off */
+  uint8_t  fill;           /* block being acquired */
+  uint16_t count;          /* samples in it */
+  int32_t  x0;             /* its first position */
+  int64_t  s0, s1;         /* sum (x - x0), sum i (x - x0) */
+  int32_t  blk[2][SPECTRUM_MAX_N];  /* x - x0, Q4; |X|^2 after the FFT */
+  uint32_t work[SPECTRUM_MAX_N / 2U];   /* packed complex q15, re low */
+  /* analysis of blk[fill ^ 1] */
+  uint8_t  phase;
+  uint32_t pos;
+  uint32_t span;
+  uint32_t grp;
+  float    a, b, c;        /* trend a + b i + c ((i - m)^2 - (n^2 - 1) / 12) */
+  float    acc, comp;      /* compensated sum while fitting c */
+  float    gain;           /* q15 per Q4 count, max |x - trend| before */
+  uint16_t top[SPECTRUM_TOP_K];    /* bins of the largest maxima so far */
+  uint64_t band[SPECTRUM_BANDS];   /* sum of |X|^2 */
+  uint32_t cycles;
+  uint32_t blocks;
+  uint32_t overruns;
+  uint32_t max_cycles;
+  Spectrum_ResultTypeDef result;
+} Spectrum_TypeDef;
+
+int  Spectrum_Init(Spectrum_TypeDef *s, uint16_t n);
+void Spectrum_Push(Spectrum_TypeDef *s, int32_t pos);
+int  Spectrum_Service(Spectrum_TypeDef *s, uint32_t budget);
+
+#endif /* __SPECTRUM_H */
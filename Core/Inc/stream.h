@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file           : stream.h
+  * @brief          : Compressed stream of every raw angle sample.
+  *
+  *  Samples are packed into STREAM frames (telemetry.h), little endian:
+  *    u32 sequence of the first sample, u16 raw angle of the first sample,
+  *    one varint per further sample
+  *  Each sample is predicted at constant speed, previous sample plus the
+  *  last difference (0 for the second sample of a frame). The varint holds
+  *  the zig-zag coded prediction error, taken modulo 4096 into -2048..2047,
+  *  7 bits per byte, least significant group first, bit 7 set when another
+  *  byte follows. Errors up to +-63 counts take one byte, others two.
+  *
+  *  Every frame starts with an absolute value (keyframe) and decodes on its
+  *  own, a lost frame costs only its own samples and shows up as a sequence
+  *  gap. A frame is sent when the next error does not fit or after
+  *  STREAM_KEY_EVERY samples, which bounds the latency.
+  ******************************************************************************
+  */
+
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#include <stdint.h>
+#include "telemetry.h"
+
+#define STREAM_HDR_LEN    6U
+#define STREAM_KEY_EVERY  50U    /* samples per frame at most */
+
+/* frame output, Telemetry_WriteFrame() on the target */
+typedef uint16_t (*Stream_SinkFn)(uint8_t type, const void *payload, uint8_t len);
+
+typedef struct
+{
+  Stream_SinkFn sink;
+  uint32_t seq;            /* sequence of the next sample */
+  uint16_t prev;           /* last sample */
+  int32_t  delta;          /* last sample-to-sample difference */
+  uint8_t  n;              /* samples in the open frame, 0 = none */
+  uint8_t  len;            /* payload bytes of the open frame */
+  uint8_t  buf[TELEMETRY_MAX_PAYLOAD];
+  uint32_t frames;
+  uint32_t bytes;          /* payload bytes handed to the sink */
+  uint32_t dropped;        /* frames the sink refused */
+} Stream_TypeDef;
+
+void Stream_Init(Stream_TypeDef *s, Stream_SinkFn sink, uint32_t seq);
+void Stream_Push(Stream_TypeDef *s, uint16_t raw);
+void Stream_Flush(Stream_TypeDef *s);
+int  Stream_Decode(const uint8_t *payload, uint8_t len, uint32_t *seq, uint16_t *raw, uint32_t max);
+
+#endif /* __STREAM_H */
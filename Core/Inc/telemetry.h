@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.h
+  * @brief          : Non-blocking USART2 output.
+  *                   Writes are copied into one of two buffers while the other
+  *                   one is sent by DMA, the sampling path never waits for
+  *                   the UART. Data that does not fit is dropped and counted.
+  *
+  *  Binary records share the stream with the text lines as frames
+  *    0x5A, type, len, payload[len], checksum
+  *  where checksum makes the 8-bit sum of type..checksum zero.
+  ******************************************************************************
+  */
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include <stdint.h>
+
+#define TELEMETRY_BUF_SIZE  256U
+
+#define TELEMETRY_SYNC          0x5AU
+#define TELEMETRY_MAX_PAYLOAD   64U
+#define TELEMETRY_FRAME_LEN(n)  ((n) + 4U)
+
+/* frame types */
+#define TELEMETRY_FRAME_SAMPLE      0x01U   /* u16 sequence, u16 raw angle */
+#define TELEMETRY_FRAME_STATE       0x02U   /* recorder.h: u32 sequence, pipeline state */
+#define TELEMETRY_FRAME_RECORD      0x03U   /* recorder.h: u32 sequence, raw batch, output hash */
+#define TELEMETRY_FRAME_HIL_STATUS  0x04U   /* hil.h: injection FIFO state */
+#define TELEMETRY_FRAME_OUTPUT      0x05U   /* app.h: u32 samples, u16 fields, selected fields */
+#define TELEMETRY_FRAME_REPLY       0x06U   /* command.h: u8 tag, u8 op, u8 status, data */
+#define TELEMETRY_FRAME_STREAM      0x07U   /* stream.h: u32 sequence, u16 raw, varint deltas */
+#define TELEMETRY_FRAME_SPECTRUM    0x08U   /* app.h: block result of spectrum.h */
+#define TELEMETRY_FRAME_ORDER       0x09U   /* app.h: revolution result of order.h */
+#define TELEMETRY_FRAME_REVOLUTION  0x0AU   /* app.h: record of revstat.h */
+#define TELEMETRY_FRAME_ALARM       0x0BU   /* app.h: alarm.h event record */
+
+/* frame types received on USART2 RX (uartrx.h) */
+#define TELEMETRY_FRAME_HIL_DATA    0x40U   /* hil.h: u32 sequence, raw angles */
+#define TELEMETRY_FRAME_HIL_STOP    0x41U   /* hil.h: end of the injection */
+#define TELEMETRY_FRAME_CMD         0x42U   /* command.h: u8 tag, u8 op, arguments */
+
+typedef struct
+{
+  uint32_t bytes_sent;
+  uint32_t bytes_dropped;
+  uint32_t transfers;
+} Telemetry_StatsTypeDef;
+
+uint16_t Telemetry_Write(const void *data, uint16_t len);
+uint16_t Telemetry_WriteFrame(uint8_t type, const void *payload, uint8_t len);
+uint16_t Telemetry_BuildFrame(uint8_t *buf, uint8_t type, const void *payload, uint8_t len);
+uint16_t Telemetry_Free(void);
+int  Telemetry_WaitIdle(uint32_t timeout_ms);
+void Telemetry_GetStats(Telemetry_StatsTypeDef *stats);
+void Telemetry_TxCplt(void);
+
+#endif /* __TELEMETRY_H */
@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file           : uartrx.h
+  * @brief          : USART2 frame reception.
+  *                   The receiver runs continuously: DMA1 Stream5 in circular
+  *                   mode fills a ring, the idle-line, half and full events
+  *                   (HAL_UARTEx_RxEventCallback) publish the write position.
+  *                   UartRx_Poll() runs in task context, splits the bytes into
+  *                   frames in the telemetry.h format and hands every frame
+  *                   with a valid checksum to the caller.
+  *
+  *  Nothing in the interrupt path looks at the data. The ring must be polled
+  *  before UARTRX_RING_SIZE bytes have arrived, at 115200 baud every 20 ms;
+  *  a lapped ring shows up as checksum errors.
+  ******************************************************************************
+  */
+
+#ifndef __UARTRX_H
+#define __UARTRX_H
+
+#include <stdint.h>
+
+#define UARTRX_RING_SIZE  256U
+
+typedef struct
+{
+  uint32_t bytes;          /* bytes taken from the ring */
+  uint32_t frames;         /* frames with a valid checksum */
+  uint32_t bad_frames;     /* checksum or length errors */
+  uint32_t skipped;        /* bytes outside any frame */
+  uint32_t restarts;       /* reception restarted after a UART error */
+} UartRx_StatsTypeDef;
+
+/* frame handler, called from UartRx_Poll() */
+typedef void (*UartRx_FrameFn)(uint8_t type, const uint8_t *payload, uint8_t len);
+
+int      UartRx_Start(void);
+uint16_t UartRx_Poll(UartRx_FrameFn fn);
+void     UartRx_GetStats(UartRx_StatsTypeDef *stats);
+void     UartRx_Event(uint16_t pos);
+void     UartRx_Error(void);
+
+#endif /* __UARTRX_H */
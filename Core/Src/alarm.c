@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file           : alarm.c
+  * @brief          : Overspeed, stall, reversal, position window and sensor
+  *                   fault detection in the acquisition path.
+  ******************************************************************************
+  */
+
+#include "alarm.h"
+#include <string.h>
+
+/* rpm to Q4 counts per ALARM_SPEED_SPAN samples */
+static int32_t Alarm_RpmToSpan(uint16_t rpm, uint32_t sample_us)
+{
+  return (int32_t)((uint64_t)rpm * 4096U * 16U * ALARM_SPEED_SPAN * sample_us / 60000000U);
+}
+
+/**
+  * @brief  Set the limits and clear the state, nothing is armed until the
+  *         speed span is filled.
+  * @param  a: alarm state
+  * @param  cfg: limits, all off when zero, window within +-ALARM_WINDOW_MAX
+  * @param  sample_us: sample period
+  * @retval 0 on success, -1 on a limit out of range
+  */
+int Alarm_Init(Alarm_TypeDef *a, const Alarm_ConfigTypeDef *cfg, uint32_t sample_us)
+{
+  if (sample_us == 0U || (cfg->stall_rpm && cfg->stall_ms == 0U)) return -1;
+  if (cfg->overspeed_rpm && cfg->stall_rpm >= cfg->overspeed_rpm) return -1;
+  if (cfg->window_min < -ALARM_WINDOW_MAX || cfg->window_min > ALARM_WINDOW_MAX) return -1;
+  if (cfg->window_max < -ALARM_WINDOW_MAX || cfg->window_max > ALARM_WINDOW_MAX) return -1;
+  memset(a, 0, sizeof(*a));
+  a->cfg = *cfg;
+  a->sample_us = sample_us;
+  a->overspeed = Alarm_RpmToSpan(cfg->overspeed_rpm, sample_us);
+  a->stall = Alarm_RpmToSpan(cfg->stall_rpm, sample_us);
+  a->stall_samples = ((uint32_t)cfg->stall_ms * 1000U + sample_us - 1U) / sample_us;
+  a->reversal = (int32_t)cfg->reversal_counts * 16;
+  return 0;
+}
+
+/**
+  * @brief  Evaluate one sample, constant cost.
+  * @param  a: alarm state
+  * @param  pos: calibrated multi-turn position, Q4
+  * @retval ALARM_xxx bits raised by this sample
+  */
+uint8_t Alarm_Check(Alarm_TypeDef *a, int32_t pos)
+{
+  const Alarm_ConfigTypeDef *cfg = &a->cfg;
+  uint8_t active = 0, raised;
+  int32_t speed;
+
+  a->fails = 0;
+
+  /* window, from the first sample */
+  if (cfg->window_min < cfg->window_max && (pos < cfg->window_min * 16 || pos > cfg->window_max * 16))
+    active |= ALARM_WINDOW;
+
+  /* reversal: hysteresis of reversal_counts around the furthest position */
+  if (a->reversal)
+  {
+    if (a->fill == 0U)
+      a->extreme = pos;
+    else if (a->dir == 0)
+    {
+      if (pos - a->extreme > a->reversal) a->dir = 1;
+      else if (a->extreme - pos > a->reversal) a->dir = -1;
+      if (a->dir) a->extreme = pos;
+    }
+    else if (a->dir * (pos - a->extreme) > 0)
+      a->extreme = pos;
+    else if (a->dir * (a->extreme - pos) > a->reversal)
+    {
+      active |= ALARM_REVERSAL;
+      a->dir = (int8_t)-a->dir;
+      a->extreme = pos;
+    }
+  }
+
+  /* travel over the span, once it holds ALARM_SPEED_SPAN older samples */
+  speed = pos - a->ring[a->idx];
+  a->ring[a->idx] = pos;
+  a->idx = (uint8_t)((a->idx + 1U) & (ALARM_SPEED_SPAN - 1U));
+  if (a->fill < ALARM_SPEED_SPAN)
+    a->fill++;
+  else
+  {
+    a->speed = speed;
+    if (speed < 0) speed = -speed;
+    if (a->overspeed && speed > a->overspeed) active |= ALARM_OVERSPEED;
+    if (a->stall)
+    {
+      if (speed >= a->stall)
+      {
+        a->running = 1;
+        a->slow = 0;
+      }
+      else if (a->running && ++a->slow >= a->stall_samples)
+        a->running = 0;
+      if (!a->running && a->slow >= a->stall_samples) active |= ALARM_STALL;
+    }
+  }
+
+  raised = (uint8_t)(active & ~a->active);
+  a->active = active;
+  if (cfg->latch) a->latched |= active;
+  for (uint32_t k = 0; k < ALARM_KINDS; k++)
+  {
+    if (raised & (1U << k)) a->events[k]++;
+  }
+  return raised;
+}
+
+/**
+  * @brief  Count a failed read in place of a sample, the sensor fault is
+  *         raised and latched at read_errors in a row. The other conditions
+  *         keep the state of the last sample.
+  * @param  a: alarm state
+  * @retval ALARM_SENSOR when raised by this read, 0 otherwise
+  */
+uint8_t Alarm_ReadError(Alarm_TypeDef *a)
+{
+  uint8_t raised;
+
+  if (a->cfg.read_errors == 0U) return 0;
+  if (a->fails < a->cfg.read_errors) a->fails++;
+  if (a->fails < a->cfg.read_errors) return 0;
+  raised = (uint8_t)(ALARM_SENSOR & ~a->active);
+  a->active |= ALARM_SENSOR;
+  a->latched |= ALARM_SENSOR;
+  if (raised) a->events[4]++;   /* bit 4, ALARM_SENSOR */
+  return raised;
+}
+
+/**
+  * @brief  Release the latched conditions, those still active stay set.
+  * @retval None
+  */
+void Alarm_Clear(Alarm_TypeDef *a)
+{
+  a->latched = (uint8_t)((a->cfg.latch ? a->active : 0U) | (a->active & ALARM_SENSOR));
+}
+
+/**
+  * @brief  Speed estimate of the last sample.
+  * @retval 1/100 rpm, signed
+  */
+int32_t Alarm_SpeedCrpm(const Alarm_TypeDef *a)
+{
+  return (int32_t)((int64_t)a->speed * 6000000000LL / ((int64_t)4096 * 16 * ALARM_SPEED_SPAN * a->sample_us));
+}
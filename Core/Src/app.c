@@ -0,0 +1,1659 @@
+/**
+  ******************************************************************************
+  * @file           : app.c
+  * @brief          : Application tasks run by the cooperative scheduler.
+  *
+  *  sample     1 kHz   a blocking capture burst when one is armed
+  *                     (capture.h), otherwise in this order:
+  *                     1. AMS5600_getRawAngle(), the mean of a burst of
+  *                        readings when oversampling (oversample.h), or
+  *                        the servo loop's reading; a failed read
+  *                        resyncs the stages below and counts towards
+  *                        the sensor fault alarm
+  *                     2. the glitch filter (median.h) when on
+  *                     3. the pipeline (and the recorder with APP_RECORD)
+  *                     4. the alarm check and output (alarm.h)
+  *                     5. the encoder emulation plan (quad.h) and the
+  *                        commutation angle (commut.h)
+  *                     6. the latency compensated position (lagcomp.h)
+  *                     7. the decimator (decim.h), spectrum block,
+  *                        order tracking (order.h), revolution statistics
+  *                        (revstat.h) and compressed stream (stream.h)
+  *                        when selected
+  *                     8. the deadband check (deadband.h), then queued
+  *                        register accesses in the slack
+  *  telemetry  100 Hz  latest sample as a text line or OUTPUT frame with
+  *                     the selected fields, DMA to USART2, or the next part
+  *                     of a completed capture. In event mode the samples
+  *                     queued by the deadband check (deadband.h) instead.
+  *                     A new order tracking result, the queued alarm
+  *                     events and revolution records first
+  *  health     10 Hz   AMS5600_getMagnetStrength() / AMS5600_getAgc(), and
+  *                     AMS5600_getConf() for the delay model when stale
+  *  log        20 Hz   drains the deferred log ring (debug.h) to USART2
+  *  button     20 Hz   user button dumps profiler and scheduler tables
+  *  rx         200 Hz  USART2 frames: commands (command.h), trajectory
+  *                     injection (hil.h) with APP_HIL
+  *  spectrum   1 kHz   a slice of the analysis of the last completed block
+  *                     (spectrum.h) when enabled, then its result
+  *
+  *  Sample and telemetry periods, output format, event mode, filter,
+  *  decimation, spectrum, order tracking, revolution statistics, alarm
+  *  limits, encoder emulation, commutation, latency compensation,
+  *  oversampling and the glitch filter can be changed at run time
+  *  (command.h).
+  *  The encoder edges themselves are emitted by the TIM2 update interrupt
+  *  (App_QuadEdge()). The position servo (servo.h) runs in the TIM4 update
+  *  interrupt (App_ServoLoop()), which then owns the I2C bus: the sample
+  *  task takes the loop's readings and the health task pauses.
+  ******************************************************************************
+  */
+
+#include "app.h"
+#include "main.h"
+#include "AMS5600_api.h"
+#include "app_config.h"
+#include "capture.h"
+#include "command.h"
+#include "cyccnt.h"
+#include "deadband.h"
+#include "debug.h"
+#include "hil.h"
+#include "lagcomp.h"
+#include "median.h"
+#include "oversample.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include "quad.h"
+#include "recorder.h"
+#include "scheduler.h"
+#include "spectrum.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "uartrx.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+/* an output line with APP_FIELD_ALL, noise, every event reason and the
+   health line of event mode: 15 + 27 + 16 + 104 + 32 + 1 + 25 = 220 */
+#define APP_TEXT_LINE_LEN  256U
+
+static App_StateTypeDef app;
+static uint8_t app_health_dirty;
+static App_SourceFn app_source = AMS5600_getRawAngle;
+static Pipeline_TypeDef app_pipeline;
+static App_OutFormatTypeDef app_out_format = APP_OUT_TEXT;
+static uint16_t app_out_fields = APP_FIELDS_DEFAULT;
+extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim3;
+extern TIM_HandleTypeDef htim4;
+extern I2C_HandleTypeDef hi2c1;
+
+static int app_sample_task = -1;
+static int app_telemetry_task = -1;
+static Stream_TypeDef app_stream;
+static uint8_t app_event_mode = (APP_EVENT_OUTPUT != 0);
+static Deadband_TypeDef app_deadband;
+static struct
+{
+  App_StateTypeDef st;
+  uint8_t reason;
+} app_events[APP_EVENT_QUEUE];
+static uint8_t app_event_head;
+static uint8_t app_event_count;
+static uint32_t app_event_overflows;
+static Decim_TypeDef app_decim;
+static Spectrum_TypeDef app_spectrum;
+static uint8_t app_spectrum_pending;
+static Order_TypeDef app_order;
+static uint8_t app_order_pending;
+static RevStat_TypeDef app_revstat;
+static uint8_t app_revstat_on;
+static RevStat_RecordTypeDef app_revs[APP_REVSTAT_QUEUE];
+static uint8_t app_rev_head;
+static uint8_t app_rev_count;
+static uint32_t app_rev_overflows;
+static Alarm_TypeDef app_alarm;
+static uint8_t app_alarm_on;
+static uint8_t app_alarm_level;
+static App_AlarmRecordTypeDef app_alarms[APP_ALARM_QUEUE];
+static uint8_t app_alarm_head;
+static uint8_t app_alarm_count;
+static uint32_t app_alarm_overflows;
+typedef struct
+{
+  uint32_t last, max, count;
+  uint64_t sum;
+} App_LatencyTypeDef;   /* cycles */
+static App_LatencyTypeDef app_alarm_latency;
+static Quad_TypeDef app_quad;
+static uint8_t app_quad_pins;
+static uint32_t app_quad_stamp;   /* read start of the sample planned */
+static uint32_t app_quad_late;
+static App_LatencyTypeDef app_quad_latency;
+static Servo_TypeDef app_servo;
+static uint32_t app_servo_loop_us;         /* 0 = off */
+static volatile uint32_t app_servo_reading; /* status << 16 | raw, for the sample task */
+static uint32_t app_servo_stamp;           /* CYCCNT at the start of that read */
+static uint16_t app_servo_raw;             /* last good read */
+static int32_t app_servo_pos;              /* Q4, continued across turns */
+static uint32_t app_servo_entry;           /* CYCCNT at the last loop */
+static uint32_t app_servo_loops;
+static uint32_t app_servo_overruns;
+static uint32_t app_servo_read_errors;
+static uint32_t app_servo_error_run;       /* failed reads in a row */
+static uint32_t app_servo_jitter;          /* cycles */
+static App_LatencyTypeDef app_servo_isr;
+static Commut_TypeDef app_commut;
+static LagComp_ModelTypeDef app_lagcomp;
+static uint8_t app_lagcomp_on;
+static uint8_t app_lagcomp_stale;         /* CONF to be read again */
+static int32_t app_lagcomp_trim_us;
+static int32_t app_lagcomp_sensor_ns;      /* model delay of the last sample */
+static uint32_t app_lagcomp_age_ns;        /* age of the last sample when compensated */
+static uint32_t app_lagcomp_age_max_ns;
+static uint16_t app_oversample_n;          /* readings per sample, 1 = off */
+static uint16_t app_oversample_raw[OVERSAMPLE_MAX_N];
+static Oversample_OutTypeDef app_oversample;
+static uint32_t app_oversample_bursts;
+static Median_TypeDef app_median;          /* window 0 = off */
+static uint32_t app_median_stamp;          /* of the last reading filtered */
+#if APP_RECORD
+static Recorder_TypeDef app_recorder;
+#endif
+
+static uint32_t App_CyclesToNs(uint32_t cycles)
+{
+  return (uint32_t)((uint64_t)cycles * 1000U / (SystemCoreClock / 1000000U));
+}
+
+static void App_AddLatency(App_LatencyTypeDef *l, uint32_t cycles)
+{
+  l->last = cycles;
+  if (cycles > l->max) l->max = cycles;
+  l->sum += cycles;
+  l->count++;
+}
+
+static uint32_t App_MeanLatencyNs(const App_LatencyTypeDef *l)
+{
+  return l->count ? App_CyclesToNs((uint32_t)(l->sum / l->count)) : 0U;
+}
+
+/* clear the detection state after a gap or a period change, latched
+   alarms stay set */
+static void App_RestartAlarm(void)
+{
+  const Alarm_ConfigTypeDef cfg = app_alarm.cfg;
+  uint8_t latched = app_alarm.latched;
+
+  Alarm_Init(&app_alarm, &cfg, App_GetSamplePeriod());
+  app_alarm.latched = latched;
+}
+
+/* drive ALARM_Pin from the alarm output, record what the sample raised,
+   or the read when it failed */
+static void App_CheckAlarm(uint32_t stamp, uint8_t read_ok)
+{
+  App_AlarmRecordTypeDef *r;
+  uint8_t raised, level;
+  uint32_t latency;
+
+  PROF_BEGIN(PROF_REGION_ALARM);
+  raised = read_ok ? Alarm_Check(&app_alarm, app.out.pos) : Alarm_ReadError(&app_alarm);
+  level = Alarm_Output(&app_alarm) != 0U;
+  if (level != app_alarm_level)
+  {
+    HAL_GPIO_WritePin(ALARM_GPIO_Port, ALARM_Pin, level ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    app_alarm_level = level;
+  }
+  latency = CYCCNT_Read() - stamp;
+  PROF_END(PROF_REGION_ALARM);
+  if (raised == 0U) return;
+
+  App_AddLatency(&app_alarm_latency, latency);
+  if (app_alarm_count == APP_ALARM_QUEUE)
+  {
+    app_alarm_overflows++;
+    return;
+  }
+  r = &app_alarms[(app_alarm_head + app_alarm_count++) % APP_ALARM_QUEUE];
+  r->tick_ms = HAL_GetTick();
+  r->sample = app.samples;
+  r->raised = raised;
+  r->output = Alarm_Output(&app_alarm);
+  r->pos = app.out.pos;
+  r->speed_crpm = Alarm_SpeedCrpm(&app_alarm);
+  r->latency_ns = App_CyclesToNs(latency);
+}
+
+/* drive the QUAD_x pins from the output position, the ones that changed */
+static void App_WriteQuadPins(void)
+{
+  uint8_t pins = Quad_Pins(&app_quad), change = pins ^ app_quad_pins;
+
+  if (change & QUAD_PIN_A)
+    HAL_GPIO_WritePin(QUAD_A_GPIO_Port, QUAD_A_Pin, (pins & QUAD_PIN_A) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+  if (change & QUAD_PIN_B)
+    HAL_GPIO_WritePin(QUAD_B_GPIO_Port, QUAD_B_Pin, (pins & QUAD_PIN_B) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+  if (change & QUAD_PIN_Z)
+    HAL_GPIO_WritePin(QUAD_Z_GPIO_Port, QUAD_Z_Pin, (pins & QUAD_PIN_Z) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+  app_quad_pins = pins;
+}
+
+/* replace the encoder edges by those towards the new sample, TIM2 starts
+   the first interval now */
+static void App_PlanQuad(uint32_t stamp)
+{
+  uint32_t primask, first;
+
+  PROF_BEGIN(PROF_REGION_QUAD);
+  primask = __get_PRIMASK();
+  __disable_irq();
+  first = Quad_Plan(&app_quad, app.out.pos, App_GetSamplePeriod() * (SystemCoreClock / 1000000U));
+  app_quad_stamp = stamp;
+  __HAL_TIM_SET_AUTORELOAD(&htim2, first ? first - 1U : 0xFFFFFFFFU);
+  __HAL_TIM_SET_COUNTER(&htim2, 0U);
+  __HAL_TIM_CLEAR_IT(&htim2, TIM_IT_UPDATE);
+  App_WriteQuadPins();   /* first sample, dropped cycles */
+  __set_PRIMASK(primask);
+  PROF_END(PROF_REGION_QUAD);
+}
+
+/* servo output u (Q15 of full scale) as TIM3 duty and SERVO_DIR_Pin */
+static void App_WriteServoOutput(int32_t u)
+{
+  uint32_t mag = (uint32_t)(u < 0 ? -u : u);
+
+  __HAL_TIM_SET_COMPARE(&htim3, TIM_CHANNEL_1, (mag * (__HAL_TIM_GET_AUTORELOAD(&htim3) + 1U)) >> 15);
+  HAL_GPIO_WritePin(SERVO_DIR_GPIO_Port, SERVO_DIR_Pin, u < 0 ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/* queue the current state when the deadband check wants it out */
+static void App_CheckEvent(void)
+{
+  uint8_t reason;
+
+  if (!app_event_mode) return;
+  reason = Deadband_Check(&app_deadband, app.out.filt, app.status, HAL_GetTick());
+  if (reason == 0U) return;
+  if (app_event_count == APP_EVENT_QUEUE)
+  {
+    app_event_overflows++;
+    return;
+  }
+  app_events[(app_event_head + app_event_count) % APP_EVENT_QUEUE].st = app;
+  app_events[(app_event_head + app_event_count) % APP_EVENT_QUEUE].reason = reason;
+  app_event_count++;
+}
+
+static void App_SampleTask(void)
+{
+  uint16_t raw;
+  uint8_t status;
+  uint32_t stamp;
+
+  if (Capture_GetState() == CAPTURE_ARMED && app_servo_loop_us == 0U)
+  {
+    /* the burst owns the bus and the CPU, nothing may touch the UART */
+    Telemetry_WaitIdle(100);
+    Capture_Run();
+    Sched_Resync();
+    /* the burst is a gap in the time-stamped positions */
+    if (app_order.points) App_SetOrder(app_order.points, app_order.orders);
+    RevStat_Resync(&app_revstat);
+    App_RestartAlarm();
+    Quad_Resync(&app_quad);
+    Commut_Resync(&app_commut);
+    Median_Resync(&app_median);
+    return;
+  }
+
+  PROF_BEGIN(PROF_REGION_READ);
+  stamp = CYCCNT_Read();
+  if (app_servo_loop_us)
+  {
+    /* the servo loop owns the bus, take its latest reading */
+    uint32_t r, primask = __get_PRIMASK();
+
+    __disable_irq();
+    r = app_servo_reading;
+    stamp = app_servo_stamp;
+    __set_PRIMASK(primask);
+    raw = (uint16_t)r;
+    status = (uint8_t)(r >> 16);
+  }
+  else if (app_oversample_n > 1U && app_source == AMS5600_getRawAngle)
+  {
+    /* the whole burst in one transfer at the bus rate */
+    status = AMS5600_getRawAngleBurst(app_oversample_raw, app_oversample_n);
+    if (status == HAL_OK)
+    {
+      Oversample_Mean(app_oversample_raw, app_oversample_n, &app_oversample);
+      app_oversample_bursts++;
+      raw = app_oversample.raw;
+    }
+  }
+  else
+    status = app_source(&raw);
+  PROF_END(PROF_REGION_READ);
+
+  if (status != HAL_OK)
+  {
+    app.i2c_errors++;
+    app.status |= APP_STATUS_READ_ERROR;
+    DLOG_WRN("raw angle read failed, status %u, errors %" PRIu32 "\n", status, app.i2c_errors);
+    Quad_Resync(&app_quad);
+    Commut_Resync(&app_commut);
+    Median_Resync(&app_median);
+    if (app_alarm_on) App_CheckAlarm(stamp, 0);
+    App_CheckEvent();
+    return;
+  }
+  if (app_median.window)
+  {
+    /* an outlier goes on as its replacement, to everything below */
+    uint32_t period = App_GetSamplePeriod() * (SystemCoreClock / 1000000U);
+    uint32_t dt = (uint32_t)(((uint64_t)(stamp - app_median_stamp) * MEDIAN_DT_ONE) / period);
+
+    PROF_BEGIN(PROF_REGION_MEDIAN);
+    if (dt > MEDIAN_DT_MAX) Median_Resync(&app_median);
+    app_median_stamp = stamp;
+    raw = Median_Push(&app_median, raw, (uint16_t)(dt > MEDIAN_DT_MAX ? MEDIAN_DT_MAX : dt));
+    PROF_END(PROF_REGION_MEDIAN);
+  }
+  app.status &= (uint8_t)~APP_STATUS_READ_ERROR;
+  app.raw = raw;
+  app.samples++;
+  if (app_oversample_n > 1U && app_source == AMS5600_getRawAngle && app_servo_loop_us == 0U &&
+      !app_median.outlier)
+  {
+    app.angle16 = app_oversample.angle;
+    app.noise = app_oversample.noise;
+  }
+  else
+  {
+    app.angle16 = (uint16_t)(raw << 4);
+    app.noise = 0;
+  }
+
+#if APP_RECORD
+  Recorder_Step(&app_recorder, &app_pipeline, raw, &app.out);
+#else
+  Pipeline_Step(&app_pipeline, raw, &app.out);
+#endif
+  if (app_alarm_on) App_CheckAlarm(stamp, 1);
+  if (app_quad.ppr) App_PlanQuad(stamp);
+  if (app_commut.pole_pairs)
+  {
+    /* App_GetElectrical() may interrupt */
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    Commut_Sample(&app_commut, raw, stamp);
+    __set_PRIMASK(primask);
+  }
+  if (app_lagcomp_on)
+  {
+    uint32_t period_us = Sched_GetTask(app_sample_task)->period_us;
+
+    app_lagcomp_sensor_ns = LagComp_SensorNs(&app_lagcomp, app.out.vel, period_us);
+    app_lagcomp_age_ns = App_CyclesToNs(CYCCNT_Read() - stamp) + (uint32_t)app_lagcomp_sensor_ns;
+    if (app_lagcomp_age_ns > app_lagcomp_age_max_ns) app_lagcomp_age_max_ns = app_lagcomp_age_ns;
+    app.comp = LagComp_Extrapolate(app.out.pos, app.out.vel, (int32_t)app_lagcomp_age_ns, period_us);
+  }
+  else
+    app.comp = app.out.pos;
+
+  if (app_decim.cfg.kind != DECIM_OFF)
+  {
+    int32_t y;
+
+    PROF_BEGIN(PROF_REGION_DECIMATE);
+    if (Decim_Push(&app_decim, (app.out.pos + 8) >> 4, &y)) app.decim = y;
+    PROF_END(PROF_REGION_DECIMATE);
+  }
+
+  Spectrum_Push(&app_spectrum, app.out.pos);
+
+  if (app_order.points)
+  {
+    /* the read start is the acquisition instant, up to a constant delay */
+    PROF_BEGIN(PROF_REGION_ORDER);
+    if (Order_Push(&app_order, app.out.pos, stamp)) app_order_pending = 1;
+    PROF_END(PROF_REGION_ORDER);
+  }
+
+  if (app_revstat_on)
+  {
+    PROF_BEGIN(PROF_REGION_REVSTAT);
+    if (RevStat_Push(&app_revstat, raw, app.out.vel, stamp))
+    {
+      if (app_rev_count == APP_REVSTAT_QUEUE)
+        app_rev_overflows++;
+      else
+        app_revs[(app_rev_head + app_rev_count++) % APP_REVSTAT_QUEUE] = app_revstat.record;
+    }
+    PROF_END(PROF_REGION_REVSTAT);
+  }
+
+  if (app_out_format == APP_OUT_STREAM)
+  {
+    PROF_BEGIN(PROF_REGION_COMPRESS);
+    Stream_Push(&app_stream, raw);
+    PROF_END(PROF_REGION_COMPRESS);
+  }
+  App_CheckEvent();
+
+  /* queued register accesses go after the acquisition, in the slack */
+  {
+    const Sched_TaskTypeDef *t = Sched_GetTask(app_sample_task);
+    uint64_t now = Sched_Now(), next = t->next_release + t->period;
+
+    if (app_servo_loop_us)
+      Cmd_BusService(0U);   /* not while the servo loop owns the bus */
+    else
+      Cmd_BusService(next > now ? (uint32_t)((next - now) / (SystemCoreClock / 1000000U)) : 0U);
+  }
+}
+
+/* snprintf at line[len] of a line of size bytes, returns the new length,
+   at most size - 1 when the text was cut */
+static int App_Append(char *line, int len, int size, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(&line[len], (size_t)(size - len), fmt, ap);
+  va_end(ap);
+  if (n < 0) return len;
+  return n < size - len ? len + n : size - 1;
+}
+
+/* append ", name : value" style fields with the three-space separator */
+static int App_FormatText(const App_StateTypeDef *st, uint8_t reason, char *line, int size)
+{
+  int len = 0;
+
+  if (app_out_fields & APP_FIELD_RAW)
+    len = App_Append(line, len, size, "rawAngle : %d", st->raw);
+  if (app_out_fields & APP_FIELD_ANGLE)
+  {
+    double angle;
+
+    PROF_BEGIN(PROF_REGION_CONVERT);
+    angle = st->angle16 * 0.0054931640625;
+    PROF_END(PROF_REGION_CONVERT);
+    len = App_Append(line, len, size, "%sAngle (deg) : %f", len ? "   " : "", angle);
+    if (app_oversample_n > 1U) len = App_Append(line, len, size, "   noise : %u", st->noise);
+  }
+  if (app_out_fields & APP_FIELD_POS)
+    len = App_Append(line, len, size, "%spos : %" PRId32, len ? "   " : "", st->out.pos);
+  if (app_out_fields & APP_FIELD_FILT)
+    len = App_Append(line, len, size, "%sfilt : %" PRId32, len ? "   " : "", st->out.filt);
+  if (app_out_fields & APP_FIELD_VEL)
+    len = App_Append(line, len, size, "%svel : %" PRId32, len ? "   " : "", st->out.vel);
+  if (app_out_fields & APP_FIELD_DECIM)
+    len = App_Append(line, len, size, "%sdecim : %" PRId32, len ? "   " : "", st->decim);
+  if (app_out_fields & APP_FIELD_COMP)
+    len = App_Append(line, len, size, "%scomp : %" PRId32, len ? "   " : "", st->comp);
+  if ((app_out_fields & APP_FIELD_EVENT) && reason)
+    len = App_Append(line, len, size, "%sevent :%s%s%s", len ? "   " : "",
+                    (reason & DEADBAND_MOVE) ? " move" : "", (reason & DEADBAND_STATUS) ? " status" : "",
+                    (reason & DEADBAND_HEARTBEAT) ? " heartbeat" : "");
+  if (len == 0) return 0;
+  return App_Append(line, len, size, "\n");
+}
+
+static uint8_t App_FormatBinary(const App_StateTypeDef *st, uint8_t reason, uint8_t *p)
+{
+  uint8_t *start = p;
+  const int32_t q4[3] = { st->out.pos, st->out.filt, st->out.vel };
+
+  for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(st->samples >> (8U * i));
+  *p++ = (uint8_t)app_out_fields;
+  *p++ = (uint8_t)(app_out_fields >> 8);
+  if (app_out_fields & APP_FIELD_RAW)
+  {
+    *p++ = (uint8_t)st->raw;
+    *p++ = (uint8_t)(st->raw >> 8);
+  }
+  if (app_out_fields & APP_FIELD_ANGLE)
+  {
+    uint16_t cdeg = (uint16_t)((st->angle16 * 36000UL) >> 16);
+
+    *p++ = (uint8_t)cdeg;
+    *p++ = (uint8_t)(cdeg >> 8);
+  }
+  for (uint32_t f = 0; f < 3U; f++)
+  {
+    if (!(app_out_fields & (APP_FIELD_POS << f))) continue;
+    for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)((uint32_t)q4[f] >> (8U * i));
+  }
+  if (app_out_fields & APP_FIELD_HEALTH)
+  {
+    *p++ = st->magnet;
+    *p++ = st->agc;
+  }
+  if (app_out_fields & APP_FIELD_EVENT) *p++ = reason;
+  if (app_out_fields & APP_FIELD_DECIM)
+  {
+    for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)((uint32_t)st->decim >> (8U * i));
+  }
+  if (app_out_fields & APP_FIELD_COMP)
+  {
+    for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)((uint32_t)st->comp >> (8U * i));
+  }
+  return (uint8_t)(p - start);
+}
+
+/* send the queued event samples, as many as the UART takes */
+static void App_DrainEvents(void)
+{
+  char line[APP_TEXT_LINE_LEN];
+  uint8_t frame[APP_OUTPUT_FRAME_LEN];
+  int len;
+
+  while (app_event_count)
+  {
+    const App_StateTypeDef *st = &app_events[app_event_head].st;
+    uint8_t reason = app_events[app_event_head].reason;
+
+    if (app_out_format == APP_OUT_BINARY)
+    {
+      len = App_FormatBinary(st, reason, frame);
+      if (Telemetry_WriteFrame(TELEMETRY_FRAME_OUTPUT, frame, (uint8_t)len) == 0U) return;
+    }
+    else if (app_out_format == APP_OUT_TEXT)
+    {
+      len = App_FormatText(st, reason, line, sizeof(line));
+      if ((reason & DEADBAND_STATUS) && (app_out_fields & APP_FIELD_HEALTH))
+        len = App_Append(line, len, sizeof(line), "magnet : %d   agc : %d\n", st->magnet, st->agc);
+      if (len && Telemetry_Write(line, (uint16_t)len) == 0U) return;
+    }
+    app_event_head = (uint8_t)((app_event_head + 1U) % APP_EVENT_QUEUE);
+    app_event_count--;
+  }
+}
+
+/* the latest revolution as text line or ORDER frame, 0 = no room */
+static int App_SendOrder(void)
+{
+  const Order_ResultTypeDef *r = &app_order.result;
+  uint32_t period_us = CYCCNT_ToUs(r->ticks);
+  uint8_t frame[APP_ORDER_FRAME_LEN(ORDER_MAX_ORDERS)], *p = frame;
+  char line[160];
+  int len;
+
+  if (app_out_format == APP_OUT_TEXT)
+  {
+    len = App_Append(line, 0, sizeof(line), "order %" PRIu32 " %.1f rpm %u samples :", r->rev,
+                   period_us ? 60e6 / period_us : 0.0, r->samples);
+    for (uint32_t k = 0; k < r->orders; k++)
+      len = App_Append(line, len, sizeof(line), " %.3f", r->amp_mc[k] / 1000.0);
+    len = App_Append(line, len, sizeof(line), "\n");
+    return Telemetry_Write(line, (uint16_t)len) != 0U;
+  }
+  if (app_out_format == APP_OUT_OFF) return 1;
+
+  for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->rev >> (8U * i));
+  for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(period_us >> (8U * i));
+  *p++ = (uint8_t)r->samples;
+  *p++ = (uint8_t)(r->samples >> 8);
+  *p++ = r->orders;
+  for (uint32_t k = 0; k < r->orders; k++)
+  {
+    for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->amp_mc[k] >> (8U * i));
+  }
+  return Telemetry_WriteFrame(TELEMETRY_FRAME_ORDER, frame, (uint8_t)(p - frame)) != 0U;
+}
+
+/* send the queued alarm events, as many as the UART takes */
+static void App_DrainAlarms(void)
+{
+  static const char *const names[ALARM_KINDS] = { " overspeed", " stall", " reversal", " window", " sensor" };
+  char line[160];
+  uint8_t frame[APP_ALARM_FRAME_LEN], *p;
+  int len;
+
+  while (app_alarm_count)
+  {
+    const App_AlarmRecordTypeDef *r = &app_alarms[app_alarm_head];
+
+    if (app_out_format == APP_OUT_TEXT)
+    {
+      len = App_Append(line, 0, sizeof(line), "alarm :");
+      for (uint32_t k = 0; k < ALARM_KINDS; k++)
+      {
+        if (r->raised & (1U << k)) len = App_Append(line, len, sizeof(line), "%s", names[k]);
+      }
+      len = App_Append(line, len, sizeof(line), "   at %" PRIu32 " ms sample %" PRIu32 "   pos : %" PRId32
+                      "   speed %.2f rpm   latency %" PRIu32 " ns\n", r->tick_ms, r->sample, r->pos,
+                      r->speed_crpm / 100.0, r->latency_ns);
+      if (Telemetry_Write(line, (uint16_t)len) == 0U) return;
+    }
+    else if (app_out_format != APP_OUT_OFF)
+    {
+      p = frame;
+      for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->tick_ms >> (8U * i));
+      for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->sample >> (8U * i));
+      *p++ = r->raised;
+      *p++ = r->output;
+      for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)((uint32_t)r->pos >> (8U * i));
+      for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)((uint32_t)r->speed_crpm >> (8U * i));
+      for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->latency_ns >> (8U * i));
+      if (Telemetry_WriteFrame(TELEMETRY_FRAME_ALARM, frame, (uint8_t)(p - frame)) == 0U) return;
+    }
+    app_alarm_head = (uint8_t)((app_alarm_head + 1U) % APP_ALARM_QUEUE);
+    app_alarm_count--;
+  }
+}
+
+/* send the queued revolution records, as many as the UART takes */
+static void App_DrainRevs(void)
+{
+  char line[160];
+  uint8_t frame[APP_REVSTAT_FRAME_LEN], *p;
+  int len;
+
+  while (app_rev_count)
+  {
+    const RevStat_RecordTypeDef *r = &app_revs[app_rev_head];
+
+    if (app_out_format == APP_OUT_TEXT)
+    {
+      len = App_Append(line, 0, sizeof(line), "rev %" PRIu32 "   period %" PRIu32 " us   speed %.2f rpm   ripple %.2f rpm"
+                       "   acc %" PRId32 "..%" PRId32 " rpm/s   samples %u\n", r->rev, r->period_us,
+                       r->speed_crpm / 100.0, r->ripple_crpm / 100.0, r->acc_min, r->acc_max, r->samples);
+      if (Telemetry_Write(line, (uint16_t)len) == 0U) return;
+    }
+    else if (app_out_format != APP_OUT_OFF)
+    {
+      const uint32_t v[6] = { r->rev, r->period_us, (uint32_t)r->speed_crpm, r->ripple_crpm,
+                              (uint32_t)r->acc_min, (uint32_t)r->acc_max };
+
+      p = frame;
+      for (uint32_t f = 0; f < 6U; f++)
+      {
+        for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(v[f] >> (8U * i));
+      }
+      *p++ = (uint8_t)r->samples;
+      *p++ = (uint8_t)(r->samples >> 8);
+      if (Telemetry_WriteFrame(TELEMETRY_FRAME_REVOLUTION, frame, (uint8_t)(p - frame)) == 0U) return;
+    }
+    app_rev_head = (uint8_t)((app_rev_head + 1U) % APP_REVSTAT_QUEUE);
+    app_rev_count--;
+  }
+}
+
+static void App_TelemetryTask(void)
+{
+  char line[APP_TEXT_LINE_LEN];
+  uint8_t frame[APP_OUTPUT_FRAME_LEN];
+  int len;
+
+  if (Capture_GetState() >= CAPTURE_DONE)
+  {
+    Capture_Drain();
+    return;
+  }
+  if (APP_RECORD) return;   /* the UART bandwidth belongs to the recording */
+  App_DrainAlarms();
+  if (app_order_pending && App_SendOrder()) app_order_pending = 0;
+  App_DrainRevs();
+  if (app_event_mode)
+  {
+    PROF_BEGIN(PROF_REGION_FORMAT);
+    App_DrainEvents();
+    PROF_END(PROF_REGION_FORMAT);
+    app_health_dirty = 0;
+    return;
+  }
+
+  if (app_out_format == APP_OUT_BINARY)
+  {
+    PROF_BEGIN(PROF_REGION_FORMAT);
+    len = App_FormatBinary(&app, 0, frame);
+    PROF_END(PROF_REGION_FORMAT);
+
+    PROF_BEGIN(PROF_REGION_TRANSMIT);
+    Telemetry_WriteFrame(TELEMETRY_FRAME_OUTPUT, frame, (uint8_t)len);
+    PROF_END(PROF_REGION_TRANSMIT);
+    app_health_dirty = 0;
+    return;
+  }
+  if (app_out_format != APP_OUT_TEXT) return;
+
+  PROF_BEGIN(PROF_REGION_FORMAT);
+  len = App_FormatText(&app, 0, line, sizeof(line));
+  PROF_END(PROF_REGION_FORMAT);
+
+  PROF_BEGIN(PROF_REGION_TRANSMIT);
+  if (len) Telemetry_Write(line, (uint16_t)len);
+  PROF_END(PROF_REGION_TRANSMIT);
+
+  if (app_health_dirty && (app_out_fields & APP_FIELD_HEALTH))
+  {
+    len = snprintf(line, sizeof(line), "magnet : %d   agc : %d\n", app.magnet, app.agc);
+    Telemetry_Write(line, (uint16_t)len);
+  }
+  app_health_dirty = 0;
+}
+
+static void App_HealthTask(void)
+{
+  uint8_t status;
+
+  if (app_servo_loop_us) return;   /* the servo loop owns the bus */
+  status = AMS5600_getMagnetStrength(&app.magnet);
+  status |= AMS5600_getAgc(&app.agc);
+  if (status != HAL_OK)
+  {
+    app.i2c_errors++;
+    return;
+  }
+  app.status = (uint8_t)((app.status & ~APP_STATUS_MAGNET) | (app.magnet & APP_STATUS_MAGNET));
+  app_health_dirty = 1;
+  if (app_lagcomp_stale)
+  {
+    uint16_t conf;
+
+    app_lagcomp_stale = 0;
+    if (AMS5600_getConf(&conf) != HAL_OK)
+    {
+      app.i2c_errors++;
+      app_lagcomp_stale = 1;
+      return;
+    }
+    /* the trim was checked when set */
+    if (conf != app_lagcomp.conf) LagComp_Init(&app_lagcomp, conf, hi2c1.Init.ClockSpeed, app_lagcomp_trim_us);
+  }
+}
+
+static void App_LogTask(void)
+{
+  Dlog_Flush(Telemetry_Write, Telemetry_Free());
+}
+
+static void App_ButtonTask(void)
+{
+  static GPIO_PinState b1 = GPIO_PIN_SET;
+  GPIO_PinState b1_prev = b1;
+
+  // user button (active low) dumps the profile and scheduler tables
+  b1 = HAL_GPIO_ReadPin(B1_GPIO_Port, B1_Pin);
+  if (b1_prev == GPIO_PIN_SET && b1 == GPIO_PIN_RESET)
+  {
+    Profiler_Dump();
+    Sched_Dump();
+    Sched_Resync();
+  }
+}
+
+/* the result of the last block as text line or SPECTRUM frame, 0 = no room */
+static int App_SendSpectrum(void)
+{
+  const Spectrum_ResultTypeDef *r = &app_spectrum.result;
+  uint32_t period_us = App_GetSamplePeriod();
+  uint8_t frame[APP_SPECTRUM_FRAME_LEN], *p = frame;
+  char line[160];
+  int len;
+
+  if (app_out_format == APP_OUT_TEXT)
+  {
+    len = App_Append(line, 0, sizeof(line), "spectrum %" PRIu32 " n %u :", r->block, r->n);
+    for (uint32_t i = 0; i < SPECTRUM_TOP_K && r->peak[i].bin_q4; i++)
+      len = App_Append(line, len, sizeof(line), "   %.2f Hz %.3f",
+                      r->peak[i].bin_q4 * 1e6 / (16.0 * r->n * period_us), r->peak[i].amp_mc / 1000.0);
+    len = App_Append(line, len, sizeof(line), "   bands");
+    for (uint32_t b = 0; b < SPECTRUM_BANDS; b++)
+      len = App_Append(line, len, sizeof(line), " %" PRIu32, r->band_mc2[b]);
+    len = App_Append(line, len, sizeof(line), "\n");
+    return Telemetry_Write(line, (uint16_t)len) != 0U;
+  }
+  if (app_out_format == APP_OUT_OFF) return 1;
+
+  for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->block >> (8U * i));
+  *p++ = (uint8_t)r->n;
+  *p++ = (uint8_t)(r->n >> 8);
+  for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(period_us >> (8U * i));
+  for (uint32_t k = 0; k < SPECTRUM_TOP_K; k++)
+  {
+    *p++ = (uint8_t)r->peak[k].bin_q4;
+    *p++ = (uint8_t)(r->peak[k].bin_q4 >> 8);
+    for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->peak[k].amp_mc >> (8U * i));
+  }
+  for (uint32_t b = 0; b < SPECTRUM_BANDS; b++)
+  {
+    for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->band_mc2[b] >> (8U * i));
+  }
+  for (uint32_t i = 0; i < 4U; i++) *p++ = (uint8_t)(r->cycles >> (8U * i));
+  return Telemetry_WriteFrame(TELEMETRY_FRAME_SPECTRUM, frame, (uint8_t)(p - frame)) != 0U;
+}
+
+static void App_SpectrumTask(void)
+{
+  int done;
+
+  if (app_spectrum_pending)
+  {
+    /* the UART is shared with captures and recordings, which come first */
+    if (APP_RECORD || Capture_GetState() != CAPTURE_IDLE || App_SendSpectrum()) app_spectrum_pending = 0;
+    return;
+  }
+  PROF_BEGIN(PROF_REGION_SPECTRUM);
+  done = Spectrum_Service(&app_spectrum, APP_SPECTRUM_STEPS);
+  PROF_END(PROF_REGION_SPECTRUM);
+  if (done) app_spectrum_pending = 1;
+}
+
+static void App_OnFrame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+  if (type == TELEMETRY_FRAME_CMD)
+    Cmd_OnFrame(payload, len);
+#if APP_HIL
+  else
+    Hil_OnFrame(type, payload, len);
+#endif
+}
+
+static void App_RxTask(void)
+{
+  UartRx_Poll(App_OnFrame);
+#if APP_HIL
+  Hil_Report();
+#endif
+}
+
+static int App_FindTask(Sched_TaskFn fn)
+{
+  const Sched_TaskTypeDef *t;
+
+  for (int i = 0; (t = Sched_GetTask(i)) != NULL; i++)
+  {
+    if (t->fn == fn) return i;
+  }
+  return -1;
+}
+
+/**
+  * @brief  Register the application tasks and start the scheduler.
+  *         Sched_Dispatch() must then be called from the main loop.
+  * @retval None
+  */
+void App_Init(void)
+{
+  Pipeline_ConfigTypeDef cfg;
+
+  Pipeline_DefaultConfig(&cfg);
+  Pipeline_Init(&app_pipeline, &cfg);
+#if APP_RECORD
+  Recorder_Init(&app_recorder, Telemetry_WriteFrame);
+#endif
+  Deadband_Init(&app_deadband, APP_EVENT_DEADBAND, APP_EVENT_HEARTBEAT_MS);
+  if (App_SetDecimation((Decim_KindTypeDef)APP_DECIM, APP_DECIM_RATIO, APP_DECIM_PARAM) != 0)
+    DLOG_ERR("invalid APP_DECIM configuration\n");
+  if (App_SetSpectrum(APP_SPECTRUM_N) != 0)
+    DLOG_ERR("invalid APP_SPECTRUM_N\n");
+  if (App_SetOrder(APP_ORDER_POINTS, APP_ORDER_ORDERS) != 0)
+    DLOG_ERR("invalid APP_ORDER configuration\n");
+  if (App_SetRevStat(APP_REVSTAT, APP_REVSTAT_HYST, APP_REVSTAT_ACC_SHIFT) != 0)
+    DLOG_ERR("invalid APP_REVSTAT configuration\n");
+
+  Sched_AddTask("sample", App_SampleTask, APP_SAMPLE_PERIOD_US);
+  Sched_AddTask("telemetry", App_TelemetryTask, APP_TELEMETRY_PERIOD_US);
+  Sched_AddTask("health", App_HealthTask, APP_HEALTH_PERIOD_US);
+  Sched_AddTask("log", App_LogTask, APP_LOG_PERIOD_US);
+  Sched_AddTask("button", App_ButtonTask, APP_BUTTON_PERIOD_US);
+  Sched_AddTask("rx", App_RxTask, APP_RX_PERIOD_US);
+  Sched_AddTask("spectrum", App_SpectrumTask, APP_SPECTRUM_PERIOD_US);
+  /* handles move while tasks are inserted in rate order */
+  app_sample_task = App_FindTask(App_SampleTask);
+  app_telemetry_task = App_FindTask(App_TelemetryTask);
+  {
+    /* limits per sample need the sample task */
+    const Alarm_ConfigTypeDef alarm = {
+      .overspeed_rpm = APP_ALARM_OVERSPEED_RPM,
+      .stall_rpm = APP_ALARM_STALL_RPM,
+      .stall_ms = APP_ALARM_STALL_MS,
+      .reversal_counts = APP_ALARM_REVERSAL_COUNTS,
+      .window_min = APP_ALARM_WINDOW_MIN,
+      .window_max = APP_ALARM_WINDOW_MAX,
+      .latch = APP_ALARM_LATCH,
+      .read_errors = APP_ALARM_READ_ERRORS,
+    };
+
+    if (App_SetAlarm(&alarm) != 0) DLOG_ERR("invalid APP_ALARM configuration\n");
+  }
+  if (App_SetQuad(APP_QUAD_PPR, APP_QUAD_MAX_HZ) != 0)
+    DLOG_ERR("invalid APP_QUAD configuration\n");
+  if (App_SetCommut(APP_COMMUT_POLE_PAIRS, APP_COMMUT_OFFSET, APP_COMMUT_LEAD_US) != 0)
+    DLOG_ERR("invalid APP_COMMUT configuration\n");
+  if (App_SetLagComp(APP_LAGCOMP, APP_LAGCOMP_TRIM_US) != 0)
+    DLOG_ERR("invalid APP_LAGCOMP configuration\n");
+  if (App_SetOversample(APP_OVERSAMPLE_N) != 0)
+    DLOG_ERR("invalid APP_OVERSAMPLE_N\n");
+  if (App_SetMedian(APP_MEDIAN_WINDOW, APP_MEDIAN_K, APP_MEDIAN_FLOOR) != 0)
+    DLOG_ERR("invalid APP_MEDIAN configuration\n");
+  /* PWM always runs, at 0 % while the servo is off */
+  __HAL_TIM_SET_COMPARE(&htim3, TIM_CHANNEL_1, 0U);
+  HAL_TIM_PWM_Start(&htim3, TIM_CHANNEL_1);
+  if (APP_SERVO_LOOP_US != 0U)
+  {
+    const Servo_ConfigTypeDef servo = {
+      .kp = APP_SERVO_KP, .ki = APP_SERVO_KI, .kd = APP_SERVO_KD,
+      .kv = APP_SERVO_KV, .ka = APP_SERVO_KA,
+      .d_shift = APP_SERVO_D_SHIFT, .out_max = APP_SERVO_OUT_MAX,
+    };
+
+    if (App_SetServo(APP_SERVO_LOOP_US, &servo) != 0) DLOG_ERR("invalid APP_SERVO configuration\n");
+  }
+  if (UartRx_Start() != 0) DLOG_ERR("uart rx start failed\n");
+  Sched_Start();
+
+#if APP_CAPTURE_AT_BOOT
+  {
+    Capture_ConfigTypeDef cfg = {
+      .trigger = CAPTURE_TRIG_VELOCITY,
+      .velocity = APP_CAPTURE_AT_BOOT,
+      .pre_samples = CAPTURE_BUFFER_SAMPLES / 4U,
+      .post_samples = CAPTURE_BUFFER_SAMPLES - CAPTURE_BUFFER_SAMPLES / 4U,
+      .timeout_ms = CAPTURE_TIMEOUT_MAX_MS,
+    };
+    if (app_servo_loop_us == 0U) Capture_Arm(&cfg);
+  }
+#endif
+}
+
+/**
+  * @brief  Replace the raw angle provider of the sample task, e.g. by a
+  *         replay or injection source. NULL restores AMS5600_getRawAngle().
+  * @retval None
+  */
+void App_SetSampleSource(App_SourceFn fn)
+{
+  app_source = fn ? fn : AMS5600_getRawAngle;
+}
+
+/**
+  * @brief  Select the telemetry output.
+  * @param  format: text line, binary frame, compressed stream or off
+  * @param  fields: APP_FIELD_xxx mask, not used by the stream
+  * @retval 0 on success, -1 on an invalid format or field
+  */
+int App_SetOutput(App_OutFormatTypeDef format, uint16_t fields)
+{
+  if (format > APP_OUT_STREAM || (fields & ~APP_FIELD_ALL)) return -1;
+  if (app_out_format == APP_OUT_STREAM && format != APP_OUT_STREAM)
+    Stream_Flush(&app_stream);
+  else if (app_out_format != APP_OUT_STREAM && format == APP_OUT_STREAM)
+    Stream_Init(&app_stream, Telemetry_WriteFrame, app.samples);
+  app_out_format = format;
+  app_out_fields = fields;
+  return 0;
+}
+
+/* an oversampling burst takes at most half the sample period */
+static int App_OversampleFits(uint16_t n, uint32_t period_us)
+{
+  return n <= 1U || Oversample_BusNs(n, hi2c1.Init.ClockSpeed) <= period_us * 500U;
+}
+
+/* the edge rate limit leaves at least one whole cycle per sample period,
+   Quad_Plan() drops what does not fit in whole cycles */
+static int App_QuadFits(const Quad_TypeDef *q, uint32_t period_us)
+{
+  return q->ppr == 0U || period_us * (SystemCoreClock / 1000000U) / q->min_ticks >= 4U;
+}
+
+/**
+  * @brief  Change the sample and telemetry periods, from the next release.
+  *         The rate-monotonic order of the tasks is kept as registered, so
+  *         the sample period should stay the shortest one.
+  * @param  sample_us: APP_SAMPLE_PERIOD_MIN_US..APP_PERIOD_MAX_US, 0 = keep,
+  *         long enough for the oversampling burst and 4 encoder edges
+  * @param  telemetry_us: up to APP_PERIOD_MAX_US, 0 = keep
+  * @retval 0 on success, -1 on an out of range period
+  */
+int App_SetPeriods(uint32_t sample_us, uint32_t telemetry_us)
+{
+  if (sample_us && (sample_us < APP_SAMPLE_PERIOD_MIN_US || sample_us > APP_PERIOD_MAX_US)) return -1;
+  if (sample_us && !App_OversampleFits(app_oversample_n, sample_us)) return -1;
+  if (sample_us && !App_QuadFits(&app_quad, sample_us)) return -1;
+  if (telemetry_us && (telemetry_us < APP_SAMPLE_PERIOD_MIN_US || telemetry_us > APP_PERIOD_MAX_US)) return -1;
+  if (sample_us) Sched_SetPeriod(app_sample_task, sample_us);
+  if (telemetry_us) Sched_SetPeriod(app_telemetry_task, telemetry_us);
+  if (sample_us) App_SetSpectrum(app_spectrum.n);   /* blocks are uniformly sampled */
+  if (sample_us) App_RestartAlarm();   /* limits are per sample */
+  return 0;
+}
+
+/**
+  * @brief  Change the pipeline filter constants, the filter state is kept.
+  * @param  filter_shift: position low-pass, 0..15
+  * @param  vel_shift: velocity low-pass, 0..15
+  * @retval 0 on success, -1 on an out of range shift
+  */
+int App_SetFilter(uint8_t filter_shift, uint8_t vel_shift)
+{
+  if (filter_shift > 15U || vel_shift > 15U) return -1;
+  app_pipeline.cfg.filter_shift = filter_shift;
+  app_pipeline.cfg.vel_shift = vel_shift;
+#if APP_RECORD
+  app_recorder.need_state = 1;   /* replay needs the new configuration */
+#endif
+  return 0;
+}
+
+/**
+  * @brief  Switch the change-driven output on or off. While on, the
+  *         telemetry task sends only the samples that left the deadband,
+  *         changed the status or are due as heartbeat, in the selected
+  *         text or binary format.
+  * @param  enable: 0 = one output per telemetry period
+  * @param  deadband: counts the filtered position may move silently
+  * @param  heartbeat_ms: longest silence, 0 = none
+  * @retval 0 on success, -1 on a heartbeat beyond APP_EVENT_HEARTBEAT_MAX_MS
+  */
+int App_SetEventMode(uint8_t enable, uint16_t deadband, uint32_t heartbeat_ms)
+{
+  if (heartbeat_ms > APP_EVENT_HEARTBEAT_MAX_MS) return -1;
+  Deadband_Init(&app_deadband, deadband, heartbeat_ms);
+  app_event_count = 0;
+  app_event_overflows = 0;
+  app_event_mode = enable ? 1U : 0U;
+  return 0;
+}
+
+/**
+  * @brief  Counters of the change-driven output since it was configured.
+  * @retval None
+  */
+void App_GetEventStats(App_EventStatsTypeDef *stats)
+{
+  stats->checked = app_deadband.checked;
+  stats->suppressed = app_deadband.suppressed;
+  stats->moves = app_deadband.moves;
+  stats->status_changes = app_deadband.status_changes;
+  stats->heartbeats = app_deadband.heartbeats;
+  stats->overflows = app_event_overflows;
+}
+
+/**
+  * @brief  Configure the decimation of the position, from the next sample.
+  *         The output rate is the sample rate / ratio; publishing it takes a
+  *         telemetry period of the same length. Designing FIR coefficients
+  *         takes two cosf() and one sinf() per tap on the single-precision
+  *         FPU, in the rx task.
+  * @param  kind: DECIM_OFF, DECIM_CIC or DECIM_FIR
+  * @param  ratio: 2..DECIM_MAX_RATIO
+  * @param  param: CIC order or FIR taps, 0 = order 3 / 4 taps per ratio
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int App_SetDecimation(Decim_KindTypeDef kind, uint8_t ratio, uint8_t param)
+{
+  Decim_ConfigTypeDef cfg = { .kind = kind, .ratio = ratio };
+
+  if (kind == DECIM_CIC) cfg.order = param ? param : 3U;
+  if (kind == DECIM_FIR)
+    cfg.taps = param ? param : (uint8_t)(ratio <= DECIM_FIR_MAX_TAPS / 4U ? 4U * ratio : DECIM_FIR_MAX_TAPS);
+  return Decim_Init(&app_decim, &cfg);
+}
+
+/**
+  * @brief  Decimator configuration, resolution gain and counters.
+  * @retval decimator
+  */
+const Decim_TypeDef *App_GetDecimation(void)
+{
+  return &app_decim;
+}
+
+/**
+  * @brief  Start the block spectrum of the position, or stop it. A block
+  *         being acquired or analysed is discarded.
+  * @param  n: block length, power of two SPECTRUM_MIN_N..SPECTRUM_MAX_N,
+  *         0 = off
+  * @retval 0 on success, -1 on an invalid length
+  */
+int App_SetSpectrum(uint16_t n)
+{
+  app_spectrum_pending = 0;
+  return Spectrum_Init(&app_spectrum, n);
+}
+
+/**
+  * @brief  Spectrum block counters and last result.
+  * @retval spectrum state
+  */
+const Spectrum_TypeDef *App_GetSpectrum(void)
+{
+  return &app_spectrum;
+}
+
+/**
+  * @brief  Start order tracking of the position, or stop it. The revolution
+  *         in progress is discarded, results start with the second complete
+  *         revolution (order.h).
+  * @param  points: grid points per revolution, power of two
+  *         ORDER_MIN_POINTS..ORDER_MAX_POINTS, 0 = off
+  * @param  orders: orders reported, 1..ORDER_MAX_ORDERS and up to points / 2
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int App_SetOrder(uint16_t points, uint8_t orders)
+{
+  app_order_pending = 0;
+  return Order_Init(&app_order, points, orders, APP_ORDER_MAX_REV_MS * (SystemCoreClock / 1000U));
+}
+
+/**
+  * @brief  Order tracking counters and last result.
+  * @retval order tracking state
+  */
+const Order_TypeDef *App_GetOrder(void)
+{
+  return &app_order;
+}
+
+/**
+  * @brief  Switch the per-revolution statistics records on or off. The
+  *         revolution in progress and the queued records are discarded,
+  *         counting starts at the next wrap of the raw angle (revstat.h).
+  * @param  enable: 0 = off
+  * @param  hysteresis: counts the angle may go back across the zero,
+  *         up to a quarter turn
+  * @param  acc_shift: acceleration low-pass, 0..15
+  * @retval 0 on success, -1 on an out of range argument
+  */
+int App_SetRevStat(uint8_t enable, uint16_t hysteresis, uint8_t acc_shift)
+{
+  if (hysteresis > 1024U || acc_shift > 15U) return -1;
+  RevStat_Init(&app_revstat, hysteresis, acc_shift, APP_REVSTAT_MAX_REV_MS * (SystemCoreClock / 1000U),
+               SystemCoreClock);
+  app_rev_count = 0;
+  app_rev_overflows = 0;
+  app_revstat_on = enable ? 1U : 0U;
+  return 0;
+}
+
+/**
+  * @brief  Counters of the revolution statistics since they were configured.
+  * @retval None
+  */
+void App_GetRevStats(App_RevStatsTypeDef *stats)
+{
+  stats->enabled = app_revstat_on;
+  stats->revolutions = app_revstat.revs;
+  stats->aborts = app_revstat.aborts;
+  stats->overflows = app_rev_overflows;
+}
+
+/**
+  * @brief  Set the alarm limits (alarm.h), from the next sample. Alarms
+  *         set and queued events are cleared, ALARM_Pin follows the next
+  *         sample. All limits 0 (and window_min >= window_max) and no
+  *         read error count stops the check and releases the pin.
+  * @param  cfg: limits
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int App_SetAlarm(const Alarm_ConfigTypeDef *cfg)
+{
+  if (Alarm_Init(&app_alarm, cfg, App_GetSamplePeriod()) != 0) return -1;
+  app_alarm_count = 0;
+  app_alarm_overflows = 0;
+  memset(&app_alarm_latency, 0, sizeof(app_alarm_latency));
+  app_alarm_on = (cfg->overspeed_rpm || cfg->stall_rpm || cfg->reversal_counts || cfg->window_min < cfg->window_max ||
+                  cfg->read_errors);
+  if (!app_alarm_on)
+  {
+    HAL_GPIO_WritePin(ALARM_GPIO_Port, ALARM_Pin, GPIO_PIN_RESET);
+    app_alarm_level = 0;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Release latched alarms, ALARM_Pin drops at the next sample unless
+  *         a condition is still active.
+  * @retval None
+  */
+void App_ClearAlarm(void)
+{
+  Alarm_Clear(&app_alarm);
+}
+
+/**
+  * @brief  Alarm state, event counters and detection latency since the
+  *         limits were set.
+  * @retval None
+  */
+void App_GetAlarmStats(App_AlarmStatsTypeDef *stats)
+{
+  stats->output = Alarm_Output(&app_alarm);
+  stats->latched = app_alarm.latched;
+  stats->events = 0;
+  for (uint32_t k = 0; k < ALARM_KINDS; k++) stats->events += app_alarm.events[k];
+  stats->overflows = app_alarm_overflows;
+  stats->latency_last_ns = App_CyclesToNs(app_alarm_latency.last);
+  stats->latency_max_ns = App_CyclesToNs(app_alarm_latency.max);
+  stats->latency_mean_ns = App_MeanLatencyNs(&app_alarm_latency);
+}
+
+/**
+  * @brief  Select the encoder emulation (quad.h), from the next sample,
+  *         which the output takes without edges. 0 lines stops TIM2 and
+  *         drops the QUAD_x pins.
+  * @param  ppr: lines per revolution, up to QUAD_MAX_PPR, 0 = off
+  * @param  max_hz: highest edge rate, up to QUAD_MAX_EDGE_HZ and at least
+  *         4 edges per sample period
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int App_SetQuad(uint16_t ppr, uint32_t max_hz)
+{
+  Quad_TypeDef q;
+
+  if (Quad_Init(&q, ppr, max_hz, SystemCoreClock) != 0) return -1;
+  if (!App_QuadFits(&q, App_GetSamplePeriod())) return -1;
+  HAL_TIM_Base_Stop_IT(&htim2);
+  app_quad = q;
+  app_quad_late = 0;
+  memset(&app_quad_latency, 0, sizeof(app_quad_latency));
+  if (ppr == 0U)
+  {
+    HAL_GPIO_WritePin(QUAD_A_GPIO_Port, QUAD_A_Pin, GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(QUAD_B_GPIO_Port, QUAD_B_Pin, GPIO_PIN_RESET);
+    HAL_GPIO_WritePin(QUAD_Z_GPIO_Port, QUAD_Z_Pin, GPIO_PIN_RESET);
+    app_quad_pins = 0;
+    return 0;
+  }
+  /* idle until the first plan */
+  __HAL_TIM_SET_AUTORELOAD(&htim2, 0xFFFFFFFFU);
+  __HAL_TIM_SET_COUNTER(&htim2, 0U);
+  HAL_TIM_Base_Start_IT(&htim2);
+  return 0;
+}
+
+/**
+  * @brief  Encoder emulation state, counters and latency since it was
+  *         selected.
+  * @retval None
+  */
+void App_GetQuadStats(App_QuadStatsTypeDef *stats)
+{
+  stats->ppr = app_quad.ppr;
+  stats->pos = app_quad.pos;
+  stats->limited = app_quad.limited;
+  stats->dropped = app_quad.dropped;
+  stats->late = app_quad_late;
+  stats->latency_last_ns = App_CyclesToNs(app_quad_latency.last);
+  stats->latency_max_ns = App_CyclesToNs(app_quad_latency.max);
+  stats->latency_mean_ns = App_MeanLatencyNs(&app_quad_latency);
+}
+
+/**
+  * @brief  Edge interrupt of the encoder emulation, called from
+  *         HAL_TIM_PeriodElapsedCallback() for TIM2.
+  * @retval None
+  */
+void App_QuadEdge(void)
+{
+  uint8_t first;
+  uint32_t next;
+
+  PROF_BEGIN(PROF_REGION_QUAD_EDGE);
+  first = app_quad.left != 0U && app_quad.left == app_quad.planned;
+  next = Quad_Edge(&app_quad);
+  /* no preload: the new interval is the one running */
+  __HAL_TIM_SET_AUTORELOAD(&htim2, next ? next - 1U : 0xFFFFFFFFU);
+  if (next && __HAL_TIM_GET_COUNTER(&htim2) > next - 1U)
+  {
+    /* entered too late for this interval, the edge goes out at once */
+    __HAL_TIM_SET_COUNTER(&htim2, next - 1U);
+    app_quad_late++;
+  }
+  App_WriteQuadPins();
+  if (first) App_AddLatency(&app_quad_latency, CYCCNT_Read() - app_quad_stamp);
+  PROF_END(PROF_REGION_QUAD_EDGE);
+}
+
+/**
+  * @brief  Start, reconfigure or stop the position servo (servo.h). The
+  *         loop stops, the output goes to 0, then with a period the sensor
+  *         is read once and the controller starts holding that position,
+  *         moving back to it with APP_SERVO_VEL and APP_SERVO_ACC after a
+  *         sensor fault until App_ServoMove() sets a target.
+  * @param  loop_us: loop period, APP_SERVO_LOOP_MIN_US..SERVO_LOOP_MAX_US,
+  *         0 = off
+  * @param  cfg: gains and limits (servo.h), unused with 0
+  * @retval 0 on success, -1 on an invalid configuration, a capture in
+  *         progress or a failed read
+  */
+int App_SetServo(uint32_t loop_us, const Servo_ConfigTypeDef *cfg)
+{
+  Servo_TypeDef check;
+  uint16_t raw;
+
+  if (loop_us != 0U)
+  {
+    if (loop_us < APP_SERVO_LOOP_MIN_US || Servo_Init(&check, cfg, loop_us, 0) != 0) return -1;
+    /* the burst and the loop would both own the bus */
+    if (Capture_GetState() != CAPTURE_IDLE) return -1;
+  }
+  HAL_TIM_Base_Stop_IT(&htim4);
+  app_servo_loop_us = 0;
+  App_WriteServoOutput(0);
+  if (loop_us == 0U) return 0;
+
+  if (AMS5600_getRawAngle(&raw) != HAL_OK) return -1;
+  app_servo_raw = raw;
+  app_servo_reading = raw;
+  app_servo_pos = (int32_t)raw << 4;
+  Servo_Init(&app_servo, cfg, loop_us, app_servo_pos);
+  Servo_Move(&app_servo, app_servo_pos, APP_SERVO_VEL, APP_SERVO_ACC);
+  app_servo_loops = 0;
+  app_servo_overruns = 0;
+  app_servo_read_errors = 0;
+  app_servo_error_run = 0;
+  app_servo_jitter = 0;
+  memset(&app_servo_isr, 0, sizeof(app_servo_isr));
+  app_servo_loop_us = loop_us;
+  /* TIM4 counts us */
+  __HAL_TIM_SET_AUTORELOAD(&htim4, loop_us - 1U);
+  __HAL_TIM_SET_COUNTER(&htim4, 0U);
+  HAL_TIM_Base_Start_IT(&htim4);
+  return 0;
+}
+
+/**
+  * @brief  New servo target, reached along a trapezoidal setpoint.
+  * @param  target: position, Q4 counts continued across turns from the
+  *         reading App_SetServo() started with
+  * @param  vel_max: Q4 counts per s, 0 = step
+  * @param  acc_max: Q4 counts per s^2, 0 = step
+  * @retval 0 on success, -1 while the servo is off
+  */
+int App_ServoMove(int32_t target, uint32_t vel_max, uint32_t acc_max)
+{
+  uint32_t primask;
+
+  if (app_servo_loop_us == 0U) return -1;
+  primask = __get_PRIMASK();
+  __disable_irq();
+  Servo_Move(&app_servo, target, vel_max, acc_max);
+  __set_PRIMASK(primask);
+  return 0;
+}
+
+/**
+  * @brief  Servo state and loop counters since it was started.
+  * @retval None
+  */
+void App_GetServoStats(App_ServoStatsTypeDef *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  stats->loop_us = app_servo_loop_us;
+  stats->loops = app_servo_loops;
+  stats->target = app_servo.target;
+  stats->pos = app_servo_pos;
+  stats->setpoint = Servo_Setpoint(&app_servo);
+  stats->out = app_servo.out;
+  stats->overruns = app_servo_overruns;
+  stats->read_errors = app_servo_read_errors;
+  stats->saturated = app_servo.saturated_loops;
+  stats->jitter_max_ns = App_CyclesToNs(app_servo_jitter);
+  stats->isr_last_cycles = app_servo_isr.last;
+  stats->isr_max_cycles = app_servo_isr.max;
+  stats->isr_mean_cycles = app_servo_isr.count ? (uint32_t)(app_servo_isr.sum / app_servo_isr.count) : 0U;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Current servo loop period.
+  * @retval period, us, 0 while the servo is off
+  */
+uint32_t App_GetServoPeriod(void)
+{
+  return app_servo_loop_us;
+}
+
+/**
+  * @brief  Servo loop interrupt, called from HAL_TIM_PeriodElapsedCallback()
+  *         for TIM4: read, control, output.
+  * @retval None
+  */
+void App_ServoLoop(void)
+{
+  uint32_t t0 = CYCCNT_Read(), period = app_servo_loop_us * (SystemCoreClock / 1000000U), gap, cycles;
+  uint16_t raw;
+  uint8_t status;
+  int32_t u;
+
+  if (period == 0U) return;
+  gap = t0 - app_servo_entry;
+  app_servo_entry = t0;
+  if (app_servo_loops)
+  {
+    uint32_t dev = gap > period ? gap - period : period - gap;
+
+    if (dev > app_servo_jitter) app_servo_jitter = dev;
+    /* updates lost to a longer masked section */
+    if (gap > period + period / 2U) app_servo_overruns += (gap + period / 2U) / period - 1U;
+  }
+
+  status = AMS5600_getRawAngle(&raw);
+  app_servo_reading = ((uint32_t)status << 16) | raw;
+  app_servo_stamp = t0;
+  if (status != HAL_OK)
+  {
+    /* hold the output for a few loops, then let go */
+    app_servo_read_errors++;
+    if (++app_servo_error_run == APP_SERVO_FAULT_READS) App_WriteServoOutput(0);
+  }
+  else
+  {
+    app_servo_pos += (int16_t)((uint16_t)(raw - app_servo_raw) << 4);
+    app_servo_raw = raw;
+    if (app_servo_error_run >= APP_SERVO_FAULT_READS) Servo_Reset(&app_servo, app_servo_pos);
+    app_servo_error_run = 0;
+    PROF_BEGIN(PROF_REGION_SERVO);
+    u = Servo_Step(&app_servo, app_servo_pos);
+    PROF_END(PROF_REGION_SERVO);
+    App_WriteServoOutput(u);
+  }
+  app_servo_loops++;
+  cycles = CYCCNT_Read() - t0;
+  App_AddLatency(&app_servo_isr, cycles);
+  if (cycles >= period) app_servo_overruns++;
+}
+
+/**
+  * @brief  Select the commutation angle (commut.h), from the next sample.
+  * @param  pole_pairs: up to COMMUT_MAX_POLE_PAIRS, 0 = off
+  * @param  offset: electrical angle of the d axis, Q16 of a turn
+  * @param  lead_us: sensor delay added to the age of each reading
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int App_SetCommut(uint8_t pole_pairs, uint16_t offset, uint32_t lead_us)
+{
+  Commut_TypeDef c;
+  uint32_t primask;
+
+  if (Commut_Init(&c, pole_pairs, offset, lead_us, APP_COMMUT_VEL_SHIFT, SystemCoreClock) != 0) return -1;
+  primask = __get_PRIMASK();
+  __disable_irq();
+  app_commut = c;
+  __set_PRIMASK(primask);
+  return 0;
+}
+
+/**
+  * @brief  Align the electrical offset over the next samples, the stator
+  *         holding the rotor at electrical angle 0 meanwhile. The result is
+  *         in App_GetCommut()->align and ->offset.
+  * @param  samples: readings to average, 1..COMMUT_ALIGN_MAX
+  * @retval 0 on success, -1 while commutation is off or on a bad count
+  */
+int App_CommutAlign(uint16_t samples)
+{
+  return Commut_AlignStart(&app_commut, samples);
+}
+
+/**
+  * @brief  Commutation state: configuration, last reading, alignment.
+  * @retval commutation state
+  */
+const Commut_TypeDef *App_GetCommut(void)
+{
+  return &app_commut;
+}
+
+/**
+  * @brief  Electrical angle now, with its sine and cosine, for the current
+  *         loop once per PWM cycle (any context).
+  * @param  out: angle, sine and cosine
+  * @retval None
+  */
+void App_GetElectrical(Commut_OutTypeDef *out)
+{
+  Commut_Angle(&app_commut, CYCCNT_Read(), out);
+}
+
+/**
+  * @brief  Select the latency compensation (lagcomp.h) of app.comp, from the
+  *         next sample. The delay model is built for the power-on CONF
+  *         until the health task has read the register.
+  * @param  enable: 0 = off, app.comp is the pipeline position
+  * @param  trim_us: added to the modelled age, +-LAGCOMP_TRIM_MAX_US
+  * @retval 0 on success, -1 on an invalid trim
+  */
+int App_SetLagComp(uint8_t enable, int32_t trim_us)
+{
+  LagComp_ModelTypeDef m;
+
+  if (LagComp_Init(&m, app_lagcomp.conf, hi2c1.Init.ClockSpeed, trim_us) != 0) return -1;
+  app_lagcomp = m;
+  app_lagcomp_trim_us = trim_us;
+  app_lagcomp_on = enable ? 1U : 0U;
+  app_lagcomp_age_max_ns = 0;
+  app_lagcomp_stale = 1;
+  return 0;
+}
+
+/**
+  * @brief  Have the health task read CONF again, after a write to it.
+  * @retval None
+  */
+void App_ConfChanged(void)
+{
+  app_lagcomp_stale = 1;
+}
+
+/**
+  * @brief  Latency compensation state: delay model and the last sample.
+  * @param  stats: filled in
+  * @retval None
+  */
+void App_GetLagCompStats(App_LagCompStatsTypeDef *stats)
+{
+  stats->enabled = app_lagcomp_on;
+  stats->conf = app_lagcomp.conf;
+  stats->sensor_ns = app_lagcomp_sensor_ns;
+  stats->age_ns = app_lagcomp_age_ns;
+  stats->age_max_ns = app_lagcomp_age_max_ns;
+  stats->pos = app.out.pos;
+  stats->comp = app.comp;
+}
+
+/**
+  * @brief  Select oversampling (oversample.h) for the sample task, from the
+  *         next sample: n readings in one burst, their circular mean in
+  *         app.angle16 and the pipeline, the noise estimate in app.noise.
+  *         Only the sensor source is oversampled, not a replay or injection
+  *         one, and not while the servo loop owns the bus.
+  * @param  n: readings per sample, 0 or 1 = off, up to OVERSAMPLE_MAX_N
+  * @retval 0 on success, -1 on a bad count or a burst longer than half the
+  *         sample period
+  */
+int App_SetOversample(uint16_t n)
+{
+  if (n > OVERSAMPLE_MAX_N || !App_OversampleFits(n, App_GetSamplePeriod())) return -1;
+  app_oversample_n = n > 1U ? n : 1U;
+  memset(&app_oversample, 0, sizeof(app_oversample));
+  app_oversample_bursts = 0;
+  return 0;
+}
+
+/**
+  * @brief  Oversampling state: readings per sample and the last burst.
+  * @param  stats: filled in
+  * @retval None
+  */
+void App_GetOversampleStats(App_OversampleStatsTypeDef *stats)
+{
+  stats->n = app_oversample_n;
+  stats->last = app_oversample;
+  stats->bursts = app_oversample_bursts;
+  stats->bus_ns = app_oversample_n > 1U ? Oversample_BusNs(app_oversample_n, hi2c1.Init.ClockSpeed) : 0U;
+}
+
+/**
+  * @brief  Select the glitch filter (median.h) for the sample task, with an
+  *         empty window from the next sample: readings whose step from the
+  *         last one is off the window's median speed by more than
+  *         floor + k sigma are replaced before the pipeline. A gap of more
+  *         than 4 periods starts the window over.
+  * @param  window: steps tested against, 0 = off, else
+  *         MEDIAN_MIN_WINDOW..MEDIAN_MAX_WINDOW
+  * @param  k: threshold in sigma, tenths
+  * @param  floor: threshold at no spread, counts, 1..2047
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int App_SetMedian(uint8_t window, uint8_t k, uint16_t floor)
+{
+  if (window == 0U)
+  {
+    memset(&app_median, 0, sizeof(app_median));
+    return 0;
+  }
+  return Median_Init(&app_median, window, k, floor);
+}
+
+/**
+  * @brief  Glitch filter configuration, counters and last test.
+  * @param  stats: filled in
+  * @retval None
+  */
+void App_GetMedianStats(App_MedianStatsTypeDef *stats)
+{
+  stats->window = app_median.window;
+  stats->k = app_median.k;
+  stats->floor = app_median.floor;
+  stats->samples = app_median.samples;
+  stats->outliers = app_median.outliers;
+  stats->resyncs = app_median.resyncs;
+  stats->med = app_median.med;
+  stats->thr = app_median.thr;
+}
+
+/**
+  * @brief  Current period of the sample task.
+  * @retval period, us
+  */
+uint32_t App_GetSamplePeriod(void)
+{
+  return Sched_GetTask(app_sample_task)->period_us;
+}
+
+/**
+  * @brief  Read access to the latest acquired values.
+  * @retval application state
+  */
+const App_StateTypeDef *App_GetState(void)
+{
+  return &app;
+}
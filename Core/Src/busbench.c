@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file           : busbench.c
+  * @brief          : Bus-level benchmark of the AS5600 read paths.
+  ******************************************************************************
+  */
+
+#include "busbench.h"
+#include "main.h"
+#include "AMS5600_api.h"
+#include "cyccnt.h"
+#include "platform.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+typedef struct
+{
+  const char *name;
+  uint8_t   (*read)(void);
+  uint8_t     values;       /* register values delivered per sample */
+} BusBench_PathTypeDef;
+
+/* I2C-bus specification minimum timings, ns */
+typedef struct
+{
+  uint32_t hz;
+  uint16_t t_hd_sta;  /* START hold */
+  uint16_t t_su_sta;  /* repeated START setup */
+  uint16_t t_su_sto;  /* STOP setup */
+  uint16_t t_buf;     /* bus free between STOP and START */
+} BusBench_TimingTypeDef;
+
+static const BusBench_TimingTypeDef timings[] = {
+  {  100000U, 4000U, 4700U, 4000U, 4700U },
+  {  400000U,  600U,  600U,  600U, 1300U },
+  { 1000000U,  260U,  260U,  260U,  500U },
+};
+
+static uint16_t bb_u16;
+static uint8_t  bb_u8;
+static AMS5600_SnapshotTypeDef bb_snap;
+
+static uint8_t BusBench_GetterRaw(void)
+{
+  return AMS5600_getRawAngle(&bb_u16);
+}
+
+static uint8_t BusBench_GetterFull(void)
+{
+  uint8_t status = AMS5600_getRawAngle(&bb_u16);
+
+  status |= AMS5600_getMagnetStrength(&bb_u8);
+  status |= AMS5600_getAgc(&bb_u8);
+  status |= AMS5600_getMagnitude(&bb_u16);
+  return status;
+}
+
+static uint8_t BusBench_CombinedRaw(void)
+{
+  return AMS5600_getRawAngleRS(&bb_u16);
+}
+
+static uint8_t BusBench_CombinedFull(void)
+{
+  uint8_t status = AMS5600_getRawAngleRS(&bb_u16);
+
+  status |= AMS5600_RdMulti(_ams5600_Address, _addr_status, &bb_u8, 1);
+  status |= AMS5600_RdMulti(_ams5600_Address, _addr_agc, &bb_u8, 1);
+  status |= AMS5600_RdWordRS(_ams5600_Address, _addr_magnitude, &bb_u16);
+  return status;
+}
+
+static uint8_t BusBench_BurstRaw(void)
+{
+  return AMS5600_getSnapshot(&bb_snap, 0);
+}
+
+static uint8_t BusBench_BurstFull(void)
+{
+  return AMS5600_getSnapshot(&bb_snap, 1);
+}
+
+static uint8_t BusBench_StickyRaw(void)
+{
+  return AMS5600_getRawAngleStream(&bb_u16);
+}
+
+static const BusBench_PathTypeDef paths[] = {
+  { "getter_raw",    BusBench_GetterRaw,    1 },
+  { "getter_full",   BusBench_GetterFull,   4 },
+  { "combined_raw",  BusBench_CombinedRaw,  1 },
+  { "combined_full", BusBench_CombinedFull, 4 },
+  { "burst_raw",     BusBench_BurstRaw,     2 },
+  { "burst_full",    BusBench_BurstFull,    4 },
+  { "sticky_raw",    BusBench_StickyRaw,    1 },
+};
+
+/* num/den with three decimals */
+static void BusBench_PrintRatio(uint64_t num, uint64_t den)
+{
+  uint64_t milli = den ? (num * 1000U + den / 2U) / den : 0U;
+
+  printf(",%" PRIu32 ".%03" PRIu32, (uint32_t)(milli / 1000U), (uint32_t)(milli % 1000U));
+}
+
+/**
+  * @brief  Run every read path for the given number of samples and print
+  *         the CSV table (see busbench.h) with printf.
+  * @param  samples: samples per path
+  * @retval None
+  */
+void BusBench_Run(uint32_t samples)
+{
+  uint32_t meas_khz = hi2c1.Init.ClockSpeed / 1000U;
+
+  if (samples == 0) return;
+  CYCCNT_Init();
+  printf("path,values,meas_khz,clock_khz,samples,trans_per_sample,bytes_per_sample,"
+         "bus_ns_per_sample,max_rate_hz,cycles_per_sample,errors\n");
+
+  for (uint32_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+  {
+    AMS5600_BusStats st;
+    uint64_t cycles = 0;
+    uint32_t t0;
+
+    if (paths[p].read == BusBench_StickyRaw) AMS5600_startRawAngleStream();
+    AMS5600_ResetBusStats();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+      t0 = CYCCNT_Read();
+      paths[p].read();
+      cycles += CYCCNT_Read() - t0;
+    }
+    AMS5600_GetBusStats(&st);
+
+    for (uint32_t c = 0; c < sizeof(timings) / sizeof(timings[0]); c++)
+    {
+      const BusBench_TimingTypeDef *t = &timings[c];
+      uint64_t bus_ns = ((uint64_t)st.bytes * 9U * 1000000000ULL) / t->hz
+                      + (uint64_t)st.transactions * (t->t_hd_sta + t->t_su_sto + t->t_buf)
+                      + (uint64_t)st.restarts * (t->t_su_sta + t->t_hd_sta);
+
+      printf("%s,%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32, paths[p].name, paths[p].values,
+             meas_khz, t->hz / 1000U, samples);
+      BusBench_PrintRatio(st.transactions, samples);
+      BusBench_PrintRatio(st.bytes, samples);
+      printf(",%" PRIu32, (uint32_t)(bus_ns / samples));
+      printf(",%" PRIu32, bus_ns ? (uint32_t)((uint64_t)samples * 1000000000ULL / bus_ns) : 0U);
+      BusBench_PrintRatio(cycles, samples);
+      printf(",%" PRIu32 "\n", st.errors);
+    }
+  }
+}
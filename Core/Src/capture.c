@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file           : capture.c
+  * @brief          : Pre/post-trigger capture of raw angle bursts ("scope mode").
+  ******************************************************************************
+  */
+
+#include "capture.h"
+#include "cyccnt.h"
+#include "telemetry.h"
+#include "AMS5600_api.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+static uint16_t cap_buf[CAPTURE_BUFFER_SAMPLES];
+static Capture_ConfigTypeDef cap_cfg;
+static Capture_ResultTypeDef cap_result;
+static volatile Capture_StateTypeDef cap_state;
+static uint32_t cap_first;     /* buffer index of the oldest sample */
+static uint32_t cap_drain;     /* next sample to drain */
+static uint8_t  cap_header_sent;
+
+/**
+  * @brief  Store the configuration and arm the capture.
+  *         Capture_Run() then has to be called from the acquisition path.
+  * @param  cfg: trigger and buffer split
+  * @retval 0 on success, -1 on invalid configuration or capture in progress
+  */
+int Capture_Arm(const Capture_ConfigTypeDef *cfg)
+{
+  if (cap_state == CAPTURE_ARMED || cap_state == CAPTURE_DRAINING) return -1;
+  if (cfg->pre_samples > CAPTURE_BUFFER_SAMPLES) return -1;
+  if (cfg->post_samples == 0 || cfg->post_samples > CAPTURE_BUFFER_SAMPLES - cfg->pre_samples) return -1;
+  if (cfg->timeout_ms == 0 || cfg->timeout_ms > CAPTURE_TIMEOUT_MAX_MS) return -1;
+  if (cfg->trigger == CAPTURE_TRIG_GPIO && cfg->gpio_port == NULL) return -1;
+  cap_cfg = *cfg;
+  cap_state = CAPTURE_ARMED;
+  return 0;
+}
+
+/**
+  * @brief  Current capture state.
+  * @retval state
+  */
+Capture_StateTypeDef Capture_GetState(void)
+{
+  return cap_state;
+}
+
+static int Capture_Triggered(uint16_t raw, uint16_t prev)
+{
+  /* sample-to-sample delta on the 12-bit circle */
+  int32_t d = (int32_t)((uint32_t)(raw - prev) << 20) >> 20;
+
+  switch (cap_cfg.trigger)
+  {
+    case CAPTURE_TRIG_RISING:
+      return d > 0 && prev < cap_cfg.level && raw >= cap_cfg.level;
+    case CAPTURE_TRIG_FALLING:
+      return d < 0 && prev >= cap_cfg.level && raw < cap_cfg.level;
+    case CAPTURE_TRIG_VELOCITY:
+      return (d < 0 ? -d : d) >= cap_cfg.velocity;
+    case CAPTURE_TRIG_GPIO:
+      return ((cap_cfg.gpio_port->IDR & cap_cfg.gpio_pin) != 0U) == (cap_cfg.gpio_state == GPIO_PIN_SET);
+    default:
+      return 1;
+  }
+}
+
+/**
+  * @brief  Acquire until trigger + post-trigger samples or timeout. Blocks
+  *         the caller for the whole capture and does not use the UART.
+  * @retval HAL status of the stream start
+  */
+uint8_t Capture_Run(void)
+{
+  uint32_t idx = 0, written = 0, remaining = 0;
+  uint32_t t_trig = 0, t_end;
+  uint32_t start_tick = HAL_GetTick();
+  uint16_t raw, prev = 0;
+  uint8_t status;
+
+  if (cap_state != CAPTURE_ARMED) return HAL_ERROR;
+  cap_result = (Capture_ResultTypeDef){ 0 };
+
+  status = AMS5600_startRawAngleStream();
+  if (status != HAL_OK)
+  {
+    cap_state = CAPTURE_IDLE;
+    return status;
+  }
+
+  for (;;)
+  {
+    if (AMS5600_getRawAngleStream(&raw) != HAL_OK)
+    {
+      cap_result.errors++;
+      raw = prev | CAPTURE_FLAG_ERROR;
+    }
+    cap_buf[idx] = raw;
+    if (++idx == CAPTURE_BUFFER_SAMPLES) idx = 0;
+    written++;
+    raw &= 0x0FFFU;
+
+    if (!cap_result.triggered)
+    {
+      if (written > cap_cfg.pre_samples && Capture_Triggered(raw, written > 1 ? prev : raw))
+      {
+        cap_result.triggered = 1;
+        cap_result.pre = cap_cfg.pre_samples;
+        remaining = cap_cfg.post_samples - 1U;
+        t_trig = CYCCNT_Read();
+        if (remaining == 0U) break;
+      }
+      else if ((written & 0xFFU) == 0U && HAL_GetTick() - start_tick > cap_cfg.timeout_ms)
+      {
+        break;
+      }
+    }
+    else if (--remaining == 0U)
+    {
+      break;
+    }
+    prev = raw;
+  }
+  t_end = CYCCNT_Read();
+
+  if (cap_result.triggered)
+  {
+    cap_result.samples = cap_cfg.pre_samples + cap_cfg.post_samples;
+    if (cap_cfg.post_samples > 1U)
+      cap_result.period_ns = (uint32_t)(((uint64_t)(t_end - t_trig) * 1000U) /
+                                        ((uint64_t)(cap_cfg.post_samples - 1U) * (SystemCoreClock / 1000000U)));
+  }
+  else
+  {
+    /* timed out: keep whatever history is there */
+    cap_result.samples = (written < CAPTURE_BUFFER_SAMPLES) ? written : CAPTURE_BUFFER_SAMPLES;
+    cap_result.pre = cap_result.samples;
+  }
+  cap_first = (idx + CAPTURE_BUFFER_SAMPLES - cap_result.samples) % CAPTURE_BUFFER_SAMPLES;
+  cap_drain = 0;
+  cap_header_sent = 0;
+  cap_state = CAPTURE_DONE;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Send the next part of a completed capture, as much as the
+  *         telemetry buffer has room for. Call periodically.
+  * @retval 1 while data remains, 0 when the capture is fully drained
+  */
+int Capture_Drain(void)
+{
+  char line[48];
+  int len;
+
+  if (cap_state != CAPTURE_DONE && cap_state != CAPTURE_DRAINING) return 0;
+  cap_state = CAPTURE_DRAINING;
+
+  if (!cap_header_sent)
+  {
+    len = snprintf(line, sizeof(line), "CAP,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+                   cap_result.samples, cap_result.pre, cap_result.period_ns, cap_result.errors);
+    if (Telemetry_Free() < len) return 1;
+    Telemetry_Write(line, (uint16_t)len);
+    cap_header_sent = 1;
+  }
+  while (cap_drain < cap_result.samples)
+  {
+    uint16_t v = cap_buf[(cap_first + cap_drain) % CAPTURE_BUFFER_SAMPLES];
+
+    len = snprintf(line, sizeof(line), "%" PRId32 ",%u%s\n",
+                   (int32_t)cap_drain - (int32_t)cap_result.pre, v & 0x0FFFU,
+                   (v & CAPTURE_FLAG_ERROR) ? ",E" : "");
+    if (Telemetry_Free() < len) return 1;
+    Telemetry_Write(line, (uint16_t)len);
+    cap_drain++;
+  }
+  if (Telemetry_Free() < 8) return 1;
+  Telemetry_Write("CAP,END\n", 8);
+  cap_state = CAPTURE_IDLE;
+  return 0;
+}
+
+/**
+  * @brief  Result of the last capture.
+  * @retval result
+  */
+const Capture_ResultTypeDef *Capture_GetResult(void)
+{
+  return &cap_result;
+}
@@ -0,0 +1,564 @@
+/**
+  ******************************************************************************
+  * @file           : command.c
+  * @brief          : Binary runtime command interface over USART2 RX.
+  ******************************************************************************
+  */
+
+#include "command.h"
+#include "main.h"
+#include "AMS5600_api.h"
+#include "app.h"
+#include "app_config.h"
+#include "capture.h"
+#include "cyccnt.h"
+#include "platform.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "uartrx.h"
+#include <string.h>
+
+/* register access waiting for the sample task */
+typedef struct
+{
+  uint8_t  pending;
+  uint8_t  tag;
+  uint8_t  op;
+  uint8_t  reg;
+  uint8_t  count;
+  uint8_t  done;
+  uint32_t deferred;       /* sample periods without enough slack */
+  uint8_t  data[CMD_REG_MAX];
+} Cmd_BusOpTypeDef;
+
+static Cmd_BusOpTypeDef cmd_bus;
+static Cmd_StatsTypeDef cmd_stats;
+
+static uint16_t Cmd_Get16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Cmd_Get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *Cmd_Put(uint8_t *p, uint32_t v, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++) *p++ = (uint8_t)(v >> (8U * i));
+  return p;
+}
+
+static void Cmd_Reply(uint8_t tag, uint8_t op, uint8_t status, const uint8_t *data, uint8_t len)
+{
+  uint8_t p[TELEMETRY_MAX_PAYLOAD];
+
+  p[0] = tag;
+  p[1] = op;
+  p[2] = status;
+  if (len) memcpy(&p[3], data, len);
+  if (status != CMD_OK) cmd_stats.errors++;
+  if (Telemetry_WriteFrame(TELEMETRY_FRAME_REPLY, p, (uint8_t)(3U + len)) == 0U) cmd_stats.replies_dropped++;
+}
+
+static uint8_t Cmd_Perf(const uint8_t *arg, uint8_t *out, uint8_t *len)
+{
+  uint8_t *p = out;
+
+  switch (arg[0])
+  {
+    case CMD_PERF_SYSTEM:
+    {
+      const App_StateTypeDef *app = App_GetState();
+      Telemetry_StatsTypeDef tx;
+      UartRx_StatsTypeDef rx;
+
+      Telemetry_GetStats(&tx);
+      UartRx_GetStats(&rx);
+      p = Cmd_Put(p, app->samples, 4);
+      p = Cmd_Put(p, app->i2c_errors, 4);
+      p = Cmd_Put(p, Sched_GetMisses(), 4);
+      p = Cmd_Put(p, Sched_GetLoadPermille(), 2);
+      p = Cmd_Put(p, tx.bytes_dropped, 4);
+      p = Cmd_Put(p, rx.frames, 4);
+      p = Cmd_Put(p, rx.bad_frames, 4);
+      break;
+    }
+    case CMD_PERF_TASK:
+    {
+      const Sched_TaskTypeDef *t = Sched_GetTask(arg[1]);
+
+      if (t == NULL) return CMD_ERR_ARG;
+      p = Cmd_Put(p, t->period_us, 4);
+      p = Cmd_Put(p, t->runs, 4);
+      p = Cmd_Put(p, t->misses, 4);
+      p = Cmd_Put(p, t->max_cycles, 4);
+      break;
+    }
+    case CMD_PERF_PROFILE:
+    {
+#if PROFILER_ENABLED
+      Prof_StatsTypeDef s;
+
+      if (arg[1] >= PROF_REGION_COUNT) return CMD_ERR_ARG;
+      Profiler_GetStats((Prof_RegionTypeDef)arg[1], &s);
+      p = Cmd_Put(p, s.count, 4);
+      p = Cmd_Put(p, s.count ? s.min : 0U, 4);
+      p = Cmd_Put(p, s.max, 4);
+      p = Cmd_Put(p, s.count ? (uint32_t)(s.sum / s.count) : 0U, 4);
+      break;
+#else
+      return CMD_ERR_UNSUPPORTED;
+#endif
+    }
+    case CMD_PERF_BUS:
+    {
+      AMS5600_BusStats bus;
+
+      AMS5600_GetBusStats(&bus);
+      p = Cmd_Put(p, bus.transactions, 4);
+      p = Cmd_Put(p, bus.restarts, 4);
+      p = Cmd_Put(p, bus.bytes, 4);
+      p = Cmd_Put(p, bus.errors, 4);
+      break;
+    }
+    case CMD_PERF_EVENT:
+    {
+      App_EventStatsTypeDef ev;
+
+      App_GetEventStats(&ev);
+      p = Cmd_Put(p, ev.checked, 4);
+      p = Cmd_Put(p, ev.suppressed, 4);
+      p = Cmd_Put(p, ev.moves, 4);
+      p = Cmd_Put(p, ev.status_changes, 4);
+      p = Cmd_Put(p, ev.heartbeats, 4);
+      p = Cmd_Put(p, ev.overflows, 4);
+      break;
+    }
+    case CMD_PERF_DECIM:
+    {
+      const Decim_TypeDef *d = App_GetDecimation();
+
+      *p++ = (uint8_t)d->cfg.kind;
+      *p++ = d->cfg.ratio;
+      *p++ = d->cfg.order;
+      *p++ = d->cfg.taps;
+      p = Cmd_Put(p, (uint16_t)d->resolution_mbits, 2);
+      p = Cmd_Put(p, d->cfg.kind != DECIM_OFF ? App_GetSamplePeriod() * d->cfg.ratio : 0U, 4);
+      p = Cmd_Put(p, d->inputs, 4);
+      p = Cmd_Put(p, d->outputs, 4);
+      break;
+    }
+    case CMD_PERF_SPECTRUM:
+    {
+      const Spectrum_TypeDef *s = App_GetSpectrum();
+
+      p = Cmd_Put(p, s->n, 2);
+      p = Cmd_Put(p, s->blocks, 4);
+      p = Cmd_Put(p, s->overruns, 4);
+      p = Cmd_Put(p, s->result.cycles, 4);
+      p = Cmd_Put(p, s->max_cycles, 4);
+      break;
+    }
+    case CMD_PERF_ORDER:
+    {
+      const Order_TypeDef *o = App_GetOrder();
+
+      p = Cmd_Put(p, o->points, 2);
+      *p++ = o->orders;
+      p = Cmd_Put(p, o->revs, 4);
+      p = Cmd_Put(p, o->restarts, 4);
+      p = Cmd_Put(p, CYCCNT_ToUs(o->result.ticks), 4);
+      break;
+    }
+    case CMD_PERF_REVSTAT:
+    {
+      App_RevStatsTypeDef rs;
+
+      App_GetRevStats(&rs);
+      *p++ = rs.enabled;
+      p = Cmd_Put(p, rs.revolutions, 4);
+      p = Cmd_Put(p, rs.aborts, 4);
+      p = Cmd_Put(p, rs.overflows, 4);
+      break;
+    }
+    case CMD_PERF_ALARM:
+    {
+      App_AlarmStatsTypeDef al;
+
+      App_GetAlarmStats(&al);
+      *p++ = al.output;
+      *p++ = al.latched;
+      p = Cmd_Put(p, al.events, 4);
+      p = Cmd_Put(p, al.overflows, 4);
+      p = Cmd_Put(p, al.latency_last_ns, 4);
+      p = Cmd_Put(p, al.latency_max_ns, 4);
+      p = Cmd_Put(p, al.latency_mean_ns, 4);
+      break;
+    }
+    case CMD_PERF_QUAD:
+    {
+      App_QuadStatsTypeDef qs;
+
+      App_GetQuadStats(&qs);
+      p = Cmd_Put(p, qs.ppr, 2);
+      p = Cmd_Put(p, (uint32_t)qs.pos, 4);
+      p = Cmd_Put(p, qs.limited, 4);
+      p = Cmd_Put(p, qs.dropped, 4);
+      p = Cmd_Put(p, qs.late, 4);
+      p = Cmd_Put(p, qs.latency_last_ns, 4);
+      p = Cmd_Put(p, qs.latency_max_ns, 4);
+      p = Cmd_Put(p, qs.latency_mean_ns, 4);
+      break;
+    }
+    case CMD_PERF_SERVO:
+    {
+      App_ServoStatsTypeDef ss;
+
+      App_GetServoStats(&ss);
+      p = Cmd_Put(p, ss.loops, 4);
+      p = Cmd_Put(p, (uint32_t)(ss.setpoint - ss.pos), 4);
+      p = Cmd_Put(p, (uint16_t)ss.out, 2);
+      p = Cmd_Put(p, ss.overruns, 4);
+      p = Cmd_Put(p, ss.read_errors, 4);
+      p = Cmd_Put(p, ss.jitter_max_ns, 4);
+      p = Cmd_Put(p, ss.isr_max_cycles, 4);
+      p = Cmd_Put(p, ss.isr_mean_cycles, 4);
+      break;
+    }
+    case CMD_PERF_COMMUT:
+    {
+      const Commut_TypeDef *c = App_GetCommut();
+      Commut_OutTypeDef e;
+      uint32_t t0 = CYCCNT_Read(), cycles;
+
+      App_GetElectrical(&e);
+      cycles = CYCCNT_Read() - t0;
+      *p++ = c->pole_pairs;
+      *p++ = (uint8_t)c->align;
+      p = Cmd_Put(p, c->offset, 2);
+      p = Cmd_Put(p, e.theta, 2);
+      p = Cmd_Put(p, (uint16_t)e.sin, 2);
+      p = Cmd_Put(p, (uint16_t)e.cos, 2);
+      p = Cmd_Put(p, (uint32_t)Commut_SpeedCrpm(c, SystemCoreClock), 4);
+      p = Cmd_Put(p, c->samples, 4);
+      p = Cmd_Put(p, cycles, 4);
+      break;
+    }
+    case CMD_PERF_LAGCOMP:
+    {
+      App_LagCompStatsTypeDef l;
+
+      App_GetLagCompStats(&l);
+      *p++ = l.enabled;
+      p = Cmd_Put(p, l.conf, 2);
+      p = Cmd_Put(p, (uint32_t)l.sensor_ns, 4);
+      p = Cmd_Put(p, l.age_ns, 4);
+      p = Cmd_Put(p, l.age_max_ns, 4);
+      p = Cmd_Put(p, (uint32_t)l.pos, 4);
+      p = Cmd_Put(p, (uint32_t)l.comp, 4);
+      break;
+    }
+    case CMD_PERF_OVERSAMPLE:
+    {
+      App_OversampleStatsTypeDef o;
+
+      App_GetOversampleStats(&o);
+      p = Cmd_Put(p, o.n, 2);
+      p = Cmd_Put(p, o.last.angle, 2);
+      p = Cmd_Put(p, o.last.sigma, 2);
+      p = Cmd_Put(p, o.last.noise, 2);
+      p = Cmd_Put(p, o.last.spread, 2);
+      p = Cmd_Put(p, o.bus_ns, 4);
+      p = Cmd_Put(p, o.bursts, 4);
+      break;
+    }
+    case CMD_PERF_MEDIAN:
+    {
+      App_MedianStatsTypeDef m;
+
+      App_GetMedianStats(&m);
+      *p++ = m.window;
+      *p++ = m.k;
+      p = Cmd_Put(p, m.floor, 2);
+      p = Cmd_Put(p, m.samples, 4);
+      p = Cmd_Put(p, m.outliers, 4);
+      p = Cmd_Put(p, m.resyncs, 4);
+      p = Cmd_Put(p, (uint16_t)m.med, 2);
+      p = Cmd_Put(p, m.thr, 2);
+      break;
+    }
+    default:
+      return CMD_ERR_ARG;
+  }
+  *len = (uint8_t)(p - out);
+  return CMD_OK;
+}
+
+static uint8_t Cmd_Capture(const uint8_t *arg)
+{
+  Capture_ConfigTypeDef cfg = {
+    .trigger = (Capture_TriggerTypeDef)arg[0],
+    .level = Cmd_Get16(&arg[1]),
+    .velocity = Cmd_Get16(&arg[3]),
+    .pre_samples = Cmd_Get32(&arg[5]),
+    .post_samples = Cmd_Get32(&arg[9]),
+    .timeout_ms = Cmd_Get32(&arg[13]),
+  };
+
+  /* no GPIO trigger from the link, it needs a port and pin */
+  if (arg[0] > CAPTURE_TRIG_VELOCITY) return CMD_ERR_ARG;
+  if (App_GetServoPeriod()) return CMD_ERR_BUSY;
+  return Capture_Arm(&cfg) == 0 ? CMD_OK : CMD_ERR_ARG;
+}
+
+static uint8_t Cmd_SetAlarm(const uint8_t *arg)
+{
+  Alarm_ConfigTypeDef cfg = {
+    .overspeed_rpm = Cmd_Get16(arg),
+    .stall_rpm = Cmd_Get16(&arg[2]),
+    .stall_ms = Cmd_Get16(&arg[4]),
+    .reversal_counts = Cmd_Get16(&arg[6]),
+    .window_min = (int32_t)Cmd_Get32(&arg[8]),
+    .window_max = (int32_t)Cmd_Get32(&arg[12]),
+    .latch = arg[16],
+    .read_errors = arg[17],
+  };
+
+  return App_SetAlarm(&cfg) == 0 ? CMD_OK : CMD_ERR_ARG;
+}
+
+static uint8_t Cmd_SetServo(const uint8_t *arg)
+{
+  Servo_ConfigTypeDef cfg = {
+    .kp = (int32_t)Cmd_Get32(&arg[2]),
+    .ki = (int32_t)Cmd_Get32(&arg[6]),
+    .kd = (int32_t)Cmd_Get32(&arg[10]),
+    .kv = (int32_t)Cmd_Get32(&arg[14]),
+    .ka = (int32_t)Cmd_Get32(&arg[18]),
+    .d_shift = arg[22],
+    .out_max = Cmd_Get16(&arg[23]),
+  };
+
+  return App_SetServo(Cmd_Get16(arg), &cfg) == 0 ? CMD_OK : CMD_ERR_ARG;
+}
+
+/* validate and queue a register access, replied by Cmd_BusService() */
+static uint8_t Cmd_QueueBus(uint8_t tag, uint8_t op, const uint8_t *arg, uint8_t n)
+{
+  Cmd_BusOpTypeDef *b = &cmd_bus;
+
+  if (b->pending || App_GetServoPeriod()) return CMD_ERR_BUSY;
+  if (op == CMD_REG_READ)
+  {
+    if (n != 2U) return CMD_ERR_LENGTH;
+    if (arg[1] == 0U || arg[1] > CMD_REG_MAX) return CMD_ERR_ARG;
+    b->count = arg[1];
+  }
+  else
+  {
+    if (n < 2U || n > 9U) return CMD_ERR_LENGTH;
+    /* ZPOS..CONF, the volatile settings */
+    if (arg[0] < 0x01U || arg[0] + (n - 1U) > 0x09U) return CMD_ERR_ARG;
+    b->count = (uint8_t)(n - 1U);
+    memcpy(b->data, &arg[1], b->count);
+  }
+  b->tag = tag;
+  b->op = op;
+  b->reg = arg[0];
+  b->done = 0;
+  b->deferred = 0;
+  b->pending = 1;
+  return CMD_OK;
+}
+
+/**
+  * @brief  Handle one CMD frame, called from the rx task.
+  * @param  payload: u8 tag, u8 op, arguments
+  * @param  len: payload length
+  * @retval None
+  */
+void Cmd_OnFrame(const uint8_t *payload, uint8_t len)
+{
+  uint8_t out[CMD_REG_MAX];
+  uint8_t tag, op, status, n, out_len = 0;
+  const uint8_t *arg;
+
+  cmd_stats.commands++;
+  if (len < 2U)
+  {
+    Cmd_Reply(len ? payload[0] : 0U, 0xFFU, CMD_ERR_LENGTH, NULL, 0);
+    return;
+  }
+  tag = payload[0];
+  op = payload[1];
+  arg = &payload[2];
+  n = (uint8_t)(len - 2U);
+
+  switch (op)
+  {
+    case CMD_PING:
+    {
+      uint8_t *p = out;
+
+      *p++ = CMD_PROTOCOL_VERSION;
+      p = Cmd_Put(p, HAL_GetTick(), 4);
+      p = Cmd_Put(p, App_GetState()->samples, 4);
+      out_len = (uint8_t)(p - out);
+      status = CMD_OK;
+      break;
+    }
+    case CMD_SET_RATE:
+      if (n != 8U) status = CMD_ERR_LENGTH;
+      else status = App_SetPeriods(Cmd_Get32(arg), Cmd_Get32(&arg[4])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_OUTPUT:
+      if (n != 3U) status = CMD_ERR_LENGTH;
+      else status = App_SetOutput((App_OutFormatTypeDef)arg[0], Cmd_Get16(&arg[1])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_FILTER:
+      if (n != 2U) status = CMD_ERR_LENGTH;
+      else status = App_SetFilter(arg[0], arg[1]) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_CAPTURE:
+      status = (n != 17U) ? CMD_ERR_LENGTH : Cmd_Capture(arg);
+      break;
+    case CMD_SET_DECIM:
+      if (n != 3U) status = CMD_ERR_LENGTH;
+      else status = App_SetDecimation((Decim_KindTypeDef)arg[0], arg[1], arg[2]) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_SPECTRUM:
+      if (n != 2U) status = CMD_ERR_LENGTH;
+      else status = App_SetSpectrum(Cmd_Get16(arg)) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_ORDER:
+      if (n != 3U) status = CMD_ERR_LENGTH;
+      else status = App_SetOrder(Cmd_Get16(arg), arg[2]) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_REVSTAT:
+      if (n != 4U) status = CMD_ERR_LENGTH;
+      else status = App_SetRevStat(arg[0], Cmd_Get16(&arg[1]), arg[3]) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_ALARM:
+      status = (n != 18U) ? CMD_ERR_LENGTH : Cmd_SetAlarm(arg);
+      break;
+    case CMD_ALARM_CLEAR:
+      App_ClearAlarm();
+      status = CMD_OK;
+      break;
+    case CMD_SET_QUAD:
+      if (n != 6U) status = CMD_ERR_LENGTH;
+      else status = App_SetQuad(Cmd_Get16(arg), Cmd_Get32(&arg[2])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_SERVO:
+      status = (n != 25U) ? CMD_ERR_LENGTH : Cmd_SetServo(arg);
+      break;
+    case CMD_SERVO_MOVE:
+      if (n != 12U) status = CMD_ERR_LENGTH;
+      else status = App_ServoMove((int32_t)Cmd_Get32(arg), Cmd_Get32(&arg[4]), Cmd_Get32(&arg[8])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_COMMUT:
+      if (n != 5U) status = CMD_ERR_LENGTH;
+      else status = App_SetCommut(arg[0], Cmd_Get16(&arg[1]), Cmd_Get16(&arg[3])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_COMMUT_ALIGN:
+      if (n != 2U) status = CMD_ERR_LENGTH;
+      else status = App_CommutAlign(Cmd_Get16(arg)) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_LAGCOMP:
+      if (n != 3U) status = CMD_ERR_LENGTH;
+      else status = App_SetLagComp(arg[0], (int16_t)Cmd_Get16(&arg[1])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_OVERSAMPLE:
+      if (n != 2U) status = CMD_ERR_LENGTH;
+      else status = App_SetOversample(Cmd_Get16(arg)) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_MEDIAN:
+      if (n != 4U) status = CMD_ERR_LENGTH;
+      else status = App_SetMedian(arg[0], arg[1], Cmd_Get16(&arg[2])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_SET_EVENT:
+      if (n != 7U) status = CMD_ERR_LENGTH;
+      else status = App_SetEventMode(arg[0], Cmd_Get16(&arg[1]), Cmd_Get32(&arg[3])) == 0 ? CMD_OK : CMD_ERR_ARG;
+      break;
+    case CMD_PERF:
+      status = (n != 2U) ? CMD_ERR_LENGTH : Cmd_Perf(arg, out, &out_len);
+      break;
+    case CMD_PERF_RESET:
+      Sched_ResetStats();
+      Profiler_Reset();
+      AMS5600_ResetBusStats();
+      status = CMD_OK;
+      break;
+    case CMD_REG_READ:
+    case CMD_REG_WRITE:
+      status = Cmd_QueueBus(tag, op, arg, n);
+      if (status == CMD_OK) return;   /* replied when done */
+      break;
+    default:
+      status = CMD_ERR_OP;
+      break;
+  }
+  Cmd_Reply(tag, op, status, out, status == CMD_OK ? out_len : 0U);
+}
+
+/**
+  * @brief  Advance a queued register access by one chunk. Called by the
+  *         sample task after its own read.
+  * @param  slack_us: time left until the next sample release
+  * @retval None
+  */
+void Cmd_BusService(uint32_t slack_us)
+{
+  Cmd_BusOpTypeDef *b = &cmd_bus;
+  uint8_t status = HAL_OK;
+  uint8_t n;
+
+  if (!b->pending) return;
+  if (slack_us < CMD_BUS_SLACK_US)
+  {
+    if (++b->deferred >= CMD_BUS_MAX_DEFER)
+    {
+      b->pending = 0;
+      Cmd_Reply(b->tag, b->op, CMD_ERR_BUSY, NULL, 0);
+    }
+    return;
+  }
+
+  n = (uint8_t)(b->count - b->done);
+  if (n > CMD_BUS_CHUNK) n = CMD_BUS_CHUNK;
+  if (b->op == CMD_REG_READ)
+  {
+    status = AMS5600_RdMulti(_ams5600_Address, (uint8_t)(b->reg + b->done), &b->data[b->done], n);
+  }
+  else
+  {
+    for (uint8_t i = 0; i < n; i++)
+      status |= AMS5600_WrByte(_ams5600_Address, (uint8_t)(b->reg + b->done + i), b->data[b->done + i]);
+    /* CONF (0x07, 0x08) sets the filter the delay model is for */
+    if (b->reg + b->done + n > 0x07U) App_ConfChanged();
+  }
+  if (status != HAL_OK)
+  {
+    b->pending = 0;
+    Cmd_Reply(b->tag, b->op, CMD_ERR_BUS, NULL, 0);
+    return;
+  }
+  b->done = (uint8_t)(b->done + n);
+  if (b->done == b->count)
+  {
+    b->pending = 0;
+    Cmd_Reply(b->tag, b->op, CMD_OK, b->data, b->op == CMD_REG_READ ? b->count : 0U);
+  }
+}
+
+/**
+  * @brief  Copy of the command counters.
+  * @retval None
+  */
+void Cmd_GetStats(Cmd_StatsTypeDef *stats)
+{
+  *stats = cmd_stats;
+}
@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file           : commut.c
+  * @brief          : Electrical angle and its sine and cosine for field
+  *                   oriented commutation of a brushless motor.
+  ******************************************************************************
+  */
+
+#include "commut.h"
+#include "sintab.h"
+#include <string.h>
+
+/**
+  * @brief  Check and take the configuration, alignment idle.
+  * @param  c: commutation state
+  * @param  pole_pairs: up to COMMUT_MAX_POLE_PAIRS, 0 = off
+  * @param  offset: electrical angle of the d axis, Q16
+  * @param  lead_us: sensor delay behind the sample stamps, up to 10 ms
+  * @param  vel_shift: velocity low-pass, up to COMMUT_VEL_SHIFT_MAX
+  * @param  tick_hz: rate of the stamps
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int Commut_Init(Commut_TypeDef *c, uint8_t pole_pairs, uint16_t offset, uint32_t lead_us,
+                uint8_t vel_shift, uint32_t tick_hz)
+{
+  if (pole_pairs > COMMUT_MAX_POLE_PAIRS || vel_shift > COMMUT_VEL_SHIFT_MAX || lead_us > 10000U) return -1;
+  memset(c, 0, sizeof(*c));
+  c->pole_pairs = pole_pairs;
+  c->offset = offset;
+  c->lead = (uint32_t)((uint64_t)lead_us * tick_hz / 1000000U);
+  c->vel_shift = vel_shift;
+  return 0;
+}
+
+/**
+  * @brief  Forget the velocity after a gap in the samples, the next one
+  *         starts from standstill.
+  * @retval None
+  */
+void Commut_Resync(Commut_TypeDef *c)
+{
+  c->primed = 0;
+}
+
+/**
+  * @brief  Take one reading: position, velocity and alignment.
+  * @param  c: commutation state
+  * @param  raw: RAW ANGLE, 12 bits
+  * @param  stamp: time of the reading, ticks
+  * @retval None
+  */
+void Commut_Sample(Commut_TypeDef *c, uint16_t raw, uint32_t stamp)
+{
+  uint16_t pos = (uint16_t)(raw << 4);
+
+  if (c->primed)
+  {
+    int64_t d = (int16_t)(uint16_t)(pos - c->pos), v;
+    uint32_t dt = stamp - c->stamp;
+
+    if (dt != 0U)
+    {
+      v = (d << 24) / dt;
+      if (v > INT32_MAX) v = INT32_MAX;
+      if (v < -INT32_MAX) v = -INT32_MAX;
+      /* the first difference starts the low-pass, not standstill */
+      if (c->primed == 1U)
+        c->vel = (int32_t)v;
+      else
+        c->vel += (int32_t)((v - c->vel) >> c->vel_shift);
+      c->primed = 2;
+    }
+  }
+  else
+  {
+    c->vel = 0;
+    c->primed = 1;
+  }
+  c->pos = pos;
+  c->stamp = stamp;
+  c->samples++;
+
+  if (c->align == COMMUT_ALIGN_RUNNING)
+  {
+    uint16_t e = (uint16_t)(pos * c->pole_pairs);
+    int16_t dev;
+
+    if (c->align_n == 0U) c->align_ref = e;
+    dev = (int16_t)(uint16_t)(e - c->align_ref);
+    c->align_sum += dev;
+    if (dev < c->align_min) c->align_min = dev;
+    if (dev > c->align_max) c->align_max = dev;
+    if (++c->align_n == c->align_samples)
+    {
+      int32_t n = c->align_n, mean = (c->align_sum + (c->align_sum < 0 ? -n / 2 : n / 2)) / n;
+
+      if (c->align_max - c->align_min > (int32_t)COMMUT_ALIGN_SPREAD)
+        c->align = COMMUT_ALIGN_FAILED;
+      else
+      {
+        c->offset = (uint16_t)(c->align_ref + mean);
+        c->align = COMMUT_ALIGN_DONE;
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Electrical angle at time now, extrapolated from the last
+  *         reading, with its sine and cosine. Safe to call from an interrupt
+  *         as long as Commut_Sample() cannot run in between.
+  * @param  c: commutation state
+  * @param  now: ticks
+  * @param  out: angle, sine and cosine
+  * @retval None
+  */
+void Commut_Angle(const Commut_TypeDef *c, uint32_t now, Commut_OutTypeDef *out)
+{
+  uint32_t age = now - c->stamp + c->lead;
+  uint16_t mech;
+
+  if (age > (1UL << COMMUT_MAX_AGE_SHIFT)) age = 1UL << COMMUT_MAX_AGE_SHIFT;
+  mech = (uint16_t)(c->pos + (int32_t)(((int64_t)c->vel * age) >> 24));
+  out->theta = (uint16_t)(mech * c->pole_pairs - c->offset);
+  SinTab_SinCos(out->theta, &out->sin, &out->cos);
+}
+
+/**
+  * @brief  Start an offset alignment over the next samples. The stator
+  *         must hold the rotor at electrical angle 0 until it is done.
+  * @param  c: commutation state, with pole pairs
+  * @param  samples: readings to average, 1..COMMUT_ALIGN_MAX
+  * @retval 0 on success, -1 without pole pairs or with a bad count
+  */
+int Commut_AlignStart(Commut_TypeDef *c, uint16_t samples)
+{
+  if (c->pole_pairs == 0U || samples == 0U || samples > COMMUT_ALIGN_MAX) return -1;
+  c->align_samples = samples;
+  c->align_n = 0;
+  c->align_sum = 0;
+  c->align_min = 0;
+  c->align_max = 0;
+  c->align = COMMUT_ALIGN_RUNNING;
+  return 0;
+}
+
+/**
+  * @brief  Mechanical speed of the velocity estimate.
+  * @param  c: commutation state
+  * @param  tick_hz: rate of the stamps
+  * @retval speed, 1/100 rpm
+  */
+int32_t Commut_SpeedCrpm(const Commut_TypeDef *c, uint32_t tick_hz)
+{
+  /* Q40 turns per tick: vel tick_hz 60 100 / 2^40, in steps that stay
+     within int64 */
+  int64_t v = ((int64_t)c->vel * (tick_hz >> 4)) >> 22;
+
+  return (int32_t)((v * 6000) >> 14);
+}
@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file           : commutbench.c
+  * @brief          : Cost and accuracy benchmark of the commutation angle
+  *                   against a 20 kHz PWM cycle.
+  ******************************************************************************
+  */
+
+#include "commutbench.h"
+#include "main.h"
+#include "commut.h"
+#include "sintab.h"
+#include "cyccnt.h"
+#include <math.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#define COMMUTBENCH_ALIGN_SAMPLES  64U
+
+static const double speeds_tps[] = { 1.0, 10.0, 50.0, 100.0 };
+
+static Commut_TypeDef cb_commut;
+static uint32_t cb_seed;
+
+/* RAW ANGLE of a mechanical angle in turns, +-0.5 count of noise */
+static uint16_t CommutBench_Sensor(double turns)
+{
+  double noise;
+
+  cb_seed = cb_seed * 1664525U + 1013904223U;
+  noise = (cb_seed >> 8) / 16777216.0 - 0.5;
+  return (uint16_t)((int32_t)floor(turns * 4096.0 + noise) & 0xFFF);
+}
+
+/* a - b of two Q16 angles, electrical degrees */
+static double CommutBench_Deg(uint16_t a, uint16_t b)
+{
+  return fabs((int16_t)(uint16_t)(a - b) * 360.0 / 65536.0);
+}
+
+static void CommutBench_Row(const char *name, double speed, uint32_t n, uint64_t cycles, uint32_t max_cycles,
+                            double err_max, double err_hold, int fail)
+{
+  uint32_t budget = SystemCoreClock / COMMUTBENCH_PWM_HZ;
+  uint32_t mean = n ? (uint32_t)(cycles / n) : 0U;
+
+  printf("%s,%.0f,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%.2f,%.2f,%.2f,%s\n", name, speed, n, mean, max_cycles,
+         100.0 * mean / budget, err_max, err_hold, fail ? "FAIL" : "ok");
+}
+
+static int CommutBench_SinCos(void)
+{
+  uint64_t cycles = 0;
+  uint32_t max_cycles = 0;
+  double err_max = 0.0;
+  int fail;
+
+  for (uint32_t a = 0; a < 65536U; a++)
+  {
+    int16_t s, c;
+    uint32_t t0 = CYCCNT_Read(), dc;
+
+    SinTab_SinCos((uint16_t)a, &s, &c);
+    dc = CYCCNT_Read() - t0;
+    cycles += dc;
+    if (dc > max_cycles) max_cycles = dc;
+    err_max = fmax(err_max, fabs(s - round(32767.0 * sin(2.0 * M_PI * a / 65536.0))));
+    err_max = fmax(err_max, fabs(c - round(32767.0 * cos(2.0 * M_PI * a / 65536.0))));
+  }
+  fail = err_max > 3.0 || cycles / 65536U > (SystemCoreClock / COMMUTBENCH_PWM_HZ) / 20U;
+  CommutBench_Row("sincos", 0.0, 65536U, cycles, max_cycles, err_max, 0.0, fail);
+  return fail;
+}
+
+static int CommutBench_Angle(double speed, uint32_t samples)
+{
+  const uint32_t per_us = SystemCoreClock / 1000000U;
+  const uint32_t period = COMMUTBENCH_SAMPLE_US * per_us, pwm = SystemCoreClock / COMMUTBENCH_PWM_HZ;
+  uint64_t cycles = 0;
+  uint32_t max_cycles = 0, n = 0;
+  double err_max = 0.0, err_hold = 0.0;
+  int fail;
+
+  Commut_Init(&cb_commut, COMMUTBENCH_POLE_PAIRS, 0U, COMMUTBENCH_DELAY_US, 2U, SystemCoreClock);
+  cb_seed = 12345U;
+  for (uint32_t k = 0; k < samples; k++)
+  {
+    uint32_t stamp = k * period;
+    double t = (double)stamp / SystemCoreClock;
+    uint16_t raw = CommutBench_Sensor(speed * (t - COMMUTBENCH_DELAY_US * 1e-6));
+
+    Commut_Sample(&cb_commut, raw, stamp);
+    for (uint32_t now = stamp; now < stamp + period; now += pwm)
+    {
+      double tn = (double)now / SystemCoreClock, e = fmod(speed * tn * COMMUTBENCH_POLE_PAIRS, 1.0);
+      uint16_t truth = (uint16_t)(int32_t)floor(e * 65536.0);
+      Commut_OutTypeDef out;
+      uint32_t t0 = CYCCNT_Read(), dc;
+
+      Commut_Angle(&cb_commut, now, &out);
+      dc = CYCCNT_Read() - t0;
+      if (k < 8U) continue;   /* velocity settling */
+      cycles += dc;
+      n++;
+      if (dc > max_cycles) max_cycles = dc;
+      err_max = fmax(err_max, CommutBench_Deg(out.theta, truth));
+      err_hold = fmax(err_hold, CommutBench_Deg((uint16_t)((raw << 4) * COMMUTBENCH_POLE_PAIRS), truth));
+    }
+  }
+  fail = err_max > COMMUTBENCH_ERR_DEG || err_max >= err_hold || cycles / (n ? n : 1U) > pwm / 20U;
+  CommutBench_Row("angle", speed, n, cycles, max_cycles, err_max, err_hold, fail);
+  return fail;
+}
+
+static int CommutBench_Align(double speed)
+{
+  const double at = 0.3137;   /* turns, d axis of the rotor */
+  const uint32_t period = COMMUTBENCH_SAMPLE_US * (SystemCoreClock / 1000000U);
+  uint16_t truth = (uint16_t)(int32_t)floor(fmod(at * COMMUTBENCH_POLE_PAIRS, 1.0) * 65536.0);
+  double err;
+  int fail;
+
+  Commut_Init(&cb_commut, COMMUTBENCH_POLE_PAIRS, 0U, 0U, 2U, SystemCoreClock);
+  cb_seed = 777U;
+  Commut_AlignStart(&cb_commut, COMMUTBENCH_ALIGN_SAMPLES);
+  for (uint32_t k = 0; k < COMMUTBENCH_ALIGN_SAMPLES; k++)
+  {
+    double t = (double)(k * period) / SystemCoreClock;
+
+    Commut_Sample(&cb_commut, CommutBench_Sensor(at + speed * t), k * period);
+  }
+  err = CommutBench_Deg(cb_commut.offset, truth);
+  if (speed == 0.0)
+    fail = cb_commut.align != COMMUT_ALIGN_DONE || err > COMMUTBENCH_ERR_DEG;
+  else
+    fail = cb_commut.align != COMMUT_ALIGN_FAILED;
+  CommutBench_Row(speed == 0.0 ? "align" : "align_moving", speed, COMMUTBENCH_ALIGN_SAMPLES, 0U, 0U,
+                  speed == 0.0 ? err : 0.0, 0.0, fail);
+  return fail;
+}
+
+/**
+  * @brief  Run every case and print the CSV table (see commutbench.h) with
+  *         printf.
+  * @param  samples: sensor readings per speed
+  * @retval 0 all checks passed, 1 otherwise
+  */
+int CommutBench_Run(uint32_t samples)
+{
+  int rc = 0;
+
+  CYCCNT_Init();
+  printf("case,speed_tps,n,cycles_mean,cycles_max,budget_pct,err_max,err_hold,check\n");
+  rc |= CommutBench_SinCos();
+  for (uint32_t i = 0; i < sizeof(speeds_tps) / sizeof(speeds_tps[0]); i++)
+    rc |= CommutBench_Angle(speeds_tps[i], samples < 16U ? 16U : samples);
+  rc |= CommutBench_Align(0.0);
+  rc |= CommutBench_Align(1.0);
+  return rc;
+}
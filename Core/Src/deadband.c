@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : deadband.c
+  * @brief          : Change-driven output decision for stationary shafts.
+  ******************************************************************************
+  */
+
+#include "deadband.h"
+#include <string.h>
+
+/**
+  * @brief  Configure and clear the counters, the next sample is output.
+  * @param  db: deadband state
+  * @param  deadband: counts the position may move silently
+  * @param  heartbeat_ms: longest silence, 0 = none
+  * @retval None
+  */
+void Deadband_Init(Deadband_TypeDef *db, uint16_t deadband, uint32_t heartbeat_ms)
+{
+  memset(db, 0, sizeof(*db));
+  db->deadband = deadband;
+  db->heartbeat_ms = heartbeat_ms;
+}
+
+/**
+  * @brief  Decide whether a sample is output.
+  * @param  db: deadband state
+  * @param  pos: position, Q4
+  * @param  status: status bits, any change is output
+  * @param  now_ms: HAL_GetTick()
+  * @retval DEADBAND_xxx reasons, 0 = suppress
+  */
+uint8_t Deadband_Check(Deadband_TypeDef *db, int32_t pos, uint8_t status, uint32_t now_ms)
+{
+  uint8_t reason = 0;
+  int32_t d = pos - db->ref_pos;
+
+  db->checked++;
+  if (!db->primed)
+  {
+    reason = DEADBAND_HEARTBEAT;
+    db->primed = 1;
+  }
+  else
+  {
+    if ((d < 0 ? -d : d) > (int32_t)db->deadband * 16) reason |= DEADBAND_MOVE;
+    if (status != db->ref_status) reason |= DEADBAND_STATUS;
+    if (db->heartbeat_ms && now_ms - db->ref_tick >= db->heartbeat_ms) reason |= DEADBAND_HEARTBEAT;
+  }
+
+  if (reason == 0U)
+  {
+    db->suppressed++;
+    return 0;
+  }
+  if (reason & DEADBAND_MOVE) db->moves++;
+  if (reason & DEADBAND_STATUS) db->status_changes++;
+  if (reason & DEADBAND_HEARTBEAT) db->heartbeats++;
+  db->ref_pos = pos;
+  db->ref_status = status;
+  db->ref_tick = now_ms;
+  return reason;
+}
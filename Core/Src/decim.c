@@ -0,0 +1,187 @@
+/**
+  ******************************************************************************
+  * @file           : decim.c
+  * @brief          : Decimation of the position stream (CIC or FIR).
+  ******************************************************************************
+  */
+
+#include "decim.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#define DECIM_PI  3.14159265f
+
+/* CIC impulse response while configuring */
+static uint32_t decim_scratch[DECIM_CIC_MAX_LEN];
+
+/* impulse response of the CIC, returns its length */
+static uint32_t Decim_CicCoef(uint8_t ratio, uint8_t order, uint32_t *c)
+{
+  uint32_t len = 1;
+
+  c[0] = 1;
+  for (uint8_t o = 0; o < order; o++)
+  {
+    uint32_t n = len + ratio - 1U;
+
+    /* prefix sums, then differences ratio apart: convolution with a boxcar */
+    for (uint32_t i = len; i < n; i++) c[i] = 0;
+    for (uint32_t i = 1; i < n; i++) c[i] += c[i - 1];
+    for (uint32_t i = n - 1U; i >= ratio; i--) c[i] -= c[i - ratio];
+    len = n;
+  }
+  return len;
+}
+
+/* Blackman windowed sinc, cutoff at half the output rate, sum 32768.
+   Single precision for the FPU, the angles are reduced in integers first:
+   the sinc argument is pi * (2i - taps + 1) / (2 ratio) */
+static void Decim_DesignFir(int16_t *coef, uint8_t taps, uint8_t ratio)
+{
+  static float h[DECIM_FIR_MAX_TAPS];
+  float sum = 0.0f;
+  int32_t total = 0;
+
+  for (uint32_t i = 0; i < taps; i++)
+  {
+    int32_t n = 2 * (int32_t)i - taps + 1;
+    int32_t m = ((n % (4 * ratio)) + 4 * ratio) % (4 * ratio);
+    float a = 2.0f * DECIM_PI * (float)i / (float)(taps - 1U);
+    float w = 0.42f - 0.5f * cosf(a) + 0.08f * cosf(2.0f * a);
+
+    h[i] = w * sinf(DECIM_PI * (float)m / (float)(2U * ratio)) / (DECIM_PI * 0.5f * (float)n);
+    sum += h[i];
+  }
+  for (uint32_t i = 0; i < taps; i++)
+  {
+    coef[i] = (int16_t)lroundf(h[i] / sum * 32768.0f);
+    total += coef[i];
+  }
+  /* rounding residue on the centre taps, the DC gain is exact */
+  coef[taps / 2U - 1U] += (int16_t)((32768 - total) / 2);
+  coef[taps / 2U] += (int16_t)((32768 - total) - (32768 - total) / 2);
+}
+
+static int32_t Decim_FirDot(const int16_t *x, const int16_t *h, uint32_t taps, int16_t ref)
+{
+  uint32_t ref2 = (uint32_t)(uint16_t)ref * 0x00010001U;
+  uint32_t acc = 0;
+
+  /* two taps per instruction: x - ref in 16 bits, then dual MAC */
+  for (uint32_t i = 0; i < taps; i += 2U)
+  {
+    uint32_t xv, hv;
+
+    memcpy(&xv, &x[i], sizeof(xv));
+    memcpy(&hv, &h[i], sizeof(hv));
+    acc = __SMLAD(__SSUB16(xv, ref2), hv, acc);
+  }
+  return (int32_t)acc;
+}
+
+/**
+  * @brief  Configure a decimator and clear its state.
+  * @param  d: decimator
+  * @param  cfg: filter, ratio and order or taps
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int Decim_Init(Decim_TypeDef *d, const Decim_ConfigTypeDef *cfg)
+{
+  float ng = 0.0f;
+
+  if (cfg->kind > DECIM_FIR) return -1;
+  if (cfg->kind != DECIM_OFF && (cfg->ratio < 2U || cfg->ratio > DECIM_MAX_RATIO)) return -1;
+  if (cfg->kind == DECIM_CIC && (cfg->order < 1U || cfg->order > DECIM_CIC_MAX_ORDER)) return -1;
+  if (cfg->kind == DECIM_FIR && (cfg->taps < 4U || cfg->taps > DECIM_FIR_MAX_TAPS || (cfg->taps & 1U))) return -1;
+
+  memset(d, 0, sizeof(*d));
+  d->cfg = *cfg;
+  if (cfg->kind == DECIM_CIC)
+  {
+    uint32_t len = Decim_CicCoef(cfg->ratio, cfg->order, decim_scratch);
+    uint64_t sq = 0;
+
+    d->gain = 1;
+    for (uint8_t o = 0; o < cfg->order; o++) d->gain *= cfg->ratio;
+    d->gain_shift = (d->gain & (d->gain - 1U)) ? 0xFFU : (uint8_t)(63U - __builtin_clzll(d->gain));
+    for (uint32_t i = 0; i < len; i++) sq += (uint64_t)decim_scratch[i] * decim_scratch[i];
+    ng = (float)sq / ((float)d->gain * (float)d->gain);
+  }
+  else if (cfg->kind == DECIM_FIR)
+  {
+    uint64_t sq = 0;
+
+    Decim_DesignFir(d->coef, cfg->taps, cfg->ratio);
+    for (uint32_t i = 0; i < cfg->taps; i++) sq += (uint64_t)((int32_t)d->coef[i] * d->coef[i]);
+    ng = (float)sq / (32768.0f * 32768.0f);
+  }
+  if (ng > 0.0f) d->resolution_mbits = (int16_t)lroundf(-500.0f * log2f(ng));
+  return 0;
+}
+
+/**
+  * @brief  Feed one input sample.
+  * @param  d: decimator, not DECIM_OFF
+  * @param  x: position, counts
+  * @param  y: output position, Q4, written when 1 is returned
+  * @retval 1 when an output is ready, 0 otherwise
+  */
+int Decim_Push(Decim_TypeDef *d, int32_t x, int32_t *y)
+{
+  int64_t q;
+  uint8_t taps = d->cfg.taps;
+
+  if (!d->primed)
+  {
+    d->x0 = x;
+    for (uint32_t i = 0; i < 2U * taps; i++) d->hist[i] = (int16_t)x;
+    d->primed = 1;
+  }
+  d->inputs++;
+
+  if (d->cfg.kind == DECIM_CIC)
+  {
+    uint64_t v = (uint64_t)(int64_t)(int32_t)((uint32_t)x - (uint32_t)d->x0);
+    uint64_t acc = v;
+
+    for (uint8_t s = 0; s < d->cfg.order; s++)
+    {
+      d->integ[s] += acc;
+      acc = d->integ[s];
+    }
+    if (++d->phase < d->cfg.ratio) return 0;
+    d->phase = 0;
+    for (uint8_t s = 0; s < d->cfg.order; s++)
+    {
+      uint64_t t = acc;
+
+      acc -= d->comb[s];
+      d->comb[s] = t;
+    }
+    /* filter output relative to the newest input, wraps cancel */
+    q = (int64_t)(acc - d->gain * v) * 16 + (int64_t)(d->gain / 2U);
+    if (d->gain_shift != 0xFFU)
+    {
+      q >>= d->gain_shift;
+    }
+    else
+    {
+      int64_t r = q % (int64_t)d->gain;
+
+      q = q / (int64_t)d->gain - (r < 0 ? 1 : 0);
+    }
+  }
+  else
+  {
+    d->hist[d->pos] = (int16_t)x;
+    d->hist[d->pos + taps] = (int16_t)x;
+    if (++d->pos == taps) d->pos = 0;
+    if (++d->phase < d->cfg.ratio) return 0;
+    d->phase = 0;
+    q = (Decim_FirDot(&d->hist[d->pos], d->coef, taps, (int16_t)x) + 1024) >> 11;
+  }
+  *y = (int32_t)((uint32_t)x * 16U + (uint32_t)q);
+  d->outputs++;
+  return 1;
+}
@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file           : hil.c
+  * @brief          : Hardware-in-the-loop trajectory injection over USART2.
+  *
+  *  Producer (Hil_OnFrame, rx task) and consumer (Hil_Read, sample task) both
+  *  run from the scheduler, so the FIFO needs no locking.
+  ******************************************************************************
+  */
+
+#include "hil.h"
+#include "main.h"
+#include "app.h"
+#include "debug.h"
+#include "telemetry.h"
+#include <string.h>
+#include <inttypes.h>
+
+static uint16_t hil_fifo[HIL_FIFO_SIZE];
+static uint32_t hil_head;          /* values written */
+static uint16_t hil_last;          /* repeated on underrun */
+static uint32_t hil_last_rx_ms;
+static uint32_t hil_last_report_ms;
+static Hil_StatsTypeDef hil;
+
+static void Hil_Put(uint8_t *p, uint32_t v, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8U * i));
+}
+
+static void Hil_SendStatus(void)
+{
+  uint8_t p[HIL_STATUS_LEN];
+
+  Hil_Put(&p[0], hil.consumed, 4);
+  Hil_Put(&p[4], hil.next_seq, 4);
+  Hil_Put(&p[8], hil.underruns, 4);
+  Hil_Put(&p[12], hil_head - hil.consumed, 2);
+  Hil_Put(&p[14], hil.gaps, 2);
+  Hil_Put(&p[16], hil.overflows, 2);
+  p[18] = hil.active;
+  (void)Telemetry_WriteFrame(TELEMETRY_FRAME_HIL_STATUS, p, sizeof(p));
+}
+
+static void Hil_Data(const uint8_t *payload, uint8_t len)
+{
+  uint32_t seq, n, room;
+
+  if (len < 6U || (len & 1U)) return;
+  seq = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) |
+        ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+  n = (len - 4U) / 2U;
+
+  if (!hil.active)
+  {
+    /* a new injection starts wherever the host starts counting */
+    memset(&hil, 0, sizeof(hil));
+    hil_head = 0;
+    hil.next_seq = seq;
+    hil.active = 1;
+    App_SetSampleSource(Hil_Read);
+    DLOG_INF("hil: injection started at %" PRIu32 "\n", seq);
+  }
+  if (seq != hil.next_seq) hil.gaps++;
+  hil.next_seq = seq + n;
+  hil_last_rx_ms = HAL_GetTick();
+
+  room = HIL_FIFO_SIZE - (hil_head - hil.consumed);
+  if (n > room)
+  {
+    hil.overflows += (uint16_t)(n - room);
+    n = room;
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    hil_fifo[hil_head % HIL_FIFO_SIZE] = (uint16_t)(payload[4U + 2U * i] | (payload[5U + 2U * i] << 8));
+    hil_head++;
+  }
+}
+
+/**
+  * @brief  Frame handler for UartRx_Poll(), ignores non-HIL frames.
+  * @retval None
+  */
+void Hil_OnFrame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+  if (type == TELEMETRY_FRAME_HIL_DATA)
+    Hil_Data(payload, len);
+  else if (type == TELEMETRY_FRAME_HIL_STOP && hil.active)
+    Hil_Stop();
+}
+
+/**
+  * @brief  Periodic part, called from the rx task: status frames and the
+  *         end of an injection whose host went away.
+  * @retval None
+  */
+void Hil_Report(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  if (!hil.active) return;
+  if (hil_head == hil.consumed && now - hil_last_rx_ms > HIL_TIMEOUT_MS)
+  {
+    DLOG_WRN("hil: no data for %u ms, back to the sensor\n", HIL_TIMEOUT_MS);
+    Hil_Stop();
+    return;
+  }
+  if (now - hil_last_report_ms >= HIL_STATUS_PERIOD_MS)
+  {
+    hil_last_report_ms = now;
+    Hil_SendStatus();
+  }
+}
+
+/**
+  * @brief  Sample source while injecting (App_SourceFn).
+  * @param  raw: next injected value, the previous one on underrun
+  * @retval HAL_OK
+  */
+uint8_t Hil_Read(uint16_t *raw)
+{
+  if (hil_head == hil.consumed)
+  {
+    hil.underruns++;
+    *raw = hil_last;
+    return HAL_OK;
+  }
+  hil_last = hil_fifo[hil.consumed % HIL_FIFO_SIZE];
+  hil.consumed++;
+  *raw = hil_last;
+  return HAL_OK;
+}
+
+/**
+  * @brief  End the injection, the sample task reads the sensor again.
+  *         A final status frame reports the totals.
+  * @retval None
+  */
+void Hil_Stop(void)
+{
+  App_SetSampleSource(NULL);
+  hil.active = 0;
+  hil_head = hil.consumed;
+  Hil_SendStatus();
+}
+
+/**
+  * @brief  Copy of the injection counters.
+  * @retval None
+  */
+void Hil_GetStats(Hil_StatsTypeDef *stats)
+{
+  *stats = hil;
+}
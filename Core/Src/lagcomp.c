@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file           : lagcomp.c
+  * @brief          : Latency compensation of the position: how old a sample
+  *                   is, and where the shaft is by now.
+  ******************************************************************************
+  */
+
+#include "lagcomp.h"
+#include "platform.h"
+
+/* time constant of the SF 16x/8x/4x/2x filters, a third of the settling
+   time, ns */
+static const int32_t lagcomp_tau_ns[4] = { 733333, 366667, 183333, 95333 };
+/* fast filter threshold in LSB for the FTH codes */
+static const uint8_t lagcomp_fth[8] = { 0U, 6U, 7U, 9U, 18U, 21U, 24U, 10U };
+
+/**
+  * @brief  Build the delay model of a CONF setting.
+  * @param  m: model
+  * @param  conf: CONF register
+  * @param  bus_hz: I2C clock
+  * @param  trim_us: added to every age, +-LAGCOMP_TRIM_MAX_US
+  * @retval 0 on success, -1 on an invalid clock or trim
+  */
+int LagComp_Init(LagComp_ModelTypeDef *m, uint16_t conf, uint32_t bus_hz, int32_t trim_us)
+{
+  if (bus_hz == 0U || trim_us > LAGCOMP_TRIM_MAX_US || trim_us < -LAGCOMP_TRIM_MAX_US) return -1;
+  m->conf = conf;
+  m->fth = lagcomp_fth[LAGCOMP_CONF_FTH(conf)];
+  m->latch_ns = (int32_t)((uint64_t)AMS5600_READ_HEAD_BITS * 1000000000U / bus_hz);
+  m->trim_ns = trim_us * 1000;
+  m->base_ns = m->trim_ns - m->latch_ns;
+  m->slow_ns = m->base_ns + lagcomp_tau_ns[LAGCOMP_CONF_SF(conf)];
+  m->fast_ns = m->base_ns + lagcomp_tau_ns[3];
+  return 0;
+}
+
+/**
+  * @brief  Age of a sample at the read start, behind the filter the speed
+  *         selects.
+  * @param  m: model
+  * @param  vel: velocity, Q4 counts per sample
+  * @param  period_us: sample period
+  * @retval age, ns, to add to the time since the read start
+  */
+int32_t LagComp_SensorNs(const LagComp_ModelTypeDef *m, int32_t vel, uint32_t period_us)
+{
+  uint32_t v = (uint32_t)(vel < 0 ? -vel : vel);
+  uint64_t t;
+
+  if (m->fth == 0U || v == 0U) return m->slow_ns;
+  /* fth counts at v / 16 counts per period */
+  t = (uint64_t)m->fth * 16U * 1000U * period_us / v;
+  if (t >= (uint64_t)(m->slow_ns - m->base_ns)) return m->slow_ns;
+  if (t <= (uint64_t)(m->fast_ns - m->base_ns)) return m->fast_ns;
+  return m->base_ns + (int32_t)t;
+}
+
+/**
+  * @brief  Position carried forward by the velocity over an age.
+  * @param  pos: position, Q4
+  * @param  vel: velocity, Q4 counts per sample
+  * @param  age_ns: time since the position was true
+  * @param  period_us: sample period
+  * @retval position, Q4
+  */
+int32_t LagComp_Extrapolate(int32_t pos, int32_t vel, int32_t age_ns, uint32_t period_us)
+{
+  int64_t d = (int64_t)vel * age_ns, p = (int64_t)period_us * 1000;
+
+  /* rounded to nearest, both signs */
+  return pos + (int32_t)((d + (d < 0 ? -p / 2 : p / 2)) / p);
+}
@@ -0,0 +1,250 @@
+/**
+  ******************************************************************************
+  * @file           : lowpower.c
+  * @brief          : Low-power acquisition between AS5600 samples.
+  *
+  *  The RTC wake-up timer (LSE, RTCCLK/16 = 2048 Hz, 488 us resolution) ends
+  *  each sleep. The RTC HAL module is not part of this project, the few
+  *  registers needed are programmed directly.
+  *
+  *  Wake-to-sample latency is measured with the DWT counter from the first
+  *  instruction of the wake-up interrupt to the end of the I2C read. In Stop
+  *  mode the core restarts on HSI: cycles up to the end of SystemClock_Config()
+  *  are converted at 16 MHz, the following ones at HCLK. The regulator
+  *  wake-up time before the interrupt runs is not visible to the counter.
+  ******************************************************************************
+  */
+
+#include "lowpower.h"
+#include "main.h"
+#include "cyccnt.h"
+#include "telemetry.h"
+#include "AMS5600_api.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+#define LP_LSE_TIMEOUT_MS  3000U
+#define LP_RTC_WUT_DIV     16U
+
+void SystemClock_Config(void);
+
+static uint32_t lp_rtc_hz;
+static volatile uint8_t lp_woken;
+static volatile uint32_t lp_wake_cyc;
+
+/* AS5600 polling interval and typical supply current per CONF PM value */
+static const uint16_t lp_poll_ms[4]    = { 0, 5, 20, 100 };
+static const uint16_t lp_supply_ua[4]  = { 6500, 3400, 1800, 1500 };
+
+static uint32_t LowPower_CyclesToNs(uint32_t cycles, uint32_t hz)
+{
+  return (uint32_t)(((uint64_t)cycles * 1000000000ULL) / hz);
+}
+
+/**
+  * @brief  Clock the RTC from LSE (LSI if the crystal does not start) and
+  *         route the wake-up timer to EXTI line 22.
+  * @retval None
+  */
+void LowPower_Init(void)
+{
+  uint32_t start;
+
+  CYCCNT_Init();
+  __HAL_RCC_PWR_CLK_ENABLE();
+  HAL_PWR_EnableBkUpAccess();
+
+  lp_rtc_hz = 32768U;
+  __HAL_RCC_LSE_CONFIG(RCC_LSE_ON);
+  start = HAL_GetTick();
+  while (__HAL_RCC_GET_FLAG(RCC_FLAG_LSERDY) == RESET)
+  {
+    if (HAL_GetTick() - start > LP_LSE_TIMEOUT_MS)
+    {
+      __HAL_RCC_LSE_CONFIG(RCC_LSE_OFF);
+      __HAL_RCC_LSI_ENABLE();
+      while (__HAL_RCC_GET_FLAG(RCC_FLAG_LSIRDY) == RESET) {}
+      lp_rtc_hz = LSI_VALUE;
+      break;
+    }
+  }
+
+  if ((RCC->BDCR & RCC_BDCR_RTCSEL) != ((lp_rtc_hz == 32768U) ? RCC_BDCR_RTCSEL_0 : RCC_BDCR_RTCSEL_1))
+  {
+    /* the clock source can only be changed after a backup domain reset */
+    uint32_t lse = RCC->BDCR & (RCC_BDCR_LSEON | RCC_BDCR_LSEBYP);
+    __HAL_RCC_BACKUPRESET_FORCE();
+    __HAL_RCC_BACKUPRESET_RELEASE();
+    RCC->BDCR |= lse;
+    while (lse && __HAL_RCC_GET_FLAG(RCC_FLAG_LSERDY) == RESET) {}
+    RCC->BDCR |= (lp_rtc_hz == 32768U) ? RCC_BDCR_RTCSEL_0 : RCC_BDCR_RTCSEL_1;
+  }
+  __HAL_RCC_RTC_ENABLE();
+
+  RTC->WPR = 0xCAU;
+  RTC->WPR = 0x53U;
+  RTC->CR &= ~RTC_CR_WUTE;
+  while ((RTC->ISR & RTC_ISR_WUTWF) == 0U) {}
+  RTC->CR &= ~RTC_CR_WUCKSEL;  /* RTCCLK / 16 */
+  RTC->CR |= RTC_CR_WUTIE;
+  RTC->WPR = 0xFFU;
+
+  EXTI->IMR |= EXTI_IMR_MR22;
+  EXTI->RTSR |= EXTI_RTSR_TR22;
+  HAL_NVIC_SetPriority(RTC_WKUP_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+}
+
+static void LowPower_ArmWakeTimer(uint32_t period_us)
+{
+  uint32_t ticks = (uint32_t)(((uint64_t)period_us * (lp_rtc_hz / LP_RTC_WUT_DIV)) / 1000000U);
+
+  if (ticks == 0U) ticks = 1U;
+  if (ticks > 0x10000U) ticks = 0x10000U;
+
+  RTC->WPR = 0xCAU;
+  RTC->WPR = 0x53U;
+  RTC->CR &= ~RTC_CR_WUTE;
+  while ((RTC->ISR & RTC_ISR_WUTWF) == 0U) {}
+  RTC->WUTR = ticks - 1U;
+  RTC->ISR = (~(RTC_ISR_WUTF | RTC_ISR_INIT) & 0x0000FFFFU) | (RTC->ISR & RTC_ISR_INIT);
+  RTC->CR |= RTC_CR_WUTE;
+  RTC->WPR = 0xFFU;
+  EXTI->PR = EXTI_PR_PR22;
+}
+
+/**
+  * @brief  RTC wake-up interrupt body, called from RTC_WKUP_IRQHandler().
+  * @retval None
+  */
+void LowPower_WakeIRQ(void)
+{
+  lp_wake_cyc = CYCCNT_Read();
+  RTC->ISR = (~(RTC_ISR_WUTF | RTC_ISR_INIT) & 0x0000FFFFU) | (RTC->ISR & RTC_ISR_INIT);
+  EXTI->PR = EXTI_PR_PR22;
+  lp_woken = 1;
+}
+
+/**
+  * @brief  Slowest AS5600 power mode whose polling interval does not exceed
+  *         the sample period, so every sample sees a fresh conversion.
+  * @param  period_us: MCU sample period
+  * @retval AMS5600_PM_xxx value
+  */
+uint8_t LowPower_As5600ModeFor(uint32_t period_us)
+{
+  uint8_t pm = AMS5600_PM_LPM3;
+
+  while (pm > AMS5600_PM_NOM && (uint32_t)lp_poll_ms[pm] * 1000U > period_us) pm--;
+  return pm;
+}
+
+/**
+  * @brief  Sleep for one sample period, then read the raw angle.
+  * @param  mode: LP_MODE_SLEEP or LP_MODE_STOP
+  * @param  period_us: time to sleep
+  * @param  rawAngle: RAW ANGLE register value
+  * @param  latency_ns: wake-up interrupt to end of read
+  * @retval HAL status of the I2C read
+  */
+uint8_t LowPower_Acquire(LowPower_ModeTypeDef mode, uint32_t period_us,
+                         uint16_t *rawAngle, uint32_t *latency_ns)
+{
+  uint32_t wake_hz = SystemCoreClock;
+  uint32_t t_restored, t_done;
+  uint8_t status;
+
+  if (mode == LP_MODE_STOP)
+  {
+    /* Stop freezes the UART DMA, let the pending line go out first */
+    Telemetry_WaitIdle(100);
+    wake_hz = HSI_VALUE;
+  }
+
+  LowPower_ArmWakeTimer(period_us);
+  HAL_SuspendTick();
+  lp_woken = 0;
+  while (!lp_woken)
+  {
+    if (mode == LP_MODE_STOP)
+      HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+    else
+      HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+  }
+  if (mode == LP_MODE_STOP) SystemClock_Config();
+  t_restored = CYCCNT_Read();
+  HAL_ResumeTick();
+
+  status = AMS5600_getRawAngle(rawAngle);
+  t_done = CYCCNT_Read();
+
+  *latency_ns = LowPower_CyclesToNs(t_restored - lp_wake_cyc, wake_hz)
+              + LowPower_CyclesToNs(t_done - t_restored, SystemCoreClock);
+  return status;
+}
+
+/**
+  * @brief  Low-power acquisition loop, replaces the scheduler. Never returns.
+  * @param  mode: LP_MODE_SLEEP or LP_MODE_STOP
+  * @param  period_us: sample period
+  * @retval None
+  */
+void LowPower_Run(LowPower_ModeTypeDef mode, uint32_t period_us)
+{
+  uint16_t rawAngle;
+  uint32_t latency_ns;
+  char line[80];
+  int len;
+
+  if (AMS5600_setPowerMode(LowPower_As5600ModeFor(period_us)) != HAL_OK) Error_Handler();
+
+  for (;;)
+  {
+    if (LowPower_Acquire(mode, period_us, &rawAngle, &latency_ns) != HAL_OK) continue;
+    len = snprintf(line, sizeof(line), "rawAngle : %d   Angle (deg) : %f   wake (us) : %" PRIu32 "\n",
+                   rawAngle, rawAngle * 0.087890625, latency_ns / 1000U);
+    Telemetry_Write(line, (uint16_t)len);
+  }
+}
+
+/**
+  * @brief  Measure wake-to-sample latency for every MCU mode / AS5600 power
+  *         mode combination and print a CSV table through printf. The worst
+  *         sample age adds the AS5600 polling interval to the latency.
+  * @param  period_us: sleep time between samples
+  * @param  samples: samples per combination
+  * @retval None
+  */
+void LowPower_LatencySweep(uint32_t period_us, uint32_t samples)
+{
+  static const char *const mode_names[] = { "run", "sleep", "stop" };
+
+  printf("\r\nlowpower sweep, period %" PRIu32 " us, rtc %" PRIu32 " Hz\r\n", period_us, lp_rtc_hz);
+  printf("mcu,as5600_pm,poll_ms,as5600_ua,n,min_us,mean_us,max_us,worst_age_us\r\n");
+
+  for (int mode = LP_MODE_SLEEP; mode <= LP_MODE_STOP; mode++)
+  {
+    for (uint8_t pm = AMS5600_PM_NOM; pm <= AMS5600_PM_LPM3; pm++)
+    {
+      LowPower_LatencyTypeDef lat = { 0, UINT32_MAX, 0, 0 };
+      uint16_t rawAngle;
+      uint32_t ns;
+
+      if (AMS5600_setPowerMode(pm) != HAL_OK) Error_Handler();
+      for (uint32_t i = 0; i < samples; i++)
+      {
+        if (LowPower_Acquire((LowPower_ModeTypeDef)mode, period_us, &rawAngle, &ns) != HAL_OK) continue;
+        lat.count++;
+        lat.sum_ns += ns;
+        if (ns < lat.min_ns) lat.min_ns = ns;
+        if (ns > lat.max_ns) lat.max_ns = ns;
+      }
+      if (lat.count == 0) continue;
+      printf("%s,%u,%u,%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\r\n",
+             mode_names[mode], pm, lp_poll_ms[pm], lp_supply_ua[pm], lat.count,
+             lat.min_ns / 1000U, (uint32_t)(lat.sum_ns / lat.count / 1000U), lat.max_ns / 1000U,
+             lat.max_ns / 1000U + lp_poll_ms[pm] * 1000U);
+    }
+  }
+  AMS5600_setPowerMode(AMS5600_PM_NOM);
+}
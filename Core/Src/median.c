@@ -0,0 +1,264 @@
+/**
+  ******************************************************************************
+  * @file           : median.c
+  * @brief          : Sliding-window median (Hampel) rejection of single-sample
+  *                   glitches in the RAW ANGLE stream.
+  ******************************************************************************
+  */
+
+#include "median.h"
+#include <string.h>
+
+#define MEDIAN_H(m, n)  ((n) == MEDIAN_NIL ? 0U : (m)->height[n])
+#define MEDIAN_S(m, n)  ((n) == MEDIAN_NIL ? 0U : (m)->size[n])
+
+/* a / b rounded to nearest, both signs, b > 0 */
+static int32_t Median_Div(int32_t a, int32_t b)
+{
+  return (a + (a < 0 ? -b : b) / 2) / b;
+}
+
+/* order of two nodes, equal steps by slot so every key is unique */
+static int Median_Less(const Median_TypeDef *m, uint8_t a, uint8_t b)
+{
+  return m->key[a] < m->key[b] || (m->key[a] == m->key[b] && a < b);
+}
+
+static void Median_Fix(Median_TypeDef *m, uint8_t n)
+{
+  uint8_t hl = MEDIAN_H(m, m->left[n]), hr = MEDIAN_H(m, m->right[n]);
+
+  m->height[n] = (uint8_t)(1U + (hl > hr ? hl : hr));
+  m->size[n] = (uint8_t)(1U + MEDIAN_S(m, m->left[n]) + MEDIAN_S(m, m->right[n]));
+}
+
+static uint8_t Median_RotateRight(Median_TypeDef *m, uint8_t y)
+{
+  uint8_t x = m->left[y];
+
+  m->left[y] = m->right[x];
+  m->right[x] = y;
+  Median_Fix(m, y);
+  Median_Fix(m, x);
+  return x;
+}
+
+static uint8_t Median_RotateLeft(Median_TypeDef *m, uint8_t x)
+{
+  uint8_t y = m->right[x];
+
+  m->right[x] = m->left[y];
+  m->left[y] = x;
+  Median_Fix(m, x);
+  Median_Fix(m, y);
+  return y;
+}
+
+/* restore the AVL balance at n after one side changed by a level */
+static uint8_t Median_Balance(Median_TypeDef *m, uint8_t n)
+{
+  int bf;
+
+  Median_Fix(m, n);
+  bf = (int)MEDIAN_H(m, m->left[n]) - (int)MEDIAN_H(m, m->right[n]);
+  if (bf > 1)
+  {
+    if (MEDIAN_H(m, m->left[m->left[n]]) < MEDIAN_H(m, m->right[m->left[n]]))
+      m->left[n] = Median_RotateLeft(m, m->left[n]);
+    return Median_RotateRight(m, n);
+  }
+  if (bf < -1)
+  {
+    if (MEDIAN_H(m, m->right[m->right[n]]) < MEDIAN_H(m, m->left[m->right[n]]))
+      m->right[n] = Median_RotateRight(m, m->right[n]);
+    return Median_RotateLeft(m, n);
+  }
+  return n;
+}
+
+static uint8_t Median_Insert(Median_TypeDef *m, uint8_t n, uint8_t i)
+{
+  if (n == MEDIAN_NIL)
+  {
+    m->left[i] = MEDIAN_NIL;
+    m->right[i] = MEDIAN_NIL;
+    m->height[i] = 1U;
+    m->size[i] = 1U;
+    return i;
+  }
+  if (Median_Less(m, i, n))
+    m->left[n] = Median_Insert(m, m->left[n], i);
+  else
+    m->right[n] = Median_Insert(m, m->right[n], i);
+  return Median_Balance(m, n);
+}
+
+/* unlink the smallest node below n into *min */
+static uint8_t Median_RemoveMin(Median_TypeDef *m, uint8_t n, uint8_t *min)
+{
+  if (m->left[n] == MEDIAN_NIL)
+  {
+    *min = n;
+    return m->right[n];
+  }
+  m->left[n] = Median_RemoveMin(m, m->left[n], min);
+  return Median_Balance(m, n);
+}
+
+/* unlink node i, which is below n; its successor node takes its place, the
+   nodes stay with their slots */
+static uint8_t Median_Remove(Median_TypeDef *m, uint8_t n, uint8_t i)
+{
+  if (n == i)
+  {
+    uint8_t l = m->left[n], r = m->right[n], s;
+
+    if (r == MEDIAN_NIL) return l;
+    r = Median_RemoveMin(m, r, &s);
+    m->left[s] = l;
+    m->right[s] = r;
+    return Median_Balance(m, s);
+  }
+  if (Median_Less(m, i, n))
+    m->left[n] = Median_Remove(m, m->left[n], i);
+  else
+    m->right[n] = Median_Remove(m, m->right[n], i);
+  return Median_Balance(m, n);
+}
+
+/**
+  * @brief  Check and take the configuration, with an empty window.
+  * @param  m: filter state
+  * @param  window: steps tested against, MEDIAN_MIN_WINDOW..MEDIAN_MAX_WINDOW,
+  *         odd for a true median
+  * @param  k: threshold in sigma, tenths (30 = 3 sigma, Hampel's)
+  * @param  floor: threshold at no spread, counts, 1..2047
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int Median_Init(Median_TypeDef *m, uint8_t window, uint8_t k, uint16_t floor)
+{
+  if (window < MEDIAN_MIN_WINDOW || window > MEDIAN_MAX_WINDOW) return -1;
+  if (floor == 0U || floor > 2047U) return -1;
+  memset(m, 0, sizeof(*m));
+  m->window = window;
+  m->k = k;
+  m->floor = floor;
+  Median_Resync(m);
+  return 0;
+}
+
+/**
+  * @brief  Start over after a gap in the readings: empty window, the next
+  *         reading passes. Counters stay.
+  * @param  m: filter state
+  * @retval None
+  */
+void Median_Resync(Median_TypeDef *m)
+{
+  m->root = MEDIAN_NIL;
+  m->head = 0;
+  m->count = 0;
+  m->primed = 0;
+  m->run = 0;
+  m->outlier = 0;
+}
+
+/**
+  * @brief  Step of a given rank in the window, by the subtree sizes.
+  * @param  m: filter state
+  * @param  rank: 0 = smallest, below the window fill
+  * @retval step, counts
+  */
+int16_t Median_Select(const Median_TypeDef *m, uint8_t rank)
+{
+  uint8_t n = m->root;
+
+  for (;;)
+  {
+    uint8_t ls = MEDIAN_S(m, m->left[n]);
+
+    if (rank < ls)
+      n = m->left[n];
+    else if (rank == ls)
+      return m->key[n];
+    else
+    {
+      rank = (uint8_t)(rank - ls - 1U);
+      n = m->right[n];
+    }
+  }
+}
+
+/**
+  * @brief  Filter one reading.
+  * @param  m: filter state
+  * @param  raw: RAW ANGLE, 12 bits
+  * @param  dt: time since the last reading, MEDIAN_DT_ONE = the nominal
+  *         interval, taken within MEDIAN_DT_MIN..MEDIAN_DT_MAX
+  * @retval the reading, or its replacement when an outlier
+  */
+uint16_t Median_Push(Median_TypeDef *m, uint16_t raw, uint16_t dt)
+{
+  int32_t s, e = 0;
+  uint8_t slot;
+
+  m->samples++;
+  m->outlier = 0;
+  if (!m->primed)
+  {
+    m->primed = 1;
+    m->y = raw & 0xFFFU;
+    return m->y;
+  }
+  if (dt < MEDIAN_DT_MIN) dt = MEDIAN_DT_MIN;
+  if (dt > MEDIAN_DT_MAX) dt = MEDIAN_DT_MAX;
+  /* wrapped to +-half a turn */
+  s = ((raw - m->y + 2048) & 0xFFF) - 2048;
+
+  if (m->count == m->window)
+  {
+    int16_t q1 = Median_Select(m, (uint8_t)((m->count - 1U) / 4U));
+    int16_t q3 = Median_Select(m, (uint8_t)(3U * (m->count - 1U) / 4U));
+    int32_t dev;
+    uint32_t thr;
+
+    /* tested in counts over this interval: the speed spread scales with
+       it, the noise of the reading does not */
+    m->med = Median_Select(m, (uint8_t)((m->count - 1U) / 2U));
+    e = Median_Div((int32_t)m->med * dt, MEDIAN_DT_ONE);
+    /* sigma = IQR * 0.7413 ~ 95 / 128; keys are within +-2048 * 256 /
+       MEDIAN_DT_MIN = +-8192, so IQR * k * 95 * dt reaches 16384 * 255 *
+       95 * 1024, about 4e11: the product is taken in 64 bits */
+    thr = m->floor + (uint32_t)((uint64_t)(uint32_t)(q3 - q1) * m->k * 95U * dt / (1280U * MEDIAN_DT_ONE));
+    m->thr = (uint16_t)(thr > 2048U ? 2048U : thr);
+    dev = s - e;
+    if (dev > m->thr || dev < -(int32_t)m->thr)
+    {
+      if (++m->run > m->window / 2U)
+      {
+        /* too many in a row for a glitch: follow the jump */
+        m->resyncs++;
+        Median_Resync(m);
+        m->primed = 1;
+        m->y = raw & 0xFFFU;
+        return m->y;
+      }
+      m->outlier = 1;
+      m->outliers++;
+    }
+    else
+      m->run = 0;
+    /* the oldest step makes room */
+    slot = m->head;
+    m->root = Median_Remove(m, m->root, slot);
+    m->head = (uint8_t)(m->head + 1U == m->window ? 0U : m->head + 1U);
+  }
+  else
+    slot = m->count++;
+
+  /* the window keeps speeds, steps per nominal interval */
+  m->key[slot] = (int16_t)Median_Div(s * (int32_t)MEDIAN_DT_ONE, dt);
+  m->root = Median_Insert(m, m->root, slot);
+  m->y = (uint16_t)((m->outlier ? m->y + e : raw) & 0xFFFU);
+  return m->y;
+}
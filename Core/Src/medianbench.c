@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file           : medianbench.c
+  * @brief          : Cost and rejection benchmark of the glitch filter for
+  *                   windows of 5 to 63 steps.
+  ******************************************************************************
+  */
+
+#include "medianbench.h"
+#include "main.h"
+#include "cyccnt.h"
+#include "median.h"
+#include <math.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+typedef struct
+{
+  const char *name;
+  double   v0, v1;         /* turns/s at the first and the last sample */
+  double   jitter;         /* reading time off the sample period, +- of it */
+} MedianBench_CaseTypeDef;
+
+static const uint8_t windows[] = { 5U, 7U, 9U, 15U, 31U, 63U };
+
+static const MedianBench_CaseTypeDef cases[] = {
+  { "stand",   0.0,  0.0, 0.0 },
+  { "run",    50.0, 50.0, 0.0 },
+  { "accel",   0.0, 50.0, 0.0 },
+  { "jitter", 50.0, 50.0, 0.4 },
+};
+
+static Median_TypeDef mb_median;
+static uint32_t mb_seed;
+
+static uint32_t MedianBench_Rand(void)
+{
+  mb_seed = mb_seed * 1664525U + 1013904223U;
+  return mb_seed >> 8;
+}
+
+static int MedianBench_One(uint8_t window, const MedianBench_CaseTypeDef *c, uint32_t samples)
+{
+  const double dt = 1e-3;
+  uint64_t cycles = 0;
+  uint32_t max_cycles = 0, timed = 0, spikes = 0, missed = 0, false_rej = 0, next_spike;
+  double err_max = 0.0, accel = (c->v1 - c->v0) / (samples * dt), last = 0.0;
+  int fail;
+
+  if (Median_Init(&mb_median, window, 30U, MEDIANBENCH_FLOOR) != 0) return 1;
+  mb_seed = 12345U;
+  next_spike = 50U + MedianBench_Rand() % 100U;
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    double t = (i + c->jitter * (MedianBench_Rand() / 8388608.0 - 1.0)) * dt;
+    double turns = c->v0 * t + 0.5 * accel * t * t, noise, err;
+    int32_t truth = (int32_t)floor(turns * 4096.0);
+    uint16_t raw, y, interval;
+    uint32_t t0, dc;
+    uint8_t spike = 0, full = mb_median.count == mb_median.window;
+
+    noise = MedianBench_Rand() / 16777216.0 - 0.5;
+    raw = (uint16_t)((int32_t)floor(turns * 4096.0 + noise) & 0xFFF);
+    if (i == next_spike)
+    {
+      uint32_t r = MedianBench_Rand();
+      int32_t s = 16 + (int32_t)(r % 2032U);
+
+      raw = (uint16_t)((raw + ((r & 0x800000U) ? -s : s)) & 0xFFF);
+      next_spike += 50U + MedianBench_Rand() % 100U;
+      spike = 1;
+    }
+    interval = (uint16_t)lround((t - last) / dt * MEDIAN_DT_ONE);
+    last = t;
+    t0 = CYCCNT_Read();
+    y = Median_Push(&mb_median, raw, interval);
+    dc = CYCCNT_Read() - t0;
+    if (full)
+    {
+      cycles += dc;
+      timed++;
+      if (dc > max_cycles) max_cycles = dc;
+    }
+    /* spikes while the window fills pass by design */
+    if (!full) continue;
+    if (spike)
+    {
+      spikes++;
+      if (!mb_median.outlier) missed++;
+    }
+    else if (mb_median.outlier)
+      false_rej++;
+    err = fabs((double)(((y - truth + 2048) & 0xFFF) - 2048));
+    if (err > err_max) err_max = err;
+  }
+
+  fail = missed != 0U || false_rej != 0U || err_max > MEDIANBENCH_ERR_MAX;
+  printf("%u,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%.0f,%s\n",
+         window, c->name, samples, timed ? (uint32_t)(cycles / timed) : 0U, max_cycles, spikes,
+         mb_median.outliers, missed, false_rej, err_max, fail ? "FAIL" : "ok");
+  return fail;
+}
+
+/**
+  * @brief  Run every window and case and print the CSV table (see
+  *         medianbench.h) with printf.
+  * @param  samples: readings per row, 1 s at 1 kHz for 1000
+  * @retval 0 all checks passed, 1 otherwise
+  */
+int MedianBench_Run(uint32_t samples)
+{
+  int rc = 0;
+
+  CYCCNT_Init();
+  if (samples < 2U * MEDIAN_MAX_WINDOW) samples = 2U * MEDIAN_MAX_WINDOW;
+  printf("window,case,samples,cycles_mean,cycles_max,spikes,rejected,missed,false,err_max,check\n");
+  for (uint32_t w = 0; w < sizeof(windows); w++)
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) rc |= MedianBench_One(windows[w], &cases[i], samples);
+  return rc;
+}
@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file           : order.c
+  * @brief          : Order tracking: the angle stream resampled to a fixed
+  *                   number of points per revolution, per-order amplitudes.
+  ******************************************************************************
+  */
+
+#include "order.h"
+#include "sintab.h"
+#include <math.h>
+#include <string.h>
+
+/* one revolution complete at time t, 1 when it gave a result */
+static int Order_Finish(Order_TypeDef *o, uint32_t t)
+{
+  Order_ResultTypeDef *r = &o->result;
+  uint32_t ticks = t - o->t0;
+  double s = o->points, t1 = o->last_ticks, t2 = ticks;
+  /* time at grid point j through -S, 0 and S: a1 j + a2 j^2 */
+  double a1 = (t2 + t1) / (2.0 * s), a2 = (t2 - t1) / (2.0 * s * s);
+  /* counts per tick, q15 and the 2 / S of a one-sided amplitude, in mc */
+  double scale = 4096.0 / t2 * 2.0 * 1000.0 / (s * 32768.0);
+
+  o->last_ticks = ticks;
+  if (t1 == 0.0) return 0;
+
+  r->rev = o->revs++;
+  r->ticks = ticks;
+  r->samples = o->samples;
+  r->orders = o->orders;
+  /* double precision once per revolution, the terms nearly cancel */
+  for (uint32_t k = 0; k < o->orders; k++)
+  {
+    double re = (double)o->tc[k] - a1 * (double)o->jc[k] - a2 * (double)o->qc[k];
+    double im = (double)o->ts[k] - a1 * (double)o->js[k] - a2 * (double)o->qs[k];
+
+    r->amp_mc[k] = (uint32_t)lround(sqrt(re * re + im * im) * scale);
+  }
+  return 1;
+}
+
+/* grid point m reached at time t, returns 1 when it completed a revolution */
+static int Order_Point(Order_TypeDef *o, int32_t m, uint32_t t)
+{
+  uint32_t mask = o->points - 1U;
+  uint32_t idx = (uint32_t)(o->dir > 0 ? m : -m) & mask;
+  uint32_t rel;
+  int done = 0;
+
+  if (idx == 0U)
+  {
+    if (o->j == (int32_t)o->points) done = Order_Finish(o, t);
+    o->j = 0;
+    o->t0 = t;
+    o->samples = 0;
+    memset(o->tc, 0, sizeof(o->tc));
+    memset(o->ts, 0, sizeof(o->ts));
+  }
+  if (o->j < 0) return done;
+
+  rel = t - o->t0;
+  for (uint32_t k = 0; k < o->orders; k++)
+  {
+    uint32_t w = o->twiddle[((k + 1U) * (uint32_t)o->j) & mask];
+
+    o->tc[k] += (int64_t)rel * (int16_t)w;
+    o->ts[k] += (int64_t)rel * (int16_t)(w >> 16);
+  }
+  o->j++;
+  return done;
+}
+
+/* drop the revolution in progress, the next one starts at the zero */
+static void Order_Restart(Order_TypeDef *o)
+{
+  if (o->j >= 0) o->restarts++;
+  o->j = -1;
+  o->last_ticks = 0;
+}
+
+/**
+  * @brief  Select the grid and the orders and clear the state.
+  * @param  o: order tracking state
+  * @param  points: grid points per revolution, power of two
+  *         ORDER_MIN_POINTS..ORDER_MAX_POINTS, 0 = off
+  * @param  orders: orders reported, 1..ORDER_MAX_ORDERS and up to points / 2
+  * @param  max_ticks: longest revolution, in time stamp ticks
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int Order_Init(Order_TypeDef *o, uint16_t points, uint8_t orders, uint32_t max_ticks)
+{
+  if (points != 0U)
+  {
+    if (points < ORDER_MIN_POINTS || points > ORDER_MAX_POINTS || (points & (points - 1U))) return -1;
+    if (orders == 0U || orders > ORDER_MAX_ORDERS || orders > points / 2U || max_ticks == 0U) return -1;
+  }
+  memset(o, 0, sizeof(*o));
+  o->points = points;
+  o->orders = orders;
+  o->max_ticks = max_ticks;
+  o->j = -1;
+  if (points == 0U) return 0;
+
+  o->shift = 16U;
+  for (uint32_t n = points; n > 1U; n >>= 1) o->shift--;
+
+  /* from the sine table: its 256 points per turn hold every grid, no
+     interpolation and no trigonometry at run time */
+  for (uint32_t m = 0; m < points; m++)
+  {
+    int16_t sn, cs;
+
+    SinTab_SinCos((uint16_t)(m << o->shift), &sn, &cs);
+    o->twiddle[m] = (uint16_t)cs | ((uint32_t)(uint16_t)sn << 16);
+  }
+  /* the trend of the times, with the same twiddles */
+  for (uint32_t k = 0; k < orders; k++)
+  {
+    for (uint32_t j = 0; j < points; j++)
+    {
+      uint32_t w = o->twiddle[((k + 1U) * j) & (points - 1U)];
+
+      o->jc[k] += (int64_t)j * (int16_t)w;
+      o->js[k] += (int64_t)j * (int16_t)(w >> 16);
+      o->qc[k] += (int64_t)(j * j) * (int16_t)w;
+      o->qs[k] += (int64_t)(j * j) * (int16_t)(w >> 16);
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Add one time-stamped position, time stamp the grid points
+  *         crossed since the previous one. The pipeline unwraps less than
+  *         half a turn per sample, so at most points / 2 grid points are
+  *         handled per call.
+  * @param  o: order tracking state
+  * @param  pos: multi-turn position, Q4, zero at the calibrated zero
+  * @param  t: acquisition time, wrapping ticks
+  * @retval 1 when a revolution completed and result was updated, 0 otherwise
+  */
+int Order_Push(Order_TypeDef *o, int32_t pos, uint32_t t)
+{
+  int32_t d, m;
+  int8_t dir;
+  int32_t g = (int32_t)1 << o->shift;   /* grid spacing, Q4 */
+  float scale;
+  int done = 0;
+
+  if (o->points == 0U) return 0;
+  if (!o->primed)
+  {
+    o->primed = 1;
+    o->prev_pos = pos;
+    o->prev_t = t;
+    return 0;
+  }
+  if (o->j >= 0 && (uint32_t)(t - o->t0) > o->max_ticks) Order_Restart(o);
+
+  d = pos - o->prev_pos;
+  if (d != 0)
+  {
+    dir = d > 0 ? 1 : -1;
+    if (dir != o->dir)
+    {
+      Order_Restart(o);
+      o->dir = dir;
+    }
+
+    /* crossing times interpolated between the two samples */
+    scale = (float)(uint32_t)(t - o->prev_t) / (float)d;
+    if (dir > 0)
+    {
+      for (m = (o->prev_pos >> o->shift) + 1; m * g <= pos; m++)
+        done |= Order_Point(o, m, o->prev_t + (uint32_t)lrintf((float)(m * g - o->prev_pos) * scale));
+    }
+    else
+    {
+      for (m = (o->prev_pos - 1) >> o->shift; m * g >= pos; m--)
+        done |= Order_Point(o, m, o->prev_t + (uint32_t)lrintf((float)(m * g - o->prev_pos) * scale));
+    }
+    o->prev_pos = pos;
+  }
+  /* at standstill the next crossing is after the latest sample */
+  o->prev_t = t;
+  if (o->j >= 0 && o->samples < 0xFFFFU) o->samples++;
+  return done;
+}
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : oversample.c
+  * @brief          : Averaging of a burst of RAW ANGLE readings into a 16-bit
+  *                   angle with a noise estimate.
+  ******************************************************************************
+  */
+
+#include "oversample.h"
+#include "platform.h"
+#include <math.h>
+
+/**
+  * @brief  Circular mean and spread of a burst of readings.
+  * @param  raw: 12-bit readings
+  * @param  n: readings, 1..OVERSAMPLE_MAX_N
+  * @param  out: mean and noise
+  * @retval None
+  */
+void Oversample_Mean(const uint16_t *raw, uint16_t n, Oversample_OutTypeDef *out)
+{
+  uint16_t ref = raw[0] & 0x0FFFU;
+  int32_t sum = 0, lo = 0, hi = 0, mean;
+  int64_t sq = 0, m2;
+
+  for (uint16_t i = 1; i < n; i++)
+  {
+    /* to the first reading, within half a turn */
+    int32_t d = (int32_t)((uint32_t)(raw[i] - ref) << 20) >> 20;
+
+    sum += d;
+    sq += (int64_t)d * d;
+    if (d < lo) lo = d;
+    if (d > hi) hi = d;
+  }
+  /* Q4, rounded to nearest, both signs */
+  mean = (sum * 16 + (sum < 0 ? -(int32_t)n / 2 : (int32_t)n / 2)) / (int32_t)n;
+  out->angle = (uint16_t)(ref * 16U + (uint32_t)mean);
+  out->raw = (uint16_t)(((uint32_t)out->angle + 8U) >> 4) & 0x0FFFU;
+  out->n = n;
+  out->spread = (uint16_t)(hi - lo);
+  out->sigma = 0;
+  out->noise = 0;
+  if (n > 1U)
+  {
+    /* n^2 variance, (n sum d^2 - (sum d)^2) */
+    m2 = (int64_t)n * sq - (int64_t)sum * sum;
+    out->sigma = (uint16_t)lrintf(sqrtf((float)m2 / ((float)n * (n - 1U))) * 16.0f);
+    out->noise = (uint16_t)lrintf(sqrtf((float)m2 / ((float)n * n * (n - 1U))) * 16.0f);
+  }
+}
+
+/**
+  * @brief  Bus time of a burst of n readings (AMS5600_getRawAngleBurst()),
+  *         without the START and STOP timings.
+  * @param  n: readings
+  * @param  bus_hz: I2C clock
+  * @retval ns
+  */
+uint32_t Oversample_BusNs(uint16_t n, uint32_t bus_hz)
+{
+  return (uint32_t)(((uint64_t)AMS5600_READ_HEAD_BITS + (uint64_t)OVERSAMPLE_BITS * n) * 1000000000U / bus_hz);
+}
@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file           : oversamplebench.c
+  * @brief          : Resolution gained by oversampling against the bus time
+  *                   it costs.
+  ******************************************************************************
+  */
+
+#include "oversamplebench.h"
+#include "main.h"
+#include "AMS5600_api.h"
+#include "cyccnt.h"
+#include "oversample.h"
+#include <math.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#define OVERSAMPLEBENCH_SF_MASK  0x0300U   /* CONF bits 9:8 */
+
+extern I2C_HandleTypeDef hi2c1;
+
+static const uint16_t sfs[] = { 0x0000U, 0x0300U };   /* 16x, 2x */
+static const uint16_t ns[] = { 1U, 2U, 4U, 8U, 16U, 32U, 64U };
+
+static uint16_t ob_raw[OVERSAMPLE_MAX_N];
+
+/* rms over the angle of the bias a mean of readings with gaussian noise
+   sigma (counts) keeps from the 1-count quantiser: the harmonics of its
+   sawtooth, damped by the noise */
+static double OversampleBench_Bias(double sigma)
+{
+  double q2 = 0.0;
+
+  for (int k = 1; k <= 16; k++)
+    q2 += exp(-4.0 * M_PI * M_PI * k * k * sigma * sigma) / (2.0 * M_PI * M_PI * k * k);
+  return sqrt(q2);
+}
+
+/**
+  * @brief  Run every filter setting and burst length and print the CSV
+  *         table (see oversamplebench.h) with printf.
+  * @param  readings: oversampled readings per row
+  * @retval None
+  */
+void OversampleBench_Run(uint32_t readings)
+{
+  uint16_t conf;
+
+  if (readings < 2U || AMS5600_getConf(&conf) != HAL_OK) return;
+  CYCCNT_Init();
+  printf("sf,n,readings,bus_us,cycles_mean,sigma,noise_est,noise_meas,eff_bits,gain_bits\n");
+  for (uint32_t s = 0; s < sizeof(sfs) / sizeof(sfs[0]); s++)
+  {
+    double bits1 = 0.0;
+
+    AMS5600_setConf((uint16_t)((conf & ~OVERSAMPLEBENCH_SF_MASK) | sfs[s]));
+    for (uint32_t k = 0; k < sizeof(ns) / sizeof(ns[0]); k++)
+    {
+      Oversample_OutTypeDef o;
+      uint64_t cycles = 0;
+      uint32_t m = 0, t0;
+      uint16_t first = 0;
+      double sigma = 0.0, est = 0.0, sum = 0.0, sq = 0.0, meas, bias, bits;
+
+      for (uint32_t r = 0; r < readings; r++)
+      {
+        int16_t d;
+
+        t0 = CYCCNT_Read();
+        if (AMS5600_getRawAngleBurst(ob_raw, ns[k]) != HAL_OK) continue;
+        Oversample_Mean(ob_raw, ns[k], &o);
+        cycles += CYCCNT_Read() - t0;
+        if (m++ == 0U) first = o.angle;
+        d = (int16_t)(o.angle - first);   /* within half a turn */
+        sum += d;
+        sq += (double)d * d;
+        sigma += o.sigma;
+        est += o.noise;
+      }
+      if (m < 2U) continue;
+      meas = sqrt(fmax(sq / m - (sum / m) * (sum / m), 0.0) * m / (m - 1U));
+      /* counts: measured spread, quantiser bias, the 1/16 count output step */
+      bias = ns[k] > 1U ? OversampleBench_Bias(sigma / m / 16.0) : sqrt(1.0 / 12.0);
+      bits = 12.0 - log2(sqrt(12.0 * ((meas / 16.0) * (meas / 16.0) + bias * bias + 1.0 / (12.0 * 256.0))));
+      if (k == 0U) bits1 = bits;
+      printf("%u,%u,%" PRIu32 ",%.1f,%" PRIu32 ",%.1f,%.2f,%.2f,%.2f,%.2f\n", 16U >> (sfs[s] >> 8), ns[k],
+             m, Oversample_BusNs(ns[k], hi2c1.Init.ClockSpeed) / 1000.0, (uint32_t)(cycles / m),
+             sigma / m, est / m, meas, bits, bits - bits1);
+    }
+  }
+  AMS5600_setConf(conf);
+}
@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file           : pipeline.c
+  * @brief          : Raw angle processing: unwrap, calibration, filtering.
+  ******************************************************************************
+  */
+
+#include "pipeline.h"
+#include <string.h>
+
+/**
+  * @brief  Neutral calibration, moderate filtering.
+  * @retval None
+  */
+void Pipeline_DefaultConfig(Pipeline_ConfigTypeDef *cfg)
+{
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->filter_shift = 3;
+  cfg->vel_shift = 4;
+}
+
+/**
+  * @brief  Reset the state; the first Pipeline_Step() primes the filters.
+  * @retval None
+  */
+void Pipeline_Init(Pipeline_TypeDef *pl, const Pipeline_ConfigTypeDef *cfg)
+{
+  memset(pl, 0, sizeof(*pl));
+  pl->cfg = *cfg;
+}
+
+/**
+  * @brief  Process one RAW ANGLE sample.
+  * @param  pl: pipeline state
+  * @param  raw: 12-bit raw angle
+  * @param  out: outputs for this sample
+  * @retval None
+  */
+void Pipeline_Step(Pipeline_TypeDef *pl, uint16_t raw, Pipeline_OutTypeDef *out)
+{
+  const Pipeline_ConfigTypeDef *cfg = &pl->cfg;
+  uint32_t single, idx, frac;
+  int32_t corr, d;
+
+  raw &= 0x0FFFU;
+  if (!pl->primed)
+  {
+    pl->turns_pos = raw;
+    pl->last_raw = raw;
+  }
+  /* shortest way round the 12-bit circle */
+  d = (int32_t)((uint32_t)(raw - pl->last_raw) << 20) >> 20;
+  pl->turns_pos += d;
+  pl->last_raw = raw;
+
+  single = (uint32_t)(raw - cfg->offset) & 0x0FFFU;
+  idx = single >> 8;
+  frac = single & 0xFFU;
+  corr = (cfg->lut[idx] * (int32_t)(256U - frac) +
+          cfg->lut[(idx + 1U) % PIPELINE_LUT_SIZE] * (int32_t)frac) / 256;
+  out->pos = (pl->turns_pos - cfg->offset) * 16 + corr;
+
+  if (!pl->primed)
+  {
+    pl->filt_acc = (int64_t)out->pos * 65536;
+    pl->filt_prev = out->pos;
+    pl->vel_acc = 0;
+    pl->primed = 1;
+  }
+  pl->filt_acc += ((int64_t)out->pos * 65536 - pl->filt_acc) >> cfg->filter_shift;
+  out->filt = (int32_t)(pl->filt_acc >> 16);
+
+  pl->vel_acc += ((int64_t)(out->filt - pl->filt_prev) * 65536 - pl->vel_acc) >> cfg->vel_shift;
+  pl->filt_prev = out->filt;
+  out->vel = (int32_t)(pl->vel_acc >> 16);
+}
+
+static uint8_t *Pipeline_Put(uint8_t *p, uint64_t v, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++) *p++ = (uint8_t)(v >> (8U * i));
+  return p;
+}
+
+static uint64_t Pipeline_Get(const uint8_t **p, uint8_t n)
+{
+  uint64_t v = 0;
+
+  for (uint8_t i = 0; i < n; i++) v |= (uint64_t)(*p)[i] << (8U * i);
+  *p += n;
+  return v;
+}
+
+/**
+  * @brief  Serialize configuration and state, little endian.
+  * @param  buf: at least PIPELINE_STATE_SIZE bytes
+  * @retval PIPELINE_STATE_SIZE
+  */
+uint16_t Pipeline_Save(const Pipeline_TypeDef *pl, uint8_t *buf)
+{
+  uint8_t *p = buf;
+
+  p = Pipeline_Put(p, (uint16_t)pl->cfg.offset, 2);
+  for (uint32_t i = 0; i < PIPELINE_LUT_SIZE; i++) *p++ = (uint8_t)pl->cfg.lut[i];
+  *p++ = pl->cfg.filter_shift;
+  *p++ = pl->cfg.vel_shift;
+  p = Pipeline_Put(p, pl->last_raw, 2);
+  *p++ = pl->primed;
+  p = Pipeline_Put(p, (uint32_t)pl->turns_pos, 4);
+  p = Pipeline_Put(p, (uint64_t)pl->filt_acc, 8);
+  p = Pipeline_Put(p, (uint32_t)pl->filt_prev, 4);
+  p = Pipeline_Put(p, (uint64_t)pl->vel_acc, 8);
+  return (uint16_t)(p - buf);
+}
+
+/**
+  * @brief  Restore what Pipeline_Save() wrote.
+  * @retval 0 on success, -1 on a length mismatch
+  */
+int Pipeline_Load(Pipeline_TypeDef *pl, const uint8_t *buf, uint16_t len)
+{
+  const uint8_t *p = buf;
+
+  if (len != PIPELINE_STATE_SIZE) return -1;
+  pl->cfg.offset = (int16_t)Pipeline_Get(&p, 2);
+  for (uint32_t i = 0; i < PIPELINE_LUT_SIZE; i++) pl->cfg.lut[i] = (int8_t)*p++;
+  pl->cfg.filter_shift = *p++;
+  pl->cfg.vel_shift = *p++;
+  pl->last_raw = (uint16_t)Pipeline_Get(&p, 2);
+  pl->primed = *p++;
+  pl->turns_pos = (int32_t)Pipeline_Get(&p, 4);
+  pl->filt_acc = (int64_t)Pipeline_Get(&p, 8);
+  pl->filt_prev = (int32_t)Pipeline_Get(&p, 4);
+  pl->vel_acc = (int64_t)Pipeline_Get(&p, 8);
+  return 0;
+}
+
+/**
+  * @brief  Fold one output into a 32-bit FNV-1a hash (little endian fields).
+  * @param  hash: running hash, PIPELINE_HASH_INIT to start
+  * @retval updated hash
+  */
+uint32_t Pipeline_Hash(uint32_t hash, const Pipeline_OutTypeDef *out)
+{
+  const int32_t v[3] = { out->pos, out->filt, out->vel };
+
+  for (uint32_t i = 0; i < 3U; i++)
+  {
+    for (uint32_t b = 0; b < 4U; b++)
+    {
+      hash ^= (uint8_t)((uint32_t)v[i] >> (8U * b));
+      hash *= 16777619UL;
+    }
+  }
+  return hash;
+}
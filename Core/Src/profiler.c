@@ -0,0 +1,113 @@
+/**
+  ******************************************************************************
+  * @file           : profiler.c
+  * @brief          : DWT cycle-counter profiling of named code regions.
+  ******************************************************************************
+  */
+
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+#include <stdio.h>
+#include <inttypes.h>
+
+Prof_StatsTypeDef prof_stats[PROF_REGION_COUNT];
+uint32_t prof_overhead;
+
+static const char *const prof_names[PROF_REGION_COUNT] =
+{
+  "read", "convert", "format", "transmit", "isr", "compress", "decimate", "spectrum", "order", "revstat", "alarm",
+  "quad", "quadedge", "servo", "median"
+};
+
+/**
+  * @brief  Start the cycle counter, calibrate the cost of an empty
+  *         PROF_BEGIN/PROF_END pair and clear the statistics.
+  * @retval None
+  */
+void Profiler_Init(void)
+{
+  uint32_t best = UINT32_MAX;
+
+  CYCCNT_Init();
+  for (int i = 0; i < 8; i++)
+  {
+    uint32_t t0 = CYCCNT_Read();
+    uint32_t dt = CYCCNT_Read() - t0;
+    if (dt < best) best = dt;
+  }
+  prof_overhead = best;
+  Profiler_Reset();
+}
+
+/**
+  * @brief  Clear the statistics of every region.
+  * @retval None
+  */
+void Profiler_Reset(void)
+{
+  for (int r = 0; r < PROF_REGION_COUNT; r++)
+  {
+    Prof_StatsTypeDef *s = &prof_stats[r];
+    s->count = 0;
+    s->min = UINT32_MAX;
+    s->max = 0;
+    s->sum = 0;
+    for (unsigned b = 0; b < PROF_HIST_BINS; b++) s->hist[b] = 0;
+  }
+}
+
+/**
+  * @brief  Consistent copy of a region's statistics: the ISR regions
+  *         (quadedge, servo) may record in between, so it is taken with
+  *         interrupts masked.
+  * @param  region: region index
+  * @param  stats: copy
+  * @retval None
+  */
+void Profiler_GetStats(Prof_RegionTypeDef region, Prof_StatsTypeDef *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *stats = prof_stats[region];
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Print the statistics of every region through printf (USART2).
+  *         This is blocking and must not be called from the sampling path.
+  * @retval None
+  */
+void Profiler_Dump(void)
+{
+  uint32_t mhz = SystemCoreClock / 1000000U;
+
+  printf("\r\nprofile (cycles @ %" PRIu32 " MHz, overhead %" PRIu32 " removed)\r\n",
+         mhz, prof_overhead);
+  printf("%-10s %10s %10s %10s %10s\r\n", "region", "count", "min", "max", "mean");
+  for (int r = 0; r < PROF_REGION_COUNT; r++)
+  {
+    /* snapshot first, the ISR region may be updated while printing */
+    Prof_StatsTypeDef s;
+
+    Profiler_GetStats((Prof_RegionTypeDef)r, &s);
+
+    if (s.count == 0)
+    {
+      printf("%-10s %10d\r\n", prof_names[r], 0);
+      continue;
+    }
+    printf("%-10s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 "\r\n",
+           prof_names[r], s.count, s.min, s.max, (uint32_t)(s.sum / s.count));
+    printf("  hist");
+    for (unsigned b = 0; b < PROF_HIST_BINS; b++)
+    {
+      if (s.hist[b]) printf(" [2^%u]=%" PRIu32, b, s.hist[b]);
+    }
+    printf("\r\n");
+  }
+}
+
+#endif /* PROFILER_ENABLED */
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file           : quad.c
+  * @brief          : Incremental encoder emulation: the position stream as
+  *                   quadrature A/B and an index pulse Z.
+  ******************************************************************************
+  */
+
+#include "quad.h"
+#include <string.h>
+
+/**
+  * @brief  Select the resolution and the edge rate limit, clear the state.
+  *         The output takes the position of the first sample without edges.
+  * @param  q: encoder emulation state
+  * @param  ppr: lines per revolution, up to QUAD_MAX_PPR, 0 = off
+  * @param  max_hz: highest edge rate, up to QUAD_MAX_EDGE_HZ, not used when off
+  * @param  tick_hz: frequency of the interval ticks
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int Quad_Init(Quad_TypeDef *q, uint16_t ppr, uint32_t max_hz, uint32_t tick_hz)
+{
+  if (ppr > QUAD_MAX_PPR) return -1;
+  if (ppr != 0U && (max_hz == 0U || max_hz > QUAD_MAX_EDGE_HZ || tick_hz < max_hz)) return -1;
+  memset(q, 0, sizeof(*q));
+  q->ppr = ppr;
+  if (ppr == 0U) return 0;
+  q->edges_per_turn = 4U * ppr;
+  q->min_ticks = (tick_hz + max_hz - 1U) / max_hz;
+  return 0;
+}
+
+/**
+  * @brief  Do not extrapolate across a gap in the input, the next plan
+  *         heads for its own sample.
+  * @param  q: encoder emulation state
+  * @retval None
+  */
+void Quad_Resync(Quad_TypeDef *q)
+{
+  q->extrapolate = 0;
+}
+
+/**
+  * @brief  Replace the plan by the edges towards one sample ahead of pos.
+  *         Call with the edge interrupt masked.
+  * @param  q: encoder emulation state
+  * @param  pos: multi-turn position, Q4, zero at the calibrated zero
+  * @param  period: sample period, in interval ticks
+  * @retval ticks to the first edge, at least the shortest interval, 0 when
+  *         there is none
+  */
+uint32_t Quad_Plan(Quad_TypeDef *q, int32_t pos, uint32_t period)
+{
+  int32_t target, n;
+  uint32_t count, max, first;
+
+  if (q->ppr == 0U) return 0;
+  target = (int32_t)(((int64_t)pos * (int32_t)q->edges_per_turn) >> 16);
+  if (!q->primed)
+  {
+    q->primed = 1;
+    q->pos = target;
+    q->target = target;
+    q->goal = target;
+    q->left = 0;
+    return 0;
+  }
+  q->goal = q->extrapolate ? 2 * target - q->target : target;
+  q->extrapolate = 1;
+  q->target = target;
+
+  n = q->goal - q->pos;
+  q->dir = n < 0 ? -1 : 1;
+  count = (uint32_t)(n < 0 ? -n : n);
+  max = period / q->min_ticks;
+  if (count > max)
+  {
+    /* whole cycles, the levels stay where they are; below a cycle per
+       period the whole cycles go */
+    uint32_t drop = (count - max + 3U) & ~3U;
+
+    if (drop > count) drop = count & ~3U;
+
+    q->limited++;
+    q->dropped += drop;
+    q->pos += q->dir * (int32_t)drop;
+    count -= drop;
+  }
+  q->left = count;
+  q->planned = count;
+  if (count == 0U) return 0;
+
+  /* count intervals of base + rem / count ticks, centred in the period */
+  q->base = period / count;
+  q->rem = period % count;
+  q->acc = 0;
+  first = q->base / 2U;
+  /* the previous edge was before this call */
+  return first < q->min_ticks ? q->min_ticks : first;
+}
+
+/**
+  * @brief  Emit the next edge of the plan, from the timer interrupt.
+  * @param  q: encoder emulation state
+  * @retval ticks to the following edge, 0 when the plan is complete
+  */
+uint32_t Quad_Edge(Quad_TypeDef *q)
+{
+  uint32_t t;
+
+  if (q->left == 0U) return 0;
+  q->pos += q->dir;
+  if (--q->left == 0U) return 0;
+
+  t = q->base;
+  q->acc += q->rem;
+  if (q->acc >= q->planned)
+  {
+    q->acc -= q->planned;
+    t++;
+  }
+  return t;
+}
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file           : ratesweep.c
+  * @brief          : Maximum sustainable sample-rate sweep.
+  ******************************************************************************
+  */
+
+#include "ratesweep.h"
+#include "main.h"
+#include "AMS5600_api.h"
+#include "cyccnt.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+extern UART_HandleTypeDef huart2;
+
+static const uint32_t rates_hz[] = {
+  100, 200, 300, 500, 750, 1000, 1500, 2000, 3000, 4000,
+  5000, 6000, 7000, 8000, 10000, 12000, 15000, 20000
+};
+
+static const char *const fmt_names[] = { "text", "binary" };
+static const char *const tx_names[] = { "blocking", "dma" };
+
+static RateSweep_ResultTypeDef results[RATESWEEP_COMBINATIONS];
+
+/* format one sample record, returns its length */
+static uint16_t RateSweep_Format(RateSweep_FormatTypeDef format, uint8_t *buf, uint16_t seq, uint16_t raw)
+{
+  if (format == RATESWEEP_FMT_TEXT)
+    return (uint16_t)snprintf((char *)buf, 64, "rawAngle : %d   Angle (deg) : %f\n", raw, raw * 0.087890625);
+
+  {
+    uint8_t payload[4] = { (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)raw, (uint8_t)(raw >> 8) };
+
+    return Telemetry_BuildFrame(buf, TELEMETRY_FRAME_SAMPLE, payload, sizeof(payload));
+  }
+}
+
+/* one rate step, returns 0 when it passed */
+static int RateSweep_Step(RateSweep_ResultTypeDef *res, uint32_t rate_hz, uint32_t window_ms)
+{
+  Telemetry_StatsTypeDef before, after;
+  uint32_t period = SystemCoreClock / rate_hz;
+  uint32_t samples = (rate_hz * window_ms) / 1000U;
+  uint32_t misses = 0, dropped, next;
+  uint8_t buf[64];
+  uint16_t raw = 0, len;
+
+  if (samples < 20U) samples = 20U;
+  Telemetry_WaitIdle(1000);
+  Telemetry_GetStats(&before);
+
+  next = CYCCNT_Read() + period;
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    while ((int32_t)(CYCCNT_Read() - next) < 0) {}
+
+    AMS5600_getRawAngle(&raw);
+    len = RateSweep_Format(res->format, buf, (uint16_t)i, raw & 0x0FFFU);
+    if (res->transport == RATESWEEP_TX_DMA)
+      Telemetry_Write(buf, len);
+    else
+      HAL_UART_Transmit(&huart2, buf, len, 100);
+
+    next += period;
+    if ((int32_t)(CYCCNT_Read() - next) > 0)
+    {
+      /* finished after the next release: count it and every skipped one */
+      misses += 1U + (CYCCNT_Read() - next) / period;
+      next = CYCCNT_Read() + period;
+    }
+  }
+
+  Telemetry_WaitIdle(1000);
+  Telemetry_GetStats(&after);
+  dropped = after.bytes_dropped - before.bytes_dropped;
+  if (misses == 0U && dropped == 0U) return 0;
+  res->misses = misses;
+  res->dropped = dropped;
+  return -1;
+}
+
+/**
+  * @brief  Run the sweep for every format/transport combination and print
+  *         the summary table. Blocks for up to a few tens of seconds and
+  *         must run before the scheduler is started.
+  * @param  window_ms: sampling window per rate step
+  * @retval None
+  */
+void RateSweep_Run(uint32_t window_ms)
+{
+  CYCCNT_Init();
+
+  for (uint32_t c = 0; c < RATESWEEP_COMBINATIONS; c++)
+  {
+    RateSweep_ResultTypeDef *res = &results[c];
+
+    *res = (RateSweep_ResultTypeDef){ .format = (RateSweep_FormatTypeDef)(c >> 1),
+                                      .transport = (RateSweep_TransportTypeDef)(c & 1U) };
+    for (uint32_t r = 0; r < sizeof(rates_hz) / sizeof(rates_hz[0]); r++)
+    {
+      if (RateSweep_Step(res, rates_hz[r], window_ms) != 0)
+      {
+        res->fail_hz = rates_hz[r];
+        break;
+      }
+      res->sustainable_hz = rates_hz[r];
+    }
+  }
+
+  printf("\nSWEEP,format,transport,sustainable_hz,fail_hz,misses,dropped\n");
+  for (uint32_t c = 0; c < RATESWEEP_COMBINATIONS; c++)
+  {
+    printf("SWEEP,%s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+           fmt_names[results[c].format], tx_names[results[c].transport], results[c].sustainable_hz,
+           results[c].fail_hz, results[c].misses, results[c].dropped);
+  }
+}
+
+/**
+  * @brief  Results of the last RateSweep_Run(), RATESWEEP_COMBINATIONS entries.
+  * @retval result table
+  */
+const RateSweep_ResultTypeDef *RateSweep_GetResults(void)
+{
+  return results;
+}
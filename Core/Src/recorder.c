@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file           : recorder.c
+  * @brief          : Field recording of the raw sample stream.
+  ******************************************************************************
+  */
+
+#include "recorder.h"
+#include "telemetry.h"
+#include <string.h>
+
+static void Recorder_Put32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+  * @brief  Start a recording, the next sample has sequence 0.
+  * @retval None
+  */
+void Recorder_Init(Recorder_TypeDef *rec, Recorder_SinkFn sink)
+{
+  memset(rec, 0, sizeof(*rec));
+  rec->sink = sink;
+  rec->need_state = 1;
+}
+
+/**
+  * @brief  Run one sample through the pipeline and record it.
+  * @param  rec: recorder
+  * @param  pl: pipeline the sample goes through
+  * @param  raw: raw angle
+  * @param  out: pipeline outputs
+  * @retval None
+  */
+void Recorder_Step(Recorder_TypeDef *rec, Pipeline_TypeDef *pl, uint16_t raw, Pipeline_OutTypeDef *out)
+{
+  uint8_t frame[RECORDER_STATE_LEN > RECORDER_RECORD_LEN ? RECORDER_STATE_LEN : RECORDER_RECORD_LEN];
+
+  if (rec->n == 0U)
+  {
+    rec->batch_seq = rec->seq;
+    rec->hash = PIPELINE_HASH_INIT;
+    if (rec->need_state || (rec->batches % RECORDER_STATE_EVERY) == 0U)
+    {
+      Recorder_Put32(frame, rec->seq);
+      Pipeline_Save(pl, &frame[4]);
+      if (rec->sink(TELEMETRY_FRAME_STATE, frame, RECORDER_STATE_LEN) == 0U)
+        rec->dropped++;
+      else
+        rec->need_state = 0;
+    }
+  }
+
+  Pipeline_Step(pl, raw, out);
+  rec->raw[rec->n++] = raw & 0x0FFFU;
+  rec->hash = Pipeline_Hash(rec->hash, out);
+  rec->seq++;
+
+  if (rec->n == RECORDER_BATCH)
+  {
+    Recorder_Put32(frame, rec->batch_seq);
+    for (uint32_t i = 0; i < RECORDER_BATCH; i++)
+    {
+      frame[4 + 2 * i] = (uint8_t)rec->raw[i];
+      frame[5 + 2 * i] = (uint8_t)(rec->raw[i] >> 8);
+    }
+    Recorder_Put32(&frame[4 + 2 * RECORDER_BATCH], rec->hash);
+    Recorder_Put32(&frame[8 + 2 * RECORDER_BATCH], (uint32_t)out->filt);
+    if (rec->sink(TELEMETRY_FRAME_RECORD, frame, RECORDER_RECORD_LEN) == 0U)
+    {
+      rec->dropped++;
+      rec->need_state = 1;
+    }
+    rec->n = 0;
+    rec->batches++;
+  }
+}
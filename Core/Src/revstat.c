@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * @file           : revstat.c
+  * @brief          : Per-revolution statistics of the shaft: period, mean
+  *                   speed, speed ripple and angular acceleration extremes.
+  ******************************************************************************
+  */
+
+#include "revstat.h"
+#include <math.h>
+#include <string.h>
+
+#define REVSTAT_TURN  4096
+
+static void RevStat_Start(RevStat_TypeDef *rs, int8_t dir, int32_t mark, uint32_t t)
+{
+  rs->dir = dir;
+  rs->mark = mark;
+  rs->t0 = t;
+  rs->n = 0;
+  rs->mean = 0.0f;
+  rs->m2 = 0.0f;
+  rs->acc_min = INT64_MAX;
+  rs->acc_max = INT64_MIN;
+}
+
+static void RevStat_Abort(RevStat_TypeDef *rs)
+{
+  rs->dir = 0;
+  rs->aborts++;
+}
+
+/* one revolution complete at time t */
+static void RevStat_Finish(RevStat_TypeDef *rs, uint32_t t)
+{
+  RevStat_RecordTypeDef *r = &rs->record;
+  uint32_t ticks = t - rs->t0;
+  /* samples per second, then Q4 counts per sample to rpm */
+  float rate = rs->n ? (float)rs->n * (float)rs->tick_hz / (float)ticks : 0.0f;
+  float rpm = rate * (60.0f / (16.0f * REVSTAT_TURN));
+
+  r->rev = rs->revs++;
+  r->period_us = (uint32_t)((uint64_t)ticks * 1000000U / rs->tick_hz);
+  r->speed_crpm = (int32_t)lrintf(rs->dir * 6000.0f * (float)rs->tick_hz / (float)ticks);
+  r->ripple_crpm = rs->n > 1U ? (uint32_t)lrintf(sqrtf(rs->m2 / (float)(rs->n - 1U)) * rpm * 100.0f) : 0U;
+  r->acc_min = rs->n ? (int32_t)lrintf((float)rs->acc_min * (1.0f / 65536.0f) * rpm * rate) : 0;
+  r->acc_max = rs->n ? (int32_t)lrintf((float)rs->acc_max * (1.0f / 65536.0f) * rpm * rate) : 0;
+  r->samples = rs->n;
+}
+
+/**
+  * @brief  Clear the state, counting starts at the next wrap.
+  * @param  rs: revolution statistics state
+  * @param  hysteresis: counts the angle may go back across the last wrap
+  * @param  acc_shift: acceleration low-pass, alpha = 2^-acc_shift, 0..15
+  * @param  max_ticks: longest revolution, in time stamp ticks
+  * @param  tick_hz: time stamp frequency
+  * @retval None
+  */
+void RevStat_Init(RevStat_TypeDef *rs, uint16_t hysteresis, uint8_t acc_shift, uint32_t max_ticks, uint32_t tick_hz)
+{
+  memset(rs, 0, sizeof(*rs));
+  rs->hysteresis = hysteresis;
+  rs->acc_shift = acc_shift;
+  rs->max_ticks = max_ticks;
+  rs->tick_hz = tick_hz;
+}
+
+/**
+  * @brief  Forget the previous sample after a gap in the input, the
+  *         revolution in progress is abandoned.
+  * @param  rs: revolution statistics state
+  * @retval None
+  */
+void RevStat_Resync(RevStat_TypeDef *rs)
+{
+  if (rs->dir != 0) RevStat_Abort(rs);
+  rs->primed = 0;
+}
+
+/**
+  * @brief  Add one sample.
+  * @param  rs: revolution statistics state
+  * @param  raw: raw angle, 0..4095
+  * @param  vel: pipeline velocity, Q4 counts per sample
+  * @param  t: acquisition time, wrapping ticks
+  * @retval 1 when a revolution completed and record was updated, 0 otherwise
+  */
+int RevStat_Push(RevStat_TypeDef *rs, uint16_t raw, int32_t vel, uint32_t t)
+{
+  int32_t u, m;
+  float x, d;
+  int done = 0;
+
+  if (!rs->primed)
+  {
+    rs->primed = 1;
+    rs->unwrapped = raw & (REVSTAT_TURN - 1);
+    rs->prev_t = t;
+    rs->prev_vel = vel;
+    return 0;
+  }
+  u = rs->unwrapped + ((((int32_t)raw - rs->unwrapped + REVSTAT_TURN / 2) & (REVSTAT_TURN - 1)) - REVSTAT_TURN / 2);
+
+  rs->acc += ((int64_t)(vel - rs->prev_vel) * 65536 - rs->acc) >> rs->acc_shift;
+  if (rs->dir != 0)
+  {
+    if ((uint32_t)(t - rs->t0) > rs->max_ticks || rs->dir * (u - rs->mark) < -(int32_t)rs->hysteresis)
+      RevStat_Abort(rs);
+  }
+  if (rs->dir != 0)
+  {
+    /* Welford: mean and sum of squared deviations, constant cost */
+    x = (float)vel;
+    rs->n++;
+    d = x - rs->mean;
+    rs->mean += d / (float)rs->n;
+    rs->m2 += d * (x - rs->mean);
+    if (rs->acc < rs->acc_min) rs->acc_min = rs->acc;
+    if (rs->acc > rs->acc_max) rs->acc_max = rs->acc;
+
+    m = rs->mark + rs->dir * REVSTAT_TURN;
+    if (rs->dir * (u - m) >= 0)
+    {
+      uint32_t tc = rs->prev_t + (uint32_t)lrintf((float)(m - rs->unwrapped) / (float)(u - rs->unwrapped)
+                                                  * (float)(uint32_t)(t - rs->prev_t));
+
+      RevStat_Finish(rs, tc);
+      RevStat_Start(rs, rs->dir, m, tc);
+      done = 1;
+    }
+  }
+  else if ((u >> 12) != (rs->unwrapped >> 12))
+  {
+    /* first wrap: 4095 -> 0 forwards, 0 -> 4095 backwards */
+    m = (u > rs->unwrapped ? u : rs->unwrapped) & ~(REVSTAT_TURN - 1);
+    RevStat_Start(rs, u > rs->unwrapped ? 1 : -1, m,
+                  rs->prev_t + (uint32_t)lrintf((float)(m - rs->unwrapped) / (float)(u - rs->unwrapped)
+                                                * (float)(uint32_t)(t - rs->prev_t)));
+  }
+
+  /* whole turns dropped so that the angle never overflows */
+  m = u & ~(REVSTAT_TURN - 1);
+  rs->unwrapped = u - m;
+  rs->mark -= m;
+  rs->prev_t = t;
+  rs->prev_vel = vel;
+  return done;
+}
@@ -0,0 +1,252 @@
+/**
+  ******************************************************************************
+  * @file           : scheduler.c
+  * @brief          : Cooperative multi-rate scheduler.
+  ******************************************************************************
+  */
+
+#include "scheduler.h"
+#include "cyccnt.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+static Sched_TaskTypeDef sched_tasks[SCHED_MAX_TASKS];
+static int sched_count;
+
+static uint32_t sched_last_cyc;
+static uint64_t sched_high;
+static uint64_t sched_window_start;
+static uint64_t sched_idle_cycles;
+static Sched_WakeupFn sched_wakeup;
+
+/**
+  * @brief  64-bit cycle timebase. Must be called at least once per counter
+  *         wrap (~51 s at 84 MHz), which the dispatch loop guarantees.
+  * @retval CPU cycles since the counter was started
+  */
+uint64_t Sched_Now(void)
+{
+  uint32_t now = CYCCNT_Read();
+
+  if (now < sched_last_cyc) sched_high += (1ULL << 32);
+  sched_last_cyc = now;
+  return sched_high | now;
+}
+
+static uint64_t Sched_UsToCycles(uint32_t us)
+{
+  return (uint64_t)us * (SystemCoreClock / 1000000U);
+}
+
+/**
+  * @brief  Register a periodic task. Tasks are kept sorted by period so the
+  *         dispatch order is rate-monotonic.
+  * @param  name: label used by Sched_Dump()
+  * @param  fn: task body, runs to completion
+  * @param  period_us: release period in microseconds
+  * @retval task handle, -1 if the table is full
+  */
+int Sched_AddTask(const char *name, Sched_TaskFn fn, uint32_t period_us)
+{
+  int i;
+
+  if (sched_count >= (int)SCHED_MAX_TASKS || fn == NULL || period_us == 0) return -1;
+
+  for (i = sched_count; i > 0 && sched_tasks[i - 1].period_us > period_us; i--)
+  {
+    sched_tasks[i] = sched_tasks[i - 1];
+  }
+  sched_tasks[i] = (Sched_TaskTypeDef){ .name = name, .fn = fn, .period_us = period_us,
+                                        .period = Sched_UsToCycles(period_us) };
+  sched_count++;
+  return i;
+}
+
+/**
+  * @brief  Change the period of a registered task, the new period applies
+  *         from its next release. The rate-monotonic order is not updated.
+  * @param  task: handle returned by Sched_AddTask()
+  * @param  period_us: new release period in microseconds
+  * @retval 0 on success, -1 on invalid arguments
+  */
+int Sched_SetPeriod(int task, uint32_t period_us)
+{
+  if (task < 0 || task >= sched_count || period_us == 0) return -1;
+  sched_tasks[task].period_us = period_us;
+  sched_tasks[task].period = Sched_UsToCycles(period_us);
+  return 0;
+}
+
+/**
+  * @brief  Start the timebase and align the first release of every task.
+  * @retval None
+  */
+void Sched_Start(void)
+{
+  CYCCNT_Init();
+  Sched_Resync();
+  Sched_ResetStats();
+}
+
+/**
+  * @brief  Register the wake-up timer for the idle sleep.
+  * @param  fn: arms a one-shot interrupt in the given number of CPU
+  *         cycles, NULL = SysTick only
+  * @retval None
+  */
+void Sched_SetWakeup(Sched_WakeupFn fn)
+{
+  sched_wakeup = fn;
+}
+
+/**
+  * @brief  Move every release to now. Used after a deliberate stall (dump,
+  *         capture) so the stall is not accounted as deadline misses.
+  * @retval None
+  */
+void Sched_Resync(void)
+{
+  uint64_t now = Sched_Now();
+
+  for (int i = 0; i < sched_count; i++) sched_tasks[i].next_release = now;
+}
+
+/**
+  * @brief  Clear run/miss counters and restart the load window.
+  * @retval None
+  */
+void Sched_ResetStats(void)
+{
+  for (int i = 0; i < sched_count; i++)
+  {
+    sched_tasks[i].runs = 0;
+    sched_tasks[i].misses = 0;
+    sched_tasks[i].max_cycles = 0;
+    sched_tasks[i].busy_cycles = 0;
+  }
+  sched_idle_cycles = 0;
+  sched_window_start = Sched_Now();
+}
+
+static void Sched_Run(Sched_TaskTypeDef *t, uint64_t now)
+{
+  uint64_t release = t->next_release;
+  uint64_t end;
+  uint32_t dt;
+
+  t->fn();
+  end = Sched_Now();
+  dt = (uint32_t)(end - now);
+  t->runs++;
+  t->busy_cycles += dt;
+  if (dt > t->max_cycles) t->max_cycles = dt;
+
+  t->next_release = release + t->period;
+  if (end > t->next_release)
+  {
+    /* this job finished late, and every release already past was skipped */
+    uint64_t skipped = (end - t->next_release) / t->period;
+    t->misses += 1U + (uint32_t)skipped;
+    t->next_release += skipped * t->period;
+    if (t->next_release < end) t->next_release += t->period;
+  }
+}
+
+/**
+  * @brief  Run the highest-priority ready task, or idle until the next
+  *         release. Call from the main loop forever.
+  * @retval None
+  */
+void Sched_Dispatch(void)
+{
+  uint64_t now = Sched_Now();
+  uint64_t next = UINT64_MAX;
+
+  for (int i = 0; i < sched_count; i++)
+  {
+    Sched_TaskTypeDef *t = &sched_tasks[i];
+
+    if (t->next_release <= now)
+    {
+      Sched_Run(t, now);
+      return;
+    }
+    if (t->next_release < next) next = t->next_release;
+  }
+
+  /* nothing ready: sleep until the next release. The wake-up is armed with
+   * interrupts masked, so one that fires before the WFI still ends it (a
+   * pending interrupt wakes the core) and is taken once they are unmasked */
+  if (sched_wakeup && next - now >= SCHED_SLEEP_MIN_CYCLES)
+  {
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    sched_wakeup((uint32_t)(next - now > UINT32_MAX ? UINT32_MAX : next - now));
+    __WFI();
+    __set_PRIMASK(primask);
+  }
+  else if (!sched_wakeup && next - now >= Sched_UsToCycles(1000U))
+  {
+    /* the SysTick interrupt guarantees a wake-up within one tick */
+    __WFI();
+  }
+  sched_idle_cycles += Sched_Now() - now;
+}
+
+/**
+  * @brief  CPU load since the last Sched_ResetStats().
+  * @retval load in per mille
+  */
+uint32_t Sched_GetLoadPermille(void)
+{
+  uint64_t elapsed = Sched_Now() - sched_window_start;
+
+  if (elapsed == 0) return 0;
+  return (uint32_t)(1000U - (sched_idle_cycles * 1000U) / elapsed);
+}
+
+/**
+  * @brief  Deadline misses of every task since the last reset.
+  * @retval total number of misses
+  */
+uint32_t Sched_GetMisses(void)
+{
+  uint32_t misses = 0;
+
+  for (int i = 0; i < sched_count; i++) misses += sched_tasks[i].misses;
+  return misses;
+}
+
+/**
+  * @brief  Read access to a task entry.
+  * @param  task: task handle
+  * @retval task entry, NULL if the handle is invalid
+  */
+const Sched_TaskTypeDef *Sched_GetTask(int task)
+{
+  if (task < 0 || task >= sched_count) return NULL;
+  return &sched_tasks[task];
+}
+
+/**
+  * @brief  Print per-task statistics and CPU load through printf (USART2).
+  *         Blocking, call Sched_Resync() afterwards.
+  * @retval None
+  */
+void Sched_Dump(void)
+{
+  uint64_t elapsed = Sched_Now() - sched_window_start;
+
+  printf("\r\nscheduler: load %" PRIu32 " permille over %" PRIu32 " ms\r\n",
+         Sched_GetLoadPermille(), (uint32_t)(elapsed / (SystemCoreClock / 1000U)));
+  printf("%-10s %10s %10s %10s %10s %8s\r\n", "task", "period_us", "runs", "misses", "max_cyc", "cpu_pm");
+  for (int i = 0; i < sched_count; i++)
+  {
+    const Sched_TaskTypeDef *t = &sched_tasks[i];
+    uint32_t cpu = elapsed ? (uint32_t)((t->busy_cycles * 1000U) / elapsed) : 0U;
+
+    printf("%-10s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %8" PRIu32 "\r\n",
+           t->name, t->period_us, t->runs, t->misses, t->max_cycles, cpu);
+  }
+}
@@ -0,0 +1,185 @@
+/**
+  ******************************************************************************
+  * @file           : servo.c
+  * @brief          : Fixed-point position controller: trapezoidal setpoint,
+  *                   PID with velocity and acceleration feed-forward.
+  ******************************************************************************
+  */
+
+#include "servo.h"
+#include <string.h>
+
+/* distance covered from speed w braking by a per loop to a stop, this loop
+   included: w + (w - a) + (w - 2a) + ... ~ w^2 / 2a + w / 2 */
+static int64_t Servo_StopDistance(int64_t w, int32_t a)
+{
+  return w * w / (2 * (int64_t)a) + w / 2;
+}
+
+/* advance the setpoint by one loop towards the target */
+static void Servo_Trajectory(Servo_TypeDef *s)
+{
+  int64_t goal = (int64_t)s->target << 16, d = goal - s->ref, dist;
+  int32_t a = s->acc_max, dir, vd, v = s->vel;
+
+  if (s->vel_max == 0 || a == 0)
+  {
+    s->ref = goal;
+    s->vel = 0;
+    s->acc = 0;
+    return;
+  }
+  dir = d < 0 ? -1 : 1;
+  dist = d < 0 ? -d : d;
+  vd = v * dir;   /* speed towards the target */
+  if (dist <= a && vd >= -a && vd <= a)
+  {
+    /* within one step of speed and distance: stop on it */
+    s->ref = goal;
+    s->vel = 0;
+    s->acc = -v;
+    return;
+  }
+
+  if (vd < 0)
+    vd += a;      /* moving away: turn round */
+  else if (dist >= Servo_StopDistance((int64_t)vd + a, a) && vd + a <= s->vel_max)
+    vd += a;
+  else if (vd > s->vel_max || dist < Servo_StopDistance(vd, a))
+    vd = vd > a ? vd - a : 0;
+  else if (vd < s->vel_max && dist >= Servo_StopDistance(s->vel_max, a))
+    vd = s->vel_max;   /* the last step below the limit */
+
+  if ((int64_t)vd >= dist)
+  {
+    /* would pass it within this loop */
+    s->ref = goal;
+    s->vel = 0;
+    s->acc = -v;
+    return;
+  }
+  s->vel = vd * dir;
+  s->acc = s->vel - v;
+  s->ref += s->vel;
+}
+
+/**
+  * @brief  Check and take the configuration, the setpoint and target at pos.
+  * @param  s: controller state
+  * @param  cfg: gains and limits (servo.h)
+  * @param  loop_us: loop period, 1..SERVO_LOOP_MAX_US
+  * @param  pos: current position, Q4 counts
+  * @retval 0 on success, -1 on an invalid configuration
+  */
+int Servo_Init(Servo_TypeDef *s, const Servo_ConfigTypeDef *cfg, uint32_t loop_us, int32_t pos)
+{
+  if (loop_us == 0U || loop_us > SERVO_LOOP_MAX_US) return -1;
+  if (cfg->kp < 0 || cfg->ki < 0 || cfg->kd < 0 || cfg->kv < 0 || cfg->ka < 0) return -1;
+  if (cfg->d_shift > SERVO_D_SHIFT_MAX || cfg->out_max < 1 || cfg->out_max > SERVO_OUT_MAX) return -1;
+  memset(s, 0, sizeof(*s));
+  s->cfg = *cfg;
+  s->loop_us = loop_us;
+  s->target = pos;
+  Servo_Reset(s, pos);
+  return 0;
+}
+
+/**
+  * @brief  Restart from pos without a bump: setpoint at pos and standing,
+  *         integrator and derivative cleared. The target stays, the next
+  *         loops move towards it again.
+  * @param  s: controller state
+  * @param  pos: current position, Q4 counts
+  * @retval None
+  */
+void Servo_Reset(Servo_TypeDef *s, int32_t pos)
+{
+  s->ref = (int64_t)pos << 16;
+  s->vel = 0;
+  s->acc = 0;
+  s->prev_pos = pos;
+  s->dpos = 0;
+  s->integ = 0;
+  s->err = 0;
+  s->out = 0;
+  s->saturated = 0;
+}
+
+/**
+  * @brief  New target and motion limits, from the next loop. Call with the
+  *         loop interrupt masked.
+  * @param  s: controller state
+  * @param  target: position, Q4 counts
+  * @param  vel_max: Q4 counts per s, 0 = step
+  * @param  acc_max: Q4 counts per s^2, 0 = step, above SERVO_ACC_MAX taken
+  *         as that
+  * @retval None
+  */
+void Servo_Move(Servo_TypeDef *s, int32_t target, uint32_t vel_max, uint32_t acc_max)
+{
+  uint64_t t = s->loop_us, v, a;
+
+  if (acc_max > SERVO_ACC_MAX) acc_max = SERVO_ACC_MAX;
+  /* to Q16 per loop and loop^2, both products below 2^64 */
+  v = (((uint64_t)vel_max * t) << 16) / 1000000U;
+  a = (((uint64_t)acc_max * t * t) << 4) / 244140625U;   /* << 16 / 10^12 */
+  /* halves of int32, so speed + acceleration stays in range */
+  s->target = target;
+  s->vel_max = (int32_t)(v > 0x3FFFFFFFU ? 0x3FFFFFFFU : v);
+  s->acc_max = (int32_t)(a > 0x3FFFFFFFU ? 0x3FFFFFFFU : a);
+  if (vel_max != 0U && s->vel_max == 0) s->vel_max = 1;
+  if (acc_max != 0U && s->acc_max == 0) s->acc_max = 1;
+}
+
+/**
+  * @brief  One control loop: setpoint, PID and feed-forward, saturation.
+  * @param  s: controller state
+  * @param  pos: measured position, Q4 counts
+  * @retval output, Q15 of full scale, within +-out_max
+  */
+int32_t Servo_Step(Servo_TypeDef *s, int32_t pos)
+{
+  const Servo_ConfigTypeDef *c = &s->cfg;
+  int32_t e, dm, lim = c->out_max;
+  int64_t u, pe, di, integ;
+
+  Servo_Trajectory(s);
+  e = Servo_Setpoint(s) - pos;
+  dm = pos - s->prev_pos;
+  s->prev_pos = pos;
+  s->dpos += (dm * 256 - s->dpos) >> c->d_shift;
+
+  /* Q16 of output units */
+  u = (int64_t)c->kp * e + s->integ
+    + (((int64_t)c->kv * s->vel + (int64_t)c->ka * s->acc) >> 16)
+    + (((int64_t)c->kd * ((s->vel >> 8) - s->dpos)) >> 8);
+  u = (u + 0x8000) >> 16;
+  s->saturated = 0;
+  if (u > lim)
+  {
+    u = lim;
+    s->saturated = 1;
+  }
+  else if (u < -lim)
+  {
+    u = -lim;
+    s->saturated = 1;
+  }
+  if (s->saturated) s->saturated_loops++;
+
+  /* integrate inside the proportional band only, and not further into a
+     saturation (conditional integration); the integrator alone stays
+     within the output range */
+  di = (int64_t)c->ki * e;
+  pe = (int64_t)c->kp * e;
+  if (pe < ((int64_t)lim << 16) && pe > -((int64_t)lim << 16) && !(s->saturated && (di > 0) == (u > 0) && di != 0))
+  {
+    integ = s->integ + di;
+    if (integ > (int64_t)lim << 16) integ = (int64_t)lim << 16;
+    if (integ < -((int64_t)lim << 16)) integ = -((int64_t)lim << 16);
+    s->integ = (int32_t)integ;
+  }
+  s->err = e;
+  s->out = (int32_t)u;
+  return s->out;
+}
@@ -0,0 +1,166 @@
+/**
+  ******************************************************************************
+  * @file           : servobench.c
+  * @brief          : Closed-loop benchmark of the position controller
+  *                   against a simulated motor.
+  ******************************************************************************
+  */
+
+#include "servobench.h"
+#include "main.h"
+#include "app_config.h"
+#include "cyccnt.h"
+#include "servo.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define SERVOBENCH_SUBSTEPS  20U
+#define SERVOBENCH_BAND      32      /* Q4, 2 counts */
+#define SERVOBENCH_HOLD      100U    /* loops settled at the end */
+
+typedef struct
+{
+  const char *name;
+  double   move;           /* turns from the start */
+  double   vel, acc;       /* turns/s, turns/s^2, 0 = step */
+  double   load;           /* of full scale, from load_at */
+  uint32_t load_at;
+  uint32_t back_at;        /* loop of the move back to the start, 0 = none */
+  uint32_t loops;
+} ServoBench_CaseTypeDef;
+
+static const ServoBench_CaseTypeDef cases[] = {
+  { "step",   10.0,   0.0,   0.0, 0.0,   0U,   0U, 1000U },
+  { "trap",   10.0,  20.0, 200.0, 0.0,   0U,   0U, 1500U },
+  { "reverse", 2.0,  20.0, 400.0, 0.0,   0U, 600U, 1200U },
+  { "load",    0.0,   0.0,   0.0, 0.2, 200U,   0U, 1000U },
+};
+
+typedef struct
+{
+  double theta;            /* turns */
+  double omega;            /* turns/s */
+  uint32_t seed;
+} ServoBench_PlantTypeDef;
+
+static Servo_TypeDef sb_servo;
+
+/* advance the motor by dt s at duty d and load l, fractions of full scale */
+static void ServoBench_Plant(ServoBench_PlantTypeDef *p, double d, double l, double dt)
+{
+  double drive = d - l, f, w;
+
+  if (p->omega == 0.0 && fabs(drive) <= SERVOBENCH_FRICTION) return;   /* stiction */
+  f = copysign(SERVOBENCH_FRICTION, p->omega != 0.0 ? p->omega : drive);
+  w = p->omega + (SERVOBENCH_WMAX * (drive - f) - p->omega) * dt / (SERVOBENCH_TAU_MS * 1e-3);
+  /* friction stops the shaft rather than turning it round */
+  if (p->omega * w < 0.0 && fabs(drive) <= SERVOBENCH_FRICTION) w = 0.0;
+  p->theta += 0.5 * (p->omega + w) * dt;
+  p->omega = w;
+}
+
+/* RAW ANGLE continued across turns, +-0.5 count of noise, Q4 */
+static int32_t ServoBench_Sensor(ServoBench_PlantTypeDef *p)
+{
+  double noise;
+
+  p->seed = p->seed * 1664525U + 1013904223U;
+  noise = (p->seed >> 8) / 16777216.0 - 0.5;
+  return (int32_t)floor(p->theta * 4096.0 + noise) * 16;
+}
+
+static int ServoBench_One(const ServoBench_CaseTypeDef *c, uint32_t runs)
+{
+  const Servo_ConfigTypeDef cfg = {
+    .kp = APP_SERVO_KP, .ki = APP_SERVO_KI, .kd = APP_SERVO_KD,
+    .kv = APP_SERVO_KV, .ka = APP_SERVO_KA,
+    .d_shift = APP_SERVO_D_SHIFT, .out_max = APP_SERVO_OUT_MAX,
+  };
+  const double loop_s = SERVOBENCH_LOOP_US * 1e-6, dt = loop_s / SERVOBENCH_SUBSTEPS;
+  const uint32_t delay_steps = (uint32_t)lround(SERVOBENCH_DELAY_US * 1e-6 / dt);
+  uint64_t cycles = 0;
+  uint32_t max_cycles = 0, last_event = 0, last_off = 0;
+  uint8_t in_band = 0;
+  int32_t target = 0, dev_max = 0, err_max = 0, final = 0;
+  double err_sq = 0.0;
+  int rc;
+
+  for (uint32_t r = 0; r < runs; r++)
+  {
+    ServoBench_PlantTypeDef plant = { 0.0, 0.0, 12345U };
+    int32_t u = 0, start = ServoBench_Sensor(&plant);
+
+    if (Servo_Init(&sb_servo, &cfg, SERVOBENCH_LOOP_US, start) != 0) return 1;
+    target = start + (int32_t)lround(c->move * 65536.0);
+    Servo_Move(&sb_servo, target, (uint32_t)lround(c->vel * 65536.0), (uint32_t)lround(c->acc * 65536.0));
+    last_event = 0;
+    last_off = 0;
+    in_band = 0;
+    dev_max = 0;
+    err_max = 0;
+    err_sq = 0.0;
+    for (uint32_t i = 0; i < c->loops; i++)
+    {
+      double load = (c->load != 0.0 && i >= c->load_at) ? c->load : 0.0;
+      int32_t pos = ServoBench_Sensor(&plant), prev = u, dist;
+      uint32_t t0, dc;
+
+      if (c->back_at && i == c->back_at)
+      {
+        target = start;
+        Servo_Move(&sb_servo, target, (uint32_t)lround(c->vel * 65536.0), (uint32_t)lround(c->acc * 65536.0));
+      }
+      t0 = CYCCNT_Read();
+      u = Servo_Step(&sb_servo, pos);
+      dc = CYCCNT_Read() - t0;
+      cycles += dc;
+      if (dc > max_cycles) max_cycles = dc;
+
+      if (abs(sb_servo.err) > err_max) err_max = abs(sb_servo.err);
+      err_sq += (double)sb_servo.err * sb_servo.err;
+      if (Servo_Setpoint(&sb_servo) != target || (c->load != 0.0 && i == c->load_at))
+      {
+        last_event = i + 1U;
+        last_off = i + 1U;
+        in_band = 0;
+        dev_max = 0;
+      }
+      else
+      {
+        dist = abs(target - pos);
+        if (dist <= SERVOBENCH_BAND) in_band = 1;
+        if (in_band && dist > dev_max) dev_max = dist;
+        if (dist > SERVOBENCH_BAND) last_off = i + 1U;
+      }
+      for (uint32_t k = 0; k < SERVOBENCH_SUBSTEPS; k++)
+        ServoBench_Plant(&plant, (k < delay_steps ? prev : u) / 32767.0, load, dt);
+    }
+    final = target - ServoBench_Sensor(&plant);
+  }
+
+  rc = (abs(final) > SERVOBENCH_BAND || last_off + SERVOBENCH_HOLD > c->loops) ? 1 : 0;
+  printf("%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%.2f,%.2f,%.2f,%.1f,%.2f,%" PRIu32 ",%s\n",
+         c->name, c->loops, (uint32_t)(cycles / ((uint64_t)runs * c->loops)), max_cycles,
+         sqrt(err_sq / c->loops) / 16.0, err_max / 16.0, dev_max / 16.0,
+         (last_off - last_event) * SERVOBENCH_LOOP_US / 1000.0, final / 16.0,
+         sb_servo.saturated_loops, rc ? "FAIL" : "ok");
+  return rc;
+}
+
+/**
+  * @brief  Run every case and print the CSV table (see servobench.h) with
+  *         printf.
+  * @param  runs: repetitions of each case for the cycle counts
+  * @retval 0 all checks passed, 1 otherwise
+  */
+int ServoBench_Run(uint32_t runs)
+{
+  int rc = 0;
+
+  CYCCNT_Init();
+  printf("case,loops,cycles_mean,cycles_max,err_rms,err_max,dev_max,settle_ms,final,saturated,check\n");
+  for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) rc |= ServoBench_One(&cases[i], runs ? runs : 1U);
+  return rc;
+}
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file           : specbench.c
+  * @brief          : Cost and accuracy benchmark of the block spectrum.
+  ******************************************************************************
+  */
+
+#include "specbench.h"
+#include "main.h"
+#include "app_config.h"
+#include "cyccnt.h"
+#include "spectrum.h"
+#include <math.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#define SPECBENCH_PI  3.14159265358979323846
+
+typedef struct
+{
+  const char *name;
+  double rpm;              /* speed at the start */
+  double rpm_per_s;        /* acceleration */
+  double amp[2];           /* vibration, counts peak */
+  double hz[2];
+} SpecBench_SignalTypeDef;
+
+static const SpecBench_SignalTypeDef signals[] = {
+  { "const",  300.0,  0.0, { 11.4, 2.0 }, {  50.0, 123.0 } },
+  { "accel",    0.0, 20.0, {  5.7, 1.0 }, {  37.0, 210.0 } },
+};
+
+static const uint16_t lengths[] = { 256U, 1024U, 4096U };
+
+static Spectrum_TypeDef sb_spectrum;
+
+/* position of sample i, Q4 of whole counts */
+static int32_t SpecBench_Position(const SpecBench_SignalTypeDef *sig, uint32_t i)
+{
+  double t = i * 1e-3;
+  double x = (sig->rpm + 0.5 * sig->rpm_per_s * t) * t * (4096.0 / 60.0);
+
+  for (uint32_t c = 0; c < 2U; c++) x += sig->amp[c] * sin(2.0 * SPECBENCH_PI * sig->hz[c] * t);
+  return (int32_t)lround(x) * 16;
+}
+
+/* the peak of the block matching a component, -1 if none */
+static int SpecBench_Match(const SpecBench_SignalTypeDef *sig, uint32_t c, uint16_t n)
+{
+  const Spectrum_ResultTypeDef *r = &sb_spectrum.result;
+
+  for (int k = 0; k < 2; k++)
+  {
+    double hz = r->peak[k].bin_q4 / 16.0 / (n * 1e-3), amp = r->peak[k].amp_mc / 1000.0;
+
+    if (fabs(hz - sig->hz[c]) <= 0.5 / (n * 1e-3) && fabs(amp - sig->amp[c]) <= 0.05 * sig->amp[c]) return k;
+  }
+  return -1;
+}
+
+static int SpecBench_One(const SpecBench_SignalTypeDef *sig, uint16_t n, uint32_t blocks)
+{
+  uint64_t cycles = 0, chz[2] = { 0, 0 }, mc[2] = { 0, 0 };
+  uint32_t max_slice = 0, done = 0, fails = 0;
+
+  Spectrum_Init(&sb_spectrum, n);
+  for (uint32_t i = 0; done < blocks; i++)
+  {
+    uint32_t t0, dt;
+    int ready;
+
+    Spectrum_Push(&sb_spectrum, SpecBench_Position(sig, i));
+    t0 = CYCCNT_Read();
+    ready = Spectrum_Service(&sb_spectrum, APP_SPECTRUM_STEPS);
+    dt = CYCCNT_Read() - t0;
+    if (dt > max_slice) max_slice = dt;
+    if (!ready) continue;
+
+    done++;
+    cycles += sb_spectrum.result.cycles;
+    for (uint32_t c = 0; c < 2U; c++)
+    {
+      int k = SpecBench_Match(sig, c, n);
+
+      if (k < 0)
+      {
+        fails++;
+        continue;
+      }
+      chz[c] += (uint64_t)sb_spectrum.result.peak[k].bin_q4 * 100000U / (16U * n);
+      mc[c] += sb_spectrum.result.peak[k].amp_mc;
+    }
+  }
+
+  printf("%s,%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32, sig->name, n, done, (uint32_t)(cycles / done), max_slice);
+  for (uint32_t c = 0; c < 2U; c++) printf(",%" PRIu32 ",%" PRIu32, (uint32_t)(chz[c] / done), (uint32_t)(mc[c] / done));
+  printf(",%s\n", fails ? "FAIL" : "ok");
+  return fails ? 1 : 0;
+}
+
+/**
+  * @brief  Run every signal with every block length and print the CSV
+  *         table (see specbench.h) with printf.
+  * @param  blocks: blocks analysed per row
+  * @retval 0 all checks passed, 1 otherwise
+  */
+int SpecBench_Run(uint32_t blocks)
+{
+  int rc = 0;
+
+  CYCCNT_Init();
+  printf("signal,n,blocks,cycles_per_block,max_slice_cycles,peak1_chz,peak1_mc,peak2_chz,peak2_mc,check\n");
+  for (uint32_t s = 0; s < sizeof(signals) / sizeof(signals[0]); s++)
+  {
+    for (uint32_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+      if (lengths[i] <= SPECTRUM_MAX_N)
+        rc |= SpecBench_One(&signals[s], lengths[i], blocks);
+      else
+        printf("%s,%u,0,,,,,,,skipped SPECTRUM_MAX_N=%u\n", signals[s].name, lengths[i], SPECTRUM_MAX_N);
+    }
+  }
+  return rc;
+}
@@ -0,0 +1,342 @@
+/**
+  ******************************************************************************
+  * @file           : spectrum.c
+  * @brief          : Vibration spectrum of the multi-turn angle, per block.
+  ******************************************************************************
+  */
+
+#include "spectrum.h"
+#include "main.h"
+#include "cyccnt.h"
+#include <math.h>
+#include <string.h>
+
+#define SPECTRUM_PI  3.14159265358979323846
+
+enum
+{
+  SPEC_IDLE = 0,
+  SPEC_FIT,                /* quadratic term of the trend */
+  SPEC_SCAN,               /* largest deviation from the trend */
+  SPEC_WINDOW,             /* scale, window and pack */
+  SPEC_FFT,
+  SPEC_BITREV,
+  SPEC_SPLIT,              /* real FFT bins, |X|^2 */
+  SPEC_PEAKS               /* maxima and bands */
+};
+
+/* cos(2 pi k / SPECTRUM_MAX_N) low, sin() high, q15, k = 0..SPECTRUM_MAX_N/2 */
+static uint32_t spec_twiddle[SPECTRUM_MAX_N / 2U + 1U];
+static uint8_t spec_twiddle_ready;
+
+static int16_t Spectrum_Q15(double v)
+{
+  long q = lround(v * 32768.0);
+
+  return (int16_t)(q > 32767 ? 32767 : q);
+}
+
+static void Spectrum_MakeTwiddles(void)
+{
+  const uint32_t half = SPECTRUM_MAX_N / 2U;
+
+  /* first quadrant computed, the second one mirrored */
+  for (uint32_t k = 0; k <= half / 2U; k++)
+  {
+    double t = 2.0 * SPECTRUM_PI * k / SPECTRUM_MAX_N;
+
+    spec_twiddle[k] = (uint16_t)Spectrum_Q15(cos(t)) | ((uint32_t)(uint16_t)Spectrum_Q15(sin(t)) << 16);
+  }
+  for (uint32_t k = half / 2U + 1U; k <= half; k++)
+  {
+    uint32_t m = spec_twiddle[half - k];
+
+    spec_twiddle[k] = (uint16_t)(-(int16_t)m) | (m & 0xFFFF0000U);
+  }
+  spec_twiddle_ready = 1;
+}
+
+/* second orthogonal polynomial over the block, zero sum and zero slope */
+static float Spectrum_P2(const Spectrum_TypeDef *s, uint32_t i)
+{
+  float t = (float)i - (float)(s->n - 1U) * 0.5f;
+
+  return t * t - ((float)s->n * (float)s->n - 1.0f) * (1.0f / 12.0f);
+}
+
+/* x - trend of sample i of the analysed block */
+static float Spectrum_Residual(const Spectrum_TypeDef *s, const int32_t *x, uint32_t i)
+{
+  return (float)x[i] - (s->a + s->b * (float)i) - s->c * Spectrum_P2(s, i);
+}
+
+/* Hann window at sample i, 0..32768 */
+static float Spectrum_Hann(const Spectrum_TypeDef *s, uint32_t i)
+{
+  uint32_t k = i * (SPECTRUM_MAX_N / s->n);
+
+  if (k > SPECTRUM_MAX_N / 2U) k = SPECTRUM_MAX_N - k;
+  return (float)(32768 - (int16_t)spec_twiddle[k]) * 0.5f;
+}
+
+static void Spectrum_Butterfly(Spectrum_TypeDef *s)
+{
+  uint32_t i = s->grp + s->pos;
+  uint32_t t = spec_twiddle[s->pos * (SPECTRUM_MAX_N / 2U / s->span)];
+  uint32_t a = s->work[i], b = s->work[i + s->span], d;
+  int32_t re, im;
+
+  /* (a + b) / 2 and (a - b) / 2 * e^(-j pi pos / span), rounded */
+  s->work[i] = __SHADD16(a, b);
+  d = __SHSUB16(a, b);
+  re = (int32_t)__SMLAD(d, t, 0x4000U) >> 15;
+  im = (int32_t)__SMLSDX(t, d, 0x4000U) >> 15;
+  s->work[i + s->span] = (uint16_t)re | ((uint32_t)im << 16);
+
+  if (++s->pos < s->span) return;
+  s->pos = 0;
+  s->grp += 2U * s->span;
+  if (s->grp < s->n / 2U) return;
+  s->grp = 0;
+  s->span >>= 1;
+}
+
+/* bin k of the real FFT from the n/2-point complex one, |X|^2 in q15^2 */
+static uint32_t Spectrum_Split(const Spectrum_TypeDef *s, uint32_t k)
+{
+  uint32_t half = s->n / 2U;
+  uint32_t z = s->work[k == half ? 0U : k], zm = s->work[k == 0U ? 0U : half - k];
+  uint32_t t = spec_twiddle[k * (SPECTRUM_MAX_N / s->n)];
+  int32_t zr = (int16_t)z, zi = (int16_t)(z >> 16), mr = (int16_t)zm, mi = (int16_t)(zm >> 16);
+  int32_t c = (int16_t)t, sn = (int16_t)(t >> 16);
+  int32_t er = zr + mr, ei = zi - mi;   /* 2 even part */
+  int32_t od = zi + mi, oi = mr - zr;   /* 2 odd part, times -j */
+  int32_t xr = er + ((c * od + sn * oi + 0x4000) >> 15);
+  int32_t xi = ei + ((c * oi - sn * od + 0x4000) >> 15);
+
+  return (uint32_t)(((int64_t)xr * xr + (int64_t)xi * xi) >> 2);
+}
+
+static uint8_t Spectrum_Band(const Spectrum_TypeDef *s, uint32_t k)
+{
+  uint8_t band = SPECTRUM_BANDS - 1U;
+
+  for (uint32_t edge = s->n / 4U; band > 0U && k < edge; edge >>= 1) band--;
+  return band;
+}
+
+static void Spectrum_Peak(Spectrum_TypeDef *s, const uint32_t *mag, uint32_t k)
+{
+  uint32_t i = SPECTRUM_TOP_K;
+
+  /* bin 1 is within the main lobe of what is left of the trend */
+  if (k < 2U || k >= s->n / 2U || mag[k] <= mag[k - 1U] || mag[k] < mag[k + 1U]) return;
+  while (i > 0U && (s->top[i - 1U] == 0U || mag[s->top[i - 1U]] < mag[k])) i--;
+  if (i == SPECTRUM_TOP_K) return;
+  memmove(&s->top[i + 1U], &s->top[i], (SPECTRUM_TOP_K - 1U - i) * sizeof(s->top[0]));
+  s->top[i] = (uint16_t)k;
+}
+
+static void Spectrum_Finish(Spectrum_TypeDef *s, const uint32_t *mag)
+{
+  Spectrum_ResultTypeDef *r = &s->result;
+  /* mean square of the unwindowed signal from one-sided Hann bins, count^2 */
+  float ms = s->gain > 0.0f ? (4.0f / 3.0f) / (s->gain * s->gain * 256.0f) : 0.0f;
+
+  memset(r, 0, sizeof(*r));
+  r->block = s->blocks;
+  r->n = s->n;
+  for (uint32_t i = 0; i < SPECTRUM_TOP_K && s->top[i] && ms > 0.0f; i++)
+  {
+    uint32_t k = s->top[i];
+    float lo = sqrtf((float)mag[k - 1U]), mid = sqrtf((float)mag[k]), hi = sqrtf((float)mag[k + 1U]);
+    float sum = (float)mag[k - 1U] + (float)mag[k] + (float)mag[k + 1U];
+
+    r->peak[i].bin_q4 = (uint16_t)lrintf(((float)k + 2.0f * (hi - lo) / (lo + 2.0f * mid + hi)) * 16.0f);
+    r->peak[i].amp_mc = (uint32_t)lrintf(sqrtf(2.0f * ms * sum) * 1000.0f);
+  }
+  for (uint32_t b = 0; b < SPECTRUM_BANDS; b++)
+  {
+    float v = (float)s->band[b] * ms * 1000.0f;
+
+    r->band_mc2[b] = v < 4.0e9f ? (uint32_t)lrintf(v) : 0xFFFFFFFFU;
+  }
+  s->blocks++;
+}
+
+/**
+  * @brief  Select the block length and clear the state.
+  * @param  s: spectrum state
+  * @param  n: block length, power of two SPECTRUM_MIN_N..SPECTRUM_MAX_N,
+  *         0 = off
+  * @retval 0 on success, -1 on an invalid length
+  */
+int Spectrum_Init(Spectrum_TypeDef *s, uint16_t n)
+{
+  if (n != 0U && (n < SPECTRUM_MIN_N || n > SPECTRUM_MAX_N || (n & (n - 1U)))) return -1;
+  if (!spec_twiddle_ready) Spectrum_MakeTwiddles();
+  memset(s, 0, sizeof(*s));
+  s->n = n;
+  return 0;
+}
+
+/**
+  * @brief  Add one position to the block being acquired, hand a full block
+  *         over to Spectrum_Service().
+  * @param  s: spectrum state
+  * @param  pos: multi-turn position, Q4
+  * @retval None
+  */
+void Spectrum_Push(Spectrum_TypeDef *s, int32_t pos)
+{
+  int32_t d;
+  float n, mean_i;
+
+  if (s->n == 0U) return;
+  if (s->count == 0U)
+  {
+    s->x0 = pos;
+    s->s0 = 0;
+    s->s1 = 0;
+  }
+  d = (int32_t)((uint32_t)pos - (uint32_t)s->x0);
+  s->blk[s->fill][s->count] = d;
+  s->s0 += d;
+  s->s1 += (int64_t)s->count * d;
+  if (++s->count < s->n) return;
+  s->count = 0;
+  if (s->phase != SPEC_IDLE)
+  {
+    s->overruns++;   /* refill the same block */
+    return;
+  }
+
+  /* least squares line through (i, x - x0) */
+  n = (float)s->n;
+  mean_i = (n - 1.0f) * 0.5f;
+  s->b = (float)(2 * s->s1 - (int64_t)(s->n - 1U) * s->s0) / (n * (n * n - 1.0f) / 6.0f);
+  s->a = (float)s->s0 / n - s->b * mean_i;
+  s->c = 0.0f;
+  s->acc = 0.0f;
+  s->comp = 0.0f;
+  s->fill ^= 1U;
+  s->phase = SPEC_FIT;
+  s->pos = 0;
+  s->cycles = 0;
+}
+
+/**
+  * @brief  Analyse the completed block for at most budget steps (one step is
+  *         a sample, a butterfly or a bin, a few tens of cycles).
+  * @param  s: spectrum state
+  * @param  budget: steps
+  * @retval 1 when s->result holds a new block, 0 otherwise
+  */
+int Spectrum_Service(Spectrum_TypeDef *s, uint32_t budget)
+{
+  int32_t *x = s->blk[s->fill ^ 1U];
+  uint32_t *mag = (uint32_t *)x;
+  uint32_t half = s->n / 2U;
+  uint32_t t0 = CYCCNT_Read();
+  int done = 0;
+
+  if (s->phase == SPEC_IDLE) return 0;
+  for (; budget > 0U && !done; budget--)
+  {
+    switch (s->phase)
+    {
+      case SPEC_FIT:
+      {
+        /* P2 is orthogonal to the line, fit it to what the line left */
+        float v = Spectrum_Residual(s, x, s->pos) * Spectrum_P2(s, s->pos) - s->comp;
+        float sum = s->acc + v;
+
+        s->comp = (sum - s->acc) - v;
+        s->acc = sum;
+        if (++s->pos < s->n) break;
+        {
+          float n = (float)s->n, n2 = n * n;
+
+          s->c = s->acc / (n * (n2 - 1.0f) * (n2 - 4.0f) * (1.0f / 180.0f));
+        }
+        s->gain = 0.0f;
+        s->pos = 0;
+        s->phase = SPEC_SCAN;
+        break;
+      }
+      case SPEC_SCAN:
+      {
+        float r = fabsf(Spectrum_Residual(s, x, s->pos));
+
+        if (r > s->gain) s->gain = r;
+        if (++s->pos < s->n) break;
+        s->gain = 16384.0f / (s->gain > 1.0f ? s->gain : 1.0f);
+        s->pos = 0;
+        s->phase = SPEC_WINDOW;
+        break;
+      }
+      case SPEC_WINDOW:
+      {
+        uint32_t i = 2U * s->pos;
+        float k = s->gain * (1.0f / 32768.0f);
+        int16_t re = (int16_t)lrintf(Spectrum_Residual(s, x, i) * Spectrum_Hann(s, i) * k);
+        int16_t im = (int16_t)lrintf(Spectrum_Residual(s, x, i + 1U) * Spectrum_Hann(s, i + 1U) * k);
+
+        s->work[s->pos] = (uint16_t)re | ((uint32_t)(uint16_t)im << 16);
+        if (++s->pos < half) break;
+        s->pos = 0;
+        s->grp = 0;
+        s->span = half / 2U;
+        s->phase = SPEC_FFT;
+        break;
+      }
+      case SPEC_FFT:
+        Spectrum_Butterfly(s);
+        if (s->span == 0U) s->phase = SPEC_BITREV;
+        break;
+      case SPEC_BITREV:
+      {
+        uint32_t r = __RBIT(s->pos) >> (__CLZ(half) + 1U);
+
+        if (s->pos < r)
+        {
+          uint32_t v = s->work[s->pos];
+
+          s->work[s->pos] = s->work[r];
+          s->work[r] = v;
+        }
+        if (++s->pos < half) break;
+        s->pos = 0;
+        s->phase = SPEC_SPLIT;
+        break;
+      }
+      case SPEC_SPLIT:
+        mag[s->pos] = Spectrum_Split(s, s->pos);
+        if (++s->pos <= half) break;
+        s->pos = 1;
+        memset(s->top, 0, sizeof(s->top));
+        memset(s->band, 0, sizeof(s->band));
+        s->phase = SPEC_PEAKS;
+        break;
+      case SPEC_PEAKS:
+        s->band[Spectrum_Band(s, s->pos)] += mag[s->pos];
+        Spectrum_Peak(s, mag, s->pos);
+        if (++s->pos <= half) break;
+        Spectrum_Finish(s, mag);
+        s->phase = SPEC_IDLE;
+        done = 1;
+        break;
+      default:
+        s->phase = SPEC_IDLE;
+        break;
+    }
+  }
+
+  s->cycles += CYCCNT_Read() - t0;
+  if (done)
+  {
+    s->result.cycles = s->cycles;
+    if (s->cycles > s->max_cycles) s->max_cycles = s->cycles;
+  }
+  return done;
+}
@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @file           : stream.c
+  * @brief          : Compressed stream of every raw angle sample.
+  ******************************************************************************
+  */
+
+#include "stream.h"
+#include <string.h>
+
+/**
+  * @brief  Start a stream, nothing is sent until the first sample.
+  * @param  s: stream
+  * @param  sink: frame output
+  * @param  seq: sequence number of the first sample
+  * @retval None
+  */
+void Stream_Init(Stream_TypeDef *s, Stream_SinkFn sink, uint32_t seq)
+{
+  memset(s, 0, sizeof(*s));
+  s->sink = sink;
+  s->seq = seq;
+}
+
+/**
+  * @brief  Send the open frame, if any.
+  * @retval None
+  */
+void Stream_Flush(Stream_TypeDef *s)
+{
+  if (s->n == 0U) return;
+  if (s->sink(TELEMETRY_FRAME_STREAM, s->buf, s->len) == 0U)
+  {
+    s->dropped++;
+  }
+  else
+  {
+    s->frames++;
+    s->bytes += s->len;
+  }
+  s->n = 0;
+}
+
+/**
+  * @brief  Append one sample, a full frame goes to the sink.
+  * @param  s: stream
+  * @param  raw: raw angle, 12 bits
+  * @retval None
+  */
+void Stream_Push(Stream_TypeDef *s, uint16_t raw)
+{
+  uint32_t zz;
+  int32_t d, r;
+
+  raw &= 0x0FFFU;
+  if (s->n != 0U)
+  {
+    /* residual of the constant speed prediction prev + last delta */
+    d = (int32_t)((raw - s->prev + 2048U) & 0x0FFFU) - 2048;
+    r = (int32_t)(((uint32_t)(d - s->delta) + 2048U) & 0x0FFFU) - 2048;
+    zz = ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+    if (s->n < STREAM_KEY_EVERY && s->len + (zz < 0x80U ? 1U : 2U) <= TELEMETRY_MAX_PAYLOAD)
+    {
+      if (zz < 0x80U)
+      {
+        s->buf[s->len++] = (uint8_t)zz;
+      }
+      else
+      {
+        s->buf[s->len++] = (uint8_t)(zz | 0x80U);
+        s->buf[s->len++] = (uint8_t)(zz >> 7);
+      }
+      s->n++;
+      s->prev = raw;
+      s->delta = d;
+      s->seq++;
+      return;
+    }
+    Stream_Flush(s);
+  }
+
+  /* keyframe */
+  s->buf[0] = (uint8_t)s->seq;
+  s->buf[1] = (uint8_t)(s->seq >> 8);
+  s->buf[2] = (uint8_t)(s->seq >> 16);
+  s->buf[3] = (uint8_t)(s->seq >> 24);
+  s->buf[4] = (uint8_t)raw;
+  s->buf[5] = (uint8_t)(raw >> 8);
+  s->len = STREAM_HDR_LEN;
+  s->n = 1;
+  s->prev = raw;
+  s->delta = 0;
+  s->seq++;
+}
+
+/**
+  * @brief  Expand one STREAM frame payload.
+  * @param  payload: frame payload
+  * @param  len: payload length
+  * @param  seq: sequence of the first sample
+  * @param  raw: decoded samples
+  * @param  max: room in raw
+  * @retval number of samples, -1 on a malformed frame
+  */
+int Stream_Decode(const uint8_t *payload, uint8_t len, uint32_t *seq, uint16_t *raw, uint32_t max)
+{
+  uint32_t n = 0, i = STREAM_HDR_LEN;
+  int32_t d = 0;
+  uint16_t v;
+
+  if (len < STREAM_HDR_LEN || max == 0U) return -1;
+  *seq = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) |
+         ((uint32_t)payload[3] << 24);
+  v = (uint16_t)(payload[4] | (payload[5] << 8));
+  if (v > 0x0FFFU) return -1;
+  raw[n++] = v;
+
+  while (i < len)
+  {
+    uint32_t zz = payload[i] & 0x7FU;
+
+    if (payload[i++] & 0x80U)
+    {
+      if (i == len || (payload[i] & 0x80U)) return -1;
+      zz |= (uint32_t)payload[i++] << 7;
+    }
+    if (n == max) return -1;
+    d = (int32_t)(((uint32_t)d + ((zz >> 1) ^ (0U - (zz & 1U))) + 2048U) & 0x0FFFU) - 2048;
+    v = (uint16_t)((v + (uint32_t)d) & 0x0FFFU);
+    raw[n++] = v;
+  }
+  return (int)n;
+}
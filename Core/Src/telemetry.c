@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.c
+  * @brief          : Non-blocking USART2 output.
+  ******************************************************************************
+  */
+
+#include "telemetry.h"
+#include "main.h"
+#include <string.h>
+
+extern UART_HandleTypeDef huart2;
+
+static uint8_t tx_buf[2][TELEMETRY_BUF_SIZE];
+static uint16_t tx_fill_len;      /* bytes waiting in tx_buf[tx_fill] */
+static uint8_t tx_fill;           /* buffer currently being filled */
+static volatile uint8_t tx_busy;  /* DMA transfer in progress */
+static Telemetry_StatsTypeDef tx_stats;
+
+/* start sending the fill buffer, called with interrupts masked */
+static void Telemetry_Kick(void)
+{
+  uint8_t *buf = tx_buf[tx_fill];
+  uint16_t len = tx_fill_len;
+
+  if (len == 0)
+  {
+    tx_busy = 0;
+    return;
+  }
+  tx_fill ^= 1U;
+  tx_fill_len = 0;
+  tx_busy = 1;
+  if (HAL_UART_Transmit_DMA(&huart2, buf, len) != HAL_OK)
+  {
+    tx_stats.bytes_dropped += len;
+    tx_busy = 0;
+    return;
+  }
+  tx_stats.bytes_sent += len;
+  tx_stats.transfers++;
+}
+
+/**
+  * @brief  Queue bytes for transmission. Never blocks.
+  * @param  data: bytes to send
+  * @param  len: number of bytes
+  * @retval number of bytes queued, 0 if they did not fit (all or nothing)
+  */
+uint16_t Telemetry_Write(const void *data, uint16_t len)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if ((uint32_t)tx_fill_len + len > TELEMETRY_BUF_SIZE)
+  {
+    tx_stats.bytes_dropped += len;
+    __set_PRIMASK(primask);
+    return 0;
+  }
+  memcpy(&tx_buf[tx_fill][tx_fill_len], data, len);
+  tx_fill_len += len;
+  if (!tx_busy) Telemetry_Kick();
+  __set_PRIMASK(primask);
+  return len;
+}
+
+/**
+  * @brief  Encode a binary frame (see telemetry.h).
+  * @param  buf: destination, at least TELEMETRY_FRAME_LEN(len) bytes
+  * @param  type: frame type
+  * @param  payload: frame payload
+  * @param  len: payload length, at most TELEMETRY_MAX_PAYLOAD
+  * @retval frame length, 0 if the payload is too long
+  */
+uint16_t Telemetry_BuildFrame(uint8_t *buf, uint8_t type, const void *payload, uint8_t len)
+{
+  const uint8_t *p = payload;
+  uint8_t sum;
+
+  if (len > TELEMETRY_MAX_PAYLOAD) return 0;
+  buf[0] = TELEMETRY_SYNC;
+  buf[1] = type;
+  buf[2] = len;
+  sum = type + len;
+  for (uint8_t i = 0; i < len; i++)
+  {
+    buf[3 + i] = p[i];
+    sum += p[i];
+  }
+  buf[3 + len] = (uint8_t)(0U - sum);
+  return (uint16_t)TELEMETRY_FRAME_LEN(len);
+}
+
+/**
+  * @brief  Queue a binary frame, all or nothing like Telemetry_Write().
+  * @retval number of bytes queued, 0 if the frame did not fit
+  */
+uint16_t Telemetry_WriteFrame(uint8_t type, const void *payload, uint8_t len)
+{
+  uint8_t frame[TELEMETRY_FRAME_LEN(TELEMETRY_MAX_PAYLOAD)];
+  uint16_t n = Telemetry_BuildFrame(frame, type, payload, len);
+
+  return n ? Telemetry_Write(frame, n) : 0;
+}
+
+/**
+  * @brief  Room left in the fill buffer.
+  * @retval bytes that Telemetry_Write() accepts right now
+  */
+uint16_t Telemetry_Free(void)
+{
+  return (uint16_t)(TELEMETRY_BUF_SIZE - tx_fill_len);
+}
+
+/**
+  * @brief  Wait until everything queued has left, so that blocking
+  *         HAL_UART_Transmit() calls can use the UART again.
+  * @param  timeout_ms: maximum time to wait
+  * @retval 0 when idle, -1 on timeout
+  */
+int Telemetry_WaitIdle(uint32_t timeout_ms)
+{
+  uint32_t start = HAL_GetTick();
+
+  while (tx_busy || tx_fill_len)
+  {
+    if (HAL_GetTick() - start > timeout_ms) return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Copy of the transfer counters.
+  * @param  stats: destination
+  * @retval None
+  */
+void Telemetry_GetStats(Telemetry_StatsTypeDef *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *stats = tx_stats;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  DMA completion hook, called from HAL_UART_TxCpltCallback().
+  * @retval None
+  */
+void Telemetry_TxCplt(void)
+{
+  Telemetry_Kick();
+}
@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file           : uartrx.c
+  * @brief          : USART2 frame reception.
+  ******************************************************************************
+  */
+
+#include "uartrx.h"
+#include "main.h"
+#include "telemetry.h"
+
+extern UART_HandleTypeDef huart2;
+
+static uint8_t rx_ring[UARTRX_RING_SIZE];
+static volatile uint16_t rx_head;    /* DMA write position of the last event */
+static volatile uint8_t rx_reset;    /* reception restarted at the ring start */
+static uint16_t rx_tail;             /* next byte to parse */
+static uint8_t rx_frame[TELEMETRY_FRAME_LEN(TELEMETRY_MAX_PAYLOAD)];
+static uint8_t rx_have;              /* bytes of the frame collected so far */
+static UartRx_StatsTypeDef rx_stats;
+
+/* feed one byte to the frame parser */
+static void UartRx_Byte(uint8_t b, UartRx_FrameFn fn)
+{
+  uint8_t sum = 0;
+
+  if (rx_have == 0U && b != TELEMETRY_SYNC)
+  {
+    rx_stats.skipped++;
+    return;
+  }
+  rx_frame[rx_have++] = b;
+  if (rx_have == 3U && b > TELEMETRY_MAX_PAYLOAD)
+  {
+    rx_stats.bad_frames++;
+    rx_have = 0;
+    return;
+  }
+  if (rx_have < 3U || rx_have < TELEMETRY_FRAME_LEN(rx_frame[2])) return;
+
+  for (uint8_t i = 1; i < rx_have; i++) sum += rx_frame[i];
+  rx_have = 0;
+  if (sum != 0U)
+  {
+    rx_stats.bad_frames++;
+    return;
+  }
+  rx_stats.frames++;
+  if (fn) fn(rx_frame[1], &rx_frame[3], rx_frame[2]);
+}
+
+/**
+  * @brief  Start circular DMA reception with idle-line events.
+  * @retval 0 on success, -1 if the HAL refused
+  */
+int UartRx_Start(void)
+{
+  /* busy when the error hook fires for a transmit error: keep going */
+  if (HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rx_ring, UARTRX_RING_SIZE) != HAL_OK) return -1;
+  rx_head = 0;
+  rx_reset = 1;
+  return 0;
+}
+
+/**
+  * @brief  Parse everything received since the last call.
+  * @param  fn: called for every valid frame, may be NULL
+  * @retval number of bytes consumed
+  */
+uint16_t UartRx_Poll(UartRx_FrameFn fn)
+{
+  uint16_t head, n = 0;
+
+  if (rx_reset)
+  {
+    rx_reset = 0;
+    rx_tail = 0;
+    rx_have = 0;
+  }
+  head = rx_head;
+  while (rx_tail != head)
+  {
+    UartRx_Byte(rx_ring[rx_tail], fn);
+    rx_tail = (uint16_t)((rx_tail + 1U) % UARTRX_RING_SIZE);
+    n++;
+  }
+  rx_stats.bytes += n;
+  return n;
+}
+
+/**
+  * @brief  Copy of the reception counters.
+  * @retval None
+  */
+void UartRx_GetStats(UartRx_StatsTypeDef *stats)
+{
+  *stats = rx_stats;
+}
+
+/**
+  * @brief  Reception event hook, called from HAL_UARTEx_RxEventCallback().
+  * @param  pos: DMA write position, UARTRX_RING_SIZE at the wrap
+  * @retval None
+  */
+void UartRx_Event(uint16_t pos)
+{
+  rx_head = (uint16_t)(pos % UARTRX_RING_SIZE);
+}
+
+/**
+  * @brief  UART error hook, called from HAL_UART_ErrorCallback(). The HAL
+  *         stops the DMA on overrun and framing errors, start it again.
+  * @retval None
+  */
+void UartRx_Error(void)
+{
+  if (UartRx_Start() == 0) rx_stats.restarts++;
+}
@@ -27,6 +27,40 @@ uint8_t AMS5600_setOutPut(uint8_t mode)
   return status;
 }
 
+/*******************************************************
+  AMS5600_setPowerMode
+  In: 0 for NOM (always on)
+      1 for LPM1 (5 ms polling)
+      2 for LPM2 (20 ms polling)
+      3 for LPM3 (100 ms polling)
+  Out: none
+  Description: sets power mode bits 1:0 in CONF register.
+*******************************************************/
+uint8_t AMS5600_setPowerMode(uint8_t mode)
+{
+  uint16_t _conf_lo = _addr_conf+1; // lower byte address
+  uint8_t config_status;
+  uint8_t status = AMS5600_RdByte(_ams5600_Address, _conf_lo, &config_status);
+  config_status &= 0b11111100; // bits 1:0 = 00, NOM
+  config_status |= mode & 0b11;
+  status |= AMS5600_WrByte(_ams5600_Address, _conf_lo, config_status);
+  return status;
+}
+
+/*******************************************************
+  AMS5600_getPowerMode
+  In: none
+  Out: power mode bits 1:0 of CONF register
+  Description: gets power mode from CONF register.
+*******************************************************/
+uint8_t AMS5600_getPowerMode(uint8_t *mode)
+{
+  uint16_t _conf_lo = _addr_conf+1; // lower byte address
+  uint8_t status = AMS5600_RdByte(_ams5600_Address, _conf_lo, mode);
+  *mode &= 0b11;
+  return status;
+}
+
 /****************************************************
   AMS5600_getAddress
   In: none
@@ -146,6 +180,100 @@ uint8_t AMS5600_getRawAngle(uint16_t *rawAngle)
   return status;
 }
 
+/*******************************************************
+  AMS5600_startRawAngleStream
+  In: none
+  Out: none
+  Description: points the address pointer at RAW ANGLE.
+  The AS5600 blocks the auto-increment on the output
+  registers, so following AMS5600_getRawAngleStream
+  calls read RAW ANGLE again without an address phase.
+  Any other register access ends the stream.
+*******************************************************/
+uint8_t AMS5600_startRawAngleStream(void)
+{
+  uint8_t status = AMS5600_SetPointer(_ams5600_Address, _addr_raw_angle);
+  return status;
+}
+
+/*******************************************************
+  AMS5600_getRawAngleStream
+  In: none
+  Out: value of raw angle register
+  Description: reads raw angle from the address pointer
+  set by AMS5600_startRawAngleStream, one 2-byte read
+  transaction per sample.
+*******************************************************/
+uint8_t AMS5600_getRawAngleStream(uint16_t *rawAngle)
+{
+  uint8_t status = AMS5600_RdWordCurrent(_ams5600_Address, rawAngle);
+  *rawAngle &= 0x0FFF;
+  return status;
+}
+
+/*******************************************************
+  AMS5600_getRawAngleRS
+  In: none
+  Out: value of raw angle register
+  Description: gets raw value of magnet position in one
+  combined transfer (register address, repeated START,
+  2-byte read) instead of two transactions.
+*******************************************************/
+uint8_t AMS5600_getRawAngleRS(uint16_t *rawAngle)
+{
+  uint8_t status = AMS5600_RdWordRS(_ams5600_Address, _addr_raw_angle, rawAngle);
+  return status;
+}
+
+/*******************************************************
+  AMS5600_getRawAngleBurst
+  In: number of readings
+  Out: successive values of raw angle register
+  Description: reads RAW ANGLE count times in one
+  combined transfer of 2 * count bytes. The address
+  pointer sticks to the output register (low byte back
+  to high byte), so each pair is a new sample taken as
+  its high byte goes out, 18 bit times apart.
+*******************************************************/
+uint8_t AMS5600_getRawAngleBurst(uint16_t *rawAngle, uint16_t count)
+{
+  uint8_t *data = (uint8_t *)rawAngle;
+  uint8_t status = AMS5600_RdMulti(_ams5600_Address, _addr_raw_angle, data, (uint16_t)(2U * count));
+
+  /* big endian pairs to values, in place: pair i is rawAngle[i] */
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint16_t v = (uint16_t)((data[2U * i] << 8) | data[2U * i + 1U]);
+
+    rawAngle[i] = v & 0x0FFF;
+  }
+  return status;
+}
+
+/*******************************************************
+  AMS5600_getSnapshot
+  In: none
+  Out: status, raw angle, AGC and magnitude
+  Description: reads STATUS..RAW ANGLE (0x0B-0x0D) and
+  AGC..MAGNITUDE (0x1A-0x1C) as two 3-byte bursts, so
+  angle and magnet health come from the same instant.
+  With full = 0 only the first burst is read.
+*******************************************************/
+uint8_t AMS5600_getSnapshot(AMS5600_SnapshotTypeDef *snap, uint8_t full)
+{
+  uint8_t data[3];
+  uint8_t status = AMS5600_RdMulti(_ams5600_Address, _addr_status, data, 3);
+
+  snap->status = data[0];
+  snap->rawAngle = ((data[1] << 8) | data[2]) & 0x0FFF;
+  if (full) {
+    status |= AMS5600_RdMulti(_ams5600_Address, _addr_agc, data, 3);
+    snap->agc = data[0];
+    snap->magnitude = ((data[1] << 8) | data[2]) & 0x0FFF;
+  }
+  return status;
+}
+
 /*******************************************************
   AMS5600_getScaledAngle
   In: none
@@ -294,7 +422,7 @@ uint8_t AMS5600_burnAngle(int *retVal)
       if ((_zPosition == 0) && (_mPosition == 0))
         *retVal = -3;
       else{
-        PRINT_MESG_DBG("burn angle function desactivated\n"); 
+        DLOG_DBG("burn angle function desactivated\n"); 
         //status |= AMS5600_WrByte(_ams5600_Address, _addr_burn, AMS5600_BURN_ANGLE);
       }
     }
@@ -327,7 +455,7 @@ uint8_t AMS5600_burnMaxAngleAndConfig(int *retVal)
     if (_maxAngle * 0.087 < 18)
       *retVal = -2;
     else{
-      PRINT_MESG_DBG("burn angle function desactivated\n");
+      DLOG_DBG("burn angle function desactivated\n");
       //status |= AMS5600_WrByte(_ams5600_Address, _addr_burn, AMS5600_BURN_SETTING);
     }
   }
@@ -6,6 +6,11 @@
 #define AMS5600_BURN_ANGLE     0x80       /**< angle */
 #define AMS5600_BURN_SETTING   0x40       /**< setting */
 
+#define AMS5600_PM_NOM         0x00       /**< always on, 6.5 mA */
+#define AMS5600_PM_LPM1        0x01       /**< 5 ms polling, 3.4 mA */
+#define AMS5600_PM_LPM2        0x02       /**< 20 ms polling, 1.8 mA */
+#define AMS5600_PM_LPM3        0x03       /**< 100 ms polling, 1.5 mA */
+
 /*******************************************************
   AMS5600_setOutPut
   In: 0 for digital PWM
@@ -16,6 +21,25 @@
 *******************************************************/
 uint8_t AMS5600_setOutPut(uint8_t mode);
 
+/*******************************************************
+  AMS5600_setPowerMode
+  In: 0 for NOM (always on)
+      1 for LPM1 (5 ms polling)
+      2 for LPM2 (20 ms polling)
+      3 for LPM3 (100 ms polling)
+  Out: none
+  Description: sets power mode bits 1:0 in CONF register.
+*******************************************************/
+uint8_t AMS5600_setPowerMode(uint8_t mode);
+
+/*******************************************************
+  AMS5600_getPowerMode
+  In: none
+  Out: power mode bits 1:0 of CONF register
+  Description: gets power mode from CONF register.
+*******************************************************/
+uint8_t AMS5600_getPowerMode(uint8_t *mode);
+
 /****************************************************
   AMS5600_getAddress
   In: none
@@ -88,6 +112,68 @@ uint8_t AMS5600_getEndPosition(uint16_t *end_position_register);
 *******************************************************/
 uint8_t AMS5600_getRawAngle(uint16_t *rawAngle);
 
+/*******************************************************
+  AMS5600_startRawAngleStream
+  In: none
+  Out: none
+  Description: points the address pointer at RAW ANGLE.
+  The AS5600 blocks the auto-increment on the output
+  registers, so following AMS5600_getRawAngleStream
+  calls read RAW ANGLE again without an address phase.
+  Any other register access ends the stream.
+*******************************************************/
+uint8_t AMS5600_startRawAngleStream(void);
+
+/*******************************************************
+  AMS5600_getRawAngleStream
+  In: none
+  Out: value of raw angle register
+  Description: reads raw angle from the address pointer
+  set by AMS5600_startRawAngleStream, one 2-byte read
+  transaction per sample.
+*******************************************************/
+uint8_t AMS5600_getRawAngleStream(uint16_t *rawAngle);
+
+/*******************************************************
+  AMS5600_getRawAngleRS
+  In: none
+  Out: value of raw angle register
+  Description: gets raw value of magnet position in one
+  combined transfer (register address, repeated START,
+  2-byte read) instead of two transactions.
+*******************************************************/
+uint8_t AMS5600_getRawAngleRS(uint16_t *rawAngle);
+
+/*******************************************************
+  AMS5600_getRawAngleBurst
+  In: number of readings
+  Out: successive values of raw angle register
+  Description: reads RAW ANGLE count times in one
+  combined transfer of 2 * count bytes. The address
+  pointer sticks to the output register (low byte back
+  to high byte), so each pair is a new sample taken as
+  its high byte goes out, 18 bit times apart.
+*******************************************************/
+uint8_t AMS5600_getRawAngleBurst(uint16_t *rawAngle, uint16_t count);
+
+/*******************************************************
+  AMS5600_getSnapshot
+  In: none
+  Out: status, raw angle, AGC and magnitude
+  Description: reads STATUS..RAW ANGLE (0x0B-0x0D) and
+  AGC..MAGNITUDE (0x1A-0x1C) as two 3-byte bursts, so
+  angle and magnet health come from the same instant.
+  With full = 0 only the first burst is read.
+*******************************************************/
+typedef struct {
+  uint8_t  status;     /* 0 0 MD ML MH 0 0 0 */
+  uint16_t rawAngle;
+  uint8_t  agc;
+  uint16_t magnitude;
+} AMS5600_SnapshotTypeDef;
+
+uint8_t AMS5600_getSnapshot(AMS5600_SnapshotTypeDef *snap, uint8_t full);
+
 /*******************************************************
   AMS5600_getScaledAngle
   In: none
@@ -0,0 +1,77 @@
+/*
+ * Deferred (tokenized) logging, see debug.h for the record format.
+ */
+
+#include "debug.h"
+#include "stm32f4xx_hal.h"
+
+static uint8_t dlog_ring[DLOG_RING_SIZE];
+static volatile uint32_t dlog_head;   /* write index, free running */
+static volatile uint32_t dlog_tail;   /* read index, free running */
+static Dlog_StatsTypeDef dlog_stats;
+
+static void Dlog_Put32(uint32_t pos, uint32_t v)
+{
+  dlog_ring[(pos + 0U) & (DLOG_RING_SIZE - 1U)] = (uint8_t)(v);
+  dlog_ring[(pos + 1U) & (DLOG_RING_SIZE - 1U)] = (uint8_t)(v >> 8);
+  dlog_ring[(pos + 2U) & (DLOG_RING_SIZE - 1U)] = (uint8_t)(v >> 16);
+  dlog_ring[(pos + 3U) & (DLOG_RING_SIZE - 1U)] = (uint8_t)(v >> 24);
+}
+
+/*
+ * Append one record, callable from thread and interrupt context. A record
+ * that does not fit is dropped whole and counted.
+ */
+void Dlog_Write(uint32_t id, uint32_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+  uint32_t len = 10U + 4U * nargs;
+  uint32_t primask = __get_PRIMASK();
+  uint32_t pos;
+
+  __disable_irq();
+  if (DLOG_RING_SIZE - (dlog_head - dlog_tail) < len)
+  {
+    dlog_stats.dropped++;
+    __set_PRIMASK(primask);
+    return;
+  }
+  pos = dlog_head;
+  dlog_ring[pos & (DLOG_RING_SIZE - 1U)] = DLOG_SYNC;
+  dlog_ring[(pos + 1U) & (DLOG_RING_SIZE - 1U)] = (uint8_t)nargs;
+  Dlog_Put32(pos + 2U, id);
+  Dlog_Put32(pos + 6U, HAL_GetTick());
+  if (nargs > 0U) Dlog_Put32(pos + 10U, a0);
+  if (nargs > 1U) Dlog_Put32(pos + 14U, a1);
+  if (nargs > 2U) Dlog_Put32(pos + 18U, a2);
+  if (nargs > 3U) Dlog_Put32(pos + 22U, a3);
+  dlog_head = pos + len;
+  dlog_stats.records++;
+  __set_PRIMASK(primask);
+}
+
+/*
+ * Hand pending bytes to the sink, at most max_len per call and never
+ * across the end of the ring. Returns the number of bytes accepted.
+ */
+uint32_t Dlog_Flush(Dlog_SinkFn sink, uint16_t max_len)
+{
+  uint32_t tail = dlog_tail;
+  uint32_t pending = dlog_head - tail;
+  uint32_t off = tail & (DLOG_RING_SIZE - 1U);
+  uint32_t n = pending;
+
+  if (n > DLOG_RING_SIZE - off) n = DLOG_RING_SIZE - off;
+  if (n > max_len) n = max_len;
+  if (n == 0U || sink(&dlog_ring[off], (uint16_t)n) == 0U) return 0;
+  dlog_tail = tail + n;
+  return n;
+}
+
+void Dlog_GetStats(Dlog_StatsTypeDef *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *stats = dlog_stats;
+  __set_PRIMASK(primask);
+}
@@ -1,25 +1,126 @@
 #include <stdio.h>
-#include <string.h>
+#include <stdint.h>
 
 #ifndef __DEBUG__
 #define __DEBUG__
 
-#define PRINT_MESG_DBG(...)     do{printf("\r\n [%s][%s][%d] ", DbgTraceGetFileName(__FILE__),__FUNCTION__,__LINE__);printf(__VA_ARGS__);}while(0);
+/*
+ * Deferred (tokenized) logging.
+ *
+ * The format string, file name, line and level of every DLOG_xxx() call are
+ * stored in the ".dlog" section, which the linker script marks INFO: it is
+ * kept in the ELF but never loaded to flash. The device only copies a record
+ * into a RAM ring:
+ *
+ *   0xA5 | nargs | id (u32) | tick ms (u32) | nargs x arg (u32)   (little endian)
+ *
+ * where id is the offset of the metadata string in ".dlog". Dlog_Flush()
+ * hands the ring to the UART from a background task and Tools/dlog/dlog_decode
+ * re-expands the records on the host from the same ELF file.
+ *
+ * Arguments are 32-bit: integers and pointers are truncated, float and double
+ * are sent as IEEE-754 single precision, %s is not supported.
+ */
 
-const char *DbgTraceGetFileName(const char *fullpath)
+#define DLOG_LEVEL_NONE  0
+#define DLOG_LEVEL_ERR   1
+#define DLOG_LEVEL_WRN   2
+#define DLOG_LEVEL_INF   3
+#define DLOG_LEVEL_DBG   4
+
+/* calls below this threshold are compiled out */
+#ifndef DLOG_LEVEL
+#ifdef DEBUG
+#define DLOG_LEVEL       DLOG_LEVEL_DBG
+#else
+#define DLOG_LEVEL       DLOG_LEVEL_WRN
+#endif
+#endif
+
+#define DLOG_SYNC        0xA5U
+#define DLOG_MAX_ARGS    4U
+#define DLOG_RING_SIZE   1024U   /* bytes, power of two */
+
+/* base name of the source file, resolved by the compiler when it can */
+#ifdef __FILE_NAME__
+#define DBG_FILENAME     __FILE_NAME__
+#else
+#define DBG_FILENAME     __FILE__
+#endif
+
+#define DLOG_STR_(x)     #x
+#define DLOG_STR(x)      DLOG_STR_(x)
+#define DLOG_CAT_(a, b)  a##b
+#define DLOG_CAT(a, b)   DLOG_CAT_(a, b)
+
+#define DLOG_NARGS(...)  DLOG_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, N, ...) N
+
+static inline uint32_t Dlog_F32(float f)
 {
-  const char *ret = fullpath;
-
-  if (strrchr(fullpath, '\\') != NULL)
-  {
-    ret = strrchr(fullpath, '\\') + 1;
-  }
-  else if (strrchr(fullpath, '/') != NULL)
-  {
-    ret = strrchr(fullpath, '/') + 1;
-  }
-
-  return ret;
+  union { float f; uint32_t u; } c = { f };
+  return c.u;
 }
+
+#define DLOG_ARG(x) _Generic((x),                                           \
+    float:   Dlog_F32(_Generic((x), float: (x), default: 0.0f)),             \
+    double:  Dlog_F32((float)_Generic((x), double: (x), default: 0.0)),      \
+    default: (uint32_t)(uintptr_t)(x))
+
+#define DLOG_CALL0(id)             Dlog_Write(id, 0, 0, 0, 0, 0)
+#define DLOG_CALL1(id, a)          Dlog_Write(id, 1, DLOG_ARG(a), 0, 0, 0)
+#define DLOG_CALL2(id, a, b)       Dlog_Write(id, 2, DLOG_ARG(a), DLOG_ARG(b), 0, 0)
+#define DLOG_CALL3(id, a, b, c)    Dlog_Write(id, 3, DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), 0)
+#define DLOG_CALL4(id, a, b, c, d) Dlog_Write(id, 4, DLOG_ARG(a), DLOG_ARG(b), DLOG_ARG(c), DLOG_ARG(d))
+
+/* the dead printf call only keeps the compiler's format checking */
+#define DLOG_EMIT(level, fmt, ...) do {                                      \
+    static const char dlog_meta[] __attribute__((section(".dlog"), used)) =  \
+      DLOG_STR(level) "\x1f" DBG_FILENAME "\x1f" DLOG_STR(__LINE__) "\x1f" fmt; \
+    if (0) printf(fmt, ##__VA_ARGS__);                                       \
+    DLOG_CAT(DLOG_CALL, DLOG_NARGS(__VA_ARGS__))((uint32_t)(uintptr_t)dlog_meta, ##__VA_ARGS__); \
+  } while (0)
+
+#define DLOG_NOP(fmt, ...) do { if (0) printf(fmt, ##__VA_ARGS__); } while (0)
+
+#if DLOG_LEVEL >= DLOG_LEVEL_ERR
+#define DLOG_ERR(...)    DLOG_EMIT(DLOG_LEVEL_ERR, __VA_ARGS__)
+#else
+#define DLOG_ERR(...)    DLOG_NOP(__VA_ARGS__)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_WRN
+#define DLOG_WRN(...)    DLOG_EMIT(DLOG_LEVEL_WRN, __VA_ARGS__)
+#else
+#define DLOG_WRN(...)    DLOG_NOP(__VA_ARGS__)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_INF
+#define DLOG_INF(...)    DLOG_EMIT(DLOG_LEVEL_INF, __VA_ARGS__)
+#else
+#define DLOG_INF(...)    DLOG_NOP(__VA_ARGS__)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_DBG
+#define DLOG_DBG(...)    DLOG_EMIT(DLOG_LEVEL_DBG, __VA_ARGS__)
+#else
+#define DLOG_DBG(...)    DLOG_NOP(__VA_ARGS__)
 #endif
 
+/* kept for older call sites */
+#define PRINT_MESG_DBG(...)  DLOG_DBG(__VA_ARGS__)
+
+typedef struct
+{
+  uint32_t records;
+  uint32_t dropped;
+} Dlog_StatsTypeDef;
+
+/* all-or-nothing byte sink, returns len when accepted and 0 otherwise */
+typedef uint16_t (*Dlog_SinkFn)(const void *data, uint16_t len);
+
+void Dlog_Write(uint32_t id, uint32_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+uint32_t Dlog_Flush(Dlog_SinkFn sink, uint16_t max_len);
+void Dlog_GetStats(Dlog_StatsTypeDef *stats);
+
+#endif
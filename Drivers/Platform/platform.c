@@ -15,6 +15,16 @@
 
 extern I2C_HandleTypeDef 	hi2c1;
 
+static AMS5600_BusStats bus_stats;
+
+/* one STOP-terminated transfer of n data bytes plus the address byte */
+static void AMS5600_Count(uint8_t status, uint16_t n)
+{
+	bus_stats.transactions++;
+	bus_stats.bytes += n + 1;
+	if (status != 0) bus_stats.errors++;
+}
+
 /*
  * beware AMS5600 sensor register addresses are 8-bit only
  */
@@ -27,7 +37,9 @@ uint8_t AMS5600_RdByte(uint16_t dev, uint8_t RegisterAddr, uint8_t *value)
 
 	data_write[0] = RegisterAddr & 0xFF;
 	status = HAL_I2C_Master_Transmit(&hi2c1, dev, data_write, 1, 100);
+	AMS5600_Count(status, 1);
 	status|= HAL_I2C_Master_Receive(&hi2c1, dev, data_read, 1, 100);
+	AMS5600_Count(status, 1);
 	*value = data_read[0];
 	return status;
 }
@@ -40,11 +52,57 @@ uint8_t AMS5600_RdWord(uint16_t dev, uint8_t RegisterAddr, uint16_t *value)
 
 	data_write[0] = RegisterAddr & 0xFF;
 	status = HAL_I2C_Master_Transmit(&hi2c1, dev, data_write, 1, 100);
+	AMS5600_Count(status, 1);
 	status|= HAL_I2C_Master_Receive(&hi2c1, dev, data_read, 2, 100);
+	AMS5600_Count(status, 2);
+	*value = (data_read[0] << 8) | (data_read[1]);
+	return status;
+}
+
+uint8_t AMS5600_SetPointer(uint16_t dev, uint8_t RegisterAddr)
+{
+	uint8_t data_write[1];
+
+	uint8_t status = 0;
+
+	data_write[0] = RegisterAddr & 0xFF;
+	status = HAL_I2C_Master_Transmit(&hi2c1, dev, data_write, 1, 100);
+	AMS5600_Count(status, 1);
+	return status;
+}
+
+uint8_t AMS5600_RdWordCurrent(uint16_t dev, uint16_t *value)
+{
+	uint8_t status = 0;
+	uint8_t data_read[2];
+
+	status = HAL_I2C_Master_Receive(&hi2c1, dev, data_read, 2, 100);
+	AMS5600_Count(status, 2);
 	*value = (data_read[0] << 8) | (data_read[1]);
 	return status;
 }
 
+uint8_t AMS5600_RdWordRS(uint16_t dev, uint8_t RegisterAddr, uint16_t *value)
+{
+	uint8_t status = 0;
+	uint8_t data_read[2];
+
+	status = AMS5600_RdMulti(dev, RegisterAddr, data_read, 2);
+	*value = (data_read[0] << 8) | (data_read[1]);
+	return status;
+}
+
+uint8_t AMS5600_RdMulti(uint16_t dev, uint8_t RegisterAddr, uint8_t *pdata, uint16_t count)
+{
+	uint8_t status = 0;
+
+	status = HAL_I2C_Mem_Read(&hi2c1, dev, RegisterAddr, I2C_MEMADD_SIZE_8BIT, pdata, count, 100);
+	/* address + register, repeated START, address + data */
+	bus_stats.restarts++;
+	AMS5600_Count(status, count + 2);
+	return status;
+}
+
 uint8_t AMS5600_WrByte(uint16_t dev, uint8_t RegisterAddr, uint8_t value)
 {
 	uint8_t data_write[2];
@@ -53,6 +111,7 @@ uint8_t AMS5600_WrByte(uint16_t dev, uint8_t RegisterAddr, uint8_t value)
 	data_write[0] = RegisterAddr & 0xFF;
 	data_write[1] = value & 0xFF;
 	status = HAL_I2C_Master_Transmit(&hi2c1, dev, data_write, 2, 100);
+	AMS5600_Count(status, 2);
 	return status;
 }
 
@@ -64,9 +123,20 @@ uint8_t AMS5600_WrWord(uint16_t dev, uint8_t RegisterAddr, uint16_t value)
 	data_write[1] = (value >> 8) & 0xFF;
 	data_write[2] = value & 0xFF;
 	status = HAL_I2C_Master_Transmit(&hi2c1, dev, data_write, 3, 100);
+	AMS5600_Count(status, 3);
 	return status;
 }
 
+void AMS5600_GetBusStats(AMS5600_BusStats *stats)
+{
+	*stats = bus_stats;
+}
+
+void AMS5600_ResetBusStats(void)
+{
+	memset(&bus_stats, 0, sizeof(bus_stats));
+}
+
 void WaitMs(uint32_t TimeMs)
 {
 	HAL_Delay(TimeMs);
@@ -65,6 +65,17 @@
 #include "stm32f4xx_hal.h"
 
 extern I2C_HandleTypeDef hi2c1;
+
+/**
+ * @brief Bus activity of the functions below, for the bus benchmark.
+ * Every STOP-terminated transfer counts once, bytes include the address byte.
+ */
+typedef struct {
+	uint32_t transactions;
+	uint32_t restarts;
+	uint32_t bytes;
+	uint32_t errors;
+} AMS5600_BusStats;
 /**
  * @brief If the macro below is defined, the device will be programmed to run
  * with I2C Fast Mode Plus (up to 1MHz). Otherwise, default max value is 400kHz.
@@ -82,6 +93,38 @@ extern I2C_HandleTypeDef hi2c1;
  
 uint8_t AMS5600_RdWord(uint16_t dev, uint8_t registerAddr, uint16_t *value);
 
+/**
+ * @brief Write the register address only, to position the address pointer.
+ */
+ 
+uint8_t AMS5600_SetPointer(uint16_t dev, uint8_t registerAddr);
+
+/**
+ * @brief Read 16 bits through I2C from the current address pointer,
+ * without sending a register address first.
+ */
+ 
+uint8_t AMS5600_RdWordCurrent(uint16_t dev, uint16_t *value);
+
+/**
+ * @brief Bus bits of a combined read before the first data byte: START,
+ * address, register, repeated START, address.
+ */
+#define AMS5600_READ_HEAD_BITS 29U
+
+/**
+ * @brief Read 16 bits through I2C in one combined transfer
+ * (register address, repeated START, read).
+ */
+ 
+uint8_t AMS5600_RdWordRS(uint16_t dev, uint8_t registerAddr, uint16_t *value);
+
+/**
+ * @brief Read count consecutive bytes through I2C in one combined transfer.
+ */
+ 
+uint8_t AMS5600_RdMulti(uint16_t dev, uint8_t registerAddr, uint8_t *pdata, uint16_t count);
+
 /**
  * @brief Read 8 bits through I2C.
  */
@@ -100,6 +143,13 @@ uint8_t AMS5600_WrByte(uint16_t dev, uint8_t registerAddr, uint8_t value);
  
 uint8_t AMS5600_WrWord(uint16_t dev, uint8_t registerAddr, uint16_t value);
 		
+/**
+ * @brief Copy / clear the bus activity counters.
+ */
+ 
+void AMS5600_GetBusStats(AMS5600_BusStats *stats);
+void AMS5600_ResetBusStats(void);
+
 /**
  * @brief Wait during N milliseconds.
  */
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file           : as5600_model.h
+  * @brief          : Behavioural model of the AS5600 register interface,
+  *                   sitting behind the host I2C shim.
+  *
+  *  Modelled: the 8-bit address pointer with auto-increment (blocked on the
+  *  low byte of RAW ANGLE, ANGLE and MAGNITUDE, so a 2-byte read can be
+  *  repeated without an address phase), ZPOS/MPOS/MANG mapping of RAW ANGLE
+  *  to ANGLE, the MD/ML/MH status bits and AGC derived from the field
+  *  strength, and the OTP burn commands with the ZMCO counter.
+  ******************************************************************************
+  */
+
+#ifndef __AS5600_MODEL_H
+#define __AS5600_MODEL_H
+
+#include <stdint.h>
+
+#define AS5600_MODEL_ADDR       0x36U     /* 7-bit I2C address */
+
+#define AS5600_MODEL_FIELD_MIN  20U       /* mT, AGC saturates high (ML) */
+#define AS5600_MODEL_FIELD_MAX  100U      /* mT, AGC saturates low (MH) */
+#define AS5600_MODEL_FIELD_MD   8U        /* mT, magnet detection threshold */
+
+/* raw angle provider, queried on every RAW ANGLE / ANGLE read */
+typedef uint16_t (*AS5600Model_SourceFn)(void *ctx);
+
+typedef struct
+{
+  uint32_t writes;        /* write transactions */
+  uint32_t reads;         /* read transactions */
+  uint32_t bytes;         /* data bytes, both directions */
+  uint32_t burns;         /* accepted BURN commands */
+  uint32_t burns_refused; /* BURN commands refused (OTP exhausted) */
+} AS5600Model_StatsTypeDef;
+
+void     AS5600Model_Erase(void);
+void     AS5600Model_PowerCycle(void);
+void     AS5600Model_SetRawAngle(uint16_t raw);
+void     AS5600Model_SetSource(AS5600Model_SourceFn fn, void *ctx);
+void     AS5600Model_SetField(uint16_t field_mt);
+int      AS5600Model_Write(const uint8_t *data, uint16_t len);
+int      AS5600Model_Read(uint8_t *data, uint16_t len);
+int      AS5600Model_ReadMore(uint8_t *data, uint16_t len);
+uint8_t  AS5600Model_Peek(uint8_t reg);
+void     AS5600Model_GetStats(AS5600Model_StatsTypeDef *stats);
+
+#endif /* __AS5600_MODEL_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file           : as5600_sim.h
+  * @brief          : Physics-driven raw angle generator for the host build.
+  *
+  *  A magnet trajectory (constant speed, ramps, stalls, torsional vibration)
+  *  is run through a model of the AS5600 signal path:
+  *
+  *    position -> slow/fast filter (CONF SF/FTH) -> output noise -> 12-bit
+  *
+  *  The filter is first order with the settling time of the selected SF
+  *  setting and is switched to the fast time constant while the input is
+  *  more than the FTH threshold away from the output. Noise is gaussian with
+  *  the datasheet RMS of the SF setting, scaled up as the field weakens.
+  *  The field follows an optional eccentricity wobble and drives the AGC of
+  *  the register model through a lag.
+  *
+  *  AS5600Sim_Next() steps virtual time and generates tens of millions of
+  *  samples per second; AS5600Sim_Attach() feeds the register model in host
+  *  real time instead.
+  ******************************************************************************
+  */
+
+#ifndef __AS5600_SIM_H
+#define __AS5600_SIM_H
+
+#include <stdint.h>
+
+#define AS5600_SIM_MAX_SEGMENTS  16U
+
+typedef enum
+{
+  SIM_SEG_CONST = 0,  /* constant speed */
+  SIM_SEG_RAMP,       /* linear speed change from the previous speed */
+  SIM_SEG_STALL       /* position frozen, vibration suppressed */
+} AS5600Sim_SegKindTypeDef;
+
+typedef struct
+{
+  AS5600Sim_SegKindTypeDef kind;
+  double duration_s;
+  double speed_rpm;      /* CONST: speed, RAMP: end speed */
+  double vib_amp_deg;    /* superimposed torsional vibration, peak */
+  double vib_hz;
+} AS5600Sim_SegmentTypeDef;
+
+typedef struct
+{
+  AS5600Sim_SegmentTypeDef seg[AS5600_SIM_MAX_SEGMENTS];
+  uint32_t n_seg;
+  uint8_t  loop;           /* restart the trajectory at the end */
+  double   start_deg;
+  double   field_mt;       /* mean axial field */
+  double   wobble_mt;      /* field modulation by magnet eccentricity, peak */
+  double   noise_scale;    /* 1 = datasheet noise, 0 = noiseless */
+  uint16_t conf;           /* CONF register, SF bits 9:8, FTH bits 12:10 */
+  uint32_t seed;
+} AS5600Sim_ConfigTypeDef;
+
+typedef struct
+{
+  AS5600Sim_ConfigTypeDef cfg;
+  double   t;              /* virtual time, s */
+  double   seg_t;          /* time into the current segment */
+  uint32_t seg;
+  double   pos_deg;        /* unwrapped mechanical angle without vibration */
+  double   speed_rpm;
+  double   speed0_rpm;     /* speed at the start of a ramp */
+  double   in_cnt;         /* filter input, unwrapped counts */
+  double   out_cnt;        /* filter output, unwrapped counts */
+  double   field_agc;      /* field as seen through the AGC lag */
+  double   tau_slow, tau_fast, sigma_cnt, fth_cnt;
+  double   e_dt, e_slow, e_fast, e_agc;   /* decay factors of the last step size */
+  double   spare_gauss;
+  uint8_t  has_spare;
+  uint64_t rng;
+  uint64_t samples;
+  uint16_t raw;
+} AS5600Sim_TypeDef;
+
+void     AS5600Sim_Init(AS5600Sim_TypeDef *sim, const AS5600Sim_ConfigTypeDef *cfg);
+void     AS5600Sim_SetConf(AS5600Sim_TypeDef *sim, uint16_t conf);
+uint16_t AS5600Sim_Next(AS5600Sim_TypeDef *sim, double dt);
+void     AS5600Sim_Fill(AS5600Sim_TypeDef *sim, uint16_t *buf, uint32_t n, double dt);
+double   AS5600Sim_TrueAngle(const AS5600Sim_TypeDef *sim);
+double   AS5600Sim_Field(const AS5600Sim_TypeDef *sim);
+void     AS5600Sim_Attach(AS5600Sim_TypeDef *sim);
+
+#endif /* __AS5600_SIM_H */
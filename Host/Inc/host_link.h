@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file           : host_link.h
+  * @brief          : Workstation end of the USART2 link for the host tools:
+  *                   a serial device, or a host-built firmware started on a
+  *                   pty, and the frame format of telemetry.h both ways.
+  ******************************************************************************
+  */
+
+#ifndef __HOST_LINK_H
+#define __HOST_LINK_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "telemetry.h"
+
+typedef struct
+{
+  int      fd;
+  int      slave;          /* pty slave kept open while the firmware runs */
+  pid_t    child;
+  uint8_t  echo_text;      /* copy non-frame bytes to stdout */
+  uint8_t  rx[TELEMETRY_FRAME_LEN(TELEMETRY_MAX_PAYLOAD)];
+  uint32_t have;
+} HostLink_TypeDef;
+
+typedef void (*HostLink_FrameFn)(void *ctx, uint8_t type, const uint8_t *payload, uint8_t len);
+
+int  HostLink_Open(HostLink_TypeDef *link, const char *dev, const char *cmd);
+void HostLink_Close(HostLink_TypeDef *link);
+int  HostLink_Send(HostLink_TypeDef *link, uint8_t type, const void *payload, uint8_t len);
+int  HostLink_Poll(HostLink_TypeDef *link, int timeout_ms, HostLink_FrameFn fn, void *ctx);
+double HostLink_Now(void);
+
+#endif /* __HOST_LINK_H */
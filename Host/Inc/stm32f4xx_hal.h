@@ -0,0 +1,322 @@
+/**
+  ******************************************************************************
+  * @file           : stm32f4xx_hal.h (host shim)
+  * @brief          : Minimal stand-in for the STM32F4 HAL and CMSIS core so
+  *                   that the driver and application sources build on Linux.
+  *
+  *  I2C1 is routed to the behavioural AS5600 model (as5600_model.h) and waits
+  *  for the bus time of each transfer unless HostShim_SetI2cRealtime(0), USART2
+  *  writes to a file descriptor with the bus time of the configured baud rate,
+  *  HAL_GetTick() and the DWT cycle counter follow the host monotonic clock
+  *  (the counter is scaled to SystemCoreClock). USART2 receives from an
+  *  optional second descriptor, paced at the baud rate. Interrupt completions
+  *  (UART DMA, reception events) are delivered from __WFI() and from DWT reads
+  *  while PRIMASK is clear.
+  ******************************************************************************
+  */
+
+#ifndef __HOST_STM32F4XX_HAL_H
+#define __HOST_STM32F4XX_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOST_BUILD 1
+
+/* ------------------------------------------------------------------------- */
+/* HAL common                                                                */
+/* ------------------------------------------------------------------------- */
+
+typedef enum
+{
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+  RESET = 0U,
+  SET = !RESET
+} FlagStatus, ITStatus;
+
+#define HAL_MAX_DELAY  0xFFFFFFFFU
+#define HSI_VALUE      16000000U
+#define LSI_VALUE      32000U
+
+#define __IO volatile
+
+extern uint32_t SystemCoreClock;
+
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+
+/* ------------------------------------------------------------------------- */
+/* Cortex-M core                                                             */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  uint32_t CTRL;
+  uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+DWT_Type *HostShim_Dwt(void);
+extern CoreDebug_Type host_coredebug;
+
+#define DWT        (HostShim_Dwt())
+#define CoreDebug  (&host_coredebug)
+
+void HostShim_Wfi(void);
+extern volatile uint32_t host_primask;
+
+static inline void __WFI(void) { HostShim_Wfi(); }
+static inline void __NOP(void) {}
+static inline void __DSB(void) {}
+static inline void __disable_irq(void) { host_primask = 1U; }
+static inline void __enable_irq(void) { host_primask = 0U; }
+static inline uint32_t __get_PRIMASK(void) { return host_primask; }
+static inline void __set_PRIMASK(uint32_t primask) { host_primask = primask; }
+static inline uint8_t __CLZ(uint32_t value) { return value ? (uint8_t)__builtin_clz(value) : 32U; }
+
+/* Cortex-M4 DSP instructions, same results as on the target */
+static inline uint32_t __SSUB16(uint32_t op1, uint32_t op2)
+{
+  uint16_t lo = (uint16_t)((int16_t)op1 - (int16_t)op2);
+  uint16_t hi = (uint16_t)((int16_t)(op1 >> 16) - (int16_t)(op2 >> 16));
+
+  return ((uint32_t)hi << 16) | lo;
+}
+
+static inline uint32_t __SMLAD(uint32_t op1, uint32_t op2, uint32_t op3)
+{
+  int32_t lo = (int32_t)(int16_t)op1 * (int16_t)op2;
+  int32_t hi = (int32_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16);
+
+  return op3 + (uint32_t)lo + (uint32_t)hi;
+}
+
+static inline uint32_t __SMLSDX(uint32_t op1, uint32_t op2, uint32_t op3)
+{
+  int32_t lo = (int32_t)(int16_t)op1 * (int16_t)(op2 >> 16);
+  int32_t hi = (int32_t)(int16_t)(op1 >> 16) * (int16_t)op2;
+
+  return op3 + (uint32_t)lo - (uint32_t)hi;
+}
+
+/* halving add / subtract, the result fits without saturation */
+static inline uint32_t __SHADD16(uint32_t op1, uint32_t op2)
+{
+  uint16_t lo = (uint16_t)(((int32_t)(int16_t)op1 + (int16_t)op2) >> 1);
+  uint16_t hi = (uint16_t)(((int32_t)(int16_t)(op1 >> 16) + (int16_t)(op2 >> 16)) >> 1);
+
+  return ((uint32_t)hi << 16) | lo;
+}
+
+static inline uint32_t __SHSUB16(uint32_t op1, uint32_t op2)
+{
+  uint16_t lo = (uint16_t)(((int32_t)(int16_t)op1 - (int16_t)op2) >> 1);
+  uint16_t hi = (uint16_t)(((int32_t)(int16_t)(op1 >> 16) - (int16_t)(op2 >> 16)) >> 1);
+
+  return ((uint32_t)hi << 16) | lo;
+}
+
+static inline uint32_t __RBIT(uint32_t value)
+{
+  uint32_t r = 0;
+
+  for (int i = 0; i < 32; i++, value >>= 1) r = (r << 1) | (value & 1U);
+  return r;
+}
+
+/* ------------------------------------------------------------------------- */
+/* GPIO                                                                      */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  volatile uint32_t IDR;
+  volatile uint32_t ODR;
+  volatile uint32_t BSRR;
+} GPIO_TypeDef;
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc, host_gpioh;
+#define GPIOA  (&host_gpioa)
+#define GPIOB  (&host_gpiob)
+#define GPIOC  (&host_gpioc)
+#define GPIOH  (&host_gpioh)
+
+#define GPIO_PIN_0   ((uint16_t)0x0001)
+#define GPIO_PIN_1   ((uint16_t)0x0002)
+#define GPIO_PIN_2   ((uint16_t)0x0004)
+#define GPIO_PIN_3   ((uint16_t)0x0008)
+#define GPIO_PIN_4   ((uint16_t)0x0010)
+#define GPIO_PIN_5   ((uint16_t)0x0020)
+#define GPIO_PIN_6   ((uint16_t)0x0040)
+#define GPIO_PIN_7   ((uint16_t)0x0080)
+#define GPIO_PIN_8   ((uint16_t)0x0100)
+#define GPIO_PIN_9   ((uint16_t)0x0200)
+#define GPIO_PIN_10  ((uint16_t)0x0400)
+#define GPIO_PIN_11  ((uint16_t)0x0800)
+#define GPIO_PIN_12  ((uint16_t)0x1000)
+#define GPIO_PIN_13  ((uint16_t)0x2000)
+#define GPIO_PIN_14  ((uint16_t)0x4000)
+#define GPIO_PIN_15  ((uint16_t)0x8000)
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* ------------------------------------------------------------------------- */
+/* I2C                                                                       */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  uint32_t id;
+} I2C_TypeDef;
+
+typedef struct
+{
+  uint32_t ClockSpeed;
+} I2C_InitTypeDef;
+
+typedef struct
+{
+  I2C_TypeDef    *Instance;
+  I2C_InitTypeDef Init;
+} I2C_HandleTypeDef;
+
+extern I2C_TypeDef host_i2c1;
+#define I2C1  (&host_i2c1)
+
+#define I2C_MEMADD_SIZE_8BIT  0x00000001U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                          uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                         uint8_t *pData, uint16_t Size, uint32_t Timeout);
+
+/* ------------------------------------------------------------------------- */
+/* UART                                                                      */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  uint32_t id;
+} USART_TypeDef;
+
+typedef struct
+{
+  uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct
+{
+  USART_TypeDef   *Instance;
+  UART_InitTypeDef Init;
+} UART_HandleTypeDef;
+
+extern USART_TypeDef host_usart2;
+#define USART2  (&host_usart2)
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData,
+                                    uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+/* ------------------------------------------------------------------------- */
+/* TIM: up-counting time base with the update interrupt, clocked at         */
+/* SystemCoreClock / (Prescaler + 1). ARR takes effect at once (no preload). */
+/* PWM channel 1 is only its compare value and enable bit.                   */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  uint32_t CNT;
+  uint32_t ARR;
+  uint32_t CCR1;
+  uint32_t CCER;
+} TIM_TypeDef;
+
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+  TIM_TypeDef         *Instance;
+  TIM_Base_InitTypeDef Init;
+} TIM_HandleTypeDef;
+
+extern TIM_TypeDef host_tim2, host_tim3, host_tim4, host_tim5;
+#define TIM2  (&host_tim2)
+#define TIM3  (&host_tim3)
+#define TIM4  (&host_tim4)
+#define TIM5  (&host_tim5)
+
+#define TIM_IT_UPDATE  0x00000001U
+#define TIM_CHANNEL_1  0x00000000U
+#define TIM_CCER_CC1E  0x00000001U
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+uint32_t HostShim_TimGetCounter(TIM_HandleTypeDef *htim);
+void HostShim_TimSetCounter(TIM_HandleTypeDef *htim, uint32_t cnt);
+
+#define __HAL_TIM_GET_COUNTER(h)        HostShim_TimGetCounter(h)
+#define __HAL_TIM_SET_COUNTER(h, v)     HostShim_TimSetCounter((h), (v))
+#define __HAL_TIM_SET_AUTORELOAD(h, v)  do { (h)->Instance->ARR = (v); (h)->Init.Period = (v); } while (0)
+#define __HAL_TIM_GET_AUTORELOAD(h)     ((h)->Instance->ARR)
+#define __HAL_TIM_SET_COMPARE(h, ch, v) ((void)(ch), (h)->Instance->CCR1 = (v))
+#define __HAL_TIM_CLEAR_IT(h, it)       ((void)(h), (void)(it))
+
+/* ------------------------------------------------------------------------- */
+/* Host side controls                                                        */
+/* ------------------------------------------------------------------------- */
+
+void HostShim_SetUartFd(int fd);
+void HostShim_SetUartRxFd(int fd);
+void HostShim_SetI2cRealtime(uint8_t on);
+void HostShim_PressButton(uint32_t ms);
+uint64_t HostShim_Micros(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_STM32F4XX_HAL_H */
@@ -0,0 +1,301 @@
+/**
+  ******************************************************************************
+  * @file           : as5600_model.c
+  * @brief          : Behavioural model of the AS5600 register interface.
+  ******************************************************************************
+  */
+
+#include "as5600_model.h"
+#include <string.h>
+
+#define REG_ZMCO       0x00U
+#define REG_ZPOS       0x01U
+#define REG_MPOS       0x03U
+#define REG_MANG       0x05U
+#define REG_CONF       0x07U
+#define REG_STATUS     0x0BU
+#define REG_RAW_ANGLE  0x0CU
+#define REG_ANGLE      0x0EU
+#define REG_AGC        0x1AU
+#define REG_MAGNITUDE  0x1BU
+#define REG_BURN       0xFFU
+
+#define BURN_ANGLE     0x80U
+#define BURN_SETTING   0x40U
+
+#define STATUS_MH      0x08U
+#define STATUS_ML      0x10U
+#define STATUS_MD      0x20U
+
+#define MAGNITUDE_NOM  2048U  /* CORDIC magnitude while the AGC regulates */
+
+typedef struct
+{
+  uint8_t  ram[9];        /* ZMCO..CONF as seen on the bus, 0x00..0x08 */
+  uint8_t  otp[9];        /* burnt copy, reloaded at power-up */
+  uint8_t  zmco;          /* angle burns done */
+  uint8_t  setting_burnt;
+  uint8_t  ptr;           /* address pointer */
+  uint16_t latch;         /* output register snapshot taken on the high byte */
+  uint16_t raw;
+  uint16_t field_mt;
+  AS5600Model_SourceFn source;
+  void    *source_ctx;
+  AS5600Model_StatsTypeDef stats;
+} Model_TypeDef;
+
+static Model_TypeDef m;
+
+/* mask of the implemented bits of the writable registers 0x01..0x08 */
+static const uint8_t wr_mask[9] = { 0x00, 0x0F, 0xFF, 0x0F, 0xFF, 0x0F, 0xFF, 0x3F, 0xFF };
+
+static uint16_t Model_Word(uint8_t reg)
+{
+  return (uint16_t)(((m.ram[reg] & 0x0FU) << 8) | m.ram[reg + 1U]);
+}
+
+static uint16_t Model_Raw(void)
+{
+  if (m.source) m.raw = m.source(m.source_ctx) & 0x0FFFU;
+  return m.raw;
+}
+
+/* ZPOS/MPOS/MANG mapping of RAW ANGLE to the 12-bit ANGLE output */
+static uint16_t Model_Angle(uint16_t raw)
+{
+  uint16_t zpos = Model_Word(REG_ZPOS);
+  uint16_t mpos = Model_Word(REG_MPOS);
+  uint32_t range = mpos ? ((uint32_t)(mpos - zpos) & 0x0FFFU) : Model_Word(REG_MANG);
+  uint32_t rel = (uint32_t)(raw - zpos) & 0x0FFFU;
+
+  if (range == 0U) return (uint16_t)rel;
+  if (rel >= range)
+  {
+    /* outside the range the output clamps to the nearer end */
+    return (rel < range + (4096U - range) / 2U) ? 4095U : 0U;
+  }
+  rel = (rel * 4096U) / range;
+  return (uint16_t)(rel > 4095U ? 4095U : rel);
+}
+
+static uint8_t Model_Agc(void)
+{
+  if (m.field_mt <= AS5600_MODEL_FIELD_MIN) return 255U;
+  if (m.field_mt >= AS5600_MODEL_FIELD_MAX) return 0U;
+  return (uint8_t)(((AS5600_MODEL_FIELD_MAX - m.field_mt) * 255U) /
+                   (AS5600_MODEL_FIELD_MAX - AS5600_MODEL_FIELD_MIN));
+}
+
+static uint8_t Model_Status(void)
+{
+  uint8_t agc = Model_Agc();
+  uint8_t st = 0;
+
+  if (m.field_mt >= AS5600_MODEL_FIELD_MD) st |= STATUS_MD;
+  if (agc == 255U) st |= STATUS_ML;
+  if (agc == 0U) st |= STATUS_MH;
+  return st;
+}
+
+static uint16_t Model_Magnitude(void)
+{
+  uint32_t mag;
+
+  if (m.field_mt <= AS5600_MODEL_FIELD_MIN)
+    mag = (MAGNITUDE_NOM * m.field_mt) / AS5600_MODEL_FIELD_MIN;
+  else if (m.field_mt >= AS5600_MODEL_FIELD_MAX)
+    mag = (MAGNITUDE_NOM * m.field_mt) / AS5600_MODEL_FIELD_MAX;
+  else
+    mag = MAGNITUDE_NOM;
+  return (uint16_t)(mag > 4095U ? 4095U : mag);
+}
+
+static void Model_Burn(uint8_t cmd)
+{
+  if (cmd == BURN_ANGLE)
+  {
+    if (m.zmco >= 3U)
+    {
+      m.stats.burns_refused++;
+      return;
+    }
+    memcpy(&m.otp[REG_ZPOS], &m.ram[REG_ZPOS], 4);
+    m.zmco++;
+    m.ram[REG_ZMCO] = m.zmco;
+    m.stats.burns++;
+  }
+  else if (cmd == BURN_SETTING)
+  {
+    /* MANG/CONF only on a part whose angles were never burnt */
+    if (m.zmco != 0U || m.setting_burnt)
+    {
+      m.stats.burns_refused++;
+      return;
+    }
+    memcpy(&m.otp[REG_MANG], &m.ram[REG_MANG], 4);
+    m.setting_burnt = 1;
+    m.stats.burns++;
+  }
+}
+
+static uint8_t Model_ReadReg(uint8_t reg)
+{
+  switch (reg)
+  {
+    case REG_ZMCO:
+      return m.zmco & 0x03U;
+    case REG_STATUS:
+      return Model_Status();
+    case REG_RAW_ANGLE:
+      m.latch = Model_Raw();
+      return (uint8_t)(m.latch >> 8);
+    case REG_ANGLE:
+      m.latch = Model_Angle(Model_Raw());
+      return (uint8_t)(m.latch >> 8);
+    case REG_MAGNITUDE:
+      m.latch = Model_Magnitude();
+      return (uint8_t)(m.latch >> 8);
+    case REG_RAW_ANGLE + 1U:
+    case REG_ANGLE + 1U:
+    case REG_MAGNITUDE + 1U:
+      return (uint8_t)m.latch;
+    case REG_AGC:
+      return Model_Agc();
+    default:
+      return (reg <= REG_CONF + 1U) ? m.ram[reg] : 0U;
+  }
+}
+
+static void Model_Advance(void)
+{
+  /* the pointer sticks to the output registers: low byte -> high byte */
+  if (m.ptr == REG_RAW_ANGLE + 1U || m.ptr == REG_ANGLE + 1U || m.ptr == REG_MAGNITUDE + 1U)
+    m.ptr--;
+  else
+    m.ptr++;
+}
+
+/**
+  * @brief  Factory-fresh part: blank OTP, no burns, magnet at 60 mT, angle 0.
+  * @retval None
+  */
+void AS5600Model_Erase(void)
+{
+  memset(&m, 0, sizeof(m));
+  m.field_mt = 60U;
+}
+
+/**
+  * @brief  Power cycle: the volatile registers reload from OTP and the
+  *         address pointer resets. Source, field and statistics are kept.
+  * @retval None
+  */
+void AS5600Model_PowerCycle(void)
+{
+  memcpy(m.ram, m.otp, sizeof(m.ram));
+  m.ram[REG_ZMCO] = m.zmco;
+  m.ptr = 0;
+}
+
+/**
+  * @brief  Fixed raw angle, used while no source is installed.
+  * @retval None
+  */
+void AS5600Model_SetRawAngle(uint16_t raw)
+{
+  m.raw = raw & 0x0FFFU;
+}
+
+/**
+  * @brief  Install a raw angle provider (NULL reverts to the fixed angle).
+  * @retval None
+  */
+void AS5600Model_SetSource(AS5600Model_SourceFn fn, void *ctx)
+{
+  m.source = fn;
+  m.source_ctx = ctx;
+}
+
+/**
+  * @brief  Axial field at the sensor, 0 = no magnet.
+  * @retval None
+  */
+void AS5600Model_SetField(uint16_t field_mt)
+{
+  m.field_mt = field_mt;
+}
+
+/**
+  * @brief  I2C write transaction: pointer byte then register data.
+  * @param  data: bytes after the address byte
+  * @param  len: number of bytes
+  * @retval 0 (ACK), -1 on an empty transaction
+  */
+int AS5600Model_Write(const uint8_t *data, uint16_t len)
+{
+  if (len == 0U) return -1;
+  m.stats.writes++;
+  m.ptr = data[0];
+  for (uint16_t i = 1; i < len; i++)
+  {
+    m.stats.bytes++;
+    if (m.ptr == REG_BURN)
+      Model_Burn(data[i]);
+    else if (m.ptr >= REG_ZPOS && m.ptr <= REG_CONF + 1U)
+      m.ram[m.ptr] = data[i] & wr_mask[m.ptr];
+    m.ptr++;
+  }
+  return 0;
+}
+
+/**
+  * @brief  I2C read transaction from the current address pointer.
+  * @param  data: destination
+  * @param  len: number of bytes
+  * @retval 0
+  */
+int AS5600Model_Read(uint8_t *data, uint16_t len)
+{
+  m.stats.reads++;
+  return AS5600Model_ReadMore(data, len);
+}
+
+/**
+  * @brief  More bytes of the current read transaction, for a bus that hands
+  *         them out one at a time.
+  * @param  data: destination
+  * @param  len: number of bytes
+  * @retval 0
+  */
+int AS5600Model_ReadMore(uint8_t *data, uint16_t len)
+{
+  for (uint16_t i = 0; i < len; i++)
+  {
+    data[i] = Model_ReadReg(m.ptr);
+    Model_Advance();
+    m.stats.bytes++;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Register value without side effects on the pointer.
+  * @retval register content
+  */
+uint8_t AS5600Model_Peek(uint8_t reg)
+{
+  uint16_t latch = m.latch;
+  uint8_t v = Model_ReadReg(reg);
+
+  m.latch = latch;
+  return v;
+}
+
+/**
+  * @brief  Copy of the bus counters.
+  * @retval None
+  */
+void AS5600Model_GetStats(AS5600Model_StatsTypeDef *stats)
+{
+  *stats = m.stats;
+}
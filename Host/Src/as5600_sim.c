@@ -0,0 +1,263 @@
+/**
+  ******************************************************************************
+  * @file           : as5600_sim.c
+  * @brief          : Physics-driven raw angle generator for the host build.
+  ******************************************************************************
+  */
+
+#include "as5600_sim.h"
+#include "as5600_model.h"
+#include "stm32f4xx_hal.h"
+#include <math.h>
+#include <string.h>
+
+#define CNT_PER_DEG     (4096.0 / 360.0)
+#define DEG_S_PER_RPM   6.0
+#define FIELD_NOM_MT    60.0     /* field of the datasheet noise figures */
+#define TAU_AGC_S       0.5e-3   /* AGC loop lag */
+#define ATTACH_STEP_S   100e-6   /* largest real-time step */
+
+/* CONF SF 16x/8x/4x/2x: step response settling time and RMS output noise */
+static const double sf_settle_s[4] = { 2.2e-3, 1.1e-3, 0.55e-3, 0.286e-3 };
+static const double sf_noise_deg[4] = { 0.015, 0.021, 0.030, 0.043 };
+/* CONF FTH: fast filter threshold in LSB, 0 = slow filter only */
+static const uint8_t fth_lsb[8] = { 0, 6, 7, 9, 18, 21, 24, 10 };
+
+static uint64_t Sim_Rand(AS5600Sim_TypeDef *sim)
+{
+  /* xorshift64* */
+  sim->rng ^= sim->rng >> 12;
+  sim->rng ^= sim->rng << 25;
+  sim->rng ^= sim->rng >> 27;
+  return sim->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static double Sim_Uniform(AS5600Sim_TypeDef *sim)
+{
+  return (double)(Sim_Rand(sim) >> 11) * (1.0 / 9007199254740992.0) * 2.0 - 1.0;
+}
+
+/* polar Box-Muller, one value cached */
+static double Sim_Gauss(AS5600Sim_TypeDef *sim)
+{
+  double u, v, s;
+
+  if (sim->has_spare)
+  {
+    sim->has_spare = 0;
+    return sim->spare_gauss;
+  }
+  do
+  {
+    u = Sim_Uniform(sim);
+    v = Sim_Uniform(sim);
+    s = u * u + v * v;
+  } while (s >= 1.0 || s == 0.0);
+  s = sqrt(-2.0 * log(s) / s);
+  sim->spare_gauss = v * s;
+  sim->has_spare = 1;
+  return u * s;
+}
+
+/* advance the trajectory by dt, splitting at segment boundaries */
+static void Sim_Move(AS5600Sim_TypeDef *sim, double dt)
+{
+  while (dt > 0.0)
+  {
+    const AS5600Sim_SegmentTypeDef *seg;
+    double left, h, v_end;
+
+    if (sim->seg >= sim->cfg.n_seg)
+    {
+      /* past the end: keep the last speed */
+      sim->pos_deg += sim->speed_rpm * DEG_S_PER_RPM * dt;
+      return;
+    }
+    seg = &sim->cfg.seg[sim->seg];
+    left = seg->duration_s - sim->seg_t;
+    h = dt < left ? dt : left;
+    switch (seg->kind)
+    {
+      case SIM_SEG_RAMP:
+        v_end = sim->speed0_rpm + (seg->speed_rpm - sim->speed0_rpm) * ((sim->seg_t + h) / seg->duration_s);
+        sim->pos_deg += 0.5 * (sim->speed_rpm + v_end) * DEG_S_PER_RPM * h;
+        sim->speed_rpm = v_end;
+        break;
+      case SIM_SEG_STALL:
+        sim->speed_rpm = 0.0;
+        break;
+      default:
+        sim->speed_rpm = seg->speed_rpm;
+        sim->pos_deg += sim->speed_rpm * DEG_S_PER_RPM * h;
+        break;
+    }
+    sim->seg_t += h;
+    dt -= h;
+    if (sim->seg_t >= seg->duration_s)
+    {
+      sim->seg_t = 0.0;
+      sim->speed0_rpm = sim->speed_rpm;
+      if (++sim->seg >= sim->cfg.n_seg && sim->cfg.loop) sim->seg = 0;
+    }
+  }
+}
+
+static double Sim_Vibration(const AS5600Sim_TypeDef *sim)
+{
+  const AS5600Sim_SegmentTypeDef *seg;
+
+  if (sim->seg >= sim->cfg.n_seg) return 0.0;
+  seg = &sim->cfg.seg[sim->seg];
+  if (seg->kind == SIM_SEG_STALL || seg->vib_amp_deg == 0.0) return 0.0;
+  return seg->vib_amp_deg * sin(2.0 * M_PI * seg->vib_hz * sim->t);
+}
+
+/**
+  * @brief  Reset the simulator to t = 0 with the given configuration.
+  * @retval None
+  */
+void AS5600Sim_Init(AS5600Sim_TypeDef *sim, const AS5600Sim_ConfigTypeDef *cfg)
+{
+  double total = 0.0;
+
+  memset(sim, 0, sizeof(*sim));
+  sim->cfg = *cfg;
+  if (sim->cfg.n_seg > AS5600_SIM_MAX_SEGMENTS) sim->cfg.n_seg = AS5600_SIM_MAX_SEGMENTS;
+  for (uint32_t i = 0; i < sim->cfg.n_seg; i++) total += sim->cfg.seg[i].duration_s;
+  if (total <= 0.0) sim->cfg.loop = 0;
+  if (sim->cfg.n_seg && sim->cfg.seg[0].kind == SIM_SEG_CONST) sim->speed_rpm = sim->cfg.seg[0].speed_rpm;
+  sim->pos_deg = cfg->start_deg;
+  sim->in_cnt = sim->out_cnt = cfg->start_deg * CNT_PER_DEG;
+  sim->field_agc = cfg->field_mt;
+  sim->rng = cfg->seed ? cfg->seed : 0x9E3779B97F4A7C15ULL;
+  AS5600Sim_SetConf(sim, cfg->conf);
+}
+
+/**
+  * @brief  Apply the SF and FTH fields of a CONF register value.
+  * @retval None
+  */
+void AS5600Sim_SetConf(AS5600Sim_TypeDef *sim, uint16_t conf)
+{
+  uint8_t sf = (conf >> 8) & 0x03U;
+
+  sim->cfg.conf = conf;
+  sim->tau_slow = sf_settle_s[sf] / 3.0;   /* settled to 5 % */
+  sim->tau_fast = sf_settle_s[3] / 3.0;
+  sim->fth_cnt = fth_lsb[(conf >> 10) & 0x07U];
+  sim->sigma_cnt = sf_noise_deg[sf] * CNT_PER_DEG * sim->cfg.noise_scale;
+  sim->e_dt = -1.0;
+}
+
+/**
+  * @brief  Advance virtual time by dt and return the RAW ANGLE at that time.
+  * @param  dt: step in seconds, > 0
+  * @retval 12-bit raw angle
+  */
+uint16_t AS5600Sim_Next(AS5600Sim_TypeDef *sim, double dt)
+{
+  double x0 = sim->in_cnt, x1, b, tau, e, y, field;
+
+  if (dt != sim->e_dt)
+  {
+    sim->e_dt = dt;
+    sim->e_slow = exp(-dt / sim->tau_slow);
+    sim->e_fast = exp(-dt / sim->tau_fast);
+    sim->e_agc = exp(-dt / TAU_AGC_S);
+  }
+
+  sim->t += dt;
+  Sim_Move(sim, dt);
+  x1 = (sim->pos_deg + Sim_Vibration(sim)) * CNT_PER_DEG;
+  sim->in_cnt = x1;
+
+  /* first-order filter, exact for an input ramping linearly over the step */
+  if (sim->fth_cnt > 0.0 && fabs(x1 - sim->out_cnt) > sim->fth_cnt)
+  {
+    tau = sim->tau_fast;
+    e = sim->e_fast;
+  }
+  else
+  {
+    tau = sim->tau_slow;
+    e = sim->e_slow;
+  }
+  b = (x1 - x0) / dt;
+  y = x1 - b * tau + (sim->out_cnt - x0 + b * tau) * e;
+  sim->out_cnt = y;
+
+  /* eccentric magnet: field follows the angle, the AGC follows the field */
+  field = sim->cfg.field_mt;
+  if (sim->cfg.wobble_mt != 0.0) field += sim->cfg.wobble_mt * sin(x1 * (2.0 * M_PI / 4096.0));
+  sim->field_agc = field + (sim->field_agc - field) * sim->e_agc;
+
+  if (sim->field_agc < AS5600_MODEL_FIELD_MD)
+  {
+    sim->raw = (uint16_t)(Sim_Rand(sim) >> 52);   /* no magnet: garbage */
+  }
+  else
+  {
+    if (sim->sigma_cnt > 0.0)
+    {
+      double scale = sim->field_agc < FIELD_NOM_MT ? FIELD_NOM_MT / sim->field_agc : 1.0;
+
+      y += Sim_Gauss(sim) * sim->sigma_cnt * scale;
+    }
+    sim->raw = (uint16_t)((int64_t)floor(y + 0.5) & 0x0FFF);
+  }
+  sim->samples++;
+  return sim->raw;
+}
+
+/**
+  * @brief  Generate n samples spaced dt apart.
+  * @retval None
+  */
+void AS5600Sim_Fill(AS5600Sim_TypeDef *sim, uint16_t *buf, uint32_t n, double dt)
+{
+  for (uint32_t i = 0; i < n; i++) buf[i] = AS5600Sim_Next(sim, dt);
+}
+
+/**
+  * @brief  Mechanical angle at the current time, degrees in [0, 360).
+  * @retval angle
+  */
+double AS5600Sim_TrueAngle(const AS5600Sim_TypeDef *sim)
+{
+  double a = fmod(sim->in_cnt / CNT_PER_DEG, 360.0);
+
+  return a < 0.0 ? a + 360.0 : a;
+}
+
+/**
+  * @brief  Field seen by the AGC, mT.
+  * @retval field
+  */
+double AS5600Sim_Field(const AS5600Sim_TypeDef *sim)
+{
+  return sim->field_agc;
+}
+
+static uint16_t Sim_Source(void *ctx)
+{
+  AS5600Sim_TypeDef *sim = ctx;
+  double now = (double)HostShim_Micros() * 1e-6;
+  uint16_t conf = (uint16_t)((AS5600Model_Peek(0x07) << 8) | AS5600Model_Peek(0x08));
+
+  if (conf != sim->cfg.conf) AS5600Sim_SetConf(sim, conf);
+  while (now - sim->t > ATTACH_STEP_S) AS5600Sim_Next(sim, ATTACH_STEP_S);
+  if (now > sim->t) AS5600Sim_Next(sim, now - sim->t);
+  AS5600Model_SetField((uint16_t)(sim->field_agc + 0.5));
+  return sim->raw;
+}
+
+/**
+  * @brief  Drive the register model from this simulator in host real time.
+  *         CONF writes through I2C take effect on the next read.
+  * @retval None
+  */
+void AS5600Sim_Attach(AS5600Sim_TypeDef *sim)
+{
+  AS5600Model_SetField((uint16_t)(sim->field_agc + 0.5));
+  AS5600Model_SetSource(Sim_Source, sim);
+}
@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file           : busbench_main.c
+  * @brief          : Host run of the bus benchmark (busbench.h) against the
+  *                   register model, CSV on stdout.
+  *
+  *  usage: busbench_host [samples]
+  *  The I2C shim does not wait for the bus here, cycles_per_sample is the
+  *  software cost on the host scaled to 84 MHz.
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "as5600_model.h"
+#include "busbench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+I2C_HandleTypeDef hi2c1;
+UART_HandleTypeDef huart2;
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler\n");
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t samples = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 100000U;
+
+  HAL_Init();
+  hi2c1.Instance = I2C1;
+  hi2c1.Init.ClockSpeed = 400000;
+  huart2.Instance = USART2;
+  huart2.Init.BaudRate = 115200;
+  AS5600Model_Erase();
+  AS5600Model_SetRawAngle(1234);
+  HostShim_SetI2cRealtime(0);
+
+  BusBench_Run(samples);
+  return 0;
+}
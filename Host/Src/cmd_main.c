@@ -0,0 +1,535 @@
+/**
+  ******************************************************************************
+  * @file           : cmd_main.c
+  * @brief          : Command line client of the runtime command interface
+  *                   (command.h).
+  *
+  *  usage: fwcmd (-d tty | -x "firmware command") [-v] command...
+  *    ping                          protocol version, uptime, samples
+  *    rate:<sample_us>:<telem_us>   task periods, 0 keeps one
+  *    output:<off|text|binary|stream>:<fields>
+  *                                  fields: APP_FIELD_xxx mask (app.h)
+  *    filter:<shift>:<vel_shift>
+  *    event:<0|1>:<deadband>:<heartbeat_ms>
+  *    decim:<off|cic|fir>:<ratio>:<order|taps>
+  *                                  0 order / taps picks the default
+  *    spectrum:<n>                  block length, 0 = off
+  *    order:<points>:<orders>       points per revolution, 0 = off
+  *    revstat:<0|1>:<hyst>:<acc_shift>
+  *                                  per-revolution records
+  *    alarm:<overspeed_rpm>:<stall_rpm>:<stall_ms>:<reversal>:<min>:<max>:<latch>:<read_errors>
+  *                                  alarm limits, 0 = off, window in counts
+  *    alarmclear                    release latched alarms
+  *    quad:<ppr>:<max_hz>           encoder emulation, 0 lines = off
+  *    servo:<loop_us>:<kp>:<ki>:<kd>:<kv>:<ka>:<d_shift>:<out_max>
+  *                                  position servo, 0 us = off, gains Q16
+  *    move:<target>:<vel>:<acc>     servo target Q4 counts, limits Q4/s and
+  *                                  Q4/s^2, 0 = step
+  *    commut:<pole_pairs>:<offset>:<lead_us>
+  *                                  electrical angle, 0 pole pairs = off
+  *    align:<samples>               electrical offset alignment
+  *    lagcomp:<0|1>:<trim_us>       latency compensation, trim may be < 0
+  *    oversample:<n>                RAW ANGLE readings per sample, 1 = off
+  *    median:<window>:<k10>:<floor> glitch filter, window 0 = off, k in
+  *                                  tenths of sigma, floor in counts
+  *    capture:<trig>:<level>:<vel>:<pre>:<post>:<timeout_ms>
+  *                                  timeout 1..10000 ms
+  *    perf:<page>:<index>           page 0 system, 1 task, 2 profile, 3 bus,
+  *                                  4 event, 5 decimation, 6 spectrum,
+  *                                  7 order, 8 revstat, 9 alarm, 10 quad,
+  *                                  11 servo, 12 commutation, 13 lagcomp,
+  *                                  14 oversampling, 15 glitch filter
+  *    perfreset
+  *    read:<reg>:<count>            AS5600 registers
+  *    write:<reg>:<byte>...
+  *    watch:<ms>                    print OUTPUT, STREAM, SPECTRUM, ORDER,
+  *                                  REVOLUTION and ALARM frames for a while
+  *  Numbers accept 0x prefixes. The firmware is pinged until it answers
+  *  before the first command; -v copies its text output to stdout.
+  *  Exit status: 0 every command succeeded, 1 an error reply or timeout,
+  *  2 usage.
+  ******************************************************************************
+  */
+
+#include "app.h"
+#include "command.h"
+#include "host_link.h"
+#include "stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+  uint8_t tag;
+  uint8_t got;
+  uint8_t status;
+  uint8_t len;
+  uint8_t data[TELEMETRY_MAX_PAYLOAD];
+  uint32_t outputs;     /* OUTPUT and STREAM frames seen while watching */
+  uint8_t watching;
+} Client_TypeDef;
+
+static const char *const status_names[] = { "ok", "length", "argument", "busy", "opcode", "bus", "unsupported" };
+static const char *const align_names[] = { "idle", "running", "done", "failed" };
+
+static uint32_t Get(const uint8_t *p, uint8_t n)
+{
+  uint32_t v = 0;
+
+  for (uint8_t i = 0; i < n; i++) v |= (uint32_t)p[i] << (8U * i);
+  return v;
+}
+
+static uint8_t *Put(uint8_t *p, uint32_t v, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++) *p++ = (uint8_t)(v >> (8U * i));
+  return p;
+}
+
+static void PrintOutput(const uint8_t *p, uint8_t len)
+{
+  uint16_t fields = (uint16_t)Get(&p[4], 2);
+  uint8_t k = 6;
+
+  printf("OUT %u", (unsigned)Get(p, 4));
+  if ((fields & APP_FIELD_RAW) && k + 2U <= len) { printf(" raw %u", (unsigned)Get(&p[k], 2)); k += 2; }
+  if ((fields & APP_FIELD_ANGLE) && k + 2U <= len) { printf(" deg %.2f", Get(&p[k], 2) / 100.0); k += 2; }
+  if ((fields & APP_FIELD_POS) && k + 4U <= len) { printf(" pos %d", (int)Get(&p[k], 4)); k += 4; }
+  if ((fields & APP_FIELD_FILT) && k + 4U <= len) { printf(" filt %d", (int)Get(&p[k], 4)); k += 4; }
+  if ((fields & APP_FIELD_VEL) && k + 4U <= len) { printf(" vel %d", (int)Get(&p[k], 4)); k += 4; }
+  if ((fields & APP_FIELD_HEALTH) && k + 2U <= len) { printf(" magnet %u agc %u", p[k], p[k + 1]); k += 2; }
+  if ((fields & APP_FIELD_EVENT) && k + 1U <= len) { printf(" event 0x%x", p[k]); k += 1; }
+  if ((fields & APP_FIELD_DECIM) && k + 4U <= len) { printf(" decim %d", (int)Get(&p[k], 4)); k += 4; }
+  if ((fields & APP_FIELD_COMP) && k + 4U <= len) printf(" comp %d", (int)Get(&p[k], 4));
+  printf("\n");
+}
+
+static void PrintStream(const uint8_t *p, uint8_t len)
+{
+  uint16_t raw[TELEMETRY_MAX_PAYLOAD];
+  uint32_t seq;
+  int n = Stream_Decode(p, len, &seq, raw, TELEMETRY_MAX_PAYLOAD);
+
+  if (n < 0)
+  {
+    printf("STREAM malformed\n");
+    return;
+  }
+  printf("STREAM %u+%d (%u bytes) raw", (unsigned)seq, n, len);
+  for (int i = 0; i < n; i++) printf(" %u", raw[i]);
+  printf("\n");
+}
+
+static void PrintSpectrum(const uint8_t *p, uint8_t len)
+{
+  uint32_t n = Get(&p[4], 2), period_us = Get(&p[6], 4);
+  const uint8_t *q = &p[10];
+
+  if (len != APP_SPECTRUM_FRAME_LEN || n == 0U || period_us == 0U)
+  {
+    printf("SPECTRUM malformed\n");
+    return;
+  }
+  printf("SPECTRUM %u n %u", (unsigned)Get(p, 4), (unsigned)n);
+  for (uint32_t k = 0; k < SPECTRUM_TOP_K; k++, q += 6)
+  {
+    if (Get(q, 2)) printf("  %.2f Hz %.3f", Get(q, 2) * 1e6 / (16.0 * n * period_us), Get(&q[2], 4) / 1000.0);
+  }
+  printf("  bands");
+  for (uint32_t b = 0; b < SPECTRUM_BANDS; b++, q += 4) printf(" %u", (unsigned)Get(q, 4));
+  printf("  %u cycles\n", (unsigned)Get(q, 4));
+}
+
+static void PrintOrder(const uint8_t *p, uint8_t len)
+{
+  uint32_t period_us = Get(&p[4], 4);
+  uint8_t k = len >= 11U ? p[10] : 0U;
+
+  if (k == 0U || len != APP_ORDER_FRAME_LEN(k))
+  {
+    printf("ORDER malformed\n");
+    return;
+  }
+  printf("ORDER %u  %.1f rpm  %u samples ", (unsigned)Get(p, 4), period_us ? 60e6 / period_us : 0.0,
+         (unsigned)Get(&p[8], 2));
+  for (uint32_t i = 0; i < k; i++) printf(" %.3f", Get(&p[11U + 4U * i], 4) / 1000.0);
+  printf("\n");
+}
+
+static void PrintRevolution(const uint8_t *p, uint8_t len)
+{
+  if (len != APP_REVSTAT_FRAME_LEN)
+  {
+    printf("REVOLUTION malformed\n");
+    return;
+  }
+  printf("REVOLUTION %u  %u us  %.2f rpm  ripple %.2f rpm  acc %d..%d rpm/s  %u samples\n", (unsigned)Get(p, 4),
+         (unsigned)Get(&p[4], 4), (int32_t)Get(&p[8], 4) / 100.0, Get(&p[12], 4) / 100.0, (int)Get(&p[16], 4),
+         (int)Get(&p[20], 4), (unsigned)Get(&p[24], 2));
+}
+
+static void PrintAlarm(const uint8_t *p, uint8_t len)
+{
+  static const char *const names[ALARM_KINDS] = { " overspeed", " stall", " reversal", " window", " sensor" };
+
+  if (len != APP_ALARM_FRAME_LEN)
+  {
+    printf("ALARM malformed\n");
+    return;
+  }
+  printf("ALARM");
+  for (uint32_t k = 0; k < ALARM_KINDS; k++)
+  {
+    if (p[8] & (1U << k)) printf("%s", names[k]);
+  }
+  printf("  output 0x%02x  %u ms  sample %u  pos %d  %.2f rpm  latency %u ns\n", p[9], (unsigned)Get(p, 4),
+         (unsigned)Get(&p[4], 4), (int)Get(&p[10], 4), (int32_t)Get(&p[14], 4) / 100.0, (unsigned)Get(&p[18], 4));
+}
+
+static void OnFrame(void *ctx, uint8_t type, const uint8_t *p, uint8_t len)
+{
+  Client_TypeDef *c = ctx;
+
+  if (type == TELEMETRY_FRAME_SPECTRUM)
+  {
+    c->outputs++;
+    if (c->watching) PrintSpectrum(p, len);
+    return;
+  }
+  if (type == TELEMETRY_FRAME_ALARM)
+  {
+    c->outputs++;
+    if (c->watching) PrintAlarm(p, len);
+    return;
+  }
+  if (type == TELEMETRY_FRAME_REVOLUTION)
+  {
+    c->outputs++;
+    if (c->watching) PrintRevolution(p, len);
+    return;
+  }
+  if (type == TELEMETRY_FRAME_ORDER)
+  {
+    c->outputs++;
+    if (c->watching) PrintOrder(p, len);
+    return;
+  }
+  if (type == TELEMETRY_FRAME_STREAM)
+  {
+    c->outputs++;
+    if (c->watching) PrintStream(p, len);
+    return;
+  }
+  if (type == TELEMETRY_FRAME_OUTPUT && len >= 6U)
+  {
+    c->outputs++;
+    if (c->watching) PrintOutput(p, len);
+    return;
+  }
+  if (type != TELEMETRY_FRAME_REPLY || len < 3U || p[0] != c->tag) return;
+  c->got = 1;
+  c->status = p[2];
+  c->len = (uint8_t)(len - 3U);
+  memcpy(c->data, &p[3], c->len);
+}
+
+/* send and wait for the reply with the same tag */
+static int Request(HostLink_TypeDef *link, Client_TypeDef *c, const uint8_t *req, uint8_t len, int timeout_ms)
+{
+  uint8_t p[TELEMETRY_MAX_PAYLOAD];
+  double end = HostLink_Now() + timeout_ms * 1e-3;
+
+  c->tag++;
+  c->got = 0;
+  p[0] = c->tag;
+  memcpy(&p[1], req, len);
+  if (HostLink_Send(link, TELEMETRY_FRAME_CMD, p, (uint8_t)(len + 1U)) != 0) return -1;
+  while (!c->got && HostLink_Now() < end)
+  {
+    if (HostLink_Poll(link, 5, OnFrame, c) < 0) return -1;
+  }
+  return c->got ? 0 : -1;
+}
+
+static void PrintReply(uint8_t op, const Client_TypeDef *c, const uint8_t *req)
+{
+  const uint8_t *d = c->data;
+
+  if (c->status != CMD_OK)
+  {
+    printf("error: %s\n", c->status < 7U ? status_names[c->status] : "?");
+    return;
+  }
+  switch (op)
+  {
+    case CMD_PING:
+      printf("version %u  tick %u ms  samples %u\n", d[0], (unsigned)Get(&d[1], 4), (unsigned)Get(&d[5], 4));
+      break;
+    case CMD_PERF:
+      if (req[1] == CMD_PERF_SYSTEM)
+        printf("samples %u  i2c_errors %u  misses %u  load %u permille  tx_dropped %u  rx_frames %u  rx_bad %u\n",
+               (unsigned)Get(d, 4), (unsigned)Get(&d[4], 4), (unsigned)Get(&d[8], 4), (unsigned)Get(&d[12], 2),
+               (unsigned)Get(&d[14], 4), (unsigned)Get(&d[18], 4), (unsigned)Get(&d[22], 4));
+      else if (req[1] == CMD_PERF_TASK)
+        printf("period %u us  runs %u  misses %u  max %u cycles\n",
+               (unsigned)Get(d, 4), (unsigned)Get(&d[4], 4), (unsigned)Get(&d[8], 4), (unsigned)Get(&d[12], 4));
+      else if (req[1] == CMD_PERF_PROFILE)
+        printf("count %u  min %u  max %u  mean %u cycles\n",
+               (unsigned)Get(d, 4), (unsigned)Get(&d[4], 4), (unsigned)Get(&d[8], 4), (unsigned)Get(&d[12], 4));
+      else if (req[1] == CMD_PERF_DECIM)
+        printf("kind %u  ratio %u  order %u  taps %u  resolution %+.3f bit  period %u us  inputs %u  outputs %u\n",
+               d[0], d[1], d[2], d[3], (int16_t)Get(&d[4], 2) / 1000.0, (unsigned)Get(&d[6], 4),
+               (unsigned)Get(&d[10], 4), (unsigned)Get(&d[14], 4));
+      else if (req[1] == CMD_PERF_SPECTRUM)
+        printf("n %u  blocks %u  overruns %u  cycles %u  max %u\n", (unsigned)Get(d, 2), (unsigned)Get(&d[2], 4),
+               (unsigned)Get(&d[6], 4), (unsigned)Get(&d[10], 4), (unsigned)Get(&d[14], 4));
+      else if (req[1] == CMD_PERF_ALARM)
+        printf("output 0x%02x  latched 0x%02x  events %u  overflows %u  latency last %u  max %u  mean %u ns\n",
+               d[0], d[1], (unsigned)Get(&d[2], 4), (unsigned)Get(&d[6], 4), (unsigned)Get(&d[10], 4),
+               (unsigned)Get(&d[14], 4), (unsigned)Get(&d[18], 4));
+      else if (req[1] == CMD_PERF_QUAD)
+        printf("ppr %u  position %d edges  limited %u  dropped %u  late %u  latency last %u  max %u  mean %u ns\n",
+               (unsigned)Get(d, 2), (int)Get(&d[2], 4), (unsigned)Get(&d[6], 4), (unsigned)Get(&d[10], 4),
+               (unsigned)Get(&d[14], 4), (unsigned)Get(&d[18], 4), (unsigned)Get(&d[22], 4), (unsigned)Get(&d[26], 4));
+      else if (req[1] == CMD_PERF_SERVO)
+        printf("loops %u  error %.2f counts  output %d  overruns %u  read_errors %u  jitter %u ns  isr max %u  mean %u cycles\n",
+               (unsigned)Get(d, 4), (int32_t)Get(&d[4], 4) / 16.0, (int16_t)Get(&d[8], 2), (unsigned)Get(&d[10], 4),
+               (unsigned)Get(&d[14], 4), (unsigned)Get(&d[18], 4), (unsigned)Get(&d[22], 4), (unsigned)Get(&d[26], 4));
+      else if (req[1] == CMD_PERF_COMMUT)
+        printf("pole_pairs %u  align %s  offset %u  angle %.2f deg  sin %d  cos %d  speed %.2f rpm  samples %u  cycles %u\n",
+               d[0], d[1] < 4U ? align_names[d[1]] : "?", (unsigned)Get(&d[2], 2), Get(&d[4], 2) * 360.0 / 65536.0,
+               (int16_t)Get(&d[6], 2), (int16_t)Get(&d[8], 2), (int32_t)Get(&d[10], 4) / 100.0,
+               (unsigned)Get(&d[14], 4), (unsigned)Get(&d[18], 4));
+      else if (req[1] == CMD_PERF_LAGCOMP)
+        printf("enabled %u  conf 0x%04x  model delay %.1f us  age %.1f us  max %.1f us  pos %.2f  comp %.2f counts\n",
+               d[0], (unsigned)Get(&d[1], 2), (int32_t)Get(&d[3], 4) / 1000.0, Get(&d[7], 4) / 1000.0,
+               Get(&d[11], 4) / 1000.0, (int32_t)Get(&d[15], 4) / 16.0, (int32_t)Get(&d[19], 4) / 16.0);
+      else if (req[1] == CMD_PERF_OVERSAMPLE)
+        printf("n %u  angle %.4f deg  sigma %.2f  noise %.2f counts  spread %u  burst %.1f us  bursts %u\n",
+               (unsigned)Get(d, 2), Get(&d[2], 2) * 360.0 / 65536.0, Get(&d[4], 2) / 16.0, Get(&d[6], 2) / 16.0,
+               (unsigned)Get(&d[8], 2), Get(&d[10], 4) / 1000.0, (unsigned)Get(&d[14], 4));
+      else if (req[1] == CMD_PERF_MEDIAN)
+        printf("window %u  k %.1f  floor %u  samples %u  outliers %u  resyncs %u  median speed %d  threshold %u\n",
+               d[0], d[1] / 10.0, (unsigned)Get(&d[2], 2), (unsigned)Get(&d[4], 4), (unsigned)Get(&d[8], 4),
+               (unsigned)Get(&d[12], 4), (int16_t)Get(&d[16], 2), (unsigned)Get(&d[18], 2));
+      else if (req[1] == CMD_PERF_REVSTAT)
+        printf("enabled %u  revolutions %u  aborts %u  overflows %u\n", d[0], (unsigned)Get(&d[1], 4),
+               (unsigned)Get(&d[5], 4), (unsigned)Get(&d[9], 4));
+      else if (req[1] == CMD_PERF_ORDER)
+        printf("points %u  orders %u  revolutions %u  restarts %u  period %u us\n", (unsigned)Get(d, 2), d[2],
+               (unsigned)Get(&d[3], 4), (unsigned)Get(&d[7], 4), (unsigned)Get(&d[11], 4));
+      else if (req[1] == CMD_PERF_EVENT)
+        printf("checked %u  suppressed %u  moves %u  status %u  heartbeats %u  overflows %u\n",
+               (unsigned)Get(d, 4), (unsigned)Get(&d[4], 4), (unsigned)Get(&d[8], 4), (unsigned)Get(&d[12], 4),
+               (unsigned)Get(&d[16], 4), (unsigned)Get(&d[20], 4));
+      else
+        printf("transactions %u  restarts %u  bytes %u  errors %u\n",
+               (unsigned)Get(d, 4), (unsigned)Get(&d[4], 4), (unsigned)Get(&d[8], 4), (unsigned)Get(&d[12], 4));
+      break;
+    case CMD_REG_READ:
+      for (uint8_t i = 0; i < c->len; i++) printf("%s%02x", i ? " " : "", d[i]);
+      printf("\n");
+      break;
+    default:
+      printf("ok\n");
+      break;
+  }
+}
+
+/* split "name:a:b..." into op and argument bytes */
+static int Encode(const char *arg, uint8_t *req, uint8_t *len, int *watch_ms)
+{
+  char buf[256], *tok, *save;
+  uint32_t v[20];
+  int n = 0;
+  uint8_t *p = req;
+
+  snprintf(buf, sizeof(buf), "%s", arg);
+  tok = strtok_r(buf, ":", &save);
+  if (!tok) return -1;
+  for (char *a; n < 20 && (a = strtok_r(NULL, ":", &save)) != NULL; n++)
+  {
+    if (!strcmp(a, "off")) v[n] = APP_OUT_OFF;
+    else if (!strcmp(a, "text")) v[n] = APP_OUT_TEXT;
+    else if (!strcmp(a, "binary")) v[n] = APP_OUT_BINARY;
+    else if (!strcmp(a, "stream")) v[n] = APP_OUT_STREAM;
+    else if (!strcmp(a, "cic")) v[n] = DECIM_CIC;
+    else if (!strcmp(a, "fir")) v[n] = DECIM_FIR;
+    else v[n] = (uint32_t)strtoul(a, NULL, 0);
+  }
+
+  *watch_ms = 0;
+  if (!strcmp(tok, "ping") && n == 0) *p++ = CMD_PING;
+  else if (!strcmp(tok, "rate") && n == 2) { *p++ = CMD_SET_RATE; p = Put(p, v[0], 4); p = Put(p, v[1], 4); }
+  else if (!strcmp(tok, "output") && n == 2) { *p++ = CMD_SET_OUTPUT; *p++ = (uint8_t)v[0]; p = Put(p, v[1], 2); }
+  else if (!strcmp(tok, "filter") && n == 2) { *p++ = CMD_SET_FILTER; *p++ = (uint8_t)v[0]; *p++ = (uint8_t)v[1]; }
+  else if (!strcmp(tok, "event") && n == 3)
+  {
+    *p++ = CMD_SET_EVENT;
+    *p++ = (uint8_t)v[0];
+    p = Put(p, v[1], 2);
+    p = Put(p, v[2], 4);
+  }
+  else if (!strcmp(tok, "decim") && n == 3)
+  {
+    *p++ = CMD_SET_DECIM;
+    *p++ = (uint8_t)v[0];
+    *p++ = (uint8_t)v[1];
+    *p++ = (uint8_t)v[2];
+  }
+  else if (!strcmp(tok, "spectrum") && n == 1) { *p++ = CMD_SET_SPECTRUM; p = Put(p, v[0], 2); }
+  else if (!strcmp(tok, "alarm") && n == 8)
+  {
+    *p++ = CMD_SET_ALARM;
+    for (int i = 0; i < 4; i++) p = Put(p, v[i], 2);
+    p = Put(p, v[4], 4);
+    p = Put(p, v[5], 4);
+    *p++ = (uint8_t)v[6];
+    *p++ = (uint8_t)v[7];
+  }
+  else if (!strcmp(tok, "alarmclear") && n == 0) *p++ = CMD_ALARM_CLEAR;
+  else if (!strcmp(tok, "quad") && n == 2) { *p++ = CMD_SET_QUAD; p = Put(p, v[0], 2); p = Put(p, v[1], 4); }
+  else if (!strcmp(tok, "servo") && n == 8)
+  {
+    *p++ = CMD_SET_SERVO;
+    p = Put(p, v[0], 2);
+    for (int i = 1; i < 6; i++) p = Put(p, v[i], 4);
+    *p++ = (uint8_t)v[6];
+    p = Put(p, v[7], 2);
+  }
+  else if (!strcmp(tok, "move") && n == 3)
+  {
+    *p++ = CMD_SERVO_MOVE;
+    for (int i = 0; i < 3; i++) p = Put(p, v[i], 4);
+  }
+  else if (!strcmp(tok, "commut") && n == 3)
+  {
+    *p++ = CMD_SET_COMMUT;
+    *p++ = (uint8_t)v[0];
+    p = Put(p, v[1], 2);
+    p = Put(p, v[2], 2);
+  }
+  else if (!strcmp(tok, "align") && n == 1) { *p++ = CMD_COMMUT_ALIGN; p = Put(p, v[0], 2); }
+  else if (!strcmp(tok, "oversample") && n == 1) { *p++ = CMD_SET_OVERSAMPLE; p = Put(p, v[0], 2); }
+  else if (!strcmp(tok, "median") && n == 3)
+  {
+    *p++ = CMD_SET_MEDIAN;
+    *p++ = (uint8_t)v[0];
+    *p++ = (uint8_t)v[1];
+    p = Put(p, v[2], 2);
+  }
+  else if (!strcmp(tok, "lagcomp") && n == 2) { *p++ = CMD_SET_LAGCOMP; *p++ = (uint8_t)v[0]; p = Put(p, v[1], 2); }
+  else if (!strcmp(tok, "revstat") && n == 3)
+  {
+    *p++ = CMD_SET_REVSTAT;
+    *p++ = (uint8_t)v[0];
+    p = Put(p, v[1], 2);
+    *p++ = (uint8_t)v[2];
+  }
+  else if (!strcmp(tok, "order") && n == 2) { *p++ = CMD_SET_ORDER; p = Put(p, v[0], 2); *p++ = (uint8_t)v[1]; }
+  else if (!strcmp(tok, "capture") && n == 6)
+  {
+    *p++ = CMD_CAPTURE;
+    *p++ = (uint8_t)v[0];
+    p = Put(p, v[1], 2);
+    p = Put(p, v[2], 2);
+    p = Put(p, v[3], 4);
+    p = Put(p, v[4], 4);
+    p = Put(p, v[5], 4);
+  }
+  else if (!strcmp(tok, "perf") && n == 2) { *p++ = CMD_PERF; *p++ = (uint8_t)v[0]; *p++ = (uint8_t)v[1]; }
+  else if (!strcmp(tok, "perfreset") && n == 0) *p++ = CMD_PERF_RESET;
+  else if (!strcmp(tok, "read") && n == 2) { *p++ = CMD_REG_READ; *p++ = (uint8_t)v[0]; *p++ = (uint8_t)v[1]; }
+  else if (!strcmp(tok, "write") && n >= 2)
+  {
+    *p++ = CMD_REG_WRITE;
+    for (int i = 0; i < n; i++) *p++ = (uint8_t)v[i];
+  }
+  else if (!strcmp(tok, "watch") && n == 1) *watch_ms = (int)v[0];
+  else return -1;
+  *len = (uint8_t)(p - req);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *dev = NULL, *cmd = NULL;
+  Client_TypeDef c = { 0 };
+  HostLink_TypeDef link;
+  uint8_t ping = CMD_PING;
+  int opt, rc = 0, verbose = 0, i;
+
+  while ((opt = getopt(argc, argv, "d:x:v")) != -1)
+  {
+    switch (opt)
+    {
+      case 'd': dev = optarg; break;
+      case 'x': cmd = optarg; break;
+      case 'v': verbose = 1; break;
+      default: dev = cmd = NULL; break;
+    }
+  }
+  if (!dev == !cmd || optind >= argc)
+  {
+    fprintf(stderr, "usage: %s (-d tty | -x \"firmware command\") [-v] command...\n", argv[0]);
+    return 2;
+  }
+  for (i = optind; i < argc; i++)
+  {
+    uint8_t req[TELEMETRY_MAX_PAYLOAD], len;
+
+    if (Encode(argv[i], req, &len, &opt) != 0)
+    {
+      fprintf(stderr, "%s: bad command\n", argv[i]);
+      return 2;
+    }
+  }
+  if (HostLink_Open(&link, dev, cmd) != 0)
+  {
+    perror(cmd ? "pty" : dev);
+    return 2;
+  }
+  link.echo_text = (uint8_t)verbose;
+
+  for (i = 0; i < 100 && Request(&link, &c, &ping, 1, 100) != 0; i++) {}
+  if (i == 100)
+  {
+    fprintf(stderr, "no reply from the firmware\n");
+    HostLink_Close(&link);
+    return 1;
+  }
+
+  for (i = optind; i < argc; i++)
+  {
+    uint8_t req[TELEMETRY_MAX_PAYLOAD], len;
+    int watch_ms;
+
+    Encode(argv[i], req, &len, &watch_ms);
+    printf("%s: ", argv[i]);
+    if (watch_ms)
+    {
+      double end = HostLink_Now() + watch_ms * 1e-3;
+
+      printf("\n");
+      c.watching = 1;
+      c.outputs = 0;
+      while (HostLink_Now() < end && HostLink_Poll(&link, 5, OnFrame, &c) >= 0) {}
+      c.watching = 0;
+      printf("%u frames\n", (unsigned)c.outputs);
+      continue;
+    }
+    /* register accesses wait for slack in the sample task */
+    if (Request(&link, &c, req, len, 2000) != 0)
+    {
+      printf("timeout\n");
+      rc = 1;
+      continue;
+    }
+    PrintReply(req[0], &c, req);
+    if (c.status != CMD_OK) rc = 1;
+  }
+  HostLink_Close(&link);
+  return rc;
+}
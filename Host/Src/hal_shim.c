@@ -0,0 +1,498 @@
+/**
+  ******************************************************************************
+  * @file           : hal_shim.c
+  * @brief          : Host implementation of the HAL subset used by the
+  *                   driver and the application (see stm32f4xx_hal.h).
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE   /* ppoll */
+#include "stm32f4xx_hal.h"
+#include "as5600_model.h"
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+uint32_t SystemCoreClock = 84000000U;
+volatile uint32_t host_primask;
+CoreDebug_Type host_coredebug;
+GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc = { .IDR = GPIO_PIN_13 }, host_gpioh;
+I2C_TypeDef host_i2c1;
+USART_TypeDef host_usart2;
+TIM_TypeDef host_tim2, host_tim3, host_tim4, host_tim5;
+
+/* CubeMX handles, defined by main.c on the target; tools without a main.c
+   counterpart get these */
+__attribute__((weak)) I2C_HandleTypeDef hi2c1 = { I2C1, { 400000U } };
+__attribute__((weak)) UART_HandleTypeDef huart2 = { USART2, { 115200U } };
+__attribute__((weak)) TIM_HandleTypeDef htim2 = { TIM2, { 0U, 0xFFFFFFFFU } };
+__attribute__((weak)) TIM_HandleTypeDef htim3 = { TIM3, { 0U, 4199U } };
+__attribute__((weak)) TIM_HandleTypeDef htim4 = { TIM4, { 83U, 999U } };
+__attribute__((weak)) TIM_HandleTypeDef htim5 = { TIM5, { 0U, 0xFFFFFFFFU } };
+
+static DWT_Type host_dwt;
+static uint64_t t0_ns;
+static int uart_fd = 1;
+static int uart_rx_fd = -1;
+static uint8_t i2c_realtime = 1;
+
+/* one outstanding UART DMA transfer, completed by time */
+static UART_HandleTypeDef *dma_huart;
+static uint64_t dma_done_us;
+static uint64_t button_release_us;
+static uint8_t in_service;
+
+/* circular "DMA" reception from uart_rx_fd, paced at the baud rate */
+static UART_HandleTypeDef *rx_huart;
+static uint8_t *rx_buf;
+static uint16_t rx_size, rx_pos;
+static uint64_t rx_free_ns;   /* end of the last character on the line */
+
+/* running timers, their update events delivered by time */
+#define HOST_TIM_MAX  4U
+static struct
+{
+  TIM_HandleTypeDef *h;
+  uint64_t t0;                /* timer ticks at the last update or counter write */
+} tim_run[HOST_TIM_MAX];
+
+static void HostShim_UartRxService(void);
+static void HostShim_TimService(void);
+static uint64_t HostShim_TimDueUs(uint64_t limit);
+
+static uint64_t HostShim_Nanos(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec - t0_ns;
+}
+
+/**
+  * @brief  Microseconds since HAL_Init().
+  */
+uint64_t HostShim_Micros(void)
+{
+  return HostShim_Nanos() / 1000U;
+}
+
+/* deliver the pending "interrupts" unless masked */
+static void HostShim_Service(void)
+{
+  uint64_t now;
+
+  if (host_primask || in_service) return;
+  in_service = 1;
+  now = HostShim_Micros();
+  if (dma_huart && now >= dma_done_us)
+  {
+    UART_HandleTypeDef *huart = dma_huart;
+
+    dma_huart = NULL;
+    HAL_UART_TxCpltCallback(huart);
+  }
+  HostShim_UartRxService();
+  HostShim_TimService();
+  if (button_release_us && now >= button_release_us)
+  {
+    button_release_us = 0;
+    host_gpioc.IDR |= GPIO_PIN_13;
+  }
+  in_service = 0;
+}
+
+static void HostShim_SpinUntil(uint64_t t_us)
+{
+  while (HostShim_Micros() < t_us) {}
+}
+
+/* bus time of n bits, in microseconds, rounded up */
+static uint64_t HostShim_BitsUs(uint32_t bits, uint32_t rate)
+{
+  return ((uint64_t)bits * 1000000U + rate - 1U) / rate;
+}
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+  t0_ns = 0;
+  t0_ns = HostShim_Nanos();
+  return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  HostShim_Service();
+  return (uint32_t)(HostShim_Micros() / 1000U);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  uint32_t start = HAL_GetTick();
+
+  while (HAL_GetTick() - start < Delay) HostShim_Wfi();
+}
+
+void HAL_SuspendTick(void) {}
+void HAL_ResumeTick(void) {}
+
+DWT_Type *HostShim_Dwt(void)
+{
+  HostShim_Service();
+  if (host_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk)
+    host_dwt.CYCCNT = (uint32_t)((HostShim_Nanos() * (SystemCoreClock / 1000000U)) / 1000U);
+  return &host_dwt;
+}
+
+/**
+  * @brief  Sleep until the next 1 ms tick or the next pending completion.
+  */
+void HostShim_Wfi(void)
+{
+  uint64_t now = HostShim_Micros();
+  uint64_t wake = (now / 1000U + 1U) * 1000U;
+  struct timespec ts;
+
+  if (dma_huart && dma_done_us < wake) wake = dma_done_us;
+  wake = HostShim_TimDueUs(wake);
+  if (wake > now)
+  {
+    ts.tv_sec = 0;
+    ts.tv_nsec = (long)((wake - now) * 1000U);
+    if (rx_huart && uart_rx_fd >= 0)
+    {
+      /* a received character is an interrupt too */
+      struct pollfd pfd = { .fd = uart_rx_fd, .events = POLLIN };
+
+      ppoll(&pfd, 1, &ts, NULL);
+    }
+    else
+    {
+      nanosleep(&ts, NULL);
+    }
+  }
+  HostShim_Service();
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  HostShim_Service();
+  return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if (PinState != GPIO_PIN_RESET)
+    GPIOx->ODR |= GPIO_Pin;
+  else
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+}
+
+/**
+  * @brief  Pull the user button (PC13, active low) for ms milliseconds.
+  */
+void HostShim_PressButton(uint32_t ms)
+{
+  host_gpioc.IDR &= ~(uint32_t)GPIO_PIN_13;
+  button_release_us = HostShim_Micros() + (uint64_t)ms * 1000U;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+  return hi2c->Init.ClockSpeed ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  1: I2C transfers take their bus time (default), 0: return at once.
+  */
+void HostShim_SetI2cRealtime(uint8_t on)
+{
+  i2c_realtime = on;
+}
+
+/* start + 9 bits per byte (address included) + stop, at the bus clock */
+static void HostShim_I2cWait(I2C_HandleTypeDef *hi2c, uint16_t Size)
+{
+  if (!i2c_realtime) return;
+  HostShim_SpinUntil(HostShim_Micros() + HostShim_BitsUs(2U + 9U * (Size + 1U), hi2c->Init.ClockSpeed));
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                          uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  (void)Timeout;
+  if (hi2c->Instance != I2C1) return HAL_ERROR;
+  HostShim_I2cWait(hi2c, Size);
+  if ((DevAddress >> 1) != AS5600_MODEL_ADDR) return HAL_ERROR;   /* address NACK */
+  return AS5600Model_Write(pData, Size) == 0 ? HAL_OK : HAL_ERROR;
+}
+
+/* the read phase after head bytes on the wire (addresses, register); in
+   real time every byte is taken from the model when it has gone out, so
+   the output registers are sampled along a long burst as by the sensor */
+static HAL_StatusTypeDef HostShim_I2cRead(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint16_t head)
+{
+  uint64_t t0;
+
+  if (!i2c_realtime)
+  {
+    if ((DevAddress >> 1) != AS5600_MODEL_ADDR) return HAL_ERROR;
+    return AS5600Model_Read(pData, Size) == 0 ? HAL_OK : HAL_ERROR;
+  }
+  t0 = HostShim_Micros();
+  HostShim_SpinUntil(t0 + HostShim_BitsUs(2U + 9U * (head + 1U), hi2c->Init.ClockSpeed));
+  if ((DevAddress >> 1) != AS5600_MODEL_ADDR) return HAL_ERROR;
+  if (AS5600Model_Read(pData, Size ? 1U : 0U) != 0) return HAL_ERROR;
+  for (uint16_t i = 1; i < Size; i++)
+  {
+    HostShim_SpinUntil(t0 + HostShim_BitsUs(2U + 9U * (head + 1U + i), hi2c->Init.ClockSpeed));
+    if (AS5600Model_ReadMore(&pData[i], 1) != 0) return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress,
+                                         uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  (void)Timeout;
+  if (hi2c->Instance != I2C1) return HAL_ERROR;
+  return HostShim_I2cRead(hi2c, DevAddress, pData, Size, 1U);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  uint8_t reg = (uint8_t)MemAddress;
+
+  (void)Timeout;
+  if (hi2c->Instance != I2C1 || MemAddSize != I2C_MEMADD_SIZE_8BIT) return HAL_ERROR;
+  /* register phase and read phase joined by a repeated START */
+  if ((DevAddress >> 1) == AS5600_MODEL_ADDR && AS5600Model_Write(&reg, 1) != 0) return HAL_ERROR;
+  return HostShim_I2cRead(hi2c, DevAddress, pData, Size, 3U);
+}
+
+/**
+  * @brief  Destination of USART2 output (stdout by default).
+  */
+void HostShim_SetUartFd(int fd)
+{
+  uart_fd = fd;
+}
+
+/**
+  * @brief  Source of USART2 input (none by default), e.g. a pty.
+  */
+void HostShim_SetUartRxFd(int fd)
+{
+  uart_rx_fd = fd;
+}
+
+static void HostShim_UartOut(const uint8_t *pData, uint16_t Size)
+{
+  while (Size)
+  {
+    ssize_t n = write(uart_fd, pData, Size);
+
+    if (n <= 0) return;
+    pData += n;
+    Size -= (uint16_t)n;
+  }
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+  return huart->Init.BaudRate ? HAL_OK : HAL_ERROR;
+}
+
+/* 8N1: 10 bit times per character */
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData,
+                                    uint16_t Size, uint32_t Timeout)
+{
+  (void)Timeout;
+  if (dma_huart == huart) return HAL_BUSY;
+  HostShim_UartOut(pData, Size);
+  HostShim_SpinUntil(HostShim_Micros() + HostShim_BitsUs(10U * Size, huart->Init.BaudRate));
+  return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  (void)huart;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+  if (dma_huart) return HAL_BUSY;
+  HostShim_UartOut(pData, Size);
+  dma_huart = huart;
+  dma_done_us = HostShim_Micros() + HostShim_BitsUs(10U * Size, huart->Init.BaudRate);
+  return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  (void)huart;
+  (void)Size;
+}
+
+/* circular mode only: every chunk read from the fd ends with an idle-line
+   event at the current position, the wrap with a transfer-complete one */
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+  if (rx_huart || Size == 0U) return HAL_BUSY;
+  rx_buf = pData;
+  rx_size = Size;
+  rx_pos = 0;
+  rx_free_ns = HostShim_Nanos();
+  rx_huart = huart;
+  return HAL_OK;
+}
+
+static void HostShim_UartRxService(void)
+{
+  struct pollfd pfd = { .fd = uart_rx_fd, .events = POLLIN };
+  uint64_t now, char_ns, avail;
+  uint16_t room;
+  ssize_t n;
+
+  if (!rx_huart || uart_rx_fd < 0) return;
+  now = HostShim_Nanos();
+  char_ns = 10000000000ULL / rx_huart->Init.BaudRate;
+  if (rx_free_ns + char_ns < now) rx_free_ns = now - char_ns;   /* idle line */
+  avail = (now - rx_free_ns) / char_ns;
+  if (avail == 0U || poll(&pfd, 1, 0) <= 0) return;
+
+  room = (uint16_t)(rx_size - rx_pos);
+  n = read(uart_rx_fd, &rx_buf[rx_pos], avail < room ? (size_t)avail : room);
+  if (n <= 0)
+  {
+    uart_rx_fd = -1;   /* other end closed */
+    return;
+  }
+  rx_free_ns += (uint64_t)n * char_ns;
+  rx_pos = (uint16_t)(rx_pos + n);
+  HAL_UARTEx_RxEventCallback(rx_huart, rx_pos);
+  if (rx_pos == rx_size) rx_pos = 0;
+}
+
+static uint64_t HostShim_TimTicks(const TIM_HandleTypeDef *htim)
+{
+  return HostShim_Nanos() * (SystemCoreClock / 1000000U) / 1000U / (htim->Init.Prescaler + 1U);
+}
+
+static int HostShim_TimFind(const TIM_HandleTypeDef *htim)
+{
+  for (uint32_t i = 0; i < HOST_TIM_MAX; i++)
+  {
+    if (tim_run[i].h == htim) return (int)i;
+  }
+  return -1;
+}
+
+/* microseconds at the next update event of the running timers, rounded up,
+   or limit when that is earlier */
+static uint64_t HostShim_TimDueUs(uint64_t limit)
+{
+  uint64_t per_us = SystemCoreClock / 1000000U;
+
+  for (uint32_t i = 0; i < HOST_TIM_MAX; i++)
+  {
+    const TIM_HandleTypeDef *htim = tim_run[i].h;
+    uint64_t due, us;
+
+    if (htim == NULL) continue;
+    due = tim_run[i].t0 + (uint64_t)htim->Instance->ARR + 1U;
+    us = (due * (htim->Init.Prescaler + 1U) + per_us - 1U) / per_us;
+    if (us < limit) limit = us;
+  }
+  return limit;
+}
+
+/* the period in effect is the one in ARR when it ends, as without preload;
+   a callback may stop or restart any timer */
+static void HostShim_TimService(void)
+{
+  for (uint32_t i = 0; i < HOST_TIM_MAX; i++)
+  {
+    while (tim_run[i].h)
+    {
+      TIM_HandleTypeDef *htim = tim_run[i].h;
+      uint64_t due = tim_run[i].t0 + (uint64_t)htim->Instance->ARR + 1U;
+
+      if (HostShim_TimTicks(htim) < due) break;
+      tim_run[i].t0 = due;
+      HAL_TIM_PeriodElapsedCallback(htim);
+    }
+  }
+}
+
+__attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  (void)htim;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+  int i = HostShim_TimFind(htim);
+
+  if (i >= 0) return HAL_BUSY;
+  i = HostShim_TimFind(NULL);
+  if (i < 0) return HAL_ERROR;
+  htim->Instance->ARR = htim->Init.Period;
+  tim_run[i].t0 = HostShim_TimTicks(htim) - htim->Instance->CNT;
+  tim_run[i].h = htim;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+  int i = HostShim_TimFind(htim);
+
+  if (i < 0) return HAL_ERROR;
+  htim->Instance->CNT = HostShim_TimGetCounter(htim);
+  tim_run[i].h = NULL;
+  return HAL_OK;
+}
+
+/* the PWM output is the compare value itself, no interrupt */
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  if (Channel != TIM_CHANNEL_1) return HAL_ERROR;
+  htim->Instance->ARR = htim->Init.Period;
+  htim->Instance->CCER |= TIM_CCER_CC1E;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  if (Channel != TIM_CHANNEL_1) return HAL_ERROR;
+  htim->Instance->CCER &= ~TIM_CCER_CC1E;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Counter of a timer, running or stopped.
+  */
+uint32_t HostShim_TimGetCounter(TIM_HandleTypeDef *htim)
+{
+  int i = HostShim_TimFind(htim);
+
+  if (i < 0) return htim->Instance->CNT;
+  return (uint32_t)(HostShim_TimTicks(htim) - tim_run[i].t0);
+}
+
+/**
+  * @brief  Restart the current period of a timer at cnt.
+  */
+void HostShim_TimSetCounter(TIM_HandleTypeDef *htim, uint32_t cnt)
+{
+  int i = HostShim_TimFind(htim);
+
+  htim->Instance->CNT = cnt;
+  if (i >= 0) tim_run[i].t0 = HostShim_TimTicks(htim) - cnt;
+}
@@ -0,0 +1,218 @@
+/**
+  ******************************************************************************
+  * @file           : hil_main.c
+  * @brief          : Host side of the trajectory injection (hil.h): streams
+  *                   raw angles to the firmware over a serial line or a pty.
+  *
+  *  usage: hil_inject (-d tty | -x "firmware command") [-n samples] [-r rpm]
+  *                    [-i file] [-v]
+  *    -d  serial device of a board (115200 8N1)
+  *    -x  start a host-built firmware on a new pty, the command gets
+  *        "-u <pty>" appended, e.g. -x "./build/firmware_host -t 30"
+  *    -n  trajectory length in samples (default 5000)
+  *    -r  simulated magnet speed, as5600_sim.h (default 60)
+  *    -i  raw angles from a file instead: one per line, or as5600_sim -o CSV
+  *    -v  copy the firmware's text output to stdout
+  *
+  *  Flow control uses the HIL_STATUS frames: at most 3/4 of the firmware
+  *  FIFO is in flight. The summary reports the sample rate the firmware
+  *  consumed at and the underruns before the end of the trajectory.
+  *  Exit status: 0 clean run, 1 underruns, gaps or overflows, 2 setup error.
+  ******************************************************************************
+  */
+
+#include "as5600_sim.h"
+#include "hil.h"
+#include "host_link.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HIL_IN_FLIGHT  (HIL_FIFO_SIZE - HIL_FIFO_SIZE / 4U)
+
+typedef struct
+{
+  uint32_t consumed, next_seq, underruns;
+  uint16_t level, gaps, overflows;
+  uint8_t  active;
+  double   t;          /* host time of reception */
+} Status_TypeDef;
+
+typedef struct
+{
+  uint32_t total;
+  uint8_t  started;
+  uint32_t before_end;            /* underruns before the last value */
+  Status_TypeDef st, first, last;
+} Run_TypeDef;
+
+static uint32_t Get(const uint8_t *p, uint8_t n)
+{
+  uint32_t v = 0;
+
+  for (uint8_t i = 0; i < n; i++) v |= (uint32_t)p[i] << (8U * i);
+  return v;
+}
+
+static void OnFrame(void *ctx, uint8_t type, const uint8_t *p, uint8_t len)
+{
+  Run_TypeDef *run = ctx;
+  Status_TypeDef *st = &run->st;
+
+  if (type != TELEMETRY_FRAME_HIL_STATUS || len != HIL_STATUS_LEN) return;
+  st->consumed = Get(&p[0], 4);
+  st->next_seq = Get(&p[4], 4);
+  st->underruns = Get(&p[8], 4);
+  st->level = (uint16_t)Get(&p[12], 2);
+  st->gaps = (uint16_t)Get(&p[14], 2);
+  st->overflows = (uint16_t)Get(&p[16], 2);
+  st->active = p[18];
+  st->t = HostLink_Now();
+
+  if (st->active && !run->started)
+  {
+    run->started = 1;
+    run->first = *st;
+  }
+  if (st->consumed < run->total)
+  {
+    run->last = *st;
+    run->before_end = st->underruns;
+  }
+}
+
+static uint16_t *LoadFile(const char *path, uint32_t *n)
+{
+  char line[256];
+  uint32_t cap = 4096, count = 0;
+  uint16_t *v = malloc(cap * sizeof(*v));
+  FILE *f = fopen(path, "r");
+
+  if (!f || !v)
+  {
+    if (f) fclose(f);
+    free(v);
+    return NULL;
+  }
+  while (fgets(line, sizeof(line), f))
+  {
+    char *p = line;
+
+    /* as5600_sim -o: t_s,true_deg,raw,field_mT */
+    if (strchr(p, ',')) p = strchr(strchr(p, ',') + 1, ',');
+    if (!p) continue;
+    if (*p == ',') p++;
+    if (*p < '0' || *p > '9') continue;
+    if (count == cap)
+    {
+      cap *= 2;
+      v = realloc(v, cap * sizeof(*v));
+      if (!v) break;
+    }
+    v[count++] = (uint16_t)(strtoul(p, NULL, 10) & 0x0FFFU);
+  }
+  fclose(f);
+  *n = count;
+  return v;
+}
+
+int main(int argc, char **argv)
+{
+  AS5600Sim_ConfigTypeDef sc = { .n_seg = 1, .field_mt = 60.0, .noise_scale = 1.0, .seed = 3 };
+  static AS5600Sim_TypeDef sim;
+  const char *dev = NULL, *cmd = NULL, *file = NULL;
+  Run_TypeDef run = { .total = 5000 };
+  Status_TypeDef *st = &run.st;
+  HostLink_TypeDef link;
+  uint32_t sent = 0;
+  uint16_t *traj = NULL;
+  double rpm = 60.0, t_end;
+  uint8_t stop_sent = 0, verbose = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:x:n:r:i:v")) != -1)
+  {
+    switch (opt)
+    {
+      case 'd': dev = optarg; break;
+      case 'x': cmd = optarg; break;
+      case 'n': run.total = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'r': rpm = atof(optarg); break;
+      case 'i': file = optarg; break;
+      case 'v': verbose = 1; break;
+      default: dev = cmd = NULL; optind = argc; break;
+    }
+  }
+  if (!dev == !cmd)
+  {
+    fprintf(stderr, "usage: %s (-d tty | -x \"firmware command\") [-n samples] [-r rpm] [-i file] [-v]\n", argv[0]);
+    return 2;
+  }
+  if (file)
+  {
+    traj = LoadFile(file, &run.total);
+    if (!traj || run.total == 0U)
+    {
+      fprintf(stderr, "%s: no raw angles\n", file);
+      return 2;
+    }
+  }
+  else
+  {
+    sc.seg[0] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_CONST, 1e9, rpm, 0.0, 0.0 };
+    AS5600Sim_Init(&sim, &sc);
+  }
+
+  if (HostLink_Open(&link, dev, cmd) != 0)
+  {
+    perror(cmd ? "pty" : dev);
+    return 2;
+  }
+  link.echo_text = verbose;
+
+  /* firmware boot plus the trajectory at 1 kHz, with a generous margin */
+  t_end = HostLink_Now() + 10.0 + run.total * 2e-3;
+  while (HostLink_Now() < t_end)
+  {
+    while (!stop_sent && sent < run.total && sent - st->consumed + HIL_DATA_MAX <= HIL_IN_FLIGHT)
+    {
+      uint8_t p[4U + 2U * HIL_DATA_MAX];
+      uint32_t n = run.total - sent < HIL_DATA_MAX ? run.total - sent : HIL_DATA_MAX;
+
+      for (uint32_t k = 0; k < 4U; k++) p[k] = (uint8_t)(sent >> (8U * k));
+      for (uint32_t k = 0; k < n; k++)
+      {
+        uint16_t raw = traj ? traj[sent + k] : AS5600Sim_Next(&sim, 1e-3);
+
+        p[4U + 2U * k] = (uint8_t)raw;
+        p[5U + 2U * k] = (uint8_t)(raw >> 8);
+      }
+      if (HostLink_Send(&link, TELEMETRY_FRAME_HIL_DATA, p, (uint8_t)(4U + 2U * n)) != 0) break;
+      sent += n;
+    }
+    if (!stop_sent && run.started && st->consumed >= run.total)
+    {
+      HostLink_Send(&link, TELEMETRY_FRAME_HIL_STOP, NULL, 0);
+      stop_sent = 1;
+    }
+    if (HostLink_Poll(&link, 1, OnFrame, &run) < 0) break;
+    if (stop_sent && !st->active) break;
+  }
+  HostLink_Close(&link);
+  free(traj);
+
+  if (!run.started)
+  {
+    fprintf(stderr, "no HIL_STATUS from the firmware\n");
+    return 2;
+  }
+  printf("sent %u  consumed %u  underruns %u (%u after the end)  gaps %u  overflows %u\n",
+         (unsigned)sent, (unsigned)st->consumed, (unsigned)run.before_end,
+         (unsigned)(st->underruns - run.before_end), (unsigned)st->gaps, (unsigned)st->overflows);
+  if (run.last.t > run.first.t)
+    printf("consumed at %.1f Hz over %.2f s\n", (double)(run.last.consumed - run.first.consumed) /
+           (run.last.t - run.first.t), run.last.t - run.first.t);
+  if (!stop_sent) printf("timed out\n");
+  return (run.before_end || st->gaps || st->overflows || !stop_sent) ? 1 : 0;
+}
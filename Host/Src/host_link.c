@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file           : host_link.c
+  * @brief          : Workstation end of the USART2 link for the host tools.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+#include "host_link.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static void HostLink_Raw(int fd)
+{
+  struct termios tio;
+
+  if (tcgetattr(fd, &tio) != 0) return;
+  cfmakeraw(&tio);
+  cfsetspeed(&tio, B115200);
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
+/* pty pair, the firmware command runs on the slave side */
+static int HostLink_Spawn(HostLink_TypeDef *link, const char *cmd)
+{
+  char *line;
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+  if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) return -1;
+  /* raw before anything is written: no echo, no CR/LF mapping */
+  link->slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+  if (link->slave < 0) return -1;
+  HostLink_Raw(link->slave);
+  if (asprintf(&line, "%s -u %s", cmd, ptsname(fd)) < 0) return -1;
+
+  link->child = fork();
+  if (link->child == 0)
+  {
+    close(fd);
+    execl("/bin/sh", "sh", "-c", line, (char *)NULL);
+    _exit(127);
+  }
+  free(line);
+  return link->child > 0 ? fd : -1;
+}
+
+/**
+  * @brief  Open a serial device (dev) or start a host firmware command on a
+  *         new pty (cmd, gets "-u <pty>" appended).
+  * @retval 0 on success, -1 with errno set
+  */
+int HostLink_Open(HostLink_TypeDef *link, const char *dev, const char *cmd)
+{
+  memset(link, 0, sizeof(*link));
+  link->slave = -1;
+  if (cmd)
+  {
+    link->fd = HostLink_Spawn(link, cmd);
+  }
+  else
+  {
+    link->fd = open(dev, O_RDWR | O_NOCTTY);
+    if (link->fd >= 0) HostLink_Raw(link->fd);
+  }
+  signal(SIGPIPE, SIG_IGN);
+  return link->fd >= 0 ? 0 : -1;
+}
+
+/**
+  * @brief  Close the link, a started firmware is terminated.
+  */
+void HostLink_Close(HostLink_TypeDef *link)
+{
+  if (link->child > 0)
+  {
+    kill(link->child, SIGTERM);
+    waitpid(link->child, NULL, 0);
+  }
+  if (link->slave >= 0) close(link->slave);
+  if (link->fd >= 0) close(link->fd);
+  link->fd = link->slave = -1;
+  link->child = 0;
+}
+
+/**
+  * @brief  Send one frame.
+  * @retval 0 on success, -1 on a write error
+  */
+int HostLink_Send(HostLink_TypeDef *link, uint8_t type, const void *payload, uint8_t len)
+{
+  uint8_t frame[TELEMETRY_FRAME_LEN(TELEMETRY_MAX_PAYLOAD)];
+  uint16_t n = Telemetry_BuildFrame(frame, type, payload, len);
+  const uint8_t *p = frame;
+
+  if (n == 0U) return -1;
+  while (n)
+  {
+    ssize_t w = write(link->fd, p, n);
+
+    if (w <= 0) return -1;
+    p += w;
+    n -= (uint16_t)w;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Wait up to timeout_ms for input and hand every complete frame
+  *         with a valid checksum to fn.
+  * @retval number of frames, -1 when the other end closed
+  */
+int HostLink_Poll(HostLink_TypeDef *link, int timeout_ms, HostLink_FrameFn fn, void *ctx)
+{
+  struct pollfd pfd = { .fd = link->fd, .events = POLLIN };
+  uint8_t buf[512];
+  int frames = 0;
+  ssize_t rc;
+
+  if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+  rc = read(link->fd, buf, sizeof(buf));
+  if (rc <= 0) return -1;
+
+  for (ssize_t i = 0; i < rc; i++)
+  {
+    uint8_t b = buf[i], sum = 0;
+
+    if (link->have == 0U && b != TELEMETRY_SYNC)
+    {
+      if (link->echo_text) putchar(b);
+      continue;
+    }
+    link->rx[link->have++] = b;
+    if (link->have == 3U && b > TELEMETRY_MAX_PAYLOAD) link->have = 0;
+    if (link->have < 3U || link->have < TELEMETRY_FRAME_LEN(link->rx[2])) continue;
+
+    for (uint32_t k = 1; k < link->have; k++) sum += link->rx[k];
+    link->have = 0;
+    if (sum != 0U) continue;
+    frames++;
+    if (fn) fn(ctx, link->rx[1], &link->rx[3], link->rx[2]);
+  }
+  return frames;
+}
+
+/**
+  * @brief  Monotonic time in seconds.
+  */
+double HostLink_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file           : host_main.c
+  * @brief          : Host counterpart of Core/Src/main.c: same boot sequence
+  *                   and scheduler loop, peripherals replaced by the shim and
+  *                   the AS5600 by the register model.
+  *
+  *  usage: firmware_host [-t seconds] [-a raw] [-r rpm] [-f field_mT] [-R ms]
+  *                       [-u tty]
+  *    -t  stop after this many seconds (default: run until killed)
+  *    -a  fixed raw angle
+  *    -r  rotate the magnet at this speed instead (as5600_sim.h, with noise
+  *        and the filter response of the CONF register)
+  *    -f  field at the sensor, 0 = no magnet (default 60)
+  *    -R  run the sample-rate sweep at boot with this window per step
+  *    -u  USART2 on this terminal (e.g. a pty, see hil_main.c) in both
+  *        directions instead of stdout
+  *  SIGUSR1 presses the user button (profiler and scheduler dump).
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "app.h"
+#include "as5600_model.h"
+#include "as5600_sim.h"
+#include "AMS5600_api.h"
+#include "profiler.h"
+#include "ratesweep.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "uartrx.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+I2C_HandleTypeDef hi2c1;
+UART_HandleTypeDef huart2;
+
+static volatile sig_atomic_t button_req;
+static AS5600Sim_TypeDef sim;
+
+static void Host_OnSignal(int sig)
+{
+  (void)sig;
+  button_req = 1;
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  if (huart->Instance == USART2) Telemetry_TxCplt();
+}
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  if (huart->Instance == USART2) UartRx_Event(Size);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM2) App_QuadEdge();
+  else if (htim->Instance == TIM4) App_ServoLoop();
+  else if (htim->Instance == TIM5) HAL_TIM_Base_Stop_IT(htim);   /* the wake-up itself */
+}
+
+/* scheduler idle wake-up, as Main_SchedWakeup() on the target */
+static void Host_SchedWakeup(uint32_t cycles)
+{
+  extern TIM_HandleTypeDef htim5;
+
+  HAL_TIM_Base_Stop_IT(&htim5);
+  __HAL_TIM_SET_COUNTER(&htim5, 0U);
+  __HAL_TIM_SET_AUTORELOAD(&htim5, cycles - 1U);
+  HAL_TIM_Base_Start_IT(&htim5);
+}
+
+/* raw terminal for USART2 in both directions */
+static int Host_OpenUart(const char *path)
+{
+  struct termios tio;
+  int fd = open(path, O_RDWR | O_NOCTTY);
+
+  if (fd < 0)
+  {
+    perror(path);
+    return -1;
+  }
+  if (tcgetattr(fd, &tio) == 0)
+  {
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  HostShim_SetUartFd(fd);
+  HostShim_SetUartRxFd(fd);
+  return fd;
+}
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler\n");
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  AS5600Sim_ConfigTypeDef sim_cfg = { .n_seg = 1, .field_mt = 60.0, .noise_scale = 1.0 };
+  double rotate_rpm = 0.0, field = 60.0;
+  uint32_t run_ms = 0, sweep_ms = 0;
+  uint8_t magStatus = 0;
+  int opt;
+
+  AS5600Model_Erase();
+  while ((opt = getopt(argc, argv, "t:a:r:f:R:u:")) != -1)
+  {
+    switch (opt)
+    {
+      case 't': run_ms = (uint32_t)(atof(optarg) * 1000.0); break;
+      case 'a': AS5600Model_SetRawAngle((uint16_t)atoi(optarg)); break;
+      case 'r': rotate_rpm = atof(optarg); break;
+      case 'f': field = atof(optarg); AS5600Model_SetField((uint16_t)field); break;
+      case 'R': sweep_ms = (uint32_t)atoi(optarg); break;
+      case 'u': if (Host_OpenUart(optarg) < 0) return 2; break;
+      default:
+        fprintf(stderr, "usage: %s [-t seconds] [-a raw] [-r rpm] [-f field_mT] [-R ms] [-u tty]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (rotate_rpm != 0.0)
+  {
+    sim_cfg.seg[0] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_CONST, 1e9, rotate_rpm, 0.0, 0.0 };
+    sim_cfg.field_mt = field;
+    AS5600Sim_Init(&sim, &sim_cfg);
+    AS5600Sim_Attach(&sim);
+  }
+  signal(SIGUSR1, Host_OnSignal);
+  setvbuf(stdout, NULL, _IONBF, 0);
+
+  HAL_Init();
+  hi2c1.Instance = I2C1;
+  hi2c1.Init.ClockSpeed = 400000;
+  huart2.Instance = USART2;
+  huart2.Init.BaudRate = 115200;
+  if (HAL_I2C_Init(&hi2c1) != HAL_OK || HAL_UART_Init(&huart2) != HAL_OK) Error_Handler();
+
+  Profiler_Init();
+
+  while (!magStatus) { // magnet detection
+    if (AMS5600_detectMagnet(&magStatus) != HAL_OK) Error_Handler();
+    printf("magStatus : %d\n", magStatus);
+    if (!magStatus) HAL_Delay(100);
+    if (run_ms && HAL_GetTick() >= run_ms) return 1;
+  }
+
+  if (sweep_ms) RateSweep_Run(sweep_ms);
+
+  App_Init();
+  Sched_SetWakeup(Host_SchedWakeup);
+
+  while (!run_ms || HAL_GetTick() < run_ms)
+  {
+    if (button_req)
+    {
+      button_req = 0;
+      HostShim_PressButton(100);
+    }
+    Sched_Dispatch();
+  }
+  Telemetry_WaitIdle(1000);
+  return 0;
+}
@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file           : lagbench_main.c
+  * @brief          : Position error with and without the latency
+  *                   compensation (lagcomp.h) against shaft speed, on the
+  *                   AS5600 simulator, CSV on stdout.
+  *
+  *  usage: lagbench_host [-n samples] [-c conf] [-b bus_hz] [-p publish_us]
+  *    every trajectory is run at SF 16x, SF 2x and SF 16x with FTH 6 LSB,
+  *    or at the given CONF only
+  *
+  *  The sample task is played every APP_SAMPLE_PERIOD_US: the RAW ANGLE
+  *  latched AMS5600_READ_HEAD_BITS bit times after the read start goes through
+  *  the pipeline (pipeline.h, default settings), and the position is used
+  *  publish_us after the read start. Both the pipeline position and the
+  *  compensated one are compared with the true angle at that instant, after
+  *  LAGBENCH_SETTLE samples; errors in counts, age_us is the mean modelled
+  *  age. The check asks the compensation to lower the RMS error wherever
+  *  there is more than a count of it.
+  *  Exit status: 0 all checks passed, 1 a check failed, 2 usage error.
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "app.h"
+#include "as5600_sim.h"
+#include "lagcomp.h"
+#include "pipeline.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LAGBENCH_SETTLE  300U
+#define LAGBENCH_STEP_S  10e-6   /* simulator step, the filter choice holds for one */
+
+typedef struct
+{
+  const char *name;
+  AS5600Sim_SegmentTypeDef seg[2];
+  uint32_t n_seg;
+} Trajectory_TypeDef;
+
+static const Trajectory_TypeDef trajectories[] =
+{
+  { "stall",     { { SIM_SEG_STALL, 1.0, 0.0, 0.0, 0.0 } }, 1 },
+  { "30rpm",     { { SIM_SEG_CONST, 1.0, 30.0, 0.0, 0.0 } }, 1 },
+  { "120rpm",    { { SIM_SEG_CONST, 1.0, 120.0, 0.0, 0.0 } }, 1 },
+  { "600rpm",    { { SIM_SEG_CONST, 1.0, 600.0, 0.0, 0.0 } }, 1 },
+  { "3000rpm",   { { SIM_SEG_CONST, 1.0, 3000.0, 0.0, 0.0 } }, 1 },
+  { "6000rpm",   { { SIM_SEG_CONST, 1.0, 6000.0, 0.0, 0.0 } }, 1 },
+  { "ramp",      { { SIM_SEG_RAMP, 2.0, 3000.0, 0.0, 0.0 },
+                   { SIM_SEG_RAMP, 2.0, 0.0, 0.0, 0.0 } }, 2 },
+  { "vibration", { { SIM_SEG_CONST, 1.0, 600.0, 2.0, 20.0 } }, 1 },
+};
+
+static const uint16_t confs[] = { 0x0000U, 0x0300U, 0x0400U };
+
+/* advance the simulator by dt in steps of at most LAGBENCH_STEP_S */
+static uint16_t Bench_Advance(AS5600Sim_TypeDef *sim, double dt)
+{
+  uint32_t steps = (uint32_t)ceil(dt / LAGBENCH_STEP_S);
+  uint16_t raw = 0;
+
+  for (uint32_t i = 0; i < steps; i++) raw = AS5600Sim_Next(sim, dt / steps);
+  return raw;
+}
+
+/* Q4 position against counts, within half a turn */
+static double Bench_Err(int32_t pos, double truth)
+{
+  double d = fmod(pos / 16.0 - truth, 4096.0);
+
+  if (d > 2048.0) d -= 4096.0;
+  if (d < -2048.0) d += 4096.0;
+  return fabs(d);
+}
+
+static int Bench_Run(const Trajectory_TypeDef *tr, uint16_t conf, uint32_t samples, uint32_t bus_hz, uint32_t publish_us)
+{
+  static AS5600Sim_TypeDef sim;
+  AS5600Sim_ConfigTypeDef sc = { .loop = 1, .field_mt = 60.0, .noise_scale = 1.0, .conf = conf, .seed = 11 };
+  const double period_s = APP_SAMPLE_PERIOD_US * 1e-6;
+  LagComp_ModelTypeDef m;
+  Pipeline_ConfigTypeDef pc;
+  Pipeline_TypeDef pl;
+  Pipeline_OutTypeDef out;
+  double latch_s, publish_s, raw_max = 0.0, raw_sq = 0.0, comp_max = 0.0, comp_sq = 0.0, age_sum = 0.0;
+  uint32_t n = 0;
+  int ok;
+
+  if (LagComp_Init(&m, conf, bus_hz, 0) != 0) return 1;
+  latch_s = m.latch_ns * 1e-9;
+  publish_s = publish_us * 1e-6;
+  memcpy(sc.seg, tr->seg, sizeof(tr->seg));
+  sc.n_seg = tr->n_seg;
+  AS5600Sim_Init(&sim, &sc);
+  Pipeline_DefaultConfig(&pc);
+  Pipeline_Init(&pl, &pc);
+
+  for (uint32_t k = 0; k < samples + LAGBENCH_SETTLE; k++)
+  {
+    /* read start at k periods: latch, publish, next read start */
+    uint16_t raw = Bench_Advance(&sim, latch_s);
+    int32_t age_ns, comp;
+    double er, ec;
+
+    Pipeline_Step(&pl, raw, &out);
+    age_ns = (int32_t)(publish_us * 1000U) + LagComp_SensorNs(&m, out.vel, APP_SAMPLE_PERIOD_US);
+    comp = LagComp_Extrapolate(out.pos, out.vel, age_ns, APP_SAMPLE_PERIOD_US);
+    Bench_Advance(&sim, publish_s - latch_s);
+    if (k >= LAGBENCH_SETTLE)
+    {
+      er = Bench_Err(out.pos, sim.in_cnt);
+      ec = Bench_Err(comp, sim.in_cnt);
+      raw_max = fmax(raw_max, er);
+      comp_max = fmax(comp_max, ec);
+      raw_sq += er * er;
+      comp_sq += ec * ec;
+      age_sum += age_ns;
+      n++;
+    }
+    Bench_Advance(&sim, period_s - publish_s);
+  }
+
+  ok = sqrt(raw_sq / n) <= 1.0 || comp_sq < raw_sq;
+  printf("0x%04x,%s,%u,%.0f,%.2f,%.2f,%.2f,%.2f,%s\n", conf, tr->name, (unsigned)n, age_sum / n / 1000.0,
+         raw_max, sqrt(raw_sq / n), comp_max, sqrt(comp_sq / n), ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t samples = 5000U, bus_hz = 400000U, publish_us = 150U;
+  int32_t conf = -1;
+  int opt, rc = 0;
+
+  while ((opt = getopt(argc, argv, "n:c:b:p:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n': samples = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'c': conf = (int32_t)(strtoul(optarg, NULL, 0) & 0xFFFFU); break;
+      case 'b': bus_hz = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'p': publish_us = (uint32_t)strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n samples] [-c conf] [-b bus_hz] [-p publish_us]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (samples == 0U || bus_hz == 0U || publish_us >= APP_SAMPLE_PERIOD_US) return 2;
+  HAL_Init();
+  printf("conf,trajectory,samples,age_us,err_raw_max,err_raw_rms,err_comp_max,err_comp_rms,check\n");
+  for (size_t c = 0; c < sizeof(confs) / sizeof(confs[0]); c++)
+  {
+    if (conf >= 0 && c > 0U) break;
+    for (size_t t = 0; t < sizeof(trajectories) / sizeof(trajectories[0]); t++)
+      rc |= Bench_Run(&trajectories[t], conf >= 0 ? (uint16_t)conf : confs[c], samples, bus_hz, publish_us);
+  }
+  return rc ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file           : medianbench_main.c
+  * @brief          : Host run of the glitch filter benchmark (medianbench.h),
+  *                   CSV on stdout.
+  *
+  *  usage: medianbench_host [samples]
+  *  cycles are the software cost on the host scaled to 84 MHz, the target
+  *  figures come from APP_MEDIANBENCH (app_config.h).
+  *  Exit status: 0 all checks passed, 1 a check failed.
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "medianbench.h"
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+  uint32_t samples = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000U;
+
+  HAL_Init();
+  return MedianBench_Run(samples) ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+/**
+  ******************************************************************************
+  * @file           : replay_main.c
+  * @brief          : Sample-exact replay of a recording (recorder.h) through
+  *                   the firmware pipeline, with output verification.
+  *
+  *  usage: replay_host capture.bin
+  *         replay_host -g capture.bin [-n samples] [-r rpm] [-D n]
+  *    -g  generate a recording from the simulator instead (as5600_sim.h),
+  *        -D drops every n-th frame to exercise the gap handling
+  *
+  *  The capture is parsed first, then replayed in one timed pass. For every
+  *  RECORD frame the batch is run through Pipeline_Step() from the state of
+  *  the last STATE frame and the output hash is compared with the logged
+  *  one. After a sequence gap verification resumes at the next STATE frame.
+  *  Exit status: 0 all verified, 1 mismatch, 2 usage or I/O error.
+  ******************************************************************************
+  */
+
+#include "as5600_sim.h"
+#include "pipeline.h"
+#include "recorder.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct
+{
+  uint8_t type;
+  uint8_t len;
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+} Frame_TypeDef;
+
+static FILE *gen_out;
+static uint32_t gen_drop_every, gen_frames;
+
+static uint32_t Get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t Gen_Sink(uint8_t type, const void *payload, uint8_t len)
+{
+  uint8_t frame[TELEMETRY_FRAME_LEN(TELEMETRY_MAX_PAYLOAD)];
+  uint16_t n = Telemetry_BuildFrame(frame, type, payload, len);
+
+  gen_frames++;
+  if (gen_drop_every && (gen_frames % gen_drop_every) == 0U) return 0;
+  /* some text in between, as on the real UART */
+  if ((gen_frames & 0x3FU) == 0U) fputs("magnet : 2   agc : 127\n", gen_out);
+  return fwrite(frame, 1, n, gen_out) == n ? n : 0;
+}
+
+static int Generate(const char *path, uint64_t samples, double rpm)
+{
+  AS5600Sim_ConfigTypeDef sc = { .n_seg = 3, .loop = 1, .field_mt = 60.0, .noise_scale = 1.0, .seed = 7 };
+  static AS5600Sim_TypeDef sim;
+  Pipeline_ConfigTypeDef pc;
+  Pipeline_TypeDef pl;
+  Pipeline_OutTypeDef out;
+  Recorder_TypeDef rec;
+
+  sc.seg[0] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_RAMP, 1.0, rpm, 0.0, 0.0 };
+  sc.seg[1] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_CONST, 2.0, rpm, 1.0, 50.0 };
+  sc.seg[2] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_RAMP, 1.0, -rpm, 0.0, 0.0 };
+  AS5600Sim_Init(&sim, &sc);
+
+  gen_out = fopen(path, "wb");
+  if (!gen_out) return 2;
+  Pipeline_DefaultConfig(&pc);
+  pc.offset = 1000;
+  for (uint32_t i = 0; i < PIPELINE_LUT_SIZE; i++) pc.lut[i] = (int8_t)((int)(i * 37U % 17U) - 8);
+  Pipeline_Init(&pl, &pc);
+  Recorder_Init(&rec, Gen_Sink);
+  for (uint64_t i = 0; i < samples; i++) Recorder_Step(&rec, &pl, AS5600Sim_Next(&sim, 1e-3), &out);
+  fclose(gen_out);
+  printf("generated %llu samples, %u frames dropped\n", (unsigned long long)samples, (unsigned)rec.dropped);
+  return 0;
+}
+
+/* split the byte stream into valid frames, skipping everything else */
+static Frame_TypeDef *Parse(const uint8_t *buf, size_t len, size_t *count, size_t *skipped)
+{
+  size_t cap = 1024, n = 0, i = 0;
+  Frame_TypeDef *frames = malloc(cap * sizeof(*frames));
+
+  *skipped = 0;
+  while (frames && i + 4 <= len)
+  {
+    uint8_t flen = buf[i + 2], sum = 0;
+
+    if (buf[i] != TELEMETRY_SYNC || flen > TELEMETRY_MAX_PAYLOAD || i + TELEMETRY_FRAME_LEN(flen) > len)
+    {
+      i++;
+      (*skipped)++;
+      continue;
+    }
+    for (size_t k = 1; k < TELEMETRY_FRAME_LEN(flen); k++) sum += buf[i + k];
+    if (sum != 0)
+    {
+      i++;
+      (*skipped)++;
+      continue;
+    }
+    if (n == cap)
+    {
+      cap *= 2;
+      frames = realloc(frames, cap * sizeof(*frames));
+      if (!frames) break;
+    }
+    frames[n].type = buf[i + 1];
+    frames[n].len = flen;
+    memcpy(frames[n].payload, &buf[i + 3], flen);
+    n++;
+    i += TELEMETRY_FRAME_LEN(flen);
+  }
+  *count = n;
+  return frames;
+}
+
+int main(int argc, char **argv)
+{
+  const char *gen = NULL;
+  uint64_t gen_samples = 1000000;
+  double rpm = 300.0;
+  uint64_t samples = 0, batches = 0, mismatches = 0, gaps = 0, unverified = 0, states = 0;
+  Pipeline_TypeDef pl;
+  Pipeline_OutTypeDef out;
+  uint32_t expect = 0;
+  uint8_t synced = 0;
+  size_t len, nframes, skipped;
+  struct timespec t0, t1;
+  uint8_t *buf;
+  Frame_TypeDef *frames;
+  FILE *f;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "g:n:r:D:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'g': gen = optarg; break;
+      case 'n': gen_samples = strtoull(optarg, NULL, 0); break;
+      case 'r': rpm = atof(optarg); break;
+      case 'D': gen_drop_every = (uint32_t)atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s capture.bin | -g capture.bin [-n samples] [-r rpm] [-D n]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (gen) return Generate(gen, gen_samples, rpm);
+  if (optind >= argc)
+  {
+    fprintf(stderr, "usage: %s capture.bin | -g capture.bin [-n samples] [-r rpm] [-D n]\n", argv[0]);
+    return 2;
+  }
+
+  f = fopen(argv[optind], "rb");
+  if (!f)
+  {
+    perror(argv[optind]);
+    return 2;
+  }
+  fseek(f, 0, SEEK_END);
+  len = (size_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  buf = malloc(len ? len : 1);
+  if (!buf || fread(buf, 1, len, f) != len)
+  {
+    fclose(f);
+    return 2;
+  }
+  fclose(f);
+  frames = Parse(buf, len, &nframes, &skipped);
+  free(buf);
+  if (!frames) return 2;
+
+  memset(&pl, 0, sizeof(pl));
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (size_t i = 0; i < nframes; i++)
+  {
+    const Frame_TypeDef *fr = &frames[i];
+
+    if (fr->type == TELEMETRY_FRAME_STATE && fr->len == RECORDER_STATE_LEN)
+    {
+      if (synced && Get32(fr->payload) != expect) gaps++;
+      Pipeline_Load(&pl, &fr->payload[4], PIPELINE_STATE_SIZE);
+      expect = Get32(fr->payload);
+      synced = 1;
+      states++;
+    }
+    else if (fr->type == TELEMETRY_FRAME_RECORD && fr->len == RECORDER_RECORD_LEN)
+    {
+      const uint8_t *p = fr->payload;
+      uint32_t hash = PIPELINE_HASH_INIT;
+
+      batches++;
+      if (!synced || Get32(p) != expect)
+      {
+        if (synced) gaps++;
+        synced = 0;
+        unverified += RECORDER_BATCH;
+        continue;
+      }
+      for (uint32_t k = 0; k < RECORDER_BATCH; k++)
+      {
+        Pipeline_Step(&pl, (uint16_t)(p[4 + 2 * k] | (p[5 + 2 * k] << 8)), &out);
+        hash = Pipeline_Hash(hash, &out);
+      }
+      if (hash != Get32(&p[4 + 2 * RECORDER_BATCH]) || (uint32_t)out.filt != Get32(&p[8 + 2 * RECORDER_BATCH]))
+      {
+        if (mismatches == 0) printf("first mismatch at sample %u\n", (unsigned)expect);
+        mismatches++;
+      }
+      expect += RECORDER_BATCH;
+      samples += RECORDER_BATCH;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  free(frames);
+
+  {
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+    printf("frames %zu (state %llu, record %llu), non-frame bytes %zu\n", nframes,
+           (unsigned long long)states, (unsigned long long)batches, skipped);
+    printf("verified %llu samples, unverified %llu, gaps %llu, mismatching batches %llu\n",
+           (unsigned long long)samples, (unsigned long long)unverified,
+           (unsigned long long)gaps, (unsigned long long)mismatches);
+    printf("replay %.3f s, %.1f Msamples/s\n", secs, secs > 0.0 ? (double)samples / secs * 1e-6 : 0.0);
+  }
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file           : servobench_main.c
+  * @brief          : Host run of the position servo benchmark (servobench.h),
+  *                   CSV on stdout.
+  *
+  *  usage: servobench_host [runs]
+  *  cycles are the software cost on the host scaled to 84 MHz, the target
+  *  figures come from APP_SERVOBENCH (app_config.h).
+  *  Exit status: 0 all checks passed, 1 a check failed.
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "servobench.h"
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+  uint32_t runs = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 3U;
+
+  HAL_Init();
+  return ServoBench_Run(runs ? runs : 1U) ? 1 : 0;
+}
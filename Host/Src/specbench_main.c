@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file           : specbench_main.c
+  * @brief          : Host run of the spectrum benchmark (specbench.h), CSV
+  *                   on stdout.
+  *
+  *  usage: specbench_host [blocks]
+  *  cycles are the software cost on the host scaled to 84 MHz, the target
+  *  figures come from APP_SPECBENCH (app_config.h).
+  *  Exit status: 0 all checks passed, 1 a check failed.
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "specbench.h"
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+  uint32_t blocks = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 8U;
+
+  HAL_Init();
+  return SpecBench_Run(blocks ? blocks : 1U) ? 1 : 0;
+}
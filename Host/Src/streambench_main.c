@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file           : streambench_main.c
+  * @brief          : Compression ratio and encoder cost of the sample stream
+  *                   (stream.h) on simulated and recorded trajectories, CSV
+  *                   on stdout.
+  *
+  *  usage: streambench_host [-n samples] [capture.bin ...]
+  *    without files a set of simulated trajectories at 1 kHz is run, a file
+  *    is a recording (recorder.h) whose raw samples are used in order
+  *
+  *  ratio is against 16-bit raw samples; bytes_per_sample counts the whole
+  *  frames on the wire (sync, type, length, checksum). cycles_per_sample is
+  *  the encoder cost on the host scaled to 84 MHz, the target figure is the
+  *  "compress" profiler region. Every stream is decoded again and compared.
+  *  Exit status: 0 all streams verified, 1 mismatch, 2 usage or I/O error.
+  ******************************************************************************
+  */
+
+#include "main.h"
+#include "as5600_sim.h"
+#include "cyccnt.h"
+#include "recorder.h"
+#include "stream.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+  const char *name;
+  AS5600Sim_SegmentTypeDef seg[3];
+  uint32_t n_seg;
+} Trajectory_TypeDef;
+
+static const Trajectory_TypeDef trajectories[] =
+{
+  { "stall",       { { SIM_SEG_STALL, 1.0, 0.0, 0.0, 0.0 } }, 1 },
+  { "10rpm",       { { SIM_SEG_CONST, 1.0, 10.0, 0.0, 0.0 } }, 1 },
+  { "60rpm",       { { SIM_SEG_CONST, 1.0, 60.0, 0.0, 0.0 } }, 1 },
+  { "300rpm",      { { SIM_SEG_CONST, 1.0, 300.0, 0.0, 0.0 } }, 1 },
+  { "1000rpm",     { { SIM_SEG_CONST, 1.0, 1000.0, 0.0, 0.0 } }, 1 },
+  { "3000rpm",     { { SIM_SEG_CONST, 1.0, 3000.0, 0.0, 0.0 } }, 1 },
+  { "vibration",   { { SIM_SEG_CONST, 1.0, 60.0, 2.0, 50.0 } }, 1 },
+  { "start_stop",  { { SIM_SEG_RAMP, 2.0, 300.0, 0.0, 0.0 },
+                     { SIM_SEG_CONST, 2.0, 300.0, 1.0, 50.0 },
+                     { SIM_SEG_RAMP, 2.0, 0.0, 0.0, 0.0 } }, 3 },
+};
+
+/* encoded frames, payloads back to back with a length byte each */
+static uint8_t *enc_buf;
+static size_t enc_len, enc_cap;
+
+static uint16_t Bench_Sink(uint8_t type, const void *payload, uint8_t len)
+{
+  (void)type;
+  if (enc_len + len + 1U > enc_cap) return 0;
+  enc_buf[enc_len++] = len;
+  memcpy(&enc_buf[enc_len], payload, len);
+  enc_len += len;
+  return (uint16_t)TELEMETRY_FRAME_LEN(len);
+}
+
+static int Bench_Run(const char *name, const uint16_t *raw, uint32_t n)
+{
+  static Stream_TypeDef s;
+  uint16_t out[TELEMETRY_MAX_PAYLOAD];
+  uint32_t t0, cycles, seq, k = 0;
+  size_t pos = 0;
+  int ok = 1;
+
+  enc_cap = (size_t)n * 3U + 64U;
+  enc_buf = realloc(enc_buf, enc_cap);
+  enc_len = 0;
+  if (!enc_buf) return -1;
+
+  Stream_Init(&s, Bench_Sink, 0);
+  t0 = CYCCNT_Read();
+  for (uint32_t i = 0; i < n; i++) Stream_Push(&s, raw[i]);
+  Stream_Flush(&s);
+  cycles = CYCCNT_Read() - t0;
+
+  while (ok && pos < enc_len)
+  {
+    uint8_t len = enc_buf[pos++];
+    int m = Stream_Decode(&enc_buf[pos], len, &seq, out, TELEMETRY_MAX_PAYLOAD);
+
+    pos += len;
+    if (m < 0 || seq != k || k + (uint32_t)m > n || memcmp(out, &raw[k], (size_t)m * sizeof(out[0])) != 0) ok = 0;
+    k += (uint32_t)(m > 0 ? m : 0);
+  }
+  if (k != n || s.dropped) ok = 0;
+
+  printf("%s,%u,%u,%u,%.3f,%.2f,%.1f,%s\n", name, (unsigned)n, (unsigned)s.frames,
+         (unsigned)(s.bytes + TELEMETRY_FRAME_LEN(0) * s.frames),
+         (double)(s.bytes + TELEMETRY_FRAME_LEN(0) * s.frames) / n,
+         2.0 * n / (double)(s.bytes + TELEMETRY_FRAME_LEN(0) * s.frames),
+         (double)cycles / n, ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
+
+/* raw samples of the RECORD frames of a capture, in file order */
+static uint16_t *Bench_Load(const char *path, uint32_t *count)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *buf;
+  uint16_t *raw = NULL;
+  size_t len, i = 0, n = 0;
+  long size;
+
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  buf = malloc((size_t)size + 1U);
+  if (!buf || fread(buf, 1, (size_t)size, f) != (size_t)size)
+  {
+    fclose(f);
+    free(buf);
+    return NULL;
+  }
+  fclose(f);
+  len = (size_t)size;
+  raw = malloc((len / RECORDER_RECORD_LEN + 1U) * RECORDER_BATCH * sizeof(*raw));
+
+  while (raw && i + 4U <= len)
+  {
+    uint8_t flen = buf[i + 2], sum = 0;
+
+    if (buf[i] != TELEMETRY_SYNC || flen > TELEMETRY_MAX_PAYLOAD || i + TELEMETRY_FRAME_LEN(flen) > len)
+    {
+      i++;
+      continue;
+    }
+    for (size_t k = 1; k < TELEMETRY_FRAME_LEN(flen); k++) sum += buf[i + k];
+    if (sum != 0)
+    {
+      i++;
+      continue;
+    }
+    if (buf[i + 1] == TELEMETRY_FRAME_RECORD && flen == RECORDER_RECORD_LEN)
+    {
+      for (uint32_t k = 0; k < RECORDER_BATCH; k++)
+        raw[n++] = (uint16_t)(buf[i + 7 + 2 * k] | (buf[i + 8 + 2 * k] << 8));
+    }
+    i += TELEMETRY_FRAME_LEN(flen);
+  }
+  free(buf);
+  *count = (uint32_t)n;
+  return raw;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t samples = 1000000U;
+  uint16_t *raw;
+  int opt, rc = 0;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    if (opt != 'n')
+    {
+      fprintf(stderr, "usage: %s [-n samples] [capture.bin ...]\n", argv[0]);
+      return 2;
+    }
+    samples = (uint32_t)strtoul(optarg, NULL, 0);
+  }
+  HAL_Init();
+  CYCCNT_Init();
+  printf("trajectory,samples,frames,wire_bytes,bytes_per_sample,ratio,cycles_per_sample,verified\n");
+
+  if (optind < argc)
+  {
+    for (int i = optind; i < argc; i++)
+    {
+      uint32_t n;
+
+      raw = Bench_Load(argv[i], &n);
+      if (!raw || n == 0U)
+      {
+        fprintf(stderr, "%s: no recorded samples\n", argv[i]);
+        free(raw);
+        return 2;
+      }
+      rc |= Bench_Run(argv[i], raw, n);
+      free(raw);
+    }
+    return rc ? 1 : 0;
+  }
+
+  raw = malloc(samples * sizeof(*raw));
+  if (!raw || samples == 0U) return 2;
+  for (size_t t = 0; t < sizeof(trajectories) / sizeof(trajectories[0]); t++)
+  {
+    static AS5600Sim_TypeDef sim;
+    AS5600Sim_ConfigTypeDef sc = { .loop = 1, .field_mt = 60.0, .noise_scale = 1.0, .seed = 11 };
+
+    memcpy(sc.seg, trajectories[t].seg, sizeof(trajectories[t].seg));
+    sc.n_seg = trajectories[t].n_seg;
+    AS5600Sim_Init(&sim, &sc);
+    AS5600Sim_Fill(&sim, raw, samples, 1e-3);
+    rc |= Bench_Run(trajectories[t].name, raw, samples);
+  }
+  free(raw);
+  return rc ? 1 : 0;
+}
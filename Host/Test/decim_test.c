@@ -0,0 +1,242 @@
+/**
+  ******************************************************************************
+  * @file           : decim_test.c
+  * @brief          : Host test of the decimation stage (decim.h).
+  *
+  *  bit-exact   every output of Decim_Push() equals a direct int64
+  *              convolution with the CIC impulse response / FIR
+  *              coefficients, on simulated and random-walk positions
+  *  response    amplitude of sine inputs at the output against the
+  *              analytic response of the filter
+  *  resolution  noise of a noisy constant position at the output against
+  *              the resolution gain the decimator reports
+  *  Exit status: 0 all passed, 1 a check failed.
+  ******************************************************************************
+  */
+
+#include "as5600_sim.h"
+#include "decim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_PI  3.14159265358979323846
+
+static int failures;
+
+static void Check(int ok, const char *what, const Decim_ConfigTypeDef *cfg, const char *detail)
+{
+  printf("%s %-10s %s R=%-2u %s=%-3u %s\n", ok ? "PASS" : "FAIL", what, cfg->kind == DECIM_CIC ? "cic" : "fir",
+         cfg->ratio, cfg->kind == DECIM_CIC ? "N" : "L", cfg->kind == DECIM_CIC ? cfg->order : cfg->taps, detail);
+  if (!ok) failures++;
+}
+
+/* impulse response of the decimator: CIC boxcar^N, or the FIR coefficients
+   in convolution order; returns its length and the sum in *gain */
+static uint32_t Impulse(const Decim_TypeDef *d, int64_t *c, int64_t *gain)
+{
+  uint32_t len = 1;
+
+  if (d->cfg.kind == DECIM_FIR)
+  {
+    for (uint32_t i = 0; i < d->cfg.taps; i++) c[i] = d->coef[d->cfg.taps - 1U - i];
+    *gain = 32768;
+    return d->cfg.taps;
+  }
+  c[0] = 1;
+  for (uint32_t o = 0; o < d->cfg.order; o++)
+  {
+    int64_t next[DECIM_CIC_MAX_LEN] = { 0 };
+
+    for (uint32_t i = 0; i < len; i++)
+      for (uint32_t k = 0; k < d->cfg.ratio; k++) next[i + k] += c[i];
+    len += d->cfg.ratio - 1U;
+    memcpy(c, next, len * sizeof(*c));
+  }
+  *gain = 1;
+  for (uint32_t o = 0; o < d->cfg.order; o++) *gain *= d->cfg.ratio;
+  return len;
+}
+
+static int64_t FloorDiv(int64_t a, int64_t b)
+{
+  return a / b - ((a % b) < 0 ? 1 : 0);
+}
+
+/* reference output for input index n, inputs before 0 equal x[0] */
+static int32_t Reference(const int32_t *x, uint32_t n, const int64_t *c, uint32_t len, int64_t gain)
+{
+  int64_t acc = 0;
+
+  for (uint32_t k = 0; k < len; k++) acc += c[k] * (k <= n ? x[n - k] : x[0]);
+  return (int32_t)(uint32_t)FloorDiv(acc * 16 + gain / 2, gain);
+}
+
+static void TestBitExact(const Decim_ConfigTypeDef *cfg, const int32_t *x, uint32_t n, const char *input)
+{
+  static Decim_TypeDef d;
+  static int64_t c[DECIM_CIC_MAX_LEN];
+  uint32_t len, outputs = 0, errors = 0;
+  int64_t gain;
+  int32_t y;
+  char detail[96];
+
+  Decim_Init(&d, cfg);
+  len = Impulse(&d, c, &gain);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    if (!Decim_Push(&d, x[i], &y)) continue;
+    outputs++;
+    if ((i + 1U) % cfg->ratio != 0U || y != Reference(x, i, c, len, gain)) errors++;
+  }
+  snprintf(detail, sizeof(detail), "%s: %u outputs, %u differ", input, outputs, errors);
+  Check(errors == 0U && outputs == n / cfg->ratio, "bit-exact", cfg, detail);
+}
+
+/* |H(f)| of the filter at the input rate, f in cycles per input sample */
+static double Response(const Decim_TypeDef *d, double f)
+{
+  static int64_t c[DECIM_CIC_MAX_LEN];
+  double re = 0.0, im = 0.0;
+  int64_t gain;
+  uint32_t len = Impulse(d, c, &gain);
+
+  for (uint32_t k = 0; k < len; k++)
+  {
+    re += c[k] * cos(2.0 * TEST_PI * f * k);
+    im -= c[k] * sin(2.0 * TEST_PI * f * k);
+  }
+  return sqrt(re * re + im * im) / (double)gain;
+}
+
+static void TestResponse(const Decim_ConfigTypeDef *cfg)
+{
+  static const double freqs[] = { 0.004, 0.013, 0.027, 0.041, 0.053, 0.071, 0.097, 0.13, 0.19, 0.27, 0.37, 0.46 };
+  static Decim_TypeDef d;
+  const uint32_t n = 1U << 16, skip = 4096;
+  double worst = 0.0, stop = 0.0;
+  char detail[96];
+
+  for (size_t j = 0; j < sizeof(freqs) / sizeof(freqs[0]); j++)
+  {
+    double f = freqs[j], ci = 0.0, cq = 0.0, want, got;
+    uint32_t m = 0;
+    int32_t y;
+
+    Decim_Init(&d, cfg);
+    for (uint32_t i = 0; i < n; i++)
+    {
+      int32_t x = (int32_t)lround(50000.0 + 2000.0 * sin(2.0 * TEST_PI * f * i));
+
+      if (!Decim_Push(&d, x, &y) || i < skip) continue;
+      ci += (y / 16.0 - 50000.0) * cos(2.0 * TEST_PI * f * i);
+      cq += (y / 16.0 - 50000.0) * sin(2.0 * TEST_PI * f * i);
+      m++;
+    }
+    got = 2.0 * sqrt(ci * ci + cq * cq) / m / 2000.0;
+    want = Response(&d, f);
+    if (fabs(got - want) > worst) worst = fabs(got - want);
+    if (f > 1.5 / cfg->ratio && got > stop) stop = got;
+  }
+  if (stop > 0.0)
+    snprintf(detail, sizeof(detail), "max |H| error %.5f, stopband (>1.5 fout) %.1f dB", worst, 20.0 * log10(stop));
+  else
+    snprintf(detail, sizeof(detail), "max |H| error %.5f", worst);
+  Check(worst < 0.002, "response", cfg, detail);
+}
+
+static double Gauss(uint64_t *rng)
+{
+  double u1, u2;
+
+  *rng = *rng * 6364136223846793005ULL + 1442695040888963407ULL;
+  u1 = ((*rng >> 11) + 1.0) / 9007199254740993.0;
+  *rng = *rng * 6364136223846793005ULL + 1442695040888963407ULL;
+  u2 = (*rng >> 11) / 9007199254740992.0;
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * TEST_PI * u2);
+}
+
+static void TestResolution(const Decim_ConfigTypeDef *cfg)
+{
+  static Decim_TypeDef d;
+  const double sigma = 3.0;
+  uint64_t rng = 12345;
+  double in_sum = 0.0, in_sq = 0.0, out_sum = 0.0, out_sq = 0.0, in_var, out_var, mbits;
+  uint32_t n = 1U << 18, m = 0;
+  int32_t y;
+  char detail[96];
+
+  Decim_Init(&d, cfg);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    int32_t x = (int32_t)lround(1000.0 + sigma * Gauss(&rng));
+
+    in_sum += x;
+    in_sq += (double)x * x;
+    if (!Decim_Push(&d, x, &y) || i < 1024U) continue;
+    out_sum += y / 16.0;
+    out_sq += (y / 16.0) * (y / 16.0);
+    m++;
+  }
+  in_var = in_sq / n - (in_sum / n) * (in_sum / n);
+  out_var = out_sq / m - (out_sum / m) * (out_sum / m);
+  mbits = -500.0 * log2(out_var / in_var);
+  snprintf(detail, sizeof(detail), "measured %+.0f mbit, reported %+d mbit", mbits, d.resolution_mbits);
+  Check(fabs(mbits - d.resolution_mbits) < 150.0, "resolution", cfg, detail);
+}
+
+int main(void)
+{
+  static const Decim_ConfigTypeDef configs[] =
+  {
+    { DECIM_CIC, 2, 1, 0 },  { DECIM_CIC, 8, 3, 0 },  { DECIM_CIC, 10, 3, 0 },
+    { DECIM_CIC, 5, 2, 0 },  { DECIM_CIC, 64, 4, 0 },
+    { DECIM_FIR, 4, 0, 16 }, { DECIM_FIR, 8, 0, 64 }, { DECIM_FIR, 3, 0, 12 },
+    { DECIM_FIR, 16, 0, 96 }, { DECIM_FIR, 32, 0, 128 },
+  };
+  static const Decim_ConfigTypeDef invalid[] =
+  {
+    { DECIM_CIC, 1, 3, 0 }, { DECIM_CIC, 65, 1, 0 }, { DECIM_CIC, 8, 5, 0 },
+    { DECIM_FIR, 8, 0, 15 }, { DECIM_FIR, 8, 0, 130 }, { (Decim_KindTypeDef)3, 8, 1, 8 },
+  };
+  const uint32_t n = 20000;
+  int32_t *walk = malloc(n * sizeof(*walk)), *turns = malloc(n * sizeof(*turns));
+  static AS5600Sim_TypeDef sim;
+  AS5600Sim_ConfigTypeDef sc = { .n_seg = 2, .loop = 1, .field_mt = 60.0, .noise_scale = 1.0, .seed = 3 };
+  uint64_t rng = 99;
+  static Decim_TypeDef d;
+  uint16_t prev;
+
+  if (!walk || !turns) return 1;
+  /* random walk with occasional large steps, far from zero */
+  walk[0] = -3000000;
+  for (uint32_t i = 1; i < n; i++) walk[i] = walk[i - 1] + (int32_t)lround(Gauss(&rng) * ((i % 97U) ? 4.0 : 300.0));
+  /* simulated shaft at up to 3000 rpm, unwrapped */
+  sc.seg[0] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_RAMP, 5.0, 3000.0, 0.0, 0.0 };
+  sc.seg[1] = (AS5600Sim_SegmentTypeDef){ SIM_SEG_CONST, 5.0, -300.0, 2.0, 40.0 };
+  AS5600Sim_Init(&sim, &sc);
+  prev = AS5600Sim_Next(&sim, 1e-3);
+  turns[0] = prev;
+  for (uint32_t i = 1; i < n; i++)
+  {
+    uint16_t raw = AS5600Sim_Next(&sim, 1e-3);
+
+    turns[i] = turns[i - 1] + (((int32_t)raw - prev + 2048) & 0x0FFF) - 2048;
+    prev = raw;
+  }
+
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    Check(Decim_Init(&d, &invalid[i]) != 0, "rejected", &invalid[i], "");
+  for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+  {
+    TestBitExact(&configs[i], walk, n, "random walk");
+    TestBitExact(&configs[i], turns, n, "simulated shaft");
+    TestResponse(&configs[i]);
+    TestResolution(&configs[i]);
+  }
+  free(walk);
+  free(turns);
+  printf("%d failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * dlog_decode - host side expander of the deferred log records (debug.h)
+ *
+ *   cc -O2 -o dlog_decode dlog_decode.c
+ *   dlog_decode firmware.elf [capture.bin | /dev/ttyACM0]
+ *
+ * The metadata strings are read from the ".dlog" section of the firmware ELF
+ * (32 or 64-bit, little endian). The stream is read from the given file or
+ * from stdin. Bytes that do not form a valid record, such as the text
+ * telemetry sharing the UART, are copied to stdout unchanged.
+ */
+
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DLOG_SYNC      0xA5U
+#define DLOG_MAX_ARGS  4U
+#define DLOG_HDR_LEN   10U
+
+static const char *level_names[] = { "---", "ERR", "WRN", "INF", "DBG" };
+
+static char    *meta;       /* content of .dlog */
+static uint32_t meta_len;
+static uint32_t meta_addr;  /* link address of .dlog, 0 on target */
+
+static uint8_t *load_file(const char *path, size_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *buf;
+  long n;
+
+  if (f == NULL) return NULL;
+  fseek(f, 0, SEEK_END);
+  n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  buf = malloc((size_t)n);
+  if (buf == NULL || fread(buf, 1, (size_t)n, f) != (size_t)n)
+  {
+    fclose(f);
+    free(buf);
+    return NULL;
+  }
+  fclose(f);
+  *len = (size_t)n;
+  return buf;
+}
+
+static int load_meta(const char *elf_path)
+{
+  size_t len;
+  uint8_t *elf = load_file(elf_path, &len);
+  uint64_t shoff, off = 0, size = 0, addr = 0;
+  unsigned shnum, shentsize, shstrndx;
+  const char *shstr;
+  int is64;
+
+  if (elf == NULL || len < sizeof(Elf32_Ehdr) || memcmp(elf, ELFMAG, SELFMAG) != 0)
+  {
+    fprintf(stderr, "%s: not an ELF file\n", elf_path);
+    return -1;
+  }
+  is64 = elf[EI_CLASS] == ELFCLASS64;
+  if (is64)
+  {
+    const Elf64_Ehdr *eh = (const Elf64_Ehdr *)elf;
+    shoff = eh->e_shoff; shnum = eh->e_shnum; shentsize = eh->e_shentsize; shstrndx = eh->e_shstrndx;
+  }
+  else
+  {
+    const Elf32_Ehdr *eh = (const Elf32_Ehdr *)elf;
+    shoff = eh->e_shoff; shnum = eh->e_shnum; shentsize = eh->e_shentsize; shstrndx = eh->e_shstrndx;
+  }
+
+#define SHDR_FIELD(i, field) (is64 ? (uint64_t)((const Elf64_Shdr *)(elf + shoff + (uint64_t)(i) * shentsize))->field \
+                                   : (uint64_t)((const Elf32_Shdr *)(elf + shoff + (uint64_t)(i) * shentsize))->field)
+  if (shoff + (uint64_t)shnum * shentsize > len || shstrndx >= shnum)
+  {
+    fprintf(stderr, "%s: truncated section table\n", elf_path);
+    return -1;
+  }
+  shstr = (const char *)elf + SHDR_FIELD(shstrndx, sh_offset);
+  for (unsigned i = 0; i < shnum; i++)
+  {
+    if (strcmp(shstr + SHDR_FIELD(i, sh_name), ".dlog") == 0)
+    {
+      off = SHDR_FIELD(i, sh_offset);
+      size = SHDR_FIELD(i, sh_size);
+      addr = SHDR_FIELD(i, sh_addr);
+      break;
+    }
+  }
+#undef SHDR_FIELD
+
+  if (size == 0 || off + size > len)
+  {
+    fprintf(stderr, "%s: no .dlog section\n", elf_path);
+    return -1;
+  }
+  meta = malloc(size + 1);
+  memcpy(meta, elf + off, size);
+  meta[size] = '\0';
+  meta_len = (uint32_t)size;
+  meta_addr = (uint32_t)addr;
+  free(elf);
+  return 0;
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* metadata entry for a record id, NULL if the id cannot be one */
+static const char *lookup(uint32_t id)
+{
+  uint32_t off = id - meta_addr;
+
+  if (off + 8U >= meta_len) return NULL;
+  if (off > 0 && meta[off - 1] != '\0') return NULL;
+  if (meta[off] < '1' || meta[off] > '4' || meta[off + 1] != '\x1f') return NULL;
+  return meta + off;
+}
+
+/* printf-like expansion with 32-bit arguments */
+static void expand(const char *fmt, const uint32_t *args, unsigned nargs)
+{
+  unsigned a = 0;
+
+  while (*fmt)
+  {
+    char spec[32];
+    size_t n = 0;
+
+    if (*fmt != '%')
+    {
+      putchar(*fmt++);
+      continue;
+    }
+    if (fmt[1] == '%')
+    {
+      putchar('%');
+      fmt += 2;
+      continue;
+    }
+    spec[n++] = *fmt++;
+    while (*fmt && strchr("-+ #0123456789.", *fmt) && n < sizeof(spec) - 4) spec[n++] = *fmt++;
+    while (*fmt && strchr("lzjtL", *fmt)) fmt++;   /* arguments are 32-bit */
+    while (*fmt == 'h') spec[n++] = *fmt++;
+    if (*fmt == '\0') break;
+    spec[n++] = *fmt;
+    spec[n] = '\0';
+
+    uint32_t v = (a < nargs) ? args[a++] : 0U;
+    switch (*fmt++)
+    {
+      case 'd': case 'i':
+        printf(spec, (int32_t)v);
+        break;
+      case 'u': case 'x': case 'X': case 'o': case 'c':
+        printf(spec, v);
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      {
+        union { uint32_t u; float f; } c = { v };
+        printf(spec, (double)c.f);
+        break;
+      }
+      case 'p':
+        printf("0x%08x", v);
+        break;
+      case 's':
+        printf("<str@0x%08x>", v);
+        break;
+      default:
+        fputs(spec, stdout);
+        break;
+    }
+  }
+}
+
+static void print_record(const char *entry, uint32_t tick, const uint32_t *args, unsigned nargs)
+{
+  const char *file = strchr(entry, '\x1f') + 1;
+  const char *line = strchr(file, '\x1f') + 1;
+  const char *fmt = strchr(line, '\x1f') + 1;
+  const char *base = file;
+
+  /* strip directories left when the compiler had no __FILE_NAME__ */
+  for (const char *p = file; p < line; p++)
+  {
+    if (*p == '/' || *p == '\\') base = p + 1;
+  }
+  printf("[%10.3f][%s][%.*s:%.*s] ", tick / 1000.0, level_names[entry[0] - '0'],
+         (int)(line - 1 - base), base, (int)(fmt - 1 - line), line);
+  expand(fmt, args, nargs);
+}
+
+int main(int argc, char **argv)
+{
+  static uint8_t buf[4096];
+  size_t len = 0;
+  FILE *in = stdin;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s firmware.elf [stream]\n", argv[0]);
+    return 2;
+  }
+  if (load_meta(argv[1]) != 0) return 1;
+  if (argc > 2 && (in = fopen(argv[2], "rb")) == NULL)
+  {
+    perror(argv[2]);
+    return 1;
+  }
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  for (;;)
+  {
+    size_t got = fread(buf + len, 1, sizeof(buf) - len, in);
+    size_t pos = 0;
+    int eof = got == 0;
+
+    len += got;
+    while (pos < len)
+    {
+      uint32_t args[DLOG_MAX_ARGS];
+      const char *entry;
+      unsigned nargs;
+
+      if (buf[pos] != DLOG_SYNC)
+      {
+        putchar(buf[pos++]);
+        continue;
+      }
+      if (len - pos < DLOG_HDR_LEN && !eof) break;   /* wait for the header */
+      nargs = (len - pos >= 2) ? buf[pos + 1] : 0xFFU;
+      entry = (nargs <= DLOG_MAX_ARGS && len - pos >= DLOG_HDR_LEN) ? lookup(rd32(buf + pos + 2)) : NULL;
+      if (entry == NULL)
+      {
+        putchar(buf[pos++]);
+        continue;
+      }
+      if (len - pos < DLOG_HDR_LEN + 4U * nargs)
+      {
+        if (!eof) break;                             /* wait for the arguments */
+        putchar(buf[pos++]);
+        continue;
+      }
+      for (unsigned i = 0; i < nargs; i++) args[i] = rd32(buf + pos + DLOG_HDR_LEN + 4U * i);
+      print_record(entry, rd32(buf + pos + 6), args, nargs);
+      pos += DLOG_HDR_LEN + 4U * nargs;
+    }
+    memmove(buf, buf + pos, len - pos);
+    len -= pos;
+    if (eof) break;
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * stream_decode - host side expander of the compressed sample stream
+ *                 (STREAM frames, Core/Inc/stream.h)
+ *
+ *   cc -O2 -o stream_decode stream_decode.c
+ *   stream_decode [capture.bin | /dev/ttyACM0] > samples.csv
+ *
+ * The stream is read from the given file or from stdin and every sample is
+ * written as "sequence,raw" to stdout. Missing sequence numbers (frames
+ * dropped by the firmware or lost on the line) are reported as comment
+ * lines. Other frames and text sharing the UART are skipped. A summary
+ * goes to stderr.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FRAME_SYNC     0x5AU
+#define FRAME_STREAM   0x07U
+#define MAX_PAYLOAD    64U
+#define STREAM_HDR_LEN 6U
+
+static uint64_t samples, frames, bad_frames, lost, wire_bytes;
+static uint32_t next_seq;
+static int have_seq;
+
+static void decode(const uint8_t *p, uint8_t len)
+{
+  uint32_t seq, i = STREAM_HDR_LEN;
+  int32_t d = 0;
+  uint16_t v;
+
+  if (len < STREAM_HDR_LEN || (p[5] & 0xF0U))
+  {
+    bad_frames++;
+    return;
+  }
+  seq = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  if (have_seq && seq != next_seq)
+  {
+    printf("# gap %u..%u\n", next_seq, seq - 1U);
+    lost += seq - next_seq;
+  }
+  v = (uint16_t)(p[4] | (p[5] << 8));
+  printf("%u,%u\n", seq++, v);
+  samples++;
+
+  while (i < len)
+  {
+    uint32_t zz = p[i] & 0x7FU;
+
+    if (p[i++] & 0x80U)
+    {
+      if (i == len) break;
+      zz |= (uint32_t)p[i++] << 7;
+    }
+    /* prediction error against previous sample plus last difference */
+    d = (int32_t)(((uint32_t)d + ((zz >> 1) ^ (0U - (zz & 1U))) + 2048U) & 0x0FFFU) - 2048;
+    v = (uint16_t)((v + (uint32_t)d) & 0x0FFFU);
+    printf("%u,%u\n", seq++, v);
+    samples++;
+  }
+  next_seq = seq;
+  have_seq = 1;
+  frames++;
+  wire_bytes += len + 4U;
+}
+
+int main(int argc, char **argv)
+{
+  static uint8_t buf[4096];
+  size_t len = 0;
+  FILE *in = stdin;
+
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+  {
+    fprintf(stderr, "usage: %s [stream]\n", argv[0]);
+    return 2;
+  }
+  if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  for (;;)
+  {
+    size_t got = fread(buf + len, 1, sizeof(buf) - len, in);
+    size_t pos = 0;
+    int eof = got == 0;
+
+    len += got;
+    while (pos < len)
+    {
+      uint8_t flen, sum = 0;
+
+      if (buf[pos] != FRAME_SYNC)
+      {
+        pos++;
+        continue;
+      }
+      if (len - pos < 3U && !eof) break;             /* wait for the header */
+      flen = (len - pos >= 3U) ? buf[pos + 2] : 0xFFU;
+      if (flen > MAX_PAYLOAD)
+      {
+        pos++;
+        continue;
+      }
+      if (len - pos < flen + 4U)
+      {
+        if (!eof) break;                             /* wait for the payload */
+        pos++;
+        continue;
+      }
+      for (unsigned k = 1; k < flen + 4U; k++) sum += buf[pos + k];
+      if (sum != 0)
+      {
+        pos++;
+        continue;
+      }
+      if (buf[pos + 1] == FRAME_STREAM) decode(&buf[pos + 3], flen);
+      pos += flen + 4U;
+    }
+    memmove(buf, buf + pos, len - pos);
+    len -= pos;
+    if (eof) break;
+  }
+
+  fprintf(stderr, "%llu samples in %llu frames, %.2f bytes/sample on the wire, %llu lost, %llu bad frames\n",
+          (unsigned long long)samples, (unsigned long long)frames,
+          samples ? (double)wire_bytes / (double)samples : 0.0,
+          (unsigned long long)lost, (unsigned long long)bad_frames);
+  return 0;
+}